@@ -23,6 +23,15 @@
 #include "../JuceHeaderAudio.h"
 #pragma warning( disable : 4244 )
 
+#if defined (__AVX__)
+    #include <immintrin.h>
+#elif defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define LGML_SSE_RAMP 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    #include <arm_neon.h>
+#endif
+
 // type to use for clock
 // can't be unsigned to allow negative countdowns
 typedef int sample_clk_t;
@@ -53,6 +62,270 @@ inline float rmsToDB_6dBHR (float rms)
 }
 
 
+// dest[i] += src[i] * (startGain + i * increment), vectorized when available
+inline void addWithGainRamp (float* dest, const float* src, int numSamples, float startGain, float increment)
+{
+    if (increment == 0)
+    {
+        FloatVectorOperations::addWithMultiply (dest, src, startGain, numSamples);
+        return;
+    }
+
+    int i = 0;
+#if defined (__AVX__)
+    const __m256 start = _mm256_set1_ps (startGain);
+    const __m256 inc = _mm256_set1_ps (increment);
+    const __m256 step = _mm256_set1_ps (8.0f);
+    __m256 idx = _mm256_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    for (; i + 8 <= numSamples ; i += 8)
+    {
+   #if defined (__FMA__)
+        const __m256 gain = _mm256_fmadd_ps (idx, inc, start);
+        _mm256_storeu_ps (dest + i, _mm256_fmadd_ps (_mm256_loadu_ps (src + i), gain, _mm256_loadu_ps (dest + i)));
+   #else
+        const __m256 gain = _mm256_add_ps (start, _mm256_mul_ps (idx, inc));
+        _mm256_storeu_ps (dest + i, _mm256_add_ps (_mm256_loadu_ps (dest + i), _mm256_mul_ps (_mm256_loadu_ps (src + i), gain)));
+   #endif
+        idx = _mm256_add_ps (idx, step);
+    }
+
+#elif LGML_SSE_RAMP
+    const __m128 start = _mm_set1_ps (startGain);
+    const __m128 inc = _mm_set1_ps (increment);
+    const __m128 step = _mm_set1_ps (4.0f);
+    __m128 idx = _mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f);
+
+    for (; i + 4 <= numSamples ; i += 4)
+    {
+        const __m128 gain = _mm_add_ps (start, _mm_mul_ps (idx, inc));
+        _mm_storeu_ps (dest + i, _mm_add_ps (_mm_loadu_ps (dest + i), _mm_mul_ps (_mm_loadu_ps (src + i), gain)));
+        idx = _mm_add_ps (idx, step);
+    }
+
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    const float32x4_t start = vdupq_n_f32 (startGain);
+    const float32x4_t step = vdupq_n_f32 (4.0f);
+    const float idxInit[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t idx = vld1q_f32 (idxInit);
+
+    for (; i + 4 <= numSamples ; i += 4)
+    {
+        const float32x4_t gain = vmlaq_n_f32 (start, idx, increment);
+        vst1q_f32 (dest + i, vmlaq_f32 (vld1q_f32 (dest + i), vld1q_f32 (src + i), gain));
+        idx = vaddq_f32 (idx, step);
+    }
+
+#endif
+
+    for (; i < numSamples ; i++) {dest[i] += src[i] * (startGain + i * increment);}
+}
+
+
+// number of sources mixed by one pass of mixWithGainRamps
+constexpr int maxFusedGainSources = 4;
+
+#if defined (__AVX__)
+inline __m256 mulAdd (__m256 a, __m256 b, __m256 c)
+{
+   #if defined (__FMA__)
+    return _mm256_fmadd_ps (a, b, c);
+   #else
+    return _mm256_add_ps (c, _mm256_mul_ps (a, b));
+   #endif
+}
+#endif
+
+// dest[i] = (accumulate ? dest[i] : 0) + sum of srcs[k][i] * (startGains[k] + i * increments[k])
+// up to maxFusedGainSources sources are mixed in a single pass over dest, gains are not ramped if all increments are null
+inline void mixWithGainRamps (float* dest, const float* const* srcs, const float* startGains, const float* increments,
+                              int numSrcs, int numSamples, bool accumulate)
+{
+    jassert (numSrcs > 0 && numSrcs <= maxFusedGainSources);
+    bool ramped = false;
+
+    for (int k = 0 ; k < numSrcs ; k++) {ramped |= increments[k] != 0;}
+
+    int i = 0;
+#if defined (__AVX__)
+    __m256 start[maxFusedGainSources], inc[maxFusedGainSources];
+
+    for (int k = 0 ; k < numSrcs ; k++)
+    {
+        start[k] = _mm256_set1_ps (startGains[k]);
+        inc[k] = _mm256_set1_ps (increments[k]);
+    }
+
+    const __m256 step = _mm256_set1_ps (8.0f);
+    __m256 idx = _mm256_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    for (; i + 8 <= numSamples ; i += 8)
+    {
+        __m256 acc = accumulate ? _mm256_loadu_ps (dest + i) : _mm256_setzero_ps();
+
+        for (int k = 0 ; k < numSrcs ; k++)
+        {
+            const __m256 gain = ramped ? mulAdd (idx, inc[k], start[k]) : start[k];
+            acc = mulAdd (_mm256_loadu_ps (srcs[k] + i), gain, acc);
+        }
+
+        _mm256_storeu_ps (dest + i, acc);
+        idx = _mm256_add_ps (idx, step);
+    }
+
+#elif LGML_SSE_RAMP
+    __m128 start[maxFusedGainSources], inc[maxFusedGainSources];
+
+    for (int k = 0 ; k < numSrcs ; k++)
+    {
+        start[k] = _mm_set1_ps (startGains[k]);
+        inc[k] = _mm_set1_ps (increments[k]);
+    }
+
+    const __m128 step = _mm_set1_ps (4.0f);
+    __m128 idx = _mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f);
+
+    for (; i + 4 <= numSamples ; i += 4)
+    {
+        __m128 acc = accumulate ? _mm_loadu_ps (dest + i) : _mm_setzero_ps();
+
+        for (int k = 0 ; k < numSrcs ; k++)
+        {
+            const __m128 gain = ramped ? _mm_add_ps (start[k], _mm_mul_ps (idx, inc[k])) : start[k];
+            acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (srcs[k] + i), gain));
+        }
+
+        _mm_storeu_ps (dest + i, acc);
+        idx = _mm_add_ps (idx, step);
+    }
+
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    float32x4_t start[maxFusedGainSources];
+
+    for (int k = 0 ; k < numSrcs ; k++) {start[k] = vdupq_n_f32 (startGains[k]);}
+
+    const float32x4_t step = vdupq_n_f32 (4.0f);
+    const float idxInit[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t idx = vld1q_f32 (idxInit);
+
+    for (; i + 4 <= numSamples ; i += 4)
+    {
+        float32x4_t acc = accumulate ? vld1q_f32 (dest + i) : vdupq_n_f32 (0);
+
+        for (int k = 0 ; k < numSrcs ; k++)
+        {
+            const float32x4_t gain = ramped ? vmlaq_n_f32 (start[k], idx, increments[k]) : start[k];
+            acc = vmlaq_f32 (acc, vld1q_f32 (srcs[k] + i), gain);
+        }
+
+        vst1q_f32 (dest + i, acc);
+        idx = vaddq_f32 (idx, step);
+    }
+
+#endif
+
+    for (; i < numSamples ; i++)
+    {
+        float acc = accumulate ? dest[i] : 0.0f;
+
+        for (int k = 0 ; k < numSrcs ; k++) {acc += srcs[k][i] * (startGains[k] + i * increments[k]);}
+
+        dest[i] = acc;
+    }
+}
+
+
+// sum of squares and absolute peak of src in one pass
+inline void sumSquaresAndPeak (const float* src, int numSamples, float& sumSquares, float& peak)
+{
+    int i = 0;
+    float s = 0, p = 0;
+#if defined (__AVX__)
+    const __m256 absMask = _mm256_castsi256_ps (_mm256_set1_epi32 (0x7fffffff));
+    __m256 vs = _mm256_setzero_ps();
+    __m256 vp = _mm256_setzero_ps();
+
+    for (; i + 8 <= numSamples ; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps (src + i);
+   #if defined (__FMA__)
+        vs = _mm256_fmadd_ps (x, x, vs);
+   #else
+        vs = _mm256_add_ps (vs, _mm256_mul_ps (x, x));
+   #endif
+        vp = _mm256_max_ps (vp, _mm256_and_ps (x, absMask));
+    }
+
+    float ts[8], tp[8];
+    _mm256_storeu_ps (ts, vs);
+    _mm256_storeu_ps (tp, vp);
+
+    for (int j = 0 ; j < 8 ; j++) {s += ts[j]; p = jmax (p, tp[j]);}
+
+#elif LGML_SSE_RAMP
+    __m128 vs = _mm_setzero_ps();
+    __m128 vp = _mm_setzero_ps();
+
+    for (; i + 4 <= numSamples ; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps (src + i);
+        vs = _mm_add_ps (vs, _mm_mul_ps (x, x));
+        // |x| as max (x, -x), sse1 has no integer casts
+        vp = _mm_max_ps (vp, _mm_max_ps (x, _mm_sub_ps (_mm_setzero_ps(), x)));
+    }
+
+    float ts[4], tp[4];
+    _mm_storeu_ps (ts, vs);
+    _mm_storeu_ps (tp, vp);
+
+    for (int j = 0 ; j < 4 ; j++) {s += ts[j]; p = jmax (p, tp[j]);}
+
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    float32x4_t vs = vdupq_n_f32 (0);
+    float32x4_t vp = vdupq_n_f32 (0);
+
+    for (; i + 4 <= numSamples ; i += 4)
+    {
+        const float32x4_t x = vld1q_f32 (src + i);
+        vs = vmlaq_f32 (vs, x, x);
+        vp = vmaxq_f32 (vp, vabsq_f32 (x));
+    }
+
+    float ts[4], tp[4];
+    vst1q_f32 (ts, vs);
+    vst1q_f32 (tp, vp);
+
+    for (int j = 0 ; j < 4 ; j++) {s += ts[j]; p = jmax (p, tp[j]);}
+
+#endif
+
+    for (; i < numSamples ; i++)
+    {
+        s += src[i] * src[i];
+        p = jmax (p, fabsf (src[i]));
+    }
+
+    sumSquares = s;
+    peak = p;
+}
+
+
+// true if the first numChannels channels only hold digital silence
+inline bool isBufferSilent (const AudioBuffer<float>& b, int numChannels, int numSamples)
+{
+    if (b.hasBeenCleared()) return true;
+
+    for (int i = 0 ; i < jmin (numChannels, b.getNumChannels()) ; i++)
+    {
+        const Range<float> r = FloatVectorOperations::findMinAndMax (b.getReadPointer (i), numSamples);
+
+        if (r.getStart() != 0 || r.getEnd() != 0) return false;
+    }
+
+    return true;
+}
+
+
 // helper for handling sample level fading in and out, autoCrossFade relaunches a fadeIn whenFadeOutEnds
 class FadeInOut
 {
@@ -187,99 +460,4 @@ public:
 
 
 
-inline void updateRMS (const AudioBuffer<float>& buffer,
-                       float& targetRmsValue,
-                       Array<float>& targetRMSChannelValues,
-                       int numChannels,
-                       bool skipChannelComputation = true)
-{
-    int numSamples = buffer.getNumSamples();
-
-    if (targetRMSChannelValues.size() != numChannels)
-    {
-        int oldSize = targetRMSChannelValues.size();
-        targetRMSChannelValues.resize (numChannels);
-
-        for (int i = oldSize ; i < numChannels ; i++)
-        {
-            targetRMSChannelValues.set (i, 0);
-        }
-
-    }
-
-    // faster implementation taken from juce Device Settings input meter
-
-    float globalS = 0;
-
-    // @ben we need that (window of 64 sample cannot describe any accurate RMS level alone thus decay factor)
-    const double decayFactor = 0.9;
-    const float lowThresh = 0.0001f;
-    const int downSample = 2;
-    const float factor = .9 * downSample * 1.0 / numSamples;
-
-    if (buffer.hasBeenCleared())
-    {
-        globalS = 0;
-    }
-    else
-    {
-        if (skipChannelComputation)
-        {
-            for (int i = numChannels - 1; i >= 0; --i)
-            {
-                // this is very intensive so aproximate RMS by max value
-
-                int n = numSamples;
-                float s = 0;
-
-                while (n -= downSample)
-                    s += fabsf (buffer.getSample (i, n));
-
-                globalS = jmax (globalS, s * factor);
-
-                //      globalS = jmax(globalS,buffer.getMagnitude(i, 0,numSamples)*.7f);
-
-                //      globalS = jmax(globalS,FloatVectorOperations::findMaximum(buffer.getReadPointer(i), numSamples))*.7f;
-            }
-        }
-        else
-        {
-
-            for (int i = numChannels - 1; i >= 0; --i)
-            {
-                int n = numSamples;
-                float s = 0;
-
-                while (n -= downSample)
-                    s += fabsf (buffer.getSample (i, n));
-
-                s *= factor;
-                //      s/=numSamples
-                //      float s =  buffer.getMagnitude(i, 0,numSamples)*.7f;
-                //      float s = FloatVectorOperations::findMaximum(buffer.getReadPointer(i), numSamples)*.7f;
-                targetRMSChannelValues.set (i, (s > targetRMSChannelValues.getReference (i)) ? s :
-                                            s > lowThresh ? targetRMSChannelValues.getReference (i) * (float)decayFactor :
-                                            0);
-
-                globalS = jmax (s, globalS);
-            }
-        }
-
-    }
-
-    if (globalS > targetRmsValue)
-        targetRmsValue = globalS;
-    else if (targetRmsValue > lowThresh)
-        targetRmsValue *= (float)decayFactor;
-    else
-        targetRmsValue = 0;
-
-
-
-
-}
-
-
-
-
 #endif  // AUDIOHELPERS_H_INCLUDED
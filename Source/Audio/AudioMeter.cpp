@@ -0,0 +1,266 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#include "AudioMeter.h"
+
+namespace
+{
+    // same ballistics as the former updateRMS
+    const float decayFactor = 0.9f;
+    const float lowThresh = 0.0001f;
+
+    inline float decayed (float newValue, float oldValue)
+    {
+        return jmax (newValue, oldValue > lowThresh ? oldValue * decayFactor : 0.0f);
+    }
+}
+
+
+AudioMeter::AudioMeter (int _integrationSamples):
+    integrationSamples (jmax (1, _integrationSamples)),
+    numConsumers (0),
+    truePeakEnabled (0),
+    isActive (false),
+    numChannels (0),
+    numAccumulated (0)
+{
+    // windowed sinc for fractional positions 1/4, 2/4, 3/4 between x[3] and x[4] of 8 taps
+    for (int p = 0 ; p < 3 ; p++)
+    {
+        const double frac = (p + 1) / 4.0;
+        double sum = 0;
+
+        for (int t = 0 ; t < numTaps ; t++)
+        {
+            const double x = frac - (t - (historySize / 2));
+            const double sinc = x == 0 ? 1.0 : std::sin (double_Pi * x) / (double_Pi * x);
+            const double window = 0.5 * (1.0 + std::cos (double_Pi * x / (numTaps / 2)));
+            interpolator[p][t] = (float) (sinc * window);
+            sum += sinc * window;
+        }
+
+        for (int t = 0 ; t < numTaps ; t++) {interpolator[p][t] = (float) (interpolator[p][t] / sum);}
+    }
+
+    reset();
+}
+
+
+void AudioMeter::reset()
+{
+    numAccumulated = 0;
+    zeromem (accSumSquares, sizeof (accSumSquares));
+    zeromem (accPeak, sizeof (accPeak));
+    zeromem (accTruePeak, sizeof (accTruePeak));
+    zeromem (history, sizeof (history));
+
+    sequence += 1;
+
+    for (int i = 0 ; i < maxChannels ; i++)
+    {
+        rms[i] = 0;
+        peak[i] = 0;
+        truePeak[i] = 0;
+    }
+
+    globalLevel = 0;
+    sequence += 1;
+}
+
+
+void AudioMeter::process (const AudioBuffer<float>& buffer, int _numChannels)
+{
+    if (numConsumers.get() <= 0)
+    {
+        // start clean when a consumer comes back
+        if (isActive) reset();
+
+        isActive = false;
+        return;
+    }
+
+    isActive = true;
+
+    const int numSamples = buffer.getNumSamples();
+    const bool withTruePeak = truePeakEnabled.get() != 0;
+    _numChannels = jmin (_numChannels, buffer.getNumChannels(), (int) maxChannels);
+
+    if (_numChannels != numChannels)
+    {
+        for (int c = numChannels ; c < _numChannels ; c++)
+        {
+            accSumSquares[c] = accPeak[c] = accTruePeak[c] = 0;
+            zeromem (history[c], sizeof (history[c]));
+        }
+
+        numChannels = _numChannels;
+    }
+
+    if (buffer.hasBeenCleared())
+    {
+        for (int c = 0 ; c < numChannels ; c++) {zeromem (history[c], sizeof (history[c]));}
+    }
+    else
+    {
+        for (int c = 0 ; c < numChannels ; c++)
+        {
+            const float* src = buffer.getReadPointer (c);
+
+            for (int start = 0 ; start < numSamples ; start += chunkSize)
+            {
+                analyse (src + start, jmin ((int) chunkSize, numSamples - start), c, withTruePeak);
+            }
+        }
+    }
+
+    numAccumulated += numSamples;
+
+    if (numAccumulated >= integrationSamples) publish();
+}
+
+
+void AudioMeter::analyse (const float* src, int numSamples, int c, bool withTruePeak)
+{
+    float sumSquares, chunkPeak;
+    sumSquaresAndPeak (src, numSamples, sumSquares, chunkPeak);
+
+    accSumSquares[c] += sumSquares;
+    accPeak[c] = jmax (accPeak[c], chunkPeak);
+
+    // previous samples are needed to interpolate around chunk boundaries
+    memcpy (scratch, history[c], sizeof (history[c]));
+    memcpy (scratch + historySize, src, (size_t) numSamples * sizeof (float));
+
+    const int len = historySize + numSamples;
+    const int firstTap = historySize / 2;
+    float tp = chunkPeak;
+
+    if (withTruePeak && chunkPeak > lowThresh)
+    {
+        // inter-sample overs can only get significant next to loud samples
+        const float candidateThresh = chunkPeak * 0.5f;
+
+        for (int k = firstTap ; k + numTaps - firstTap <= len ; k++)
+        {
+            if (jmax (fabsf (scratch[k]), fabsf (scratch[k + 1])) < candidateThresh) continue;
+
+            const float* x = scratch + k - firstTap;
+
+            for (int p = 0 ; p < 3 ; p++)
+            {
+                float v = 0;
+
+                for (int t = 0 ; t < numTaps ; t++) {v += interpolator[p][t] * x[t];}
+
+                tp = jmax (tp, fabsf (v));
+            }
+        }
+    }
+
+    accTruePeak[c] = jmax (accTruePeak[c], tp);
+    memcpy (history[c], scratch + len - historySize, sizeof (history[c]));
+}
+
+
+void AudioMeter::publish()
+{
+    float global = 0;
+
+    // odd sequence while writing
+    sequence += 1;
+
+    for (int c = 0 ; c < numChannels ; c++)
+    {
+        const float r = std::sqrt (accSumSquares[c] / numAccumulated);
+        rms[c] = decayed (r, rms[c].get());
+        peak[c] = decayed (accPeak[c], peak[c].get());
+        truePeak[c] = decayed (accTruePeak[c], truePeak[c].get());
+        global = jmax (global, r);
+
+        accSumSquares[c] = accPeak[c] = accTruePeak[c] = 0;
+    }
+
+    for (int c = numChannels ; c < numPublishedChannels.get() ; c++)
+    {
+        rms[c] = 0;
+        peak[c] = 0;
+        truePeak[c] = 0;
+    }
+
+    numPublishedChannels = numChannels;
+    globalLevel = decayed (global, globalLevel.get());
+
+    sequence += 1;
+    numAccumulated = 0;
+}
+
+
+bool AudioMeter::getSnapshot (Snapshot& s) const
+{
+    for (int attempt = 0 ; attempt < 4 ; attempt++)
+    {
+        const uint32 before = sequence.get();
+
+        if (before & 1) continue;
+
+        s.numChannels = numPublishedChannels.get();
+        s.globalLevel = globalLevel.get();
+
+        for (int c = 0 ; c < s.numChannels ; c++)
+        {
+            s.rms[c] = rms[c].get();
+            s.peak[c] = peak[c].get();
+            s.truePeak[c] = truePeak[c].get();
+        }
+
+        s.sequence = before;
+
+        if (sequence.get() == before) return true;
+    }
+
+    // every value is still atomic, they may just come from different publications
+    s.numChannels = numPublishedChannels.get();
+    s.globalLevel = globalLevel.get();
+
+    for (int c = 0 ; c < s.numChannels ; c++)
+    {
+        s.rms[c] = rms[c].get();
+        s.peak[c] = peak[c].get();
+        s.truePeak[c] = truePeak[c].get();
+    }
+
+    s.sequence = sequence.get();
+    return false;
+}
+
+
+float AudioMeter::getRMS (int channel) const
+{
+    return isPositiveAndBelow (channel, (int) maxChannels) ? rms[channel].get() : 0;
+}
+
+float AudioMeter::getPeak (int channel) const
+{
+    return isPositiveAndBelow (channel, (int) maxChannels) ? peak[channel].get() : 0;
+}
+
+float AudioMeter::getTruePeak (int channel) const
+{
+    return isPositiveAndBelow (channel, (int) maxChannels) ? truePeak[channel].get() : 0;
+}
@@ -0,0 +1,101 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include "AudioHelpers.h"
+
+/*
+ multichannel peak / rms / true-peak meter
+
+ the audio thread analyses each block in one pass per channel and publishes decayed levels
+ every integration period into a fixed size snapshot guarded by a sequence counter (seqlock),
+ so UI or OSC consumers can poll it from any thread without touching audio memory
+ true-peak is estimated with a 4x polyphase interpolator, only around the loudest samples of a block
+
+ nothing is analysed until a consumer is registered, and true-peak is opt-in (it reads as the sample peak otherwise)
+ */
+class AudioMeter
+{
+public:
+    AudioMeter (int integrationSamples = 512);
+
+    static const int maxChannels = 64;
+
+    struct Snapshot
+    {
+        int numChannels;
+        float globalLevel;
+        float rms[maxChannels];
+        float peak[maxChannels];
+        float truePeak[maxChannels];
+        uint32 sequence;
+    };
+
+    // any thread, levels are only computed while at least one consumer is registered
+    void addConsumer() {++numConsumers;}
+    void removeConsumer() {--numConsumers;}
+    bool hasConsumers() const {return numConsumers.get() > 0;}
+    void setTruePeakEnabled (bool b) {truePeakEnabled = b ? 1 : 0;}
+
+    // audio thread
+    void process (const AudioBuffer<float>& buffer, int numChannels);
+    void reset();
+
+    // any thread, returns false if a consistent snapshot could not be read (values are still usable)
+    bool getSnapshot (Snapshot& s) const;
+    float getGlobalLevel() const {return globalLevel.get();}
+    float getRMS (int channel) const;
+    float getPeak (int channel) const;
+    float getTruePeak (int channel) const;
+    int getNumChannels() const {return numPublishedChannels.get();}
+    uint32 getSequence() const {return sequence.get();}
+
+private:
+    void analyse (const float* src, int numSamples, int channel, bool withTruePeak);
+    void publish();
+
+    static const int numTaps = 8;
+    static const int historySize = numTaps - 1;
+    static const int chunkSize = 256;
+    float interpolator[3][numTaps];
+
+    const int integrationSamples;
+
+    Atomic<int> numConsumers;
+    Atomic<int> truePeakEnabled;
+
+    // audio thread state
+    bool isActive;
+    int numChannels;
+    int numAccumulated;
+    float accSumSquares[maxChannels];
+    float accPeak[maxChannels];
+    float accTruePeak[maxChannels];
+    float history[maxChannels][historySize];
+    float scratch[historySize + chunkSize];
+
+    // published state
+    Atomic<uint32> sequence;
+    Atomic<int> numPublishedChannels;
+    Atomic<float> globalLevel;
+    Atomic<float> rms[maxChannels];
+    Atomic<float> peak[maxChannels];
+    Atomic<float> truePeak[maxChannels];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioMeter)
+};
@@ -17,54 +17,145 @@
  */
 
 #include "BufferBlockList.h"
+#include "BufferBlockStore.h"
+#include "AudioHelpers.h"
 
 
+ScratchBlock::ScratchBlock (const File& _file, int _numChannels, int _numSamples):
+    numChannels (_numChannels),
+    numSamples (_numSamples),
+    file (_file)
+{
+    const int64 numBytes = (int64) numChannels * numSamples * (int64) sizeof (float);
+    file.getParentDirectory().createDirectory();
+
+    {
+        // sparse file of the right size, reads as zeros
+        FileOutputStream out (file);
+
+        if (out.failedToOpen() || !out.setPosition (numBytes) || out.truncate().failed()) return;
+    }
+
+    map = new MemoryMappedFile (file, Range<int64> (0, numBytes), MemoryMappedFile::readWrite);
+}
 
-BufferBlockList::BufferBlockList (int _numChannels, int  _minNumSample, int _blockSize): bufferBlockSize (_blockSize), minNumSample (_minNumSample)
+ScratchBlock::~ScratchBlock()
 {
-    jassert (bufferBlockSize > 0);
-    allocateSamples (_numChannels, minNumSample);
+    map = nullptr;
+    file.deleteFile();
+}
 
+float* ScratchBlock::getChannel (int c) const
+{
+    jassert (isValid() && c < numChannels);
+    return static_cast<float*> (map->getData()) + (size_t) c * (size_t) numSamples;
 }
 
-void BufferBlockList::allocateSamples (int numChannels, int numSamples)
+void ScratchBlock::touch (int startSample, int num, bool forWriting) const
 {
-    jassert (numChannels > 0);
+    const int samplesPerPage = 4096 / (int) sizeof (float);
 
-    //  jassert(numSamples>0);
-    if (getAllocatedNumChannels() != numChannels)
+    for (int c = 0 ; c < numChannels ; c++)
     {
-        for (int i = 0 ; i < size() ; i++)
+        volatile float* d = getChannel (c);
+
+        for (int i = startSample ; i < startSample + num ; i += samplesPerPage)
         {
-            OwnedArray::getUnchecked (i)->setSize (numChannels, bufferBlockSize);
+            if (forWriting) d[i] = 0;
+            else (void) d[i];
         }
     }
+}
 
-    int i = size() * bufferBlockSize;
 
+AudioBlock::AudioBlock (int numChannels, int numSamples):
+    buffer (numChannels, numSamples),
+    lastWriteTime (Time::getMillisecondCounter()),
+    numWrites (0)
+{
+}
+
+AudioBlock::AudioBlock (ScratchBlock* _scratch):
+    scratch (_scratch),
+    lastWriteTime (Time::getMillisecondCounter()),
+    numWrites (0)
+{
+    HeapBlock<float*> channels ((size_t) scratch->numChannels);
+
+    for (int c = 0 ; c < scratch->numChannels ; c++) {channels[c] = scratch->getChannel (c);}
+
+    buffer.setDataToReferTo (channels.getData(), scratch->numChannels, scratch->numSamples);
+}
+
+
+BufferBlockList::BufferBlockList (int _numChannels, int  _minNumSample, int _blockSize): bufferBlockSize (_blockSize), minNumSample (_minNumSample), writeGeneration (new WriteGeneration())
+{
+    jassert (bufferBlockSize > 0);
+    targetNumSamples = 0;
+    blockStore = nullptr;
+    accessIsWrite = 0;
+    allocateSamples (_numChannels, minNumSample);
+
+}
+
+BufferBlockList::~BufferBlockList()
+{
+    setBlockStore (nullptr);
+}
+
+void BufferBlockList::setBlockStore (BufferBlockStore* store)
+{
+    if (blockStore == store) return;
+
+    if (blockStore) blockStore->removeBlockList (this);
+
+    blockStore = store;
+
+    if (blockStore) blockStore->addBlockList (this);
+}
+
+void BufferBlockList::allocateSamples (int numChannels, int numSamples)
+{
+    jassert (numChannels > 0);
+
+    // spilled blocks get reallocated in RAM here
+    if (getAllocatedNumChannels() != numChannels) setNumChannels (numChannels);
+
+    //  jassert(numSamples>0);
     numSamples = jmax (numSamples, minNumSample);
+    const int numBlocks = numSamples / bufferBlockSize + 1;
 
-    while (i <= numSamples)
-    {
-        add (new AudioSampleBuffer (numChannels, bufferBlockSize));
-        i += bufferBlockSize;
-    }
+    // allocations and frees are done out of the lock
+    ReferenceCountedArray<AudioBlock> changed;
 
-    while (i > numSamples + bufferBlockSize)
-    {
-        removeLast();
-        i -= bufferBlockSize;
+    for (int i = size() ; i < numBlocks ; i++) {changed.add (new AudioBlock (numChannels, bufferBlockSize));}
 
-    }
+    const SpinLock::ScopedLockType lk (blockLock);
 
+    for (auto* b : changed) {blocks.add (b);}
+
+    changed.clearQuick();
+
+    while (blocks.size() > numBlocks)
+    {
+        changed.add (blocks.getObjectPointerUnchecked (blocks.size() - 1));
+        blocks.removeLast();
+    }
 }
 
 void BufferBlockList::setNumChannels (int numChannels)
 {
-    for (auto c : *this)
+    // blocks are replaced rather than resized, other threads may still be reading the old ones
+    ReferenceCountedArray<AudioBlock> newBlocks;
+
+    for (int i = 0 ; i < size() ; i++) {newBlocks.add (new AudioBlock (numChannels, bufferBlockSize));}
+
     {
-        c->setSize (numChannels, bufferBlockSize);
+        const SpinLock::ScopedLockType lk (blockLock);
+        blocks.swapWith (newBlocks);
     }
+
+    ++writeGeneration->value;
 }
 void BufferBlockList::setNumSample (int numSamples)
 {
@@ -81,12 +172,13 @@ int BufferBlockList::getAllocatedNumSample()const
 }
 int BufferBlockList::getAllocatedNumChannels()const
 {
-    return size() > 0 ? OwnedArray::getFirst()->getNumChannels() : 0;
+    return size() > 0 ? blocks.getObjectPointerUnchecked (0)->buffer.getNumChannels() : 0;
 }
 void BufferBlockList::copyTo (AudioSampleBuffer& outBuf, int listStartSample, int bufStartSample, int numSampleToCopy)
 {
     if (numSampleToCopy == -1) numSampleToCopy = outBuf.getNumSamples();
 
+    const SpinLock::ScopedLockType lk (blockLock);
     jassert (numSampleToCopy <= size()*bufferBlockSize);
     int numChannels = jmin (getAllocatedNumChannels(), outBuf.getNumChannels());
     int sampleProcessed = 0;
@@ -97,7 +189,7 @@ void BufferBlockList::copyTo (AudioSampleBuffer& outBuf, int listStartSample, in
     while (sampleProcessed < numSampleToCopy)
     {
         readBlockIdx = (int)floor (readPosInList * 1.0 / bufferBlockSize);
-        int readPosInBlock = (readPosInList % targetNumSamples) % bufferBlockSize ;
+        int readPosInBlock = (targetNumSamples > 0 ? readPosInList % targetNumSamples : readPosInList) % bufferBlockSize ;
 
         int blockSize =  bufferBlockSize - readPosInBlock;
 
@@ -110,7 +202,7 @@ void BufferBlockList::copyTo (AudioSampleBuffer& outBuf, int listStartSample, in
 
         for (int i = 0 ; i < numChannels ; i++)
         {
-            const auto ref = OwnedArray::getUnchecked (readBlockIdx);
+            const auto ref = getUnchecked (readBlockIdx);
             outBuf.copyFrom ( i, writePos, *ref, i, readPosInBlock, blockSize);
         }
 
@@ -118,7 +210,7 @@ void BufferBlockList::copyTo (AudioSampleBuffer& outBuf, int listStartSample, in
         writePos += blockSize;
         sampleProcessed += blockSize;
 
-        if (readPosInList >= targetNumSamples)
+        if (targetNumSamples > 0 && readPosInList >= targetNumSamples)
         {
             jassert (readPosInList < targetNumSamples + bufferBlockSize);
             readPosInList %= targetNumSamples;
@@ -134,6 +226,7 @@ void BufferBlockList::copyFrom (const AudioSampleBuffer& inBuf, int listStartSam
 {
     if (numSampleToCopy == -1)numSampleToCopy =  inBuf.getNumSamples();
 
+    const SpinLock::ScopedLockType lk (blockLock);
     jassert (listStartSample + numSampleToCopy < getAllocatedNumSample());
     jassert (inBuf.getNumChannels() == getAllocatedNumChannels());
     int numChannels = inBuf.getNumChannels();
@@ -158,11 +251,13 @@ void BufferBlockList::copyFrom (const AudioSampleBuffer& inBuf, int listStartSam
 
         for (int i = 0 ; i < numChannels ; i++)
         {
-            auto* ref =  OwnedArray::getUnchecked (writeBlockIdx);
+            auto* ref =  getUnchecked (writeBlockIdx);
             ref->copyFrom (i, startWrite, inBuf, i, readPos, blockSize);
 
         }
 
+        markBlockWritten (writeBlockIdx);
+
         readPos += blockSize;
         writePosInList += blockSize;
         sampleProcessed += blockSize;
@@ -172,12 +267,67 @@ void BufferBlockList::copyFrom (const AudioSampleBuffer& inBuf, int listStartSam
     }
 }
 
+void BufferBlockList::addTo (AudioSampleBuffer& destBuffer, int numChannels, int listStartSample, int numSamples, float startGain, float endGain)
+{
+    if (numSamples <= 0) return;
+
+    const SpinLock::ScopedLockType lk (blockLock);
+    numChannels = jmin (numChannels, getAllocatedNumChannels(), destBuffer.getNumChannels());
+    const float increment = (endGain - startGain) / numSamples;
+    int sampleProcessed = 0;
+    int readPosInList = listStartSample;
+
+    while (sampleProcessed < numSamples)
+    {
+        const int readBlockIdx = readPosInList / bufferBlockSize;
+        const int readPosInBlock = readPosInList % bufferBlockSize;
+        // like copyTo, may read recorded samples past the loop end before wrapping
+        const int blockSize = jmin (bufferBlockSize - readPosInBlock, numSamples - sampleProcessed);
+
+        jassert (blockSize > 0);
+        jassert (readBlockIdx < size());
+
+        const auto block = getUnchecked (readBlockIdx);
+        const float gain = startGain + sampleProcessed * increment;
+
+        for (int i = 0 ; i < numChannels ; i++)
+        {
+            addWithGainRamp (destBuffer.getWritePointer (i, sampleProcessed), block->getReadPointer (i, readPosInBlock), blockSize, gain, increment);
+        }
+
+        readPosInList += blockSize;
+        sampleProcessed += blockSize;
+
+        if (targetNumSamples > 0 && readPosInList >= targetNumSamples) readPosInList %= targetNumSamples;
+    }
+}
+
 float BufferBlockList::getSample (int c, int n)
 {
+    const SpinLock::ScopedLockType lk (blockLock);
     int readI = n % bufferBlockSize ;
     int readBI = (int)floor (n * 1.0 / bufferBlockSize);
     jassert (readBI < size());
-    return  OwnedArray::getUnchecked (readBI)->getSample (c, readI);
+    return  getUnchecked (readBI)->getSample (c, readI);
+}
+
+
+void BufferBlockList::swapContentWith (BufferBlockList& other)
+{
+    jassert (bufferBlockSize == other.bufferBlockSize);
+
+    if (&other == this) return;
+
+    // always lock in the same order
+    BufferBlockList* first = this < &other ? this : &other;
+    BufferBlockList* second = this < &other ? &other : this;
+    const SpinLock::ScopedLockType lk1 (first->blockLock);
+    const SpinLock::ScopedLockType lk2 (second->blockLock);
+
+    blocks.swapWith (other.blocks);
+    std::swap (targetNumSamples, other.targetNumSamples);
+    ++writeGeneration->value;
+    ++other.writeGeneration->value;
 }
 
 
@@ -189,3 +339,281 @@ AudioSampleBuffer& BufferBlockList::getContiguousBuffer (int sampleStart, int nu
     copyTo (contiguous_Cache, sampleStart, 0, numSamples);
     return contiguous_Cache;
 }
+
+
+void BufferBlockList::markBlockWritten (int blockIdx)
+{
+    AudioBlock* block = blocks.getObjectPointerUnchecked (blockIdx);
+    block->lastWriteTime = Time::getMillisecondCounter();
+    ++block->numWrites;
+    ++writeGeneration->value;
+}
+
+AudioBlock::Ptr BufferBlockList::getBlock (int blockIdx)
+{
+    const SpinLock::ScopedLockType lk (blockLock);
+    return blockIdx < blocks.size() ? blocks.getObjectPointerUnchecked (blockIdx) : nullptr;
+}
+
+
+BlockListSnapshot BufferBlockList::getSnapshot (int numSamples)
+{
+    BlockListSnapshot snapshot;
+    snapshot.blockSize = bufferBlockSize;
+    snapshot.writes = writeGeneration;
+
+    const int numBlocks = numSamples > 0 ? (numSamples - 1) / bufferBlockSize + 1 : 0;
+    snapshot.blocks.ensureStorageAllocated (numBlocks);
+
+    // generation is read with the blocks, so a write made right after is detected
+    const SpinLock::ScopedLockType lk (blockLock);
+    snapshot.writeGeneration = writeGeneration->value.get();
+
+    for (int i = 0 ; i < jmin (numBlocks, blocks.size()) ; i++) {snapshot.blocks.add (blocks.getObjectPointerUnchecked (i));}
+
+    return snapshot;
+}
+
+bool BlockListSnapshot::readTo (AudioSampleBuffer& outBuf, int listStartSample, int bufStartSample, int numSamples) const
+{
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        const int pos = listStartSample + done;
+        const int blockIdx = pos / blockSize;
+        const int posInBlock = pos % blockSize;
+        const int num = jmin (blockSize - posInBlock, numSamples - done);
+
+        if (blockIdx >= blocks.size()) return false;
+
+        const AudioSampleBuffer& buffer = blocks.getObjectPointerUnchecked (blockIdx)->buffer;
+        const int numChannels = jmin (outBuf.getNumChannels(), buffer.getNumChannels());
+
+        for (int c = 0 ; c < numChannels ; c++) {outBuf.copyFrom (c, bufStartSample + done, buffer, c, posInBlock, num);}
+
+        done += num;
+    }
+
+    return true;
+}
+
+
+void BufferBlockList::readTo (AudioSampleBuffer& outBuf, int listStartSample, int bufStartSample, int numSamples)
+{
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        const int pos = listStartSample + done;
+        const int blockIdx = pos / bufferBlockSize;
+        const int posInBlock = pos % bufferBlockSize;
+        const int num = jmin (bufferBlockSize - posInBlock, numSamples - done);
+
+        // the reference keeps the block alive even if it is spilled or replaced meanwhile
+        AudioBlock::Ptr block = getBlock (blockIdx);
+
+        if (block == nullptr)
+        {
+            jassertfalse;
+            return;
+        }
+
+        const int numChannels = jmin (outBuf.getNumChannels(), block->buffer.getNumChannels());
+
+        for (int c = 0 ; c < numChannels ; c++) {outBuf.copyFrom (c, bufStartSample + done, block->buffer, c, posInBlock, num);}
+
+        done += num;
+    }
+}
+
+void BufferBlockList::writeFrom (const AudioSampleBuffer& inBuf, int listStartSample, int bufStartSample, int numSamples)
+{
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        const int pos = listStartSample + done;
+        const int blockIdx = pos / bufferBlockSize;
+        const int posInBlock = pos % bufferBlockSize;
+        const int num = jmin (bufferBlockSize - posInBlock, numSamples - done);
+
+        AudioBlock::Ptr block = getBlock (blockIdx);
+
+        if (block == nullptr)
+        {
+            jassertfalse;
+            return;
+        }
+
+        const int numChannels = jmin (inBuf.getNumChannels(), block->buffer.getNumChannels());
+
+        for (int c = 0 ; c < numChannels ; c++) {block->buffer.copyFrom (c, posInBlock, inBuf, c, bufStartSample + done, num);}
+
+        {
+            const SpinLock::ScopedLockType lk (blockLock);
+
+            if (blockIdx < blocks.size())
+            {
+                // the block was spilled while we wrote it, write again in its replacement
+                if (blocks.getObjectPointerUnchecked (blockIdx) != block.get()) continue;
+
+                markBlockWritten (blockIdx);
+            }
+        }
+
+        done += num;
+    }
+}
+
+
+int64 BufferBlockList::getResidentBytes()
+{
+    const SpinLock::ScopedLockType lk (blockLock);
+    int64 res = 0;
+
+    for (auto* b : blocks)
+    {
+        if (b->scratch == nullptr)
+            res += (int64) b->buffer.getNumChannels() * bufferBlockSize * (int64) sizeof (float);
+    }
+
+    return res;
+}
+
+int BufferBlockList::getNumSpilledBlocks()
+{
+    const SpinLock::ScopedLockType lk (blockLock);
+    int res = 0;
+
+    for (auto* b : blocks) {if (b->scratch != nullptr) res++;}
+
+    return res;
+}
+
+int BufferBlockList::getOldestResidentBlock (uint32 minIdleMs, int numSamples, uint32& lastWriteTime)
+{
+    const SpinLock::ScopedLockType lk (blockLock);
+    const uint32 now = Time::getMillisecondCounter();
+    // block under the needle is kept in RAM, and the ones about to be written
+    const int accessedBlock = accessPosition.get() / bufferBlockSize;
+    const int lastKeptBlock = accessIsWrite.get() ? (accessPosition.get() + numSamples) / bufferBlockSize : accessedBlock;
+    int res = -1;
+
+    for (int i = 0 ; i < blocks.size() ; i++)
+    {
+        const AudioBlock* b = blocks.getObjectPointerUnchecked (i);
+        const uint32 t = b->lastWriteTime.get();
+
+        // recording always starts from the first block
+        if (b->scratch != nullptr || i == 0 || (i >= accessedBlock && i <= lastKeptBlock) || now - t < minIdleMs) continue;
+
+        if (res == -1 || (int32) (t - lastWriteTime) < 0)
+        {
+            res = i;
+            lastWriteTime = t;
+        }
+    }
+
+    return res;
+}
+
+bool BufferBlockList::spillBlock (int blockIdx, const File& scratchFile)
+{
+    AudioBlock::Ptr block = getBlock (blockIdx);
+
+    if (block == nullptr || block->scratch != nullptr) return false;
+
+    const uint32 numWrites = block->numWrites.get();
+    const int numChannels = block->buffer.getNumChannels();
+    ScratchBlock::Ptr scratch = new ScratchBlock (scratchFile, numChannels, bufferBlockSize);
+
+    if (!scratch->isValid()) return false;
+
+    // copied without any lock, we hold a reference to the block and writes during the copy are detected below
+    // never written blocks are left as zeros
+    if (numWrites > 0)
+    {
+        scratch->touch (0, bufferBlockSize, true);
+
+        for (int c = 0 ; c < numChannels ; c++)
+        {
+            memcpy (scratch->getChannel (c), block->buffer.getReadPointer (c), (size_t) bufferBlockSize * sizeof (float));
+        }
+    }
+
+    AudioBlock::Ptr mapped = new AudioBlock (scratch);
+    mapped->lastWriteTime = block->lastWriteTime.get();
+    mapped->numWrites = numWrites;
+
+    {
+        const SpinLock::ScopedLockType lk (blockLock);
+
+        // only published if the block was neither written nor replaced meanwhile
+        if (blockIdx >= blocks.size() || blocks.getObjectPointerUnchecked (blockIdx) != block.get() || block->numWrites.get() != numWrites)
+            return false;
+
+        blocks.set (blockIdx, mapped);
+    }
+
+    // RAM block is freed out of the lock, or later by the last thread reading it
+    return true;
+}
+
+bool BufferBlockList::unspillBlock (int blockIdx)
+{
+    AudioBlock::Ptr block = getBlock (blockIdx);
+
+    if (block == nullptr || block->scratch == nullptr) return false;
+
+    const uint32 numWrites = block->numWrites.get();
+    const int numChannels = block->buffer.getNumChannels();
+    AudioBlock::Ptr resident = new AudioBlock (numChannels, bufferBlockSize);
+
+    // same as spillBlock, copied without lock and only published if nothing was written meanwhile
+    for (int c = 0 ; c < numChannels ; c++) {resident->buffer.copyFrom (c, 0, block->buffer, c, 0, bufferBlockSize);}
+
+    resident->lastWriteTime = block->lastWriteTime.get();
+    resident->numWrites = numWrites;
+
+    {
+        const SpinLock::ScopedLockType lk (blockLock);
+
+        if (blockIdx >= blocks.size() || blocks.getObjectPointerUnchecked (blockIdx) != block.get() || block->numWrites.get() != numWrites)
+            return false;
+
+        blocks.set (blockIdx, resident);
+    }
+
+    // scratch file is unmapped and deleted with the last reference
+    return true;
+}
+
+void BufferBlockList::prefetch (int numSamples)
+{
+    const int total = targetNumSamples > 0 ? targetNumSamples : getAllocatedNumSample();
+
+    if (total <= 0) return;
+
+    const int pos = accessPosition.get();
+    const bool isWriting = accessIsWrite.get() != 0;
+    int done = 0;
+
+    while (done < jmin (numSamples, total))
+    {
+        const int p = (pos + done) % total;
+        const int blockIdx = p / bufferBlockSize;
+        const int posInBlock = p % bufferBlockSize;
+        const int num = jmin (bufferBlockSize - posInBlock, numSamples - done, total - p);
+        AudioBlock::Ptr block = getBlock (blockIdx);
+
+        if (block != nullptr && block->scratch != nullptr)
+        {
+            // a write retried next time if the audio thread wrote to the block meanwhile
+            if (isWriting) unspillBlock (blockIdx);
+            else block->scratch->touch (posInBlock, num, false);
+        }
+
+        done += num;
+    }
+}
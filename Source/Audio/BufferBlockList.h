@@ -21,23 +21,154 @@
 
 #define DEFAULT_BUFFER_BLOCK_SIZE 1000000 // ~ 20s@44.1kHz should be bigger than the highest block size
 
-class BufferBlockList : public OwnedArray<AudioSampleBuffer>
+class BufferBlockStore;
+
+// block content moved to a memory mapped scratch file, channels are stored one after the other
+class ScratchBlock : public ReferenceCountedObject
+{
+public:
+    ScratchBlock (const File& file, int numChannels, int numSamples);
+    ~ScratchBlock();
+
+    typedef ReferenceCountedObjectPtr<ScratchBlock> Ptr;
+
+    bool isValid() const {return map != nullptr && map->getData() != nullptr;}
+    float* getChannel (int c) const;
+
+    // fault pages of this range in, so that the audio thread doesn't have to
+    void touch (int startSample, int numSamples, bool forWriting) const;
+
+    const int numChannels;
+    const int numSamples;
+
+private:
+    File file;
+    ScopedPointer<MemoryMappedFile> map;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScratchBlock)
+};
+
+
+// one block of samples, shared by reference so that threads other than the audio one can copy it out of the block lock
+// a block is never resized in place, it is replaced as a whole in its list
+class AudioBlock : public ReferenceCountedObject
+{
+public:
+    AudioBlock (int numChannels, int numSamples);
+    // refers to the samples of a scratch block
+    AudioBlock (ScratchBlock* scratch);
+
+    typedef ReferenceCountedObjectPtr<AudioBlock> Ptr;
+
+    AudioSampleBuffer buffer;
+    const ScratchBlock::Ptr scratch;
+
+    Atomic<uint32> lastWriteTime;
+    // incremented after each write, readers copying out of the lock use it to detect concurrent writes
+    Atomic<uint32> numWrites;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioBlock)
+};
+
+
+// counts the writes to a list, shared so that a snapshot can still check it once the list is deleted
+class WriteGeneration : public ReferenceCountedObject
+{
+public:
+    typedef ReferenceCountedObjectPtr<WriteGeneration> Ptr;
+    Atomic<uint32> value;
+};
+
+
+// references to the blocks of a list, for readers that may outlive it (exports)
+struct BlockListSnapshot
+{
+    ReferenceCountedArray<AudioBlock> blocks;
+    int blockSize;
+    WriteGeneration::Ptr writes;
+    uint32 writeGeneration;
+
+    // copies out of any lock, no wrapping
+    bool readTo (AudioSampleBuffer& outBuf, int listStartSample, int bufStartSample, int numSamples) const;
+    // the list was written (or its blocks replaced) since the snapshot
+    bool wasWritten() const {return writes->value.get() != writeGeneration;}
+};
+
+
+class BufferBlockList
 {
 public:
     BufferBlockList (int numChannels = 1, int minNumSample = 44100 * 2, int blockSize = DEFAULT_BUFFER_BLOCK_SIZE );
+    ~BufferBlockList();
     void allocateSamples (int numChannels, int numSamples );
     int getAllocatedNumSample() const;
     int getNumSamples() const;
     int getAllocatedNumChannels() const;
     void setNumChannels (int numChannels);
     void setNumSample (int numSample);
+
+    // these hold the block lock for the whole copy, they are meant for the short copies of the audio thread
     void copyTo (AudioSampleBuffer& outBuf, int listStartSample, int bufStartSample = 0, int numSampleToCopy = -1);
     void copyFrom (const AudioSampleBuffer& inBuf, int listStartSample, int bufStartSample = 0, int numSampleToCopy = -1);
+    // mix straight from blocks into the start of destBuffer with a linear gain ramp, wrapping like copyTo
+    void addTo (AudioSampleBuffer& destBuffer, int numChannels, int listStartSample, int numSamples, float startGain, float endGain);
     float getSample (int c, int n);
+
+    // copies of any length for other threads, the block lock is only taken to get or check block references
+    // so the audio thread is never blocked by them, no wrapping at the loop end
+    void readTo (AudioSampleBuffer& outBuf, int listStartSample, int bufStartSample, int numSamples);
+    void writeFrom (const AudioSampleBuffer& inBuf, int listStartSample, int bufStartSample, int numSamples);
+
+    // exchanges blocks and length with other in constant time, block sizes must match
+    void swapContentWith (BufferBlockList& other);
     AudioSampleBuffer& getContiguousBuffer (int sampleStart = 0, int numSamples = -1);
     AudioSampleBuffer contiguous_Cache;
     int targetNumSamples;
     const int minNumSample;
     const int bufferBlockSize;
 
+    int size() const {return blocks.size();}
+    // blockLock must be held
+    AudioSampleBuffer* getUnchecked (int blockIdx) const {return &blocks.getObjectPointerUnchecked (blockIdx)->buffer;}
+
+    // optional store spilling idle blocks to disk, block pointers can then change in the background
+    // so any direct access to blocks should hold getBlockLock()
+    void setBlockStore (BufferBlockStore* store);
+    SpinLock& getBlockLock() {return blockLock;}
+    // blockLock must be held
+    void markBlockWritten (int blockIdx);
+    // incremented by every markBlockWritten, lets readers outside the audio thread detect concurrent writes
+    uint32 getWriteGeneration() const {return writeGeneration->value.get();}
+
+    // references the blocks holding the first numSamples, the snapshot stays valid after the list is deleted
+    BlockListSnapshot getSnapshot (int numSamples);
+
+    // hint for prefetching, current read or write position
+    // blocks ahead of a write position are brought back to RAM so that the audio thread never writes to a scratch file
+    void setAccessPosition (int pos, bool isWriting = false) {accessPosition = pos; accessIsWrite = isWriting ? 1 : 0;}
+
+    int64 getResidentBytes();
+    int getNumSpilledBlocks();
+
+private:
+    friend class BufferBlockStore;
+
+    AudioBlock::Ptr getBlock (int blockIdx);
+
+    // returns the least recently written block staying in RAM, idle for at least minIdleMs, or -1
+    // blocks within numSamples ahead of a write position are not candidates
+    int getOldestResidentBlock (uint32 minIdleMs, int numSamples, uint32& lastWriteTime);
+    bool spillBlock (int blockIdx, const File& scratchFile);
+    bool unspillBlock (int blockIdx);
+    // touches spilled pages ahead of a read position, unspills blocks ahead of a write position
+    void prefetch (int numSamples);
+
+    ReferenceCountedArray<AudioBlock> blocks;
+    // only held for pointer swaps and the short copies of the audio thread
+    SpinLock blockLock;
+    BufferBlockStore* blockStore;
+    Atomic<int> accessPosition;
+    Atomic<int> accessIsWrite;
+    const WriteGeneration::Ptr writeGeneration;
+
 };
@@ -0,0 +1,136 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#include "BufferBlockStore.h"
+
+
+BufferBlockStore::BufferBlockStore (const String& name):
+    Thread (name + "_blockStore"),
+    memoryBudget (0),
+    minIdleMs (2000),
+    prefetchLength (44100 * 2)
+{
+}
+
+BufferBlockStore::~BufferBlockStore()
+{
+    stopThread (1000);
+    jassert (lists.size() == 0);
+}
+
+
+void BufferBlockStore::setMemoryBudget (int64 numBytes)
+{
+    memoryBudget = jmax ((int64) 0, numBytes);
+
+    // started with the first budget, kept afterwards to prefetch blocks already spilled
+    if (memoryBudget.get() > 0)
+    {
+        const ScopedLock lk (listLock);
+
+        if (!isThreadRunning()) startThread (3);
+    }
+
+    notify();
+}
+
+
+void BufferBlockStore::addBlockList (BufferBlockList* l)
+{
+    const ScopedLock lk (listLock);
+    lists.addIfNotAlreadyThere (l);
+}
+
+void BufferBlockStore::removeBlockList (BufferBlockList* l)
+{
+    const ScopedLock lk (listLock);
+    lists.removeFirstMatchingValue (l);
+}
+
+
+int64 BufferBlockStore::getResidentBytes()
+{
+    const ScopedLock lk (listLock);
+    int64 res = 0;
+
+    for (auto l : lists) {res += l->getResidentBytes();}
+
+    return res;
+}
+
+int BufferBlockStore::getNumSpilledBlocks()
+{
+    const ScopedLock lk (listLock);
+    int res = 0;
+
+    for (auto l : lists) {res += l->getNumSpilledBlocks();}
+
+    return res;
+}
+
+
+File BufferBlockStore::getScratchDirectory()
+{
+    return File::getSpecialLocation (File::tempDirectory).getChildFile ("LGML_scratch");
+}
+
+
+void BufferBlockStore::run()
+{
+    while (!threadShouldExit())
+    {
+        wait (20);
+
+        {
+            const ScopedLock lk (listLock);
+
+            for (auto l : lists) {l->prefetch (prefetchLength.get());}
+        }
+
+        const int64 budget = memoryBudget.get();
+
+        // one block at a time to give prefetch a chance to run
+        if (budget > 0 && getResidentBytes() > budget) spillOldestBlock();
+    }
+}
+
+
+bool BufferBlockStore::spillOldestBlock()
+{
+    const ScopedLock lk (listLock);
+    BufferBlockList* oldestList = nullptr;
+    int oldestBlock = -1;
+    uint32 oldestTime = 0;
+
+    for (auto l : lists)
+    {
+        uint32 t = 0;
+        const int idx = l->getOldestResidentBlock ((uint32) minIdleMs.get(), prefetchLength.get(), t);
+
+        if (idx >= 0 && (oldestList == nullptr || (int32) (t - oldestTime) < 0))
+        {
+            oldestList = l;
+            oldestBlock = idx;
+            oldestTime = t;
+        }
+    }
+
+    if (oldestList == nullptr) return false;
+
+    return oldestList->spillBlock (oldestBlock, getScratchDirectory().getNonexistentChildFile ("block", ".raw", false));
+}
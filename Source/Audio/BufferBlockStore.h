@@ -0,0 +1,66 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include "BufferBlockList.h"
+
+/*
+ keeps the blocks of a set of BufferBlockList within a memory budget
+
+ a background thread spills the least recently written blocks to memory mapped scratch files
+ when RAM usage is over budget, and faults in pages of spilled blocks ahead of each list read position
+ spilled blocks ahead of a write position are brought back to RAM before the audio thread reaches them
+ the thread only runs once a budget has been set
+ */
+class BufferBlockStore : private Thread
+{
+public:
+    BufferBlockStore (const String& name);
+    ~BufferBlockStore();
+
+    // 0 keeps every block in RAM
+    void setMemoryBudget (int64 numBytes);
+    int64 getMemoryBudget() const {return memoryBudget.get();}
+
+    // blocks written more recently than that are never spilled
+    void setMinIdleTime (int ms) {minIdleMs = ms;}
+    // number of samples prefetched ahead of access positions
+    void setPrefetchLength (int numSamples) {prefetchLength = numSamples;}
+
+    int64 getResidentBytes();
+    int getNumSpilledBlocks();
+
+    static File getScratchDirectory();
+
+private:
+    friend class BufferBlockList;
+    void addBlockList (BufferBlockList*);
+    void removeBlockList (BufferBlockList*);
+
+    void run() override;
+    bool spillOldestBlock();
+
+    CriticalSection listLock;
+    Array<BufferBlockList*> lists;
+
+    Atomic<int64> memoryBudget;
+    Atomic<int> minIdleMs;
+    Atomic<int> prefetchLength;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BufferBlockStore)
+};
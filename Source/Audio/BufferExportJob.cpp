@@ -0,0 +1,148 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#include "BufferExportJob.h"
+#include "../Utils/DebugHelpers.h"
+
+
+BufferExportJob::BufferExportJob (double _sampleRate, ProgressTask* _task):
+    ThreadPoolJob ("bufferExport"),
+    sampleRate (_sampleRate),
+    task (_task)
+{
+}
+
+BufferExportJob::~BufferExportJob()
+{
+    masterReference.clear();
+}
+
+
+void BufferExportJob::addList (BufferBlockList* list, int numChannels, int numSamples, const File& destFile)
+{
+    Item item;
+    item.isFileCopy = false;
+    item.snapshot = list->getSnapshot (numSamples);
+    item.numChannels = numChannels;
+    item.numSamples = numSamples;
+    item.destFile = destFile;
+    item.succeeded = false;
+    items.add (item);
+}
+
+void BufferExportJob::addFileCopy (const File& source, const File& destFile)
+{
+    Item item;
+    item.isFileCopy = true;
+    item.numChannels = 0;
+    item.numSamples = 0;
+    item.source = source;
+    item.destFile = destFile;
+    item.succeeded = false;
+    items.add (item);
+}
+
+
+ThreadPoolJob::JobStatus BufferExportJob::runJob()
+{
+    int64 totalSamples = 0;
+
+    for (auto& item : items) {totalSamples += item.numSamples;}
+
+    int64 samplesBefore = 0;
+
+    for (auto& item : items)
+    {
+        if (shouldExit()) break;
+
+        if (item.isFileCopy)
+        {
+            item.succeeded = item.source.copyFileTo (item.destFile);
+        }
+        else
+        {
+            item.succeeded = exportList (item, samplesBefore, totalSamples);
+            samplesBefore += item.numSamples;
+            // blocks are released here rather than on the message thread
+            item.snapshot.blocks.clear();
+        }
+
+        if (!item.succeeded) NLOG ("export", "!!! failed to export " + item.destFile.getFullPathName());
+    }
+
+    // results are handled on the message thread
+    WeakReference<ProgressTask> t (task);
+    Array<Item> results (items);
+    auto callback = onItemExported;
+
+    MessageManager::callAsync ([t, results, callback]()
+    {
+        if (callback)
+        {
+            for (auto& item : results) {callback (item.destFile, item.succeeded);}
+        }
+
+        if (t.get()) t.get()->end();
+    });
+
+    return jobHasFinished;
+}
+
+
+bool BufferExportJob::exportList (Item& item, int64 samplesBefore, int64 totalSamples)
+{
+    TemporaryFile tmp (item.destFile);
+    ScopedPointer<FileOutputStream> fp (tmp.getFile().createOutputStream());
+
+    if (fp == nullptr) return false;
+
+    WavAudioFormat format;
+    ScopedPointer<AudioFormatWriter> writer (format.createWriterFor (fp, sampleRate, (unsigned int) item.numChannels, 24, StringPairArray(), 0));
+
+    if (writer == nullptr) return false;
+
+    fp.release();
+
+    AudioBuffer<float> chunk (item.numChannels, chunkSize);
+
+    for (int pos = 0 ; pos < item.numSamples ; pos += chunkSize)
+    {
+        if (shouldExit()) return false;
+
+        const int n = jmin ((int) chunkSize, item.numSamples - pos);
+
+        if (!item.snapshot.readTo (chunk, pos, 0, n)) return false;
+
+        if (item.snapshot.wasWritten())
+        {
+            NLOG ("export", "!! " + item.destFile.getFileName() + " was recorded during export, skipping it");
+            return false;
+        }
+
+        if (!writer->writeFromAudioSampleBuffer (chunk, 0, n)) return false;
+
+        if (ProgressTask* t = task.get())
+        {
+            if (totalSamples > 0) t->setProgress ((float) ((samplesBefore + pos + n) * 1.0 / totalSamples));
+        }
+    }
+
+    writer = nullptr;
+    return tmp.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,74 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include "BufferBlockList.h"
+#include "../Utils/ProgressNotifier.h"
+
+/*
+ writes BufferBlockLists to wav files on a thread pool
+
+ lists are snapshot when added : the job holds references to their blocks, so a list can be deleted meanwhile
+ blocks are streamed chunk by chunk to the writer out of any lock, so the audio callback is never blocked
+ the write generation of each list is checked after every chunk : a list written to during the export
+ (a track recording again) is aborted instead of producing a file mixing two takes
+ files are written to a temporary file and only replace the destination when complete
+ */
+class BufferExportJob : public ThreadPoolJob
+{
+public:
+    BufferExportJob (double sampleRate, ProgressTask* task);
+    ~BufferExportJob();
+
+    // message thread, references the blocks of list
+    void addList (BufferBlockList* list, int numChannels, int numSamples, const File& destFile);
+    // copy an existing file instead of rendering a list
+    void addFileCopy (const File& source, const File& destFile);
+
+    // called on the message thread for each item once the job is finished
+    std::function<void (const File& destFile, bool succeeded)> onItemExported;
+
+    JobStatus runJob() override;
+
+    int getNumItems() const {return items.size();}
+
+    static const int chunkSize = 16384;
+
+private:
+    struct Item
+    {
+        bool isFileCopy;
+        BlockListSnapshot snapshot;
+        int numChannels;
+        int numSamples;
+        File source;
+        File destFile;
+        bool succeeded;
+    };
+
+    bool exportList (Item& item, int64 samplesBefore, int64 totalSamples);
+
+    Array<Item> items;
+    double sampleRate;
+    WeakReference<ProgressTask> task;
+
+    WeakReference<BufferExportJob>::Master masterReference;
+    friend class WeakReference<BufferExportJob>;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BufferExportJob)
+};
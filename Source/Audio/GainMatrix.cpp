@@ -0,0 +1,140 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#include "GainMatrix.h"
+
+
+GainMatrix::GainMatrix():
+    numInputs (0),
+    numOutputs (0),
+    activeDirty (false),
+    ramping (false)
+{
+    setSize (0, 0);
+}
+
+
+void GainMatrix::setSize (int _numInputs, int _numOutputs)
+{
+    jassert (_numInputs <= maxInputs && _numOutputs <= maxOutputs);
+    numInputs = jlimit (0, (int) maxInputs, _numInputs);
+    numOutputs = jlimit (0, (int) maxOutputs, _numOutputs);
+
+    FloatVectorOperations::clear (current, maxInputs * maxOutputs);
+    FloatVectorOperations::clear (target, maxInputs * maxOutputs);
+    zeromem (numActiveInputs, sizeof (numActiveInputs));
+    activeDirty = false;
+    ramping = false;
+}
+
+
+void GainMatrix::setTarget (int input, int output, float gain)
+{
+    jassert (isPositiveAndBelow (input, numInputs) && isPositiveAndBelow (output, numOutputs));
+    float& t = target[output * maxInputs + input];
+
+    if (t == gain) return;
+
+    t = gain;
+    activeDirty = true;
+}
+
+
+int GainMatrix::getNumActiveCrosspoints()
+{
+    if (activeDirty) updateActiveCrosspoints();
+
+    int n = 0;
+
+    for (int o = 0 ; o < numOutputs ; o++) {n += numActiveInputs[o];}
+
+    return n;
+}
+
+
+void GainMatrix::updateActiveCrosspoints()
+{
+    ramping = false;
+
+    for (int o = 0 ; o < numOutputs ; o++)
+    {
+        const float* c = current + o * maxInputs;
+        const float* t = target + o * maxInputs;
+        int n = 0;
+
+        for (int i = 0 ; i < numInputs ; i++)
+        {
+            if (c[i] != 0 || t[i] != 0) activeInputs[o][n++] = i;
+
+            ramping |= c[i] != t[i];
+        }
+
+        numActiveInputs[o] = n;
+    }
+
+    activeDirty = false;
+}
+
+
+void GainMatrix::process (const float* const* inputs, float* const* outputs, int numSamples)
+{
+    if (numSamples <= 0) return;
+
+    if (activeDirty) updateActiveCrosspoints();
+
+    const float invNumSamples = 1.0f / numSamples;
+    const float* srcs[maxFusedGainSources];
+    float startGains[maxFusedGainSources], increments[maxFusedGainSources];
+
+    for (int o = 0 ; o < numOutputs ; o++)
+    {
+        const int numActive = numActiveInputs[o];
+
+        if (numActive == 0)
+        {
+            FloatVectorOperations::clear (outputs[o], numSamples);
+            continue;
+        }
+
+        for (int first = 0 ; first < numActive ; first += maxFusedGainSources)
+        {
+            const int numSrcs = jmin ((int) maxFusedGainSources, numActive - first);
+
+            for (int k = 0 ; k < numSrcs ; k++)
+            {
+                const int in = activeInputs[o][first + k];
+                const int idx = o * maxInputs + in;
+                srcs[k] = inputs[in];
+                startGains[k] = current[idx];
+                increments[k] = (target[idx] - current[idx]) * invNumSamples;
+            }
+
+            // first pass writes the output, no clear needed
+            mixWithGainRamps (outputs[o], srcs, startGains, increments, numSrcs, numSamples, first > 0);
+        }
+    }
+
+    if (ramping)
+    {
+        // ramps are done, crosspoints that reached 0 are dropped
+        for (int o = 0 ; o < numOutputs ; o++) {FloatVectorOperations::copy (current + o * maxInputs, target + o * maxInputs, numInputs);}
+
+        updateActiveCrosspoints();
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include "AudioHelpers.h"
+
+/*
+ inputs x outputs gain matrix, as used by mixers
+
+ only active crosspoints (non null current or target gain) are processed, each output being computed
+ with fused passes of up to maxFusedGainSources inputs instead of one pass per crosspoint
+ a new target is ramped over the next processed block, then the crosspoint is back to a flat gain
+ storage is fixed so that all methods can be called from the audio thread
+ */
+class GainMatrix
+{
+public:
+    GainMatrix();
+
+    static const int maxInputs = 64;
+    static const int maxOutputs = 32;
+
+    // all gains are reset to 0
+    void setSize (int numInputs, int numOutputs);
+    int getNumInputs() const {return numInputs;}
+    int getNumOutputs() const {return numOutputs;}
+
+    void setTarget (int input, int output, float gain);
+    float getTarget (int input, int output) const {return target[output * maxInputs + input];}
+    float getCurrent (int input, int output) const {return current[output * maxInputs + input];}
+
+    // output channels are overwritten, they should not alias input channels
+    void process (const float* const* inputs, float* const* outputs, int numSamples);
+
+    bool isRamping() const {return ramping;}
+    int getNumActiveCrosspoints();
+
+private:
+    void updateActiveCrosspoints();
+
+    int numInputs, numOutputs;
+    float current[maxInputs * maxOutputs];
+    float target[maxInputs * maxOutputs];
+
+    // active inputs of each output
+    int activeInputs[maxOutputs][maxInputs];
+    int numActiveInputs[maxOutputs];
+    bool activeDirty;
+    bool ramping;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GainMatrix)
+};
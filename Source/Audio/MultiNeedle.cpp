@@ -246,7 +246,9 @@ MultiNeedle::MultiNeedle (int fIn, int fOut, int max):
     maxNeedles (max),
     currentPos (0),
     loopSize (0),
-    isStitching (false)
+    isStitching (false),
+    commandFifo (commandQueueSize),
+    renderThreadId (nullptr)
 {
     needles.resize (maxNeedles);
     int idx = 0;
@@ -258,12 +260,99 @@ MultiNeedle::MultiNeedle (int fIn, int fOut, int max):
     }
 }
 
+bool MultiNeedle::isRenderThread() const
+{
+    return renderThreadId.get() == Thread::getCurrentThreadId();
+}
+
+void MultiNeedle::postCommand (CommandType type, int value)
+{
+    const SpinLock::ScopedLockType lk (producerLock);
+    int start1, size1, start2, size2;
+    commandFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        ++numDroppedCommands;
+        jassertfalse;
+        return;
+    }
+
+    Command& cmd = commands[size1 > 0 ? start1 : start2];
+    cmd.type = type;
+    cmd.value = value;
+    commandFifo.finishedWrite (1);
+}
+
+void MultiNeedle::processCommands()
+{
+    int start1, size1, start2, size2;
+    commandFifo.prepareToRead (commandFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0 ; i < size1 + size2 ; i++)
+    {
+        const Command& cmd = commands[i < size1 ? start1 + i : start2 + i - size1];
+
+        switch (cmd.type)
+        {
+            case loopSizeCommand:
+                setLoopSizeInternal (cmd.value);
+                break;
+
+            case jumpCommand:
+                // loop may have shrunk since the jump was asked
+                if (loopSize > 0) jumpToInternal (cmd.value % loopSize);
+
+                break;
+
+            case fadeAllOutCommand:
+                fadeAllOutInternal();
+                break;
+
+            case resetCommand:
+                resetAllInternal();
+                break;
+        }
+    }
+
+    commandFifo.finishedRead (size1 + size2);
+}
+
+void MultiNeedle::applyPendingCommands()
+{
+    renderThreadId = Thread::getCurrentThreadId();
+    processCommands();
+}
+
 void MultiNeedle::setLoopSize (int _loopSize)
+{
+    if (isRenderThread()) setLoopSizeInternal (_loopSize);
+    else postCommand (loopSizeCommand, _loopSize);
+}
+
+void MultiNeedle::jumpTo (const int to)
+{
+    if (isRenderThread()) jumpToInternal (to);
+    else postCommand (jumpCommand, to);
+}
+
+void MultiNeedle::fadeAllOut()
+{
+    if (isRenderThread()) fadeAllOutInternal();
+    else postCommand (fadeAllOutCommand, 0);
+}
+
+void MultiNeedle::resetAll()
+{
+    if (isRenderThread()) resetAllInternal();
+    else postCommand (resetCommand, 0);
+}
+
+void MultiNeedle::setLoopSizeInternal (int _loopSize)
 {
     if (_loopSize == loopSize)return;
 
     loopSize = _loopSize;
-    ScopedLock lk (readMutex);
 
     if (_loopSize > 0)
     {
@@ -282,7 +371,7 @@ void MultiNeedle::setLoopSize (int _loopSize)
     }
 }
 
-void MultiNeedle::jumpTo (const int to)
+void MultiNeedle::jumpToInternal (const int to)
 {
     jassert (loopSize > 0);
     jassert (to >= 0);
@@ -293,7 +382,7 @@ void MultiNeedle::jumpTo (const int to)
 //        dbg++;
 //    }
 
-    fadeAllOut();
+    fadeAllOutInternal();
 
     if (FadeNeedle* fN = getMostConsumedNeedle (to))
     {
@@ -361,7 +450,7 @@ FadeNeedle*   MultiNeedle::consumeNextNeedle (int numSamples)
     }
 
 }
-void MultiNeedle::fadeAllOut()
+void MultiNeedle::fadeAllOutInternal()
 {
     for (auto& n : needles)
     {
@@ -369,7 +458,7 @@ void MultiNeedle::fadeAllOut()
     }
 }
 
-void MultiNeedle::resetAll()
+void MultiNeedle::resetAllInternal()
 {
     for (auto& n : needles)
     {
@@ -379,13 +468,20 @@ void MultiNeedle::resetAll()
 
 void MultiNeedle::addToBuffer ( BufferBlockList& originBufferList, AudioBuffer<float>& destBuffer, int numSamples, bool isLooping)
 {
+    applyPendingCommands();
+
+    if (loopSize <= 0)
+    {
+        numActiveNeedle = 0;
+        return;
+    }
+
     //    jassert(destBuffer.getNumChannels()>=originBuffer.getNumChannels());
     const int minComonChannels = jmin (destBuffer.getNumChannels(), originBufferList.getAllocatedNumChannels());
     // ensure buffer is larger than last possible read sample
     //  jassert(originBufferList.getAllocatedNumSample()>loopSize+fadeOutNumSamples);
-    jassert (loopSize > 0);
-    //
-    jassert (loopSize == originBufferList.getNumSamples());
+    // loop size may be applied a block after the buffer one when set from another thread
+    jassert (loopSize <= originBufferList.getAllocatedNumSample());
 
     const int nextPos = currentPos + numSamples;
 
@@ -421,7 +517,6 @@ void MultiNeedle::addToBuffer ( BufferBlockList& originBufferList, AudioBuffer<f
     numActiveNeedle = 0;
     float accumNeedle = 0;
     float accumNeedleSq = 0;
-    ScopedLock lk (readMutex);
 
     while ((fN = consumeNextNeedle (numSamples)))
     {
@@ -467,12 +562,7 @@ void MultiNeedle::addToBuffer ( BufferBlockList& originBufferList, AudioBuffer<f
         //      }
         //    }
 
-        AudioSampleBuffer tmpContiguous = originBufferList.getContiguousBuffer (curStartPos, numSamples);
-
-        for (int  i = minComonChannels - 1; i >= 0  ; i--)
-        {
-            destBuffer.addFromWithRamp (i, 0, tmpContiguous.getReadPointer (i), numSamples,  fN->getFadeValueStart(), fN->getFadeValueEnd());
-        }
+        originBufferList.addTo (destBuffer, minComonChannels, curStartPos, numSamples, fN->getFadeValueStart(), fN->getFadeValueEnd());
 
         //    if(fN->reverse){
         //      // not supported atm
@@ -507,7 +597,7 @@ void MultiNeedle::addToBuffer ( BufferBlockList& originBufferList, AudioBuffer<f
         {
             //      int firstPart = loopSize - currentPos;
             const int secondPart = nextPos - loopSize;
-            jumpTo (secondPart);
+            jumpToInternal (secondPart);
 
         }
         else
@@ -80,20 +80,59 @@ public:
     int loopSize;
     int numActiveNeedle;
     bool isStitching;
-    CriticalSection readMutex;
 
     MultiNeedle (int fIn = 512, int fOut = 512, int max = 10);
 
+    // control can be called from any thread, it is applied right away on the rendering thread
+    // and queued from other threads to be applied at the start of next addToBuffer, so rendering never locks
+    // before the first rendered block every control is queued
     void setLoopSize (int _loopSize);
     void jumpTo (const int to);
-    FadeNeedle*   consumeNextNeedle (int numSamples);
     void fadeAllOut();
     void resetAll();
+
+    // rendering thread only, applies queued controls now instead of in next addToBuffer
+    void applyPendingCommands();
+
+    FadeNeedle*   consumeNextNeedle (int numSamples);
     void addToBuffer ( BufferBlockList& originBuffer, AudioBuffer<float>& destBuffer, int numSamples, bool isLooping);
 
+    int getNumDroppedCommands() const {return numDroppedCommands.get();}
+
 
 
 private:
+    enum CommandType
+    {
+        loopSizeCommand = 0,
+        jumpCommand,
+        fadeAllOutCommand,
+        resetCommand
+    };
+
+    struct Command
+    {
+        CommandType type;
+        int value;
+    };
+
+    bool isRenderThread() const;
+    void postCommand (CommandType type, int value);
+    void processCommands();
+
+    void setLoopSizeInternal (int _loopSize);
+    void jumpToInternal (const int to);
+    void fadeAllOutInternal();
+    void resetAllInternal();
+
+    static const int commandQueueSize = 64;
+    AbstractFifo commandFifo;
+    Command commands[commandQueueSize];
+    // only taken by producers, rendering thread never waits on it
+    SpinLock producerLock;
+    Atomic<void*> renderThreadId;
+    Atomic<int> numDroppedCommands;
+
 
     FadeNeedle* getMostConsumedNeedle (const int time);
     FadeNeedle* getLessConsumedNeedle (const int time);
@@ -57,17 +57,21 @@ PlayableBuffer::PlayableBuffer (int numChannels, int numSamples, float _sampleRa
     lastState (BUFFER_STOPPED),
     stateChanged (false),
     numTimePlayed (0),
+    originRevision (0),
     sampleOffsetBeforeNewState (0),
     multiNeedle (512, 512)
     //tailRecordNeedle(0),
 
 #if BUFFER_CAN_STRETCH
     , stretchJob (nullptr)
+    , stretchedBlockList (1, 0)
+    , stretchOutput (0)
 #if RT_STRETCH
     , pendingTimeStretchRatio (1)
     , isStretchPending (false)
     , isStretchReady (false)
     , fadePendingStretch (256, 256)
+    , progressiveGain (0)
 #endif
 #endif
 
@@ -134,6 +138,9 @@ bool PlayableBuffer::processNextBlock (AudioBuffer<float>& buffer, sample_clk_t
 {
     bool succeeded = true;
 
+    // needle controls queued from other threads are applied before anything reads the needles
+    multiNeedle.applyPendingCommands();
+
     if (buffer.getNumSamples() != blockSize)
     {
         setBlockSize (buffer.getNumSamples());
@@ -176,6 +183,7 @@ bool PlayableBuffer::processNextBlock (AudioBuffer<float>& buffer, sample_clk_t
         bufferBlockList.setNumSample (getRecordedLength());
         fadeInOut();
         bufferBlockList.copyTo (originAudioBuffer, 0, 0, getRecordedLength());
+        originChanged();
 
     }
 
@@ -189,7 +197,6 @@ bool PlayableBuffer::processNextBlock (AudioBuffer<float>& buffer, sample_clk_t
     if (!processPendingRTStretch (buffer, time))
         readNextBlock (buffer, time, sampleOffsetBeforeNewState);
 
-    //  int stretchedSample = tmpBufferStretch.getNumSamples();
     if (originAudioBuffer.getNumSamples() == 0)
     {
         isStretchPending = false;
@@ -203,7 +210,7 @@ bool PlayableBuffer::processNextBlock (AudioBuffer<float>& buffer, sample_clk_t
 
             applyStretch();
 
-            if (isPlaying())setPlayNeedle ( time % tmpBufferStretch.getNumSamples());
+            if (isPlaying())setPlayNeedle ( time % getRecordedLength());
         }
         else if (!fadePendingStretch.isFadingOut())
         {
@@ -278,6 +285,7 @@ bool PlayableBuffer::writeAudioBlock (const AudioBuffer<float>& buffer, int from
 
     bufferBlockList.copyFrom (buffer, recordNeedle);
     recordNeedle += samplesToWrite;
+    bufferBlockList.setAccessPosition ((int) recordNeedle, true);
 
 
     return true;
@@ -310,7 +318,9 @@ inline void PlayableBuffer::readNextBlock (AudioBuffer<float>& buffer, sample_cl
 
     if (state == BUFFER_PLAYING && !isStretchPending)
     {
-        jassert (multiNeedle.loopSize == getRecordedLength() );
+        // a length set from another thread may not be queued yet, this thread applies it right away
+        if (multiNeedle.loopSize != getRecordedLength()) multiNeedle.setLoopSize (getRecordedLength());
+
         sample_clk_t targetTime = (time  + getRecordedLength()) % getRecordedLength();
 
         if (targetTime != playNeedle)
@@ -332,13 +342,14 @@ inline void PlayableBuffer::readNextBlock (AudioBuffer<float>& buffer, sample_cl
     //  buffer.clear();
     if (recordNeedle > 0 && !isRecording() )
     {
+        // same for a jump racing with this block
         if (isPlaying() && multiNeedle.currentPos != playNeedle && !isStretchPending)
         {
             multiNeedle.jumpTo (playNeedle);
-            jassertfalse;
         }
 
 
+        bufferBlockList.setAccessPosition (multiNeedle.currentPos);
         multiNeedle.addToBuffer (bufferBlockList, buffer, buffer.getNumSamples(), isPlaying());
         //    }
 
@@ -460,7 +471,12 @@ bool PlayableBuffer::isOrWasRecording() const {return (state == BUFFER_RECORDING
 //bool PlayableBuffer::isRecordingTail() const{return  recordNeedle>0 && !isRecording() && tailRecordNeedle<2*getNumSampleFadeOut();}
 //void PlayableBuffer::stopRecordingTail() {tailRecordNeedle = 2*getNumSampleFadeOut();}
 
-void PlayableBuffer::startRecord() {recordNeedle = 0; tailRecordNeedle = 0; multiNeedle.setLoopSize (0); playNeedle = 0; globalPlayNeedle = 0; originAudioBuffer.setSize (0, 0, false, false, true);}
+void PlayableBuffer::startRecord() {recordNeedle = 0; tailRecordNeedle = 0; multiNeedle.setLoopSize (0); playNeedle = 0; globalPlayNeedle = 0; originAudioBuffer.setSize (0, 0, false, false, true); originChanged();}
+
+void PlayableBuffer::originChanged()
+{
+    stretchCache.setSourceRevision (++originRevision);
+}
 inline void PlayableBuffer::startPlay() {multiNeedle.setLoopSize (recordNeedle); setPlayNeedle (0);}
 
 
@@ -531,10 +547,13 @@ void PlayableBuffer::fadeInOut()
 {
     int fadeIn = multiNeedle.fadeInNumSamples;
     int fadeOut = multiNeedle.fadeOutNumSamples;
+    const SpinLock::ScopedLockType lk (bufferBlockList.getBlockLock());
     auto startBlock = bufferBlockList.getUnchecked (0);
     startBlock->applyGainRamp ( 0, fadeIn, 0.0f, 1.f);
+    bufferBlockList.markBlockWritten (0);
 
     int lIdx = floor (bufferBlockList.getNumSamples() / bufferBlockList.bufferBlockSize);
+    bufferBlockList.markBlockWritten (lIdx);
     auto endBlock = bufferBlockList.getUnchecked (lIdx);
     int endPoint = bufferBlockList.getNumSamples() - (lIdx * bufferBlockList.bufferBlockSize);
     jassert (endPoint > 0);
@@ -548,6 +567,7 @@ void PlayableBuffer::fadeInOut()
         {
             auto eendBlock = bufferBlockList.getUnchecked (lIdx - 1);
             eendBlock->applyGainRamp (bufferBlockList.bufferBlockSize - firstPart, firstPart, 1.0f, ratio);
+            bufferBlockList.markBlockWritten (lIdx - 1);
             endBlock->applyGainRamp (0, endPoint, ratio, 0.0f);
         }
         else
@@ -594,34 +614,49 @@ void PlayableBuffer::setTimeRatio (const double ratio)
 #endif
 
 
+#if PROCESS_FINAL_STRETCH
+    ThreadPool* tp = getEngineThreadPool();
+
+    if (tp->contains (stretchJob))
+    {
+        ScopedLock lk (stretchJob->jobLock);
+        stretchJob->signalJobShouldExit();
+        //      int64 mil = Time::currentTimeMillis();
+        tp->waitForJobToFinish (stretchJob, -1);
+        //      DBG("Waited : " <<(Time::currentTimeMillis() - mil));
+    }
+    else stretchJob = nullptr;
+
+    // stop playing samples of a cancelled stretch
+    stretchOutput = 0;
+#endif
+
     if (ratio != 1.0)
     {
 #if PROCESS_FINAL_STRETCH
-        ThreadPool* tp = getEngineThreadPool();
+        // previously used tempo, no need to stretch again
+        AudioSampleBuffer render;
 
-        if (tp->contains (stretchJob))
+        if (stretchCache.lookUp (ratio, getOriginRevision(), render, onsetSamples))
         {
-            ScopedLock lk (stretchJob->jobLock);
-            stretchJob->signalJobShouldExit();
-            //      int64 mil = Time::currentTimeMillis();
-            tp->waitForJobToFinish (stretchJob, -1);
-            //      DBG("Waited : " <<(Time::currentTimeMillis() - mil));
+            stretchJob = nullptr;
+            multiNeedle.fadeAllOut();
+            publishStretch (render);
+            return;
         }
-        else stretchJob = nullptr;
 
-        stretchJob = new StretcherJob (this, ratio);
+        stretchJob = new StretcherJob (this, ratio, tp);
         tp->addJob (stretchJob, true);
 #else
         bufferBlockList.setNumSample(originAudioBuffer.getNumSamples());
-        bufferBlockList.copyFrom (originAudioBuffer, 0);
+        bufferBlockList.writeFrom (originAudioBuffer, 0, 0, originAudioBuffer.getNumSamples());
         setRecordedLength (originAudioBuffer.getNumSamples());
 #endif
     }
     else
     {
 
-        tmpBufferStretch.makeCopyOf(originAudioBuffer);
-        isStretchReady = true;
+        publishStretch (originAudioBuffer);
 
 //        bufferBlockList.copyFrom (originAudioBuffer, 0);
 //        setRecordedLength (originAudioBuffer.getNumSamples());
@@ -631,6 +666,45 @@ void PlayableBuffer::setTimeRatio (const double ratio)
 
 
 
+}
+
+void PlayableBuffer::beginStretchOutput (int numSamples)
+{
+    isStretchReady = false;
+    // readers stop using stretched samples before the list is resized
+    stretchOutput = 0;
+    stretchedBlockList.allocateSamples (getNumChannels(), numSamples);
+    stretchedBlockList.setNumSample (numSamples);
+    stretchOutput = packStretchOutput (numSamples, 0);
+}
+
+void PlayableBuffer::writeStretchOutput (const AudioSampleBuffer& source, int listStartSample, int numSamples)
+{
+    const int targetLength = getStretchTargetLength();
+
+    for (int done = 0 ; done < numSamples ;)
+    {
+        const int num = jmin ((int) stretchPublishChunkSize, numSamples - done);
+        // never holds the lock taken by the audio thread while copying
+        stretchedBlockList.writeFrom (source, listStartSample + done, done, num);
+        done += num;
+
+        const int64 published = packStretchOutput (targetLength, listStartSample + done);
+
+        for (;;)
+        {
+            const int64 current = stretchOutput.get();
+
+            if ((int) (current >> 32) != targetLength || stretchOutput.compareAndSetBool (published, current)) break;
+        }
+    }
+}
+
+void PlayableBuffer::publishStretch (const AudioSampleBuffer& render)
+{
+    beginStretchOutput (render.getNumSamples());
+    writeStretchOutput (render, 0, render.getNumSamples());
+    isStretchReady = true;
 }
 #endif
 
@@ -669,7 +743,7 @@ void PlayableBuffer::initRTStretch()
     stretchNeedle = 0;
 }
 
-bool PlayableBuffer::processPendingRTStretch (AudioBuffer<float>& b, sample_clk_t /*time*/)
+bool PlayableBuffer::processPendingRTStretch (AudioBuffer<float>& b, sample_clk_t time)
 {
 
     if (isStretchPending )
@@ -757,6 +831,8 @@ bool PlayableBuffer::processPendingRTStretch (AudioBuffer<float>& b, sample_clk_
         RTStretcher->retrieve (outBuf, jmin (outNumSample, available));
         double ratio = jmin (stretchNeedle * 1.0 / originNumSamples, 1.0);
 
+        mixProgressiveStretch (b, time);
+
         b.applyGainRamp (0, outNumSample,
                          lastFade,
                          curFade);
@@ -776,10 +852,13 @@ bool PlayableBuffer::processPendingRTStretch (AudioBuffer<float>& b, sample_clk_
 void PlayableBuffer::applyStretch()
 {
     DBG ("apply stretch");
-    int targetNumSamples = tmpBufferStretch.getNumSamples();
+    int targetNumSamples = getStretchTargetLength();
+    stretchOutput = 0;
+    progressiveGain = 0;
     //  playNeedle =  0;
+    // no copy, previous audio is kept in stretchedBlockList for next stretch
+    bufferBlockList.swapContentWith (stretchedBlockList);
     setRecordedLength (targetNumSamples);
-    bufferBlockList.copyFrom (tmpBufferStretch, 0);
     isStretchReady = false;
     isStretchPending = false;
     pendingTimeStretchRatio = 1.0;
@@ -788,4 +867,37 @@ void PlayableBuffer::applyStretch()
 
 
 };
+
+void PlayableBuffer::mixProgressiveStretch (AudioBuffer<float>& b, sample_clk_t time)
+{
+    // one read for both, the stretch may be restarted meanwhile
+    const int64 output = stretchOutput.get();
+    const int targetLength = (int) (output >> 32);
+    const int watermark = (int) (output & 0xffffffff);
+    const int numSamples = b.getNumSamples();
+
+    if (targetLength <= 0 || numSamples == 0)
+    {
+        progressiveGain = 0;
+        return;
+    }
+
+    // same position as the one taken when the stretch is applied
+    const int pos = (int) (time % targetLength);
+    const int numReady = watermark >= targetLength ? numSamples : jlimit (0, numSamples, watermark - pos);
+    const float targetGain = numReady == numSamples ? 1.0f : 0.0f;
+
+    if (progressiveGain == 0 && targetGain == 0) return;
+
+    // crossfade between real-time stretch and published samples, falling back to real-time if playback outruns the stretcher
+    b.applyGainRamp (0, numSamples, 1.0f - progressiveGain, 1.0f - targetGain);
+
+    if (numReady > 0)
+    {
+        AudioSampleBuffer ready (b.getArrayOfWritePointers(), b.getNumChannels(), numReady);
+        stretchedBlockList.addTo (ready, b.getNumChannels(), pos, numReady, progressiveGain, progressiveGain + (targetGain - progressiveGain) * numReady / numSamples);
+    }
+
+    progressiveGain = targetGain;
+}
 #endif
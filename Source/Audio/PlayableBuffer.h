@@ -23,6 +23,7 @@
 #include "AudioConfig.h"
 #include "AudioHelpers.h"
 #include "BufferBlockList.h"
+#include "StretchCache.h"
 
 
 
@@ -123,6 +124,11 @@ public :
 
     int numTimePlayed;
     AudioSampleBuffer originAudioBuffer;
+    // to be called when originAudioBuffer content is replaced, outdates cached stretched renders
+    // called on the audio thread, only bumps revisions
+    void originChanged();
+    uint32 getOriginRevision() const {return originRevision.get();}
+    StretchCache stretchCache;
     BufferBlockList bufferBlockList;
     MultiNeedle multiNeedle;
 
@@ -155,6 +161,9 @@ private:
     void initRTStretch();
     void applyStretch();
     bool processPendingRTStretch (AudioBuffer<float>& b, sample_clk_t time);
+    // replaces real-time stretched output by published stretched samples when they cover the block
+    void mixProgressiveStretch (AudioBuffer<float>& b, sample_clk_t time);
+    float progressiveGain;
     ScopedPointer<RubberBand::RubberBandStretcher> RTStretcher;
     float pendingTimeStretchRatio;
     int processedStretch;
@@ -167,11 +176,25 @@ private:
 #if BUFFER_CAN_STRETCH
     friend class StretcherJob;
     WeakReference<StretcherJob> stretchJob;
-    AudioSampleBuffer tmpBufferStretch;
+
+    // stretched audio is written here and swapped with bufferBlockList once complete
+    // samples below the watermark are final and can be played while the rest is computed
+    BufferBlockList stretchedBlockList;
+    // target length (high bits) and watermark packed in one atomic, so that a reader never mixes two stretches
+    Atomic<int64> stretchOutput;
+    static int64 packStretchOutput (int targetLength, int watermark) {return ((int64) targetLength << 32) | (uint32) watermark;}
+    int getStretchTargetLength() const {return (int) (stretchOutput.get() >> 32);}
+    int getStretchWatermark() const {return (int) (stretchOutput.get() & 0xffffffff);}
+    void beginStretchOutput (int numSamples);
+    // writes final samples in small chunks, advancing the watermark after each one unless another stretch began
+    void writeStretchOutput (const AudioSampleBuffer& source, int listStartSample, int numSamples);
+    static const int stretchPublishChunkSize = 16384;
+    void publishStretch (const AudioSampleBuffer& render);
     bool isStretchReady;
 
 #endif
 
+    Atomic<uint32> originRevision;
     int sampleOffsetBeforeNewState;
     BufferState state;
     BufferState lastState;
@@ -0,0 +1,215 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#include "StretchCache.h"
+
+
+StretchCache::StretchCache (int64 _memoryBudget):
+    memoryBudget (jmax ((int64) 0, _memoryBudget)),
+    usedBytes (0),
+    sourceRevision (0),
+    useCounter (0),
+    numHits (0),
+    numMisses (0)
+{
+}
+
+
+void StretchCache::setMemoryBudget (int64 numBytes)
+{
+    OwnedArray<Entry> removed;
+    const ScopedLock lk (lock);
+    memoryBudget = jmax ((int64) 0, numBytes);
+    evictToFit (memoryBudget, removed);
+}
+
+int64 StretchCache::getMemoryBudget() const
+{
+    const ScopedLock lk (lock);
+    return memoryBudget;
+}
+
+
+void StretchCache::setSourceRevision (uint32 revision)
+{
+    sourceRevision = revision;
+}
+
+
+bool StretchCache::lookUp (double ratio, uint32 revision, AudioSampleBuffer& render, Array<int>& onsets)
+{
+    OwnedArray<Entry> removed;
+    const ScopedLock lk (lock);
+    pruneStaleEntries (removed);
+    Entry* e = revision == sourceRevision.get() ? find (ratio) : nullptr;
+
+    if (e == nullptr)
+    {
+        ++numMisses;
+        return false;
+    }
+
+    ++numHits;
+    e->lastUse = ++useCounter;
+    render.makeCopyOf (e->render);
+    onsets = e->onsets;
+    return true;
+}
+
+
+void StretchCache::add (double ratio, uint32 revision, const AudioSampleBuffer& render, const Array<int>& onsets)
+{
+    if (Entry* e = createEntry (ratio, revision, render.getNumChannels(), render.getNumSamples(), onsets))
+    {
+        for (int c = 0 ; c < render.getNumChannels() ; c++) {e->render.copyFrom (c, 0, render, c, 0, render.getNumSamples());}
+
+        insertEntry (e);
+    }
+}
+
+void StretchCache::add (double ratio, uint32 revision, BufferBlockList& render, int numSamples, const Array<int>& onsets)
+{
+    if (Entry* e = createEntry (ratio, revision, render.getAllocatedNumChannels(), numSamples, onsets))
+    {
+        render.readTo (e->render, 0, 0, numSamples);
+        insertEntry (e);
+    }
+}
+
+
+StretchCache::Entry* StretchCache::createEntry (double ratio, uint32 revision, int numChannels, int numSamples, const Array<int>& onsets) const
+{
+    if (revision != sourceRevision.get()) return nullptr;
+
+    const int64 numBytes = (int64) numChannels * numSamples * sizeof (float);
+
+    if (numBytes == 0 || numBytes > getMemoryBudget()) return nullptr;
+
+    Entry* e = new Entry();
+    e->ratio = ratio;
+    e->revision = revision;
+    e->render.setSize (numChannels, numSamples);
+    e->onsets = onsets;
+    e->lastUse = 0;
+    return e;
+}
+
+void StretchCache::insertEntry (Entry* e)
+{
+    ScopedPointer<Entry> newEntry (e);
+    OwnedArray<Entry> removed;
+    const ScopedLock lk (lock);
+
+    // source changed or budget lowered while copying
+    if (e->revision != sourceRevision.get() || e->getNumBytes() > memoryBudget) return;
+
+    pruneStaleEntries (removed);
+
+    if (Entry* existing = find (e->ratio)) removeEntry (entries.indexOf (existing), removed);
+
+    evictToFit (memoryBudget - e->getNumBytes(), removed);
+
+    e->lastUse = ++useCounter;
+    usedBytes += e->getNumBytes();
+    entries.add (newEntry.release());
+}
+
+
+void StretchCache::clear()
+{
+    OwnedArray<Entry> removed;
+    const ScopedLock lk (lock);
+    removed.swapWith (entries);
+    usedBytes = 0;
+}
+
+
+int StretchCache::getNumEntries() const
+{
+    const ScopedLock lk (lock);
+    const uint32 revision = sourceRevision.get();
+    int num = 0;
+
+    for (auto* e : entries) {if (e->revision == revision) num++;}
+
+    return num;
+}
+
+int64 StretchCache::getUsedBytes() const
+{
+    const ScopedLock lk (lock);
+    const uint32 revision = sourceRevision.get();
+    int64 num = 0;
+
+    for (auto* e : entries) {if (e->revision == revision) num += e->getNumBytes();}
+
+    return num;
+}
+
+float StretchCache::getHitRate() const
+{
+    const int hits = numHits.get();
+    const int total = hits + numMisses.get();
+    return total > 0 ? hits * 1.0f / total : 0.0f;
+}
+
+
+StretchCache::Entry* StretchCache::find (double ratio) const
+{
+    // ratios come from the same bpm divisions, only rounding noise is tolerated
+    for (auto* e : entries)
+    {
+        if (std::abs (e->ratio - ratio) <= 1e-9 * ratio) return e;
+    }
+
+    return nullptr;
+}
+
+
+void StretchCache::removeEntry (int index, OwnedArray<Entry>& removed)
+{
+    Entry* e = entries.removeAndReturn (index);
+    usedBytes -= e->getNumBytes();
+    removed.add (e);
+}
+
+void StretchCache::pruneStaleEntries (OwnedArray<Entry>& removed)
+{
+    const uint32 revision = sourceRevision.get();
+
+    for (int i = entries.size() ; --i >= 0;)
+    {
+        if (entries.getUnchecked (i)->revision != revision) removeEntry (i, removed);
+    }
+}
+
+void StretchCache::evictToFit (int64 budget, OwnedArray<Entry>& removed)
+{
+    while (usedBytes > budget && entries.size() > 0)
+    {
+        int oldest = 0;
+
+        for (int i = 1 ; i < entries.size() ; i++)
+        {
+            // wrap safe comparison of use counters
+            if ((int32) (entries.getUnchecked (i)->lastUse - entries.getUnchecked (oldest)->lastUse) < 0) oldest = i;
+        }
+
+        removeEntry (oldest, removed);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include "BufferBlockList.h"
+
+/*
+ least recently used renders of a buffer stretched at different ratios
+
+ renders are keyed by time ratio and by the revision of the source audio they were computed from,
+ so switching back to a previously used tempo doesn't need a new offline stretch
+ the cache is kept within a memory budget, the least recently used renders are evicted first
+ the audio thread only bumps the source revision : outdated renders are pruned by the next call from another thread,
+ and renders are copied and freed out of the lock
+ */
+class StretchCache
+{
+public:
+    StretchCache (int64 memoryBudget = 64 * 1024 * 1024);
+
+    // 0 disables caching
+    void setMemoryBudget (int64 numBytes);
+    int64 getMemoryBudget() const;
+
+    // source audio has changed, renders of other revisions are dropped later
+    // any thread, never locks nor frees
+    void setSourceRevision (uint32 revision);
+
+    // copies the render and its onsets if found, counts as a hit or a miss
+    bool lookUp (double ratio, uint32 revision, AudioSampleBuffer& render, Array<int>& onsets);
+    // renders bigger than the budget or of an outdated revision are ignored
+    void add (double ratio, uint32 revision, const AudioSampleBuffer& render, const Array<int>& onsets);
+    void add (double ratio, uint32 revision, BufferBlockList& render, int numSamples, const Array<int>& onsets);
+    void clear();
+
+    int getNumEntries() const;
+    int64 getUsedBytes() const;
+    int getNumHits() const {return numHits.get();}
+    int getNumMisses() const {return numMisses.get();}
+    float getHitRate() const;
+
+private:
+    struct Entry
+    {
+        double ratio;
+        uint32 revision;
+        AudioSampleBuffer render;
+        Array<int> onsets;
+        uint32 lastUse;
+
+        int64 getNumBytes() const {return (int64) render.getNumChannels() * render.getNumSamples() * sizeof (float);}
+    };
+
+    Entry* find (double ratio) const;
+    // returns nullptr if the render can't be cached, the render is allocated but not filled
+    Entry* createEntry (double ratio, uint32 revision, int numChannels, int numSamples, const Array<int>& onsets) const;
+    void insertEntry (Entry* e);
+    // lock must be held, removed entries are moved to removed so that they are freed out of the lock
+    void pruneStaleEntries (OwnedArray<Entry>& removed);
+    void evictToFit (int64 budget, OwnedArray<Entry>& removed);
+    void removeEntry (int index, OwnedArray<Entry>& removed);
+
+    CriticalSection lock;
+    OwnedArray<Entry> entries;
+    int64 memoryBudget;
+    int64 usedBytes;
+    Atomic<uint32> sourceRevision;
+    uint32 useCounter;
+
+    Atomic<int> numHits, numMisses;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StretchCache)
+};
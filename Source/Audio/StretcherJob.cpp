@@ -27,6 +27,235 @@ using namespace RubberBand;
 
 
 
+namespace
+{
+    const RubberBandStretcher::Options offlineOptions = RubberBandStretcher::OptionProcessOffline
+                                                        //                                       | RubberBandStretcher::OptionTransientsMixed
+                                                        | RubberBandStretcher::OptionTransientsSmooth
+                                                        //| RubberBandStretcher::OptionPhaseAdaptive
+                                                        | RubberBandStretcher::OptionThreadingNever
+                                                        | RubberBandStretcher::OptionWindowStandard
+                                                        //                                       | RubberBandStretcher::OptionStretchElastic
+                                                        | RubberBandStretcher::OptionStretchPrecise;
+
+    // start of the strongest energy rise within range of pos
+    int findTransientNear (const AudioSampleBuffer& b, int numSamples, int pos, int range)
+    {
+        const int frame = 512;
+        int best = pos;
+        float bestRise = 0;
+        float lastEnergy = -1;
+
+        for (int f = jmax (0, pos - range) ; f + frame <= jmin (numSamples, pos + range) ; f += frame)
+        {
+            float energy = 0;
+
+            for (int c = 0 ; c < b.getNumChannels() ; c++)
+            {
+                float sumSquares = 0, peak = 0;
+                sumSquaresAndPeak (b.getReadPointer (c, f), frame, sumSquares, peak);
+                energy += sumSquares;
+            }
+
+            if (lastEnergy >= 0 && energy - lastEnergy > bestRise)
+            {
+                bestRise = energy - lastEnergy;
+                best = f;
+            }
+
+            lastEnergy = energy;
+        }
+
+        return best;
+    }
+}
+
+
+struct StretchSegment
+{
+    int start, end;
+    int paddedStart, paddedEnd;
+    AudioSampleBuffer output;
+    int numProduced;
+    Array<int> onsets;
+    Atomic<int> finished;
+};
+
+// segments shared by a StretcherJob and its helpers, each worker claims segments until none is left
+class StretchSegments : public ReferenceCountedObject
+{
+public:
+    typedef ReferenceCountedObjectPtr<StretchSegments> Ptr;
+
+    StretchSegments (const AudioSampleBuffer& _origin, double _ratio, int _sampleRate, int _blockSize):
+        origin (_origin),
+        numChannels (_origin.getNumChannels()),
+        ratio (_ratio),
+        sampleRate (_sampleRate),
+        blockSize (_blockSize),
+        nextSegment (0),
+        numFinished (0),
+        shouldStop (0)
+    {
+    }
+
+    // afterSegment is called after each segment stretched by this worker
+    void work (ThreadPoolJob* job, std::function<void()> afterSegment = nullptr)
+    {
+        // per worker scratch, reused for every segment and chunk
+        HeapBlock<const float*> in;
+        HeapBlock<float*> out;
+        AudioSampleBuffer discard;
+
+        for (;;)
+        {
+            const int idx = ++nextSegment - 1;
+
+            // origin may be gone once all segments are claimed
+            if (idx >= segments.size()) break;
+
+            if (in == nullptr)
+            {
+                in.malloc ((size_t) numChannels);
+                out.malloc ((size_t) numChannels);
+                discard.setSize (numChannels, blockSize);
+            }
+
+            stretch (*segments.getUnchecked (idx), job, in, out, discard);
+            segments.getUnchecked (idx)->finished = 1;
+            ++numFinished;
+            segmentFinished.signal();
+
+            if (afterSegment) afterSegment();
+        }
+    }
+
+    bool isCancelled (ThreadPoolJob* job)
+    {
+        if (job->shouldExit()) shouldStop = 1;
+
+        return shouldStop.get() != 0;
+    }
+
+    const AudioSampleBuffer& origin;
+    const int numChannels;
+    const double ratio;
+    const int sampleRate;
+    const int blockSize;
+
+    OwnedArray<StretchSegment> segments;
+    Atomic<int> nextSegment, numFinished, shouldStop;
+    WaitableEvent segmentFinished;
+
+private:
+    void stretch (StretchSegment& s, ThreadPoolJob* job, const float** in, float** out, AudioSampleBuffer& discard)
+    {
+        const int len = s.paddedEnd - s.paddedStart;
+        s.numProduced = 0;
+
+        if (isCancelled (job)) return;
+
+        RubberBandStretcher st ((size_t) sampleRate, (size_t) numChannels, offlineOptions);
+        st.setDebugLevel (0);
+        st.setPitchScale (1.0);
+        st.setTimeRatio (ratio);
+        st.setExpectedInputDuration ((size_t) len);
+        st.setMaxProcessSize ((size_t) blockSize);
+
+        for (int pos = 0 ; pos < len ; pos += blockSize)
+        {
+            if (isCancelled (job)) return;
+
+            const int n = jmin (blockSize, len - pos);
+
+            for (int c = 0 ; c < numChannels ; c++) {in[c] = origin.getReadPointer (c, s.paddedStart + pos);}
+
+            st.study (in, (size_t) n, pos + n >= len);
+        }
+
+        for (int pos = 0 ; pos < len ; pos += blockSize)
+        {
+            if (isCancelled (job)) return;
+
+            const int n = jmin (blockSize, len - pos);
+
+            for (int c = 0 ; c < numChannels ; c++) {in[c] = origin.getReadPointer (c, s.paddedStart + pos);}
+
+            st.process (in, (size_t) n, pos + n >= len);
+
+            int available;
+
+            while ((available = st.available()) > 0)
+            {
+                const int room = s.output.getNumSamples() - s.numProduced;
+
+                if (room > 0)
+                {
+                    const int toRetrieve = jmin (available, room);
+
+                    for (int c = 0 ; c < numChannels ; c++) {out[c] = s.output.getWritePointer (c, s.numProduced);}
+
+                    s.numProduced += (int) st.retrieve (out, (size_t) toRetrieve);
+                }
+                else
+                {
+                    // more than expected, only keep the nominal length
+                    for (int c = 0 ; c < numChannels ; c++) {out[c] = discard.getWritePointer (c);}
+
+                    st.retrieve (out, (size_t) jmin (available, discard.getNumSamples()));
+                }
+            }
+        }
+
+        std::vector<int> tp = st.getExactTimePoints();
+        const int inc = (int) st.getInputIncrement();
+
+        for (size_t i = 0 ; i < tp.size() ; i++)
+        {
+            const int onset = s.paddedStart + tp[i] * inc;
+
+            if (onset >= s.start && onset < s.end) s.onsets.add (onset);
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (StretchSegments)
+};
+
+// helps the job owning segments when a pool thread is free
+class StretchSegmentsHelperJob : public ThreadPoolJob
+{
+public:
+    StretchSegmentsHelperJob (StretchSegments* s): ThreadPoolJob ("stretchHelper"), segments (s) {}
+
+    JobStatus runJob() override
+    {
+        segments->work (this);
+        return jobHasFinished;
+    }
+
+    StretchSegments::Ptr segments;
+};
+
+
+StretcherJob::StretcherJob (PlayableBuffer* pb, double _ratio, ThreadPool* _helperPool, int _maxNumWorkers):
+    ThreadPoolJob ("stretch"),
+    owner (pb),
+    originNumSamples (0),
+    originRevision (0),
+    targetNumSamples (0),
+    ratio (_ratio),
+    helperPool (_helperPool),
+    maxNumWorkers (_maxNumWorkers > 0 ? _maxNumWorkers : jmax (1, SystemStats::getNumCpus())),
+    numSegments (0)
+{
+}
+
+StretcherJob::~StretcherJob()
+{
+    masterReference.clear();
+}
+
+
 void StretcherJob::initStretcher (int sampleRate, int numChannels)
 {
     if (sampleRate == 0)
@@ -36,17 +265,7 @@ void StretcherJob::initStretcher (int sampleRate, int numChannels)
 
     stretcher = new    RubberBandStretcher (sampleRate, //size_t sampleRate,
                                             numChannels,//size_t channels,
-                                            RubberBandStretcher::OptionProcessOffline
-                                            //                                       | RubberBandStretcher::OptionTransientsMixed
-                                            | RubberBandStretcher::OptionTransientsSmooth
-                                            //| RubberBandStretcher::OptionPhaseAdaptive
-                                            | RubberBandStretcher::OptionThreadingNever
-                                            | RubberBandStretcher::OptionWindowStandard
-
-                                            //                                       | RubberBandStretcher::OptionStretchElastic
-                                            | RubberBandStretcher::OptionStretchPrecise
-
-                                            //Options options = DefaultOptions,
+                                            offlineOptions
                                             //double initialTimeRatio = 1.0,
                                             //double initialPitchScale = 1.0
                                             );
@@ -54,7 +273,7 @@ void StretcherJob::initStretcher (int sampleRate, int numChannels)
     stretcher->setDebugLevel (0);
     stretcher->setPitchScale (1.0);
 
-
+    inPointers.malloc ((size_t) numChannels);
 
 }
 
@@ -64,11 +283,44 @@ void StretcherJob::initStretcher (int sampleRate, int numChannels)
 
 ThreadPoolJob::JobStatus StretcherJob::runJob()
 {
-    owner->isStretchReady = false;
-    int processed = 0;
-    int block = tmpStretchBuf.bufferBlockSize;
-
     originNumSamples = owner->originAudioBuffer.getNumSamples();
+    originRevision = owner->getOriginRevision();
+    targetNumSamples = (int) (originNumSamples * ratio);
+    jassert (targetNumSamples != 0);
+    owner->multiNeedle.fadeAllOut();
+
+    // stretched samples are published progressively in owner->stretchedBlockList
+    owner->beginStretchOutput (targetNumSamples);
+
+    Array<int> onsets;
+    numSegments = 0;
+
+    const bool parallel = maxNumWorkers > 1 && originNumSamples >= 2 * minSegmentSeconds * (int) owner->sampleRate;
+    const bool succeeded = parallel ? runParallel (onsets) : runSerial (onsets);
+
+    if (succeeded && !shouldExit() )
+    {
+        ScopedTryLock lk (jobLock);
+
+        if (lk.isLocked())
+        {
+            jassert (owner->isStretchReady == false);
+            jassert (owner->getStretchWatermark() == targetNumSamples);
+            owner->onsetSamples.swapWith (onsets);
+            owner->onsetSamples.sort();
+            owner->stretchCache.add (ratio, originRevision, owner->stretchedBlockList, targetNumSamples, owner->onsetSamples);
+            owner->isStretchReady = true;
+        }
+    }
+
+    return jobHasFinished;
+}
+
+
+bool StretcherJob::runSerial (Array<int>& onsets)
+{
+    int processed = 0;
+    int block = processBlockSize;
 
     while (!shouldExit() && processed < originNumSamples)
     {
@@ -78,8 +330,6 @@ ThreadPoolJob::JobStatus StretcherJob::runJob()
     processed = 0;
     int read = 0;
     int produced = 0;
-    tmpStretchBuf.setNumChannels (owner->getNumChannels());
-    owner->multiNeedle.fadeAllOut();
 
     while (!shouldExit() && processed < originNumSamples)
     {
@@ -93,55 +343,159 @@ ThreadPoolJob::JobStatus StretcherJob::runJob()
 
     }
 
-    if (!shouldExit() )
+    if (shouldExit()) return false;
+
+    int diffSample = abs (produced - targetNumSamples);
+
+    if (diffSample > 128)
     {
-        ScopedTryLock lk (jobLock);
+        jassertfalse;
+    }
 
-        if (lk.isLocked())
-        {
 
-            int targetNumSamples = originNumSamples * ratio;
-            jassert (targetNumSamples != 0);
+    double actualRatio = produced * 1.0 / originNumSamples;
+    jassert (fabs (ratio - actualRatio) < 0.01 );
 
-            int diffSample = abs (produced - targetNumSamples);
+    // pad if the stretcher gave a bit less than expected
+    if (produced < targetNumSamples)
+    {
+        outScratch.setSize (owner->getNumChannels(), targetNumSamples - produced, false, false, true);
+        outScratch.clear();
+        owner->writeStretchOutput (outScratch, produced, targetNumSamples - produced);
+    }
 
-            if (diffSample > 128)
-            {
-                jassertfalse;
-            }
+    std::vector<int> tp = stretcher->getExactTimePoints();
+    int inc = stretcher->getInputIncrement();
 
+    for (size_t i = 0 ; i < tp.size(); i++)
+    {
+        onsets.add (tp[i]*inc);
+    }
 
-            double actualRatio = produced * 1.0 / originNumSamples;
-            jassert (fabs (ratio - actualRatio) < 0.01 );
-            tmpStretchBuf.setNumSample (targetNumSamples);
-            jassert (owner->isStretchReady == false);
-            std::vector<int> tp = stretcher->getExactTimePoints();
-            owner->onsetSamples.clear() ;
-            int inc = stretcher->getInputIncrement();
+    //    owner->fadeInOut(owner->fadeSamples, 0);
 
-            for (size_t i = 0 ; i < tp.size(); i++)
-            {
-                owner->onsetSamples.add (tp[i]*inc);
-            }
-            owner->onsetSamples.sort();
+    int dbg = stretcher->available();
+    jassert (dbg <= 0);
 
-            //      std::swap(owner->tmpBufferBlockList, tmpStretchBuf);
-            owner->tmpBufferStretch.setSize (tmpStretchBuf.getAllocatedNumChannels(), tmpStretchBuf.getNumSamples());
-            tmpStretchBuf.copyTo (owner->tmpBufferStretch, 0);
-            owner->isStretchReady = true;
+    return true;
+}
+
+
+bool StretcherJob::runParallel (Array<int>& onsets)
+{
+    const AudioSampleBuffer& origin = owner->originAudioBuffer;
+    const int minSegmentLength = minSegmentSeconds * (int) owner->sampleRate;
+    numSegments = jmax (2, jmin (maxNumWorkers * 2, originNumSamples / minSegmentLength));
 
+    StretchSegments::Ptr segments = new StretchSegments (origin, ratio, (int) owner->sampleRate, processBlockSize);
 
-            //    int dbg =stretcher->getSamplesRequired();
-            //    jassert(dbg<=0);
+    // seams are placed so that their crossfade ends right before a transient
+    int segmentStart = 0;
 
-            //    owner->fadeInOut(owner->fadeSamples, 0);
+    for (int i = 0 ; i < numSegments ; i++)
+    {
+        int segmentEnd = originNumSamples;
 
-            int dbg = stretcher->available();
-            jassert (dbg <= 0);
+        if (i < numSegments - 1)
+        {
+            const int nominal = (int) ((int64) originNumSamples * (i + 1) / numSegments);
+            const int transient = findTransientNear (origin, originNumSamples, nominal, originNumSamples / numSegments / 4);
+            segmentEnd = jlimit (segmentStart + 4 * segmentOverlap, originNumSamples - 4 * segmentOverlap, transient - segmentOverlap);
         }
+
+        StretchSegment* s = segments->segments.add (new StretchSegment());
+        s->start = segmentStart;
+        s->end = segmentEnd;
+        s->paddedStart = jmax (0, segmentStart - segmentOverlap);
+        s->paddedEnd = jmin (originNumSamples, segmentEnd + segmentOverlap);
+        s->output.setSize (origin.getNumChannels(), roundToInt ((s->paddedEnd - s->paddedStart) * ratio) + 1);
+        s->numProduced = 0;
+
+        segmentStart = segmentEnd;
     }
 
-    return jobHasFinished;
+    if (helperPool != nullptr)
+    {
+        for (int i = 0 ; i < jmin (maxNumWorkers - 1, numSegments - 1) ; i++) {helperPool->addJob (new StretchSegmentsHelperJob (segments), true);}
+    }
+
+    int numAssembled = 0;
+    segments->work (this, [&] {assembleSegments (*segments, numAssembled);});
+
+    // helpers may still be stretching the segments they claimed
+    while (segments->numFinished.get() < numSegments)
+    {
+        segments->segmentFinished.wait (5);
+        assembleSegments (*segments, numAssembled);
+    }
+
+    if (segments->shouldStop.get() != 0 || shouldExit()) return false;
+
+    assembleSegments (*segments, numAssembled);
+    jassert (numAssembled == numSegments);
+
+    for (auto* s : segments->segments) {onsets.addArray (s->onsets);}
+
+    return true;
+}
+
+
+void StretcherJob::assembleSegments (StretchSegments& segments, int& numAssembled)
+{
+    // a region ends where the crossfade with next segment starts, so it only needs finished segments
+    while (numAssembled < numSegments && segments.segments.getUnchecked (numAssembled)->finished.get() != 0)
+    {
+        if (segments.shouldStop.get() != 0) return;
+
+        const int i = numAssembled;
+        StretchSegment* s = segments.segments.getUnchecked (i);
+        const bool isLast = i == numSegments - 1;
+        const int regionStart = i > 0 ? roundToInt (s->paddedStart * ratio) : 0;
+        const int regionEnd = isLast ? targetNumSamples : jmin (targetNumSamples, roundToInt ((s->end - segmentOverlap) * ratio));
+
+        assembleScratch.setSize (owner->getNumChannels(), jmax (0, regionEnd - regionStart), false, false, true);
+        assembleScratch.clear();
+
+        // adds output of seg over [from, to) in destination time with a gain ramp, clipped to what was produced
+        auto addRange = [&] (const StretchSegment & seg, int from, int to, float startGain, float endGain)
+        {
+            const int segStart = roundToInt (seg.paddedStart * ratio);
+            const int a = jmax (from, segStart, regionStart);
+            const int b = jmin (to, segStart + seg.numProduced, regionEnd);
+
+            if (b <= a) return;
+
+            jassert (std::abs (seg.numProduced - roundToInt ((seg.paddedEnd - seg.paddedStart) * ratio)) <= 128);
+            const float slope = (endGain - startGain) / (float) (to - from);
+
+            for (int c = 0 ; c < jmin (assembleScratch.getNumChannels(), seg.output.getNumChannels()) ; c++)
+            {
+                assembleScratch.addFromWithRamp (c, a - regionStart, seg.output.getReadPointer (c, a - segStart), b - a,
+                                                 startGain + slope * (a - from), startGain + slope * (b - from));
+            }
+        };
+
+        if (i > 0)
+        {
+            // crossfade with the tail of previous segment
+            const StretchSegment* prev = segments.segments.getUnchecked (i - 1);
+            const int fadeEnd = roundToInt ((s->start + segmentOverlap) * ratio);
+            addRange (*prev, regionStart, fadeEnd, 1.0f, 0.0f);
+            addRange (*s, regionStart, fadeEnd, 0.0f, 1.0f);
+            addRange (*s, fadeEnd, regionEnd, 1.0f, 1.0f);
+        }
+        else
+        {
+            addRange (*s, regionStart, regionEnd, 1.0f, 1.0f);
+        }
+
+        if (regionEnd > regionStart)
+        {
+            owner->writeStretchOutput (assembleScratch, regionStart, regionEnd - regionStart);
+        }
+
+        numAssembled++;
+    }
 }
 
 
@@ -172,15 +526,13 @@ int StretcherJob::studyStretch (double _ratio, int start, int block)
     }
 
     const int numCh ( owner->originAudioBuffer.getNumChannels());
-    const float** tmp = new const float*[numCh];
 
     for (int i = 0 ; i  < numCh ; i++)
     {
-        tmp[i] = owner->originAudioBuffer.getReadPointer (i) + start;
+        inPointers[i] = owner->originAudioBuffer.getReadPointer (i) + start;
     }
 
-    stretcher->study (const_cast<const float* const*> (tmp), block, isFinal);
-    delete[] tmp;
+    stretcher->study (inPointers.getData(), block, isFinal);
     return block;
 
 }
@@ -202,27 +554,30 @@ void StretcherJob::processStretch (int start, int block, int* read, int* produce
 
     }
 
-    // VS screw with the constness here
     const int numCh (owner->originAudioBuffer.getNumChannels());
-    const float** tmpIn = new const float*[numCh];
 
     for (int i = 0 ; i  < numCh ; i++)
     {
-        tmpIn[i] = owner->originAudioBuffer.getReadPointer (i) + start;
+        inPointers[i] = owner->originAudioBuffer.getReadPointer (i) + start;
     }
 
-    stretcher->process (const_cast<const float* const*> (tmpIn), block, isFinal);
-    delete [] tmpIn;
+    stretcher->process (inPointers.getData(), block, isFinal);
     int available = stretcher->available();
     //  jassert( *produced + available< owner->getAllocatedNumSample());
 
 
-    AudioSampleBuffer tmpOutBuf (owner->getNumChannels(), available);
-    float* const* tmpOut = tmpOutBuf.getArrayOfWritePointers();
+    outScratch.setSize (owner->getNumChannels(), available, false, false, true);
+    float* const* tmpOut = outScratch.getArrayOfWritePointers();
     int retrievedSamples = (int)stretcher->retrieve (tmpOut, available);
-    tmpStretchBuf.setNumSample (*produced + retrievedSamples);
-    tmpStretchBuf.copyFrom (tmpOutBuf, *produced, 0, retrievedSamples);
     jassert (retrievedSamples == available);
+
+    // publish as we go, extra samples past the target length are dropped
+    const int toWrite = jmin (retrievedSamples, targetNumSamples - *produced);
+
+    if (toWrite > 0)
+    {
+        owner->writeStretchOutput (outScratch, *produced, toWrite);
+    }
     
     *read = block;
     *produced += retrievedSamples;
@@ -29,23 +29,22 @@
 // stretcher
 namespace RubberBand {class RubberBandStretcher;};
 class PlayableBuffer;
+class StretchSegments;
 
+/*
+ offline stretch of the origin buffer of a PlayableBuffer
+
+ long loops are split in segments cut right before transients, segments are stretched in parallel
+ by this job and by helper jobs added to helperPool, then crossfaded on their overlapping seams
+ short loops, or a single worker, use one stretcher over the whole loop
+ output is written in order to the owner stretchedBlockList, advancing its watermark as regions are final
+ */
 class StretcherJob : public ThreadPoolJob
 {
 public:
 
-    StretcherJob (PlayableBuffer* pb, double _ratio):
-        ThreadPoolJob ("stretch"),
-        owner (pb),
-        ratio (_ratio),
-        tmpStretchBuf (1, 44100, 4096)
-
-    {
-    };
-    ~StretcherJob ()
-    
-    {masterReference.clear();
-    };
+    StretcherJob (PlayableBuffer* pb, double _ratio, ThreadPool* _helperPool = nullptr, int _maxNumWorkers = -1);
+    ~StretcherJob ();
 
 
     JobStatus runJob()override;
@@ -56,16 +55,39 @@ public:
     void initStretcher (int sR, int c);
     PlayableBuffer* owner;
     int originNumSamples;
+    uint32 originRevision;
+    int targetNumSamples;
     double ratio;
 
-    BufferBlockList tmpStretchBuf;
-
 
     ScopedPointer<RubberBand::RubberBandStretcher> stretcher;
 
     CriticalSection jobLock;
-    
+
+    static const int processBlockSize = 4096;
+    // segments are never shorter than that
+    static const int minSegmentSeconds = 4;
+    // input samples shared by two segments on each side of a seam
+    static const int segmentOverlap = 4096;
+
+    // number of segments of last parallel run, 0 if stretched serially
+    int getNumSegments() const {return numSegments;}
+
 private:
+    bool runSerial (Array<int>& onsets);
+    bool runParallel (Array<int>& onsets);
+    // publishes contiguous finished segments
+    void assembleSegments (StretchSegments& segments, int& numAssembled);
+
+    ThreadPool* helperPool;
+    int maxNumWorkers;
+    int numSegments;
+    AudioSampleBuffer assembleScratch;
+
+    // reused by each chunk
+    HeapBlock<const float*> inPointers;
+    AudioSampleBuffer outScratch;
+
     WeakReference<StretcherJob>::Master masterReference;
     friend class WeakReference<StretcherJob>;
 
@@ -86,6 +86,9 @@ void Controllable::setParentContainer (ControllableContainer* container)
 void Controllable::updateControlAddress()
 {
     this->controlAddress = getControlAddress();
+
+    if (parentContainer) parentContainer->updateAddressIndices (this, false);
+
     listeners.call (&Listener::controllableControlAddressChanged, this);
 }
 
@@ -0,0 +1,315 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#include "ControllableAddressIndex.h"
+#include "ControllableContainer.h"
+
+#include <juce_osc/juce_osc.h>
+
+
+// one node per address segment, holding the controllable ending there if any
+class ControllableAddressIndex::TrieNode
+{
+public:
+    TrieNode (const String& _name): name (_name)
+    {
+        // names with non OSC characters can't be matched by patterns
+        try
+        {
+            if (name.isNotEmpty()) address = new OSCAddress ("/" + name);
+        }
+        catch (OSCFormatError&)
+        {
+            address = nullptr;
+        }
+    }
+
+    TrieNode* getChild (const String& n)
+    {
+        return childrenByName.contains (n) ? childrenByName[n] : nullptr;
+    }
+
+    TrieNode* getOrCreateChild (const String& n)
+    {
+        if (TrieNode* c = getChild (n)) return c;
+
+        TrieNode* c = children.add (new TrieNode (n));
+        childrenByName.set (n, c);
+        return c;
+    }
+
+    void removeChild (TrieNode* c)
+    {
+        childrenByName.remove (c->name);
+        children.removeObject (c);
+    }
+
+    bool isEmpty() const {return controllable.get() == nullptr && children.size() == 0;}
+
+    String name;
+    ScopedPointer<OSCAddress> address;
+    WeakReference<Controllable> controllable;
+
+    OwnedArray<TrieNode> children;
+    HashMap<String, TrieNode*> childrenByName;
+};
+
+
+namespace
+{
+    StringArray splitAddress (const String& address)
+    {
+        StringArray res;
+        res.addTokens (address, "/", "");
+
+        if (res.size() && res[0].isEmpty()) res.remove (0);
+
+        return res;
+    }
+
+    bool isPatternSegment (const String& s)
+    {
+        return s.containsAnyOf ("*?[]{}");
+    }
+
+    struct PatternSegment
+    {
+        PatternSegment (const String& s): segment (s), isPattern (isPatternSegment (s))
+        {
+            if (isPattern) pattern = new OSCAddressPattern ("/" + s);
+        }
+
+        String segment;
+        bool isPattern;
+        ScopedPointer<OSCAddressPattern> pattern;
+    };
+
+    void collectMatching (ControllableAddressIndex::TrieNode* node, const OwnedArray<PatternSegment>& segments, int depth, bool getNotExposed, Array<Controllable*>& res);
+}
+
+
+Atomic<int> ControllableAddressIndex::lastRevision;
+
+ControllableAddressIndex::ControllableAddressIndex (ControllableContainer* _owner):
+    owner (_owner),
+    trieRoot (new TrieNode (String()))
+{
+    bumpRevision();
+}
+
+ControllableAddressIndex::~ControllableAddressIndex()
+{
+}
+
+
+void ControllableAddressIndex::rebuild()
+{
+    {
+        const ScopedWriteLock lk (lock);
+        addressMap.clear();
+        controllableAddresses.clear();
+        trieRoot = new TrieNode (String());
+        bumpRevision();
+    }
+
+    // containers locks are not held while indexing, as they can be held by updates
+    auto all = owner->getAllControllables (true, true);
+
+    for (auto& c : all)
+    {
+        if (c.get() && owner->containsControllable (c.get())) updateControllable (c.get());
+    }
+}
+
+
+void ControllableAddressIndex::updateControllable (Controllable* c)
+{
+    const String address = c->getControlAddress (owner);
+    const ScopedWriteLock lk (lock);
+
+    if (controllableAddresses.contains (c))
+    {
+        if (controllableAddresses[c] == address) return;
+
+        removeControllableInternal (c);
+    }
+
+    addressMap.set (address, c);
+    controllableAddresses.set (c, address);
+    addToTrie (c, address);
+    bumpRevision();
+}
+
+
+void ControllableAddressIndex::removeControllable (Controllable* c)
+{
+    const ScopedWriteLock lk (lock);
+    removeControllableInternal (c);
+}
+
+
+void ControllableAddressIndex::removeContainer (ControllableContainer* cc)
+{
+    {
+        const ScopedLock lk (cc->controllables.getLock());
+
+        for (auto& c : cc->controllables) {removeControllable (c);}
+    }
+
+    const ScopedLock lk (cc->controllableContainers.getLock());
+
+    for (auto& child : cc->controllableContainers)
+    {
+        if (child.get()) {removeContainer (child.get());}
+    }
+}
+
+
+void ControllableAddressIndex::removeControllableInternal (Controllable* c)
+{
+    if (!controllableAddresses.contains (c)) return;
+
+    const String oldAddress = controllableAddresses[c];
+    controllableAddresses.remove (c);
+
+    if (addressMap[oldAddress].get() == c || addressMap[oldAddress].get() == nullptr)
+        addressMap.remove (oldAddress);
+
+    removeFromTrie (oldAddress);
+    bumpRevision();
+}
+
+
+Controllable* ControllableAddressIndex::getControllable (const String& address, bool getNotExposed)
+{
+    const ScopedReadLock lk (lock);
+    Controllable* c = addressMap[address].get();
+
+    if (c != nullptr && (c->isControllableExposed || getNotExposed)) return c;
+
+    return nullptr;
+}
+
+
+Array<Controllable*> ControllableAddressIndex::getControllablesMatching (const StringArray& addressPatternSplit, bool getNotExposed)
+{
+    Array<Controllable*> res;
+
+    if (addressPatternSplit.size() == 0) return res;
+
+    OwnedArray<PatternSegment> segments;
+
+    for (auto& s : addressPatternSplit) {segments.add (new PatternSegment (s));}
+
+    const ScopedReadLock lk (lock);
+    collectMatching (trieRoot, segments, 0, getNotExposed, res);
+    return res;
+}
+
+
+int ControllableAddressIndex::getNumControllables()
+{
+    const ScopedReadLock lk (lock);
+    return controllableAddresses.size();
+}
+
+
+String ControllableAddressIndex::normalizeAddress (const String& address)
+{
+    String res = address.startsWithChar ('/') ? address : "/" + address;
+
+    // most addresses are already lowercase, avoid creating a new string then
+    for (auto p = res.getCharPointer(); !p.isEmpty(); ++p)
+    {
+        if (CharacterFunctions::isUpperCase (*p)) return res.toLowerCase();
+    }
+
+    return res;
+}
+
+
+void ControllableAddressIndex::addToTrie (Controllable* c, const String& address)
+{
+    TrieNode* node = trieRoot;
+
+    for (auto& s : splitAddress (address)) {node = node->getOrCreateChild (s);}
+
+    node->controllable = c;
+}
+
+
+void ControllableAddressIndex::removeFromTrie (const String& address)
+{
+    const StringArray split = splitAddress (address);
+    Array<TrieNode*> path;
+    TrieNode* node = trieRoot;
+
+    for (auto& s : split)
+    {
+        path.add (node);
+        node = node->getChild (s);
+
+        if (node == nullptr) return;
+    }
+
+    node->controllable = nullptr;
+
+    // prune empty branches
+    for (int i = path.size() - 1 ; i >= 0 && node->isEmpty() ; i--)
+    {
+        TrieNode* parent = path.getUnchecked (i);
+        parent->removeChild (node);
+        node = parent;
+    }
+}
+
+
+namespace
+{
+    void collectMatching (ControllableAddressIndex::TrieNode* node, const OwnedArray<PatternSegment>& segments, int depth, bool getNotExposed, Array<Controllable*>& res)
+    {
+        const bool isLast = depth == segments.size() - 1;
+        const PatternSegment* seg = segments.getUnchecked (depth);
+
+        auto visit = [&] (ControllableAddressIndex::TrieNode * child)
+        {
+            if (isLast)
+            {
+                Controllable* c = child->controllable.get();
+
+                if (c != nullptr && (c->isControllableExposed || getNotExposed)) res.add (c);
+            }
+            else
+            {
+                collectMatching (child, segments, depth + 1, getNotExposed, res);
+            }
+        };
+
+        if (!seg->isPattern)
+        {
+            if (auto* child = node->getChild (seg->segment)) visit (child);
+
+            return;
+        }
+
+        for (auto* child : node->children)
+        {
+            if (child->address != nullptr && seg->pattern->matches (*child->address)) visit (child);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#ifndef CONTROLLABLEADDRESSINDEX_H_INCLUDED
+#define CONTROLLABLEADDRESSINDEX_H_INCLUDED
+
+#include "Controllable.h"
+
+class ControllableContainer;
+
+/*
+ index of all controllables below a container, by address relative to this container
+
+ exact addresses are resolved with a single hash lookup
+ pattern addresses (OSC wildcards) are matched against a trie of address segments, where each segment is precompiled,
+ so only the pattern is parsed at query time
+
+ it is created on first lookup and kept up to date by ControllableContainer when controllables or containers
+ are added, removed or renamed
+ */
+
+class ControllableAddressIndex
+{
+public:
+    ControllableAddressIndex (ControllableContainer* owner);
+    ~ControllableAddressIndex();
+
+    // index whole hierarchy of owner
+    void rebuild();
+
+    // add or update address of a controllable
+    void updateControllable (Controllable* c);
+    void removeControllable (Controllable* c);
+
+    // remove a container and all its children
+    void removeContainer (ControllableContainer* cc);
+
+    // address should be lowercase with leading "/"
+    Controllable* getControllable (const String& address, bool getNotExposed);
+    Array<Controllable*> getControllablesMatching (const StringArray& addressPatternSplit, bool getNotExposed);
+
+    int getNumControllables();
+
+    // changes each time an address is added, moved or removed, unique across indexes
+    // so that a lookup result can be cached with (container, revision)
+    int getRevision() const {return revision.get();}
+
+    // add leading "/" if needed and lowercase
+    static String normalizeAddress (const String& address);
+
+    class TrieNode;
+
+private:
+    void removeControllableInternal (Controllable* c);
+    void addToTrie (Controllable* c, const String& address);
+    void removeFromTrie (const String& address);
+
+    ControllableContainer* owner;
+
+    HashMap<String, WeakReference<Controllable>> addressMap;
+    HashMap<Controllable*, String> controllableAddresses;
+    ScopedPointer<TrieNode> trieRoot;
+
+    ReadWriteLock lock;
+
+    Atomic<int> revision;
+    static Atomic<int> lastRevision;
+    void bumpRevision() {revision = ++lastRevision;}
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ControllableAddressIndex)
+};
+
+
+#endif  // CONTROLLABLEADDRESSINDEX_H_INCLUDED
@@ -23,7 +23,6 @@
 #include "../Scripting/Js/JsHelpers.h"
 #include "Parameter/ParameterFactory.h"
 
-#include <juce_osc/juce_osc.h>
 
 
 ControllableContainer * ControllableContainer::globalRoot(nullptr);
@@ -50,6 +49,8 @@ ControllableContainer::~ControllableContainer()
     //controllables.clear();
     //DBG("CLEAR CONTROLLABLE CONTAINER");
 
+    if (parentContainer) parentContainer->removeFromAddressIndices (this);
+
     // manage memory if not cleared
     auto all = getAllControllableContainers (true);
 
@@ -61,6 +62,7 @@ ControllableContainer::~ControllableContainer()
 
     clearContainer();
     masterReference.clear();
+    delete addressIndex.get();
 }
 ControllableContainer * ControllableContainer::getRoot(bool global){
     if(global){
@@ -105,7 +107,9 @@ void ControllableContainer::removeFromParent()
 void ControllableContainer::removeControllable (Controllable* c)
 {
     controllableContainerListeners.call (&Listener::controllableRemoved, this, c);
+    removeControllableInternal (c);
 
+    updateAddressIndices (c, true);
 
     controllables.removeObject (c);
     notifyStructureChanged (this,false);
@@ -215,6 +219,7 @@ void ControllableContainer::removeChildControllableContainer (ControllableContai
 
     //  container->removeControllableContainerListener(this);
     notifyStructureChanged (this,false);
+    removeFromAddressIndices (container);
     container->setParentContainer (nullptr);
 }
 
@@ -444,120 +449,71 @@ Array<WeakReference<ControllableContainer > > ControllableContainer::getAllContr
 
 
 
-Controllable* ControllableContainer::getControllableForAddress (String address, bool recursive, bool getNotExposed)
+Controllable* ControllableContainer::getControllableForAddress (String address, bool /*recursive*/, bool getNotExposed)
 {
-    StringArray addrArray;
-    addrArray.addTokens (address.toLowerCase(), juce::StringRef ("/"), juce::StringRef ("\""));
-    
-    // remove first when address starts with " / "
-    if(addrArray.size() && addrArray.getReference(0).isEmpty())
-        addrArray.remove (0);
-
-    return getControllableForAddress (addrArray, recursive, getNotExposed);
+    return getAddressIndex()->getControllable (ControllableAddressIndex::normalizeAddress (address), getNotExposed);
 }
 
 
-Controllable* ControllableContainer::getControllableForAddress (StringArray addressSplit, bool recursive, bool getNotExposed)
+Controllable* ControllableContainer::getControllableForAddress (StringArray addressSplit, bool /*recursive*/, bool getNotExposed)
 {
     if (addressSplit.size() == 0) jassertfalse; // SHOULD NEVER BE THERE !
 
-    bool isTargetAControllable = addressSplit.size() == 1;
-
-    if (isTargetAControllable)
-    {
-
-        //DBG("Check controllable Address : " + shortName);
-        const ScopedLock lk (controllables.getLock());
+    return getAddressIndex()->getControllable ("/" + addressSplit.joinIntoString ("/"), getNotExposed);
+}
 
-        for (auto& c : controllables)
-        {
-            if (c->shortName == addressSplit[0])
-            {
-                //DBG(c->shortName);
-                if (c->isControllableExposed || getNotExposed) return c;
-                else return nullptr;
-            }
-        }
-    }
+Array<Controllable*> ControllableContainer::getControllablesForExtendedAddress (StringArray addressSplit, bool /*recursive*/, bool getNotExposed)
+{
+    if (addressSplit.size() == 0) jassertfalse; // SHOULD NEVER BE THERE !
 
-    else
-    {
-        ScopedLock lk (controllableContainers.getLock());
+    return getAddressIndex()->getControllablesMatching (addressSplit, getNotExposed);
+}
 
-        for (auto& cc : controllableContainers)
-        {
-            if (cc.get())
-            {
 
-                if (cc->shortName == addressSplit[0])
-                {
-                    addressSplit.remove (0);
-                    return cc->getControllableForAddress (addressSplit, recursive, getNotExposed);
-                }
+ControllableAddressIndex* ControllableContainer::getAddressIndex()
+{
+    if (ControllableAddressIndex* index = addressIndex.get()) return index;
 
+    const SpinLock::ScopedLockType lk (addressIndexLock);
 
-            }
-        }
+    if (addressIndex.get() == nullptr)
+    {
+        // concurrent lookups never see a partially built index
+        ScopedPointer<ControllableAddressIndex> newIndex = new ControllableAddressIndex (this);
+        newIndex->rebuild();
+        addressIndex = newIndex.release();
     }
 
-    return nullptr;
+    return addressIndex.get();
 }
 
-Array<Controllable*> ControllableContainer::getControllablesForExtendedAddress (StringArray addressSplit, bool recursive, bool getNotExposed)
+ControllableAddressIndex* ControllableContainer::getBuiltAddressIndex()
 {
-    if (addressSplit.size() == 0) jassertfalse; // SHOULD NEVER BE THERE !
-    Array<Controllable *> res;
-    bool isTargetAControllable = addressSplit.size() == 1;
+    if (ControllableAddressIndex* index = addressIndex.get()) return index;
 
-    if (isTargetAControllable)
-    {
-        {
-            //DBG("Check controllable Address : " + shortName);
-            const ScopedLock lk (controllables.getLock());
-
-            for (auto& c : controllables)
-            {
-                if (c->isControllableExposed || getNotExposed){
-                    OSCAddress ad("/"+c->shortName);
-                    OSCAddressPattern pat ("/"+addressSplit[0]);
-                    if ( pat.matches(ad))
-                    {
-                        //DBG(c->shortName);
-                        res.add(c);
-
-                    }
-                }
-            }
-        }
+    // changes made while another thread builds the index are applied once it is published
+    const SpinLock::ScopedLockType lk (addressIndexLock);
+    return addressIndex.get();
+}
 
-    }
 
-    else
+void ControllableContainer::updateAddressIndices (Controllable* c, bool isRemoved)
+{
+    if (ControllableAddressIndex* index = getBuiltAddressIndex())
     {
-        ScopedLock lk (controllableContainers.getLock());
-        auto deeperAddr = addressSplit;
-        deeperAddr.remove(0);
-
-        for (auto& cc : controllableContainers)
-        {
-
-            if (cc.get())
-            {
-
-                OSCAddress ad("/"+cc->shortName);
-                OSCAddressPattern pat ("/"+addressSplit[0]);
-                if (pat.matches(ad))
-                {
+        if (isRemoved) index->removeControllable (c);
+        else index->updateControllable (c);
+    }
 
-                    res.addArray(cc->getControllablesForExtendedAddress (deeperAddr, recursive, getNotExposed));
-                }
+    if (parentContainer) parentContainer->updateAddressIndices (c, isRemoved);
+}
 
 
-            }
-        }
-    }
+void ControllableContainer::removeFromAddressIndices (ControllableContainer* cc)
+{
+    if (ControllableAddressIndex* index = getBuiltAddressIndex()) index->removeContainer (cc);
 
-    return res;
+    if (parentContainer) parentContainer->removeFromAddressIndices (cc);
 }
 
 
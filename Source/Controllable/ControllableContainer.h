@@ -20,6 +20,7 @@
 #define ControllableCONTAINER_H_INCLUDED
 
 #include "Controllable.h"
+#include "ControllableAddressIndex.h"
 
 
 #include "../Utils/DebugHelpers.h"
@@ -152,9 +153,15 @@ public:
     virtual Array<WeakReference<Controllable>> getAllControllables (bool recursive = false, bool getNotExposed = false);
     virtual Array<WeakReference<ControllableContainer>> getAllControllableContainers (bool recursive = false);
 
-     Controllable* getControllableForAddress (String addressSplit, bool recursive = true, bool getNotExposed = false);
-     Controllable* getControllableForAddress (StringArray addressSplit, bool recursive = true, bool getNotExposed = false);
+    // lookups use the address index of this container, built on first call
+    Controllable* getControllableForAddress (String addressSplit, bool recursive = true, bool getNotExposed = false);
+    Controllable* getControllableForAddress (StringArray addressSplit, bool recursive = true, bool getNotExposed = false);
     Array<Controllable*> getControllablesForExtendedAddress (StringArray addressSplit, bool recursive=true, bool getNotExposed=false);
+    ControllableAddressIndex* getAddressIndex();
+
+    // keep address indexes of this container and its parents up to date
+    void updateAddressIndices (Controllable* c, bool isRemoved);
+    void removeFromAddressIndices (ControllableContainer* c);
     ControllableContainer * getMirroredContainer(ControllableContainer * other,ControllableContainer * root = nullptr);
     bool containsControllable (Controllable* c, int maxSearchLevels = -1);
     String getControlAddress (ControllableContainer* relativeTo = nullptr);
@@ -200,6 +207,8 @@ protected :
 
     //  container with custom controllable can override this
     virtual void addControllableInternal (Controllable*) {};
+    // called before c is deleted
+    virtual void removeControllableInternal (Controllable*) {};
 
     /// identifiers
     static const Identifier controlAddressIdentifier;
@@ -210,6 +219,12 @@ protected :
     void notifyStructureChanged (ControllableContainer* origin,bool isAdded);
     void notifyChildAddressChanged (ControllableContainer* origin);
 
+    // published once fully built, owned by this container
+    Atomic<ControllableAddressIndex*> addressIndex;
+    SpinLock addressIndexLock;
+    // index to keep up to date, waits for a build in progress on another thread
+    ControllableAddressIndex* getBuiltAddressIndex();
+
     typename  WeakReference< ControllableContainer >::Master masterReference;
     friend class WeakReference<ControllableContainer>;
 
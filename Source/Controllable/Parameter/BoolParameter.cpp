@@ -22,6 +22,7 @@ BoolParameter::BoolParameter (const String& niceName, const String& description,
     Parameter ( niceName, description, initialValue, enabled),
     invertVisuals (false)
 {
+    enableTypedValue();
     setValue (initialValue);
 }
 
@@ -73,6 +73,7 @@ EnumParameter::EnumParameter (const String& niceName, const String& description,
     asyncNotifier.addListener (this);
 
     value = var (enumData);
+    selectedIndex = -1;
 
 }
 EnumParameter::~EnumParameter()
@@ -186,6 +187,7 @@ void EnumParameter::selectId (Identifier key, bool shouldSelect, bool appendSele
 
     if (numSelectionChange > 0)
     {
+        updateSelectedIndex();
         auto msg = EnumChangeMessage::newSelectionMessage (key, shouldSelect, getModel()->isValidId (key));
         processForMessage (*msg, enumListeners);
         asyncNotifier.addMessage (msg);
@@ -420,8 +422,16 @@ Array<var>* EnumParameter::getSelectedSet (const juce::var& v) const
 }
 
 
+void EnumParameter::updateSelectedIndex()
+{
+    auto selection = getSelectedSetIds (value);
+    auto* m = getModel();
+    selectedIndex = (m && selection.size()) ? m->getProperties().indexOf (selection[0]) : -1;
+}
+
 void EnumParameter::modelOptionAdded (EnumParameterModel*, Identifier& key )
 {
+    updateSelectedIndex();
     auto msg = EnumChangeMessage::newStructureChangeMessage (key, true);
     msg->isValid = getModel()->isValidId (msg->key);
     if (getSelectedIds().contains (key))
@@ -437,6 +447,7 @@ void EnumParameter::modelOptionAdded (EnumParameterModel*, Identifier& key )
 };
 void EnumParameter::modelOptionRemoved (EnumParameterModel*, Identifier& key)
 {
+    updateSelectedIndex();
     auto msg = EnumChangeMessage::newStructureChangeMessage (key, false);
     msg->isValid = getModel()->isValidId (msg->key);
     if (getSelectedIds().contains (key))
@@ -140,6 +140,9 @@ public:
     bool selectionIsNotEmpty();
     var getValueForId (const Identifier& i);
 
+    // index of first selected option in the model, -1 if none, safe to read from any thread
+    int getSelectedIndex() const {return selectedIndex.get();}
+
 
 
 
@@ -178,6 +181,8 @@ private:
     WeakReference<EnumParameterModel> model;
     DynamicObject* enumData;
     bool ownModel;
+    Atomic<int> selectedIndex;
+    void updateSelectedIndex();
 
     // model Listener
     void modelOptionAdded (EnumParameterModel*, Identifier&) override;
@@ -27,13 +27,21 @@ public:
         minimumValue (min),
         maximumValue (max)
     {
-
+        updateTypedRange();
     }
     virtual ~MinMaxParameter() {};
 
     var minimumValue;
     var maximumValue;
 
+    // copy of the range readable from the audio thread, see limitTypedValue
+    Atomic<double> typedMinimum, typedMaximum;
+    void updateTypedRange()
+    {
+        typedMinimum = (double) minimumValue;
+        typedMaximum = (double) maximumValue;
+    }
+
 
     DynamicObject* getObject() override
     {
@@ -52,6 +60,8 @@ public:
             if (ob->hasProperty (minValueIdentifier)) {minimumValue = ob->getProperty (minValueIdentifier);}
 
             if (ob->hasProperty (maxValueIdentifier)) {maximumValue = ob->getProperty (maxValueIdentifier);}
+
+            updateTypedRange();
         }
         else
         {
@@ -63,11 +73,17 @@ public:
     {
         minimumValue = min;
         maximumValue = max;
+        updateTypedRange();
         listeners.call (&Listener::parameterRangeChanged, this);
+        postChange (ParameterChangeHub::rangeChange);
+    }
+
+    var getRangeVar() const override
+    {
         var arr;
         arr.append (minimumValue);
         arr.append (maximumValue);
-        queuedNotifier.addMessage (new ParamWithValue (this, arr, true));
+        return arr;
     }
 
 };
@@ -43,6 +43,7 @@ NumericParameter<T>::NumericParameter (const String& niceName, const String& des
         jassertfalse;
     }
 
+    enableTypedValue();
 }
 
 template<class T>
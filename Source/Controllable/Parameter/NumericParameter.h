@@ -28,6 +28,7 @@ public:
     ~NumericParameter() {};
 
     void setValueInternal (const var& _value) override;
+    double limitTypedValue (double v) const override {return jlimit (typedMinimum.get(), typedMaximum.get(), v);}
 
     void setNormalizedValue (const T  normalizedValue, bool silentSet = false, bool force = false);
 
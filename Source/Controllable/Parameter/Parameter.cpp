@@ -15,6 +15,7 @@
 
 #include "Parameter.h"
 #include "../../Scripting/Js/JsHelpers.h"
+#include "../../Utils/AudioThread.h"
 
 
 const Identifier Parameter::valueIdentifier ("value");
@@ -25,18 +26,33 @@ Parameter::Parameter ( const String& niceName, const String& description, var in
     isEditable (true),
     isPresettable (true),
     isOverriden (false),
-    queuedNotifier (100),
     hasCommitedValue (false),
     isCommitableParameter (false),
-    isSettingValue (false),
-    isLocking (true),
     defaultValue (initialValue),
     value (initialValue),
-    mappingDisabled (false)
+    mappingDisabled (false),
+    hasTypedValue (false),
+    typedVarIsInt (false),
+    typedVarIsBool (false),
+    nextPendingChange (nullptr),
+    notifiedValue (initialValue),
+    hasDeferredValue (false),
+    deferredSilentSet (false),
+    deferredForce (false)
 {
 
 
 
+}
+
+Parameter::~Parameter()
+{
+    if (pendingChanges.get() != 0)
+    {
+        if (auto* hub = ParameterChangeHub::getInstanceWithoutCreating()) hub->forget (this);
+    }
+
+    Parameter::masterReference.clear();
 }
 
 void Parameter::resetValue (bool silentSet,bool force)
@@ -66,71 +82,100 @@ void Parameter::setValue (const var & _value, bool silentSet, bool force)
 
 }
 
-bool Parameter::waitOrDeffer (const var& _value, bool silentSet, bool force )
+bool Parameter::deferSetValue (const var& _value, bool silentSet, bool force )
 {
-    if (!force && isSettingValue)
+    auto* hub = ParameterChangeHub::getInstanceWithoutCreating();
+
+    if (hub == nullptr) return false;
+
     {
-        if (isLocking)
-        {
-            int overflow = 1000000;
-            auto startWait = Time::currentTimeMillis();
-
-            while (isSettingValue && overflow > 0)
-            {
-                //        Thread::sleep(1);
-                Thread::yield();
-                overflow--;
-            }
-
-            if (isSettingValue && overflow <= 0)
-            {
-                DBG ("locked for : " << Time::currentTimeMillis() - startWait);
-            }
-        }
+        const SpinLock::ScopedLockType sl (deferredValueLock);
+        deferredSilentSet = hasDeferredValue ? (deferredSilentSet && silentSet) : silentSet;
+        deferredForce = hasDeferredValue ? (deferredForce || force) : force;
+        deferredValue = _value;
+        hasDeferredValue = true;
+    }
 
-        // force defering if locking too long or not locking
-        if (isSettingValue)
-        {
-            if (auto* mm = MessageManager::getInstanceWithoutCreating())
-            {
-                mm->callAsync ([this, _value, silentSet, force]() {tryToSetValue (_value, silentSet, force);});
-                return true;
-            }
-        }
+    // not through postChange : it would be applied right away on the message thread
+    hub->markChanged (this, ParameterChangeHub::deferredSetValue);
+    return true;
+}
+
+void Parameter::applyDeferredValue()
+{
+    var v;
+    bool silentSet, force;
+
+    {
+        const SpinLock::ScopedLockType sl (deferredValueLock);
+
+        if (!hasDeferredValue) return;
 
-        //    jassertfalse;
+        // leave the slot empty so that the next writer doesn't free the old value
+        v.swapWith (deferredValue);
+        silentSet = deferredSilentSet;
+        force = deferredForce;
+        hasDeferredValue = false;
     }
 
-    return false;
+    tryToSetValue (v, silentSet, force);
 }
+
+void Parameter::enableTypedValue()
+{
+    hasTypedValue = true;
+    typedVarIsInt = value.isInt();
+    typedVarIsBool = value.isBool();
+    typedValue = (double) value;
+}
+
 void Parameter::tryToSetValue (const var & _value, bool silentSet, bool force )
 {
+    // the audio thread never writes the var, nor allocates or waits for another writer
+    if (hasTypedValue && AudioThread::isCurrentThread())
+    {
+        const double v = limitTypedValue (typedVarIsInt ? (double) (int) _value : (typedVarIsBool ? ((bool) _value ? 1.0 : 0.0) : (double) _value));
+
+        if (force || v != typedValue.get()) setTypedValueFromAudio (v, silentSet);
 
-    if (!force && checkValueIsTheSame (_value, value)) return;
+        return;
+    }
 
-    if (!waitOrDeffer (_value, silentSet, force))
+    // another write is in progress, writers never wait for each other
+    if (!isSettingValue.compareAndSetBool (1, 0))
     {
-        isSettingValue = true;
+        // without message thread there is no one to apply it
+        if (!deferSetValue (_value, silentSet, force)) jassertfalse;
 
-        if (value.getDynamicObject())
-        {
-            lastValue = value.clone();
-        }
-        else
-        {
-            lastValue = var (value);
-        }
+        return;
+    }
 
-        setValueInternal (_value);
+    // compare to the typed value, the var may not be synced yet with an audio thread write
+    if (!force && checkValueIsTheSame (_value, hasTypedValue ? getValueForNotification() : value))
+    {
+        isSettingValue = 0;
+        return;
+    }
 
-        if (!isOverriden && !checkValueIsTheSame (defaultValue, value)) isOverriden = true;
+    if (value.getDynamicObject())
+    {
+        lastValue = value.clone();
+    }
+    else
+    {
+        lastValue = var (value);
+    }
 
-        if (!silentSet && (force || !checkValueIsTheSame (lastValue, value)))
-            notifyValueChanged (false);
+    setValueInternal (_value);
 
-        isSettingValue = false;
-    }
+    if (hasTypedValue) typedValue = (double) value;
+
+    if (!isOverriden && !checkValueIsTheSame (defaultValue, value)) isOverriden = true;
+
+    if (!silentSet && (force || !checkValueIsTheSame (lastValue, value)))
+        notifyValueChanged (false);
 
+    isSettingValue = 0;
 }
 
 
@@ -178,12 +223,125 @@ void Parameter::checkVarIsConsistentWithType()
 
 void Parameter::notifyValueChanged (bool defferIt)
 {
+    // the writer copies the var, the message thread must not read it while another thread writes it
+    if (!hasTypedValue)
+    {
+        var copy (value);
+
+        {
+            const SpinLock::ScopedLockType sl (notifiedValueLock);
+            notifiedValue.swapWith (copy);
+        }
+    }
+
     if (defferIt)
-        triggerAsyncUpdate();
+        postChange (ParameterChangeHub::deferredValueChange | ParameterChangeHub::valueChange);
     else
+    {
         listeners.call (&Listener::parameterValueChanged, this);
+        postChange (ParameterChangeHub::valueChange);
+    }
+}
 
-    queuedNotifier.addMessage (new ParamWithValue (this, value, false));
+void Parameter::setTypedValueFromAudio (double v, bool silentSet)
+{
+    jassert (hasTypedValue);
+    typedValue = limitTypedValue (v);
+
+    if (silentSet)
+    {
+        postChange (ParameterChangeHub::typedValueChange);
+    }
+    // listeners may rely on being called before setValue returns (transport, looper sync)
+    else if (isSettingValue.compareAndSetBool (1, 0))
+    {
+        listeners.call (&Listener::parameterValueChanged, this);
+        isSettingValue = 0;
+        postChange (ParameterChangeHub::typedValueChange | ParameterChangeHub::valueChange);
+    }
+    else
+    {
+        postChange (ParameterChangeHub::typedValueChange | ParameterChangeHub::deferredValueChange | ParameterChangeHub::valueChange);
+    }
+}
+
+void Parameter::syncValueFromTypedValue()
+{
+    const var v = getValueForNotification();
+
+    if (checkValueIsTheSame (v, value)) return;
+
+    lastValue = var (value);
+    setValueInternal (v);
+
+    // setValueInternal may have limited it, keep the mirror in range unless the audio thread wrote again
+    const double raw = (double) v;
+    const double limited = (double) value;
+
+    if (limited != raw) typedValue.compareAndSetBool (limited, raw);
+
+    if (!isOverriden && !checkValueIsTheSame (defaultValue, value)) isOverriden = true;
+}
+
+void Parameter::postChange (int changeTypes)
+{
+    if (asyncListeners.size() == 0) changeTypes &= (ParameterChangeHub::deferredValueChange | ParameterChangeHub::typedValueChange | ~ParameterChangeHub::changeFlagsMask);
+
+    if ((changeTypes & ParameterChangeHub::changeFlagsMask) == 0) return;
+
+    if ((changeTypes & ParameterChangeHub::deferredValueChange) == 0)
+    {
+        MessageManager* mm = MessageManager::getInstanceWithoutCreating();
+
+        auto* hub = ParameterChangeHub::getInstanceWithoutCreating();
+
+        if (mm != nullptr && mm->isThisTheMessageThread() && (hub == nullptr || !hub->isBatching()))
+        {
+            deliverChanges (changeTypes);
+            return;
+        }
+    }
+
+    if (auto* hub = ParameterChangeHub::getInstanceWithoutCreating()) hub->markChanged (this, changeTypes);
+}
+
+void Parameter::deliverChanges (int changeTypes)
+{
+    // values are coalesced, trigger fires are not
+    const int numNotifications = jmax (1, ParameterChangeHub::getNumFires (changeTypes));
+
+    if (changeTypes & ParameterChangeHub::typedValueChange)
+        syncValueFromTypedValue();
+
+    if (changeTypes & ParameterChangeHub::deferredValueChange)
+        for (int i = 0 ; i < numNotifications ; i++) {listeners.call (&Listener::parameterValueChanged, this);}
+
+    if (changeTypes & ParameterChangeHub::rangeChange)
+        asyncListeners.call (&AsyncListener::newMessage, ParamWithValue (this, getRangeVar(), true));
+
+    if (changeTypes & ParameterChangeHub::valueChange)
+        for (int i = 0 ; i < numNotifications ; i++) {asyncListeners.call (&AsyncListener::newMessage, ParamWithValue (this, getValueForNotification(), false));}
+
+    if (changeTypes & ParameterChangeHub::deferredSetValue)
+        applyDeferredValue();
+}
+
+var Parameter::getValueForNotification() const
+{
+    if (!hasTypedValue)
+    {
+        const SpinLock::ScopedLockType sl (notifiedValueLock);
+        return notifiedValue;
+    }
+
+    // don't read the var that may be written by another thread
+    const double v = typedValue.get();
+
+    if (typedVarIsInt) return (int) v;
+
+    if (typedVarIsBool) return v != 0;
+
+    return v;
 }
 
 
@@ -226,11 +384,6 @@ var Parameter::getVarState()
 
 
 
-void Parameter::handleAsyncUpdate()
-{
-    listeners.call (&Listener::parameterValueChanged, this);
-};
-
 bool Parameter::isMappable()
 {
     return isEditable && !mappingDisabled ;
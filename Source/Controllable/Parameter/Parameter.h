@@ -18,14 +18,15 @@
 
 #include "../Controllable.h"
 #include "../../Utils/QueuedNotifier.h"
+#include "ParameterChangeHub.h"
 
 
-class Parameter : public Controllable, private AsyncUpdater
+class Parameter : public Controllable
 {
 public:
     Parameter ( const String& niceName, const String& description, var initialValue, bool enabled = true);
 
-    virtual ~Parameter() {Parameter::masterReference.clear(); cancelPendingUpdate();}
+    virtual ~Parameter();
 
 
 
@@ -45,9 +46,8 @@ public:
     // useful for thread syncronization
     bool isCommitableParameter;
 
-    // when race condition are met, do we lock?
-    bool isLocking;
-    volatile bool isSettingValue;
+    // non zero while a write is in progress, concurrent or reentrant writers defer instead of waiting
+    Atomic<int> isSettingValue;
 
     void setNewDefault(const var & value,bool notify);
     void resetValue (bool silentSet = false,bool force = false);
@@ -69,14 +69,28 @@ public:
 
 
     //helpers for fast typing
-    float floatValue() const { return (float)value; }
-    double doubleValue() const {return (double)value;}
-    int intValue() const { return (int)value; }
-    bool boolValue() const { return (bool)value; }
+    // typed parameters read an atomic copy of their value so the audio thread never touches the var
+    float floatValue() const { return hasTypedValue ? (float) typedValue.get() : (float)value; }
+    double doubleValue() const {return hasTypedValue ? typedValue.get() : (double)value;}
+    int intValue() const { return hasTypedValue ? (int) typedValue.get() : (int)value; }
+    bool boolValue() const { return hasTypedValue ? typedValue.get() != 0 : (bool)value; }
     virtual String stringValue() const { return value.toString(); }
 
     void notifyValueChanged (bool defferIt = false);
 
+    // latest notified value, safe to read from any thread unlike the var
+    var getValueForNotification() const;
+
+    // audio thread write of typed parameters : only the atomic copy is set here,
+    // synchronous listeners are called right away unless another write is in progress,
+    // the var and async listeners follow on the message thread through ParameterChangeHub
+    // setValue routes here when called from an audio thread
+    void setTypedValueFromAudio (double v, bool silentSet = false);
+    bool isTyped() const {return hasTypedValue;}
+
+    // range applied to typed writes that don't go through setValueInternal
+    virtual double limitTypedValue (double v) const {return v;}
+
     virtual DynamicObject* createDynamicObject() override;
 
 
@@ -124,13 +138,16 @@ public:
     };
 
     typedef QueuedNotifier<ParamWithValue>::Listener AsyncListener;
-    QueuedNotifier<ParamWithValue> queuedNotifier;
-    void handleAsyncUpdate()override;
+    // values can be set from audio thread, changes are coalesced by ParameterChangeHub
+    // and async listeners get the latest value once per message loop tick
+    ListenerList<AsyncListener> asyncListeners;
+
 
+    void addAsyncParameterListener (AsyncListener* newListener) { asyncListeners.add (newListener); }
+    void removeAsyncParameterListener (AsyncListener* listener) { asyncListeners.remove (listener); }
 
-    void addAsyncParameterListener (AsyncListener* newListener) { queuedNotifier.addListener (newListener); }
-    void addAsyncCoalescedListener (AsyncListener* newListener) { queuedNotifier.addAsyncCoalescedListener (newListener); }
-    void removeAsyncParameterListener (AsyncListener* listener) { queuedNotifier.removeListener (listener); }
+    // value sent with async range messages
+    virtual var getRangeVar() const {return var::undefined();}
 
 
     //JS Helper
@@ -149,7 +166,18 @@ public:
 
 
 protected:
-    bool waitOrDeffer (const var& _value, bool silentSet, bool force);
+    // hand the write to the message thread through ParameterChangeHub, never allocates nor waits
+    // writes deferred in the same tick are merged, the latest value wins
+    // returns false if there is no hub to apply it
+    bool deferSetValue (const var& _value, bool silentSet, bool force);
+
+    // set by numeric and bool parameters, typedValue mirrors value after each write
+    void enableTypedValue();
+    bool hasTypedValue;
+    Atomic<double> typedValue;
+
+    // send ParameterChangeHub::ChangeType to async listeners, immediately if called from message thread
+    void postChange (int changeTypes);
 
 private:
 
@@ -158,6 +186,23 @@ private:
 
     void checkVarIsConsistentWithType();
 
+    friend class ParameterChangeHub;
+    void deliverChanges (int changeTypes);
+    void syncValueFromTypedValue();
+    bool typedVarIsInt, typedVarIsBool;
+    Atomic<int> pendingChanges;
+    Parameter* nextPendingChange;
+
+    // copy of value made by the writer for non typed parameters, read when delivering
+    var notifiedValue;
+    SpinLock notifiedValueLock;
+
+    // write deferred by deferSetValue, applied by deliverChanges
+    void applyDeferredValue();
+    var deferredValue;
+    bool hasDeferredValue, deferredSilentSet, deferredForce;
+    SpinLock deferredValueLock;
+
     WeakReference<Parameter>::Master masterReference;
     friend class WeakReference<Parameter>;
 
@@ -0,0 +1,162 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+
+#include "ParameterChangeHub.h"
+#include "Parameter.h"
+
+juce_ImplementSingleton (ParameterChangeHub);
+
+ParameterChangeHub::ParameterChangeHub():
+    batchDepth (0),
+    deliveryHead (nullptr),
+    deliveryTail (nullptr)
+{
+}
+
+ParameterChangeHub::~ParameterChangeHub()
+{
+    cancelPendingUpdate();
+    clearSingletonInstance();
+}
+
+
+void ParameterChangeHub::markChanged (Parameter* p, int changeTypes)
+{
+    ++numMarkedChanges;
+
+    // flags are or'ed, the fire count is added
+    const int flags = changeTypes & changeFlagsMask;
+    const int fires = changeTypes & ~changeFlagsMask;
+    int old = p->pendingChanges.get();
+
+    while (!p->pendingChanges.compareAndSetBool ((old | flags) + fires, old)) {old = p->pendingChanges.get();}
+
+    // already queued, the delivery will read the latest value
+    if (old != 0) return;
+
+    for (;;)
+    {
+        Parameter* head = pendingHead.get();
+        p->nextPendingChange = head;
+
+        if (pendingHead.compareAndSetBool (p, head)) break;
+    }
+
+    triggerAsyncUpdate();
+}
+
+
+void ParameterChangeHub::grabPending()
+{
+    Parameter* stack = pendingHead.exchange (nullptr);
+
+    if (stack == nullptr) return;
+
+    // stack is newest first
+    Parameter* reversed = nullptr;
+    Parameter* last = stack;
+
+    while (stack != nullptr)
+    {
+        Parameter* next = stack->nextPendingChange;
+        stack->nextPendingChange = reversed;
+        reversed = stack;
+        stack = next;
+    }
+
+    if (deliveryTail != nullptr) deliveryTail->nextPendingChange = reversed;
+    else deliveryHead = reversed;
+
+    deliveryTail = last;
+}
+
+
+void ParameterChangeHub::forget (Parameter* p)
+{
+    jassert (MessageManager::getInstanceWithoutCreating() == nullptr || MessageManager::getInstance()->isThisTheMessageThread());
+
+    grabPending();
+
+    Parameter* prev = nullptr;
+
+    for (Parameter* cur = deliveryHead ; cur != nullptr ; prev = cur, cur = cur->nextPendingChange)
+    {
+        if (cur != p) continue;
+
+        if (prev != nullptr) prev->nextPendingChange = cur->nextPendingChange;
+        else deliveryHead = cur->nextPendingChange;
+
+        if (deliveryTail == cur) deliveryTail = prev;
+
+        break;
+    }
+
+    p->pendingChanges = 0;
+}
+
+
+void ParameterChangeHub::beginBatch()
+{
+    batchDepth++;
+}
+
+void ParameterChangeHub::endBatch()
+{
+    jassert (batchDepth > 0);
+
+    if (--batchDepth == 0) flush();
+}
+
+
+void ParameterChangeHub::handleAsyncUpdate()
+{
+    flush();
+}
+
+
+void ParameterChangeHub::flush()
+{
+    // delivered when the batch closes
+    if (batchDepth > 0) return;
+
+    grabPending();
+
+    // only what was dirty when we started, parameters changed by listeners are delivered next tick
+    Parameter* end = deliveryTail;
+
+    while (Parameter* p = deliveryHead)
+    {
+        const bool isLast = p == end;
+        deliveryHead = p->nextPendingChange;
+
+        if (deliveryHead == nullptr) deliveryTail = nullptr;
+
+        p->nextPendingChange = nullptr;
+
+        // a producer changing p from now on will queue it again
+        const int changes = p->pendingChanges.exchange (0);
+
+        if (changes != 0)
+        {
+            ++numDeliveredUpdates;
+            p->deliverChanges (changes);
+        }
+
+        if (isLast) break;
+    }
+
+    if (deliveryHead != nullptr) triggerAsyncUpdate();
+}
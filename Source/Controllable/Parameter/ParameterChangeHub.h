@@ -0,0 +1,102 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+
+#ifndef PARAMETERCHANGEHUB_H_INCLUDED
+#define PARAMETERCHANGEHUB_H_INCLUDED
+
+#include "../../JuceHeaderCore.h"
+
+class Parameter;
+
+/*
+ single dispatcher for asynchronous parameter notifications
+
+ a parameter keeps a word of pending change bits and an intrusive link instead of its own queue :
+ a change from any thread only sets bits, and the first change since last delivery pushes the parameter
+ on a lock free stack (no allocation, no capacity) and wakes the message thread with triggerAsyncUpdate,
+ which posts to the JUCE message queue and may take its lock : only the first change since last delivery does so
+ once per message loop tick, every dirty parameter gets one coalesced update carrying its latest value,
+ except triggers that keep a count of fires in the upper bits of the word
+ */
+class ParameterChangeHub : private AsyncUpdater
+{
+public:
+    enum ChangeType
+    {
+        valueChange = 1,
+        rangeChange = 2,
+        deferredValueChange = 4, // synchronous listeners called from the message thread
+        typedValueChange = 8, // only the typed copy was written, var is synced from it before delivery
+        deferredSetValue = 16, // a write that found another one in progress, applied from the message thread
+        triggerFire = 1 << 8 // added instead of or'ed : triggers are delivered once per fire, never coalesced
+    };
+
+    static const int changeFlagsMask = triggerFire - 1;
+    static int getNumFires (int changes) {return changes / triggerFire;}
+
+    // created by Engine, producers use getInstanceWithoutCreating as they may run on the audio thread
+    juce_DeclareSingleton (ParameterChangeHub, true)
+
+    // any thread, never allocates nor spins
+    void markChanged (Parameter* p, int changeTypes);
+
+    // message thread, unlinks a dirty parameter being deleted
+    void forget (Parameter* p);
+
+    // message thread, delivers pending changes now
+    void flush();
+
+    // message thread, while a batch is open async changes made on the message thread are queued too,
+    // so that a parameter changed several times in the batch is delivered once when the batch closes
+    void beginBatch();
+    void endBatch();
+    bool isBatching() const {return batchDepth > 0;}
+
+    struct ScopedBatch
+    {
+        ScopedBatch() : hub (getInstanceWithoutCreating()) {if (hub != nullptr) hub->beginBatch();}
+        ~ScopedBatch() {if (hub != nullptr) hub->endBatch();}
+        ParameterChangeHub* hub;
+        JUCE_DECLARE_NON_COPYABLE (ScopedBatch)
+    };
+
+    int64 getNumMarkedChanges() const {return numMarkedChanges.get();}
+    int64 getNumDeliveredUpdates() const {return numDeliveredUpdates.get();}
+
+    ~ParameterChangeHub();
+
+private:
+    ParameterChangeHub();
+
+    void handleAsyncUpdate() override;
+
+    // moves the shared stack to the delivery list, in change order
+    void grabPending();
+
+    Atomic<Parameter*> pendingHead;
+
+    // message thread only
+    int batchDepth;
+    Parameter* deliveryHead;
+    Parameter* deliveryTail;
+
+    Atomic<int64> numMarkedChanges, numDeliveredUpdates;
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterChangeHub)
+};
+
+
+#endif  // PARAMETERCHANGEHUB_H_INCLUDED
@@ -10,6 +10,7 @@
 
 #include "ParameterContainer.h"
 #include "../Parameter/ParameterFactory.h"
+#include "../../Preset/PresetMorphEngine.h"
 
 //#include "../Parameter/NumericParameter.h"
 //#include "../Parameter/BoolParameter.h"
@@ -48,8 +49,19 @@ ParameterContainer::ParameterContainer (StringRef niceName):
 
 ParameterContainer::~ParameterContainer()
 {
+    // parameters are deleted by ~ControllableContainer, morphs must not ramp them anymore
+    if (auto* morphEngine = PresetMorphEngine::getInstanceWithoutCreating()) morphEngine->cancelMorphsUsing (this);
+
     ParameterContainer::masterReference.clear();
 }
+
+void ParameterContainer::removeControllableInternal (Controllable* c)
+{
+    if (auto* p = dynamic_cast<Parameter*> (c))
+    {
+        if (auto* morphEngine = PresetMorphEngine::getInstanceWithoutCreating()) morphEngine->cancelMorphsUsing (p);
+    }
+}
 const String  ParameterContainer::getNiceName()
 {
     return nameParam->stringValue();
@@ -375,13 +387,33 @@ bool ParameterContainer::loadPreset (PresetManager::Preset* preset)
 
     loadPresetInternal (preset);
 
-    for (auto& pv : preset->presetValues)
     {
+        // all values are set before listeners are called so that they see the whole preset,
+        // async notifications are coalesced and delivered once at the end of the batch
+        ParameterChangeHub::ScopedBatch batch;
+        Array<Parameter*> changedParameters;
+        changedParameters.ensureStorageAllocated (preset->presetValues.size());
+
+        for (auto& pv : preset->presetValues)
+        {
+            Parameter* p = dynamic_cast<Parameter*> (pv->resolve (this));
+
+            if (p == nullptr || p == currentPresetName) continue;
 
-        Parameter* p = dynamic_cast<Parameter*> (getControllableForAddress (pv->paramControlAddress));
+            if (p->isCommitableParameter)
+            {
+                p->setValue (pv->presetValue);
+                continue;
+            }
+
+            if (p->checkValueIsTheSame (pv->presetValue, p->value)) continue;
+
+            p->setValue (pv->presetValue, true);
+            // a parameter listed twice is already at its value the second time
+            changedParameters.add (p);
+        }
 
-        //DBG("Load preset, param set container : " << niceName << ", niceName : " << p->niceName << ",pv controlAddress : " << p->controlAddress << "" << pv->presetValue.toString());
-        if (p != nullptr && p != currentPresetName) p->setValue (pv->presetValue);
+        for (auto& p : changedParameters) {p->notifyValueChanged();}
     }
 
     currentPreset = preset;
@@ -443,7 +475,7 @@ bool ParameterContainer::resetFromPreset()
 
     for (auto& pv : currentPreset->presetValues)
     {
-        Parameter* p = (Parameter*)getControllableForAddress (pv->paramControlAddress);
+        Parameter* p = (Parameter*)pv->resolve (this);
 
         if (p != nullptr && p != currentPresetName) p->resetValue();
     }
@@ -112,6 +112,10 @@ public:
     WeakReference< ParameterContainer >::Master masterReference;
     friend class WeakReference<ParameterContainer>;
 
+protected:
+    // preset morphs using a parameter are cancelled before it is deleted
+    void removeControllableInternal (Controllable* c) override;
+
 
 private:
     // internal callback that a controllableContainer can override to react to any of it's parameter change
@@ -45,21 +45,23 @@ public:
     void tryToSetValue (const var & _value, bool silentSet, bool force) override
     {
 
-        if (!waitOrDeffer (_value, silentSet, force))
+        if ((_value.isInt() && (int) _value == 0)
+            || (_value.isDouble() && (double) _value == 0)
+            || silentSet)
+            return;
+
+        // another write is in progress, even forced writes don't run concurrently
+        // a trigger holds no value, its synchronous listeners are called from the message thread
+        if (!isSettingValue.compareAndSetBool (1, 0))
         {
-            if ( ! ((_value.isInt() && (int) _value == 0)
-                    || (_value.isDouble() && (double) _value == 0)
-                   ))
-            {
-
-                isSettingValue = true;
-
-                if (!silentSet) notifyValueChanged();
-
-                isSettingValue = false;
-            }
+            postChange (ParameterChangeHub::deferredValueChange | ParameterChangeHub::valueChange | ParameterChangeHub::triggerFire);
+            return;
         }
 
+        listeners.call (&Listener::parameterValueChanged, this);
+        postChange (ParameterChangeHub::valueChange | ParameterChangeHub::triggerFire);
+        isSettingValue = 0;
+
     }
 
     DECLARE_OBJ_TYPE (Trigger)
@@ -31,7 +31,7 @@ ParameterUI::ParameterUI (Parameter* _parameter) :
 {
     if (parameter.get())
     {
-        parameter->addAsyncCoalescedListener (this);
+        parameter->addAsyncParameterListener (this);
         parameter->addParameterListener (this);
         
     }
@@ -147,7 +147,7 @@ void MIDIController::callJs (const MidiMessage& message)
         Array<var> args;
         args.add (message.getControllerNumber());
         args.add (message.getControllerValue());
-        callFunctionFromIdentifier (onCCFunctionName, args);
+        postFunctionCall (onCCFunctionName, args);
 
         for (auto& p : jsCCListeners)
         {
@@ -160,7 +160,7 @@ void MIDIController::callJs (const MidiMessage& message)
         Array<var> args;
         args.add (message.getNoteNumber());
         args.add (message.isNoteOn() ? message.getVelocity() : 0);
-        callFunctionFromIdentifier (onCCFunctionName, args);
+        postFunctionCall (onCCFunctionName, args);
 
         for (auto& p : jsNoteListeners)
         {
@@ -172,7 +172,7 @@ void MIDIController::callJs (const MidiMessage& message)
         static const Identifier onPitchWheelFunctionName ("onPitchWheel");
         Array<var> args;
         args.add (message.getPitchWheelValue());
-        callFunctionFromIdentifier (onPitchWheelFunctionName, args);
+        postFunctionCall (onPitchWheelFunctionName, args);
     }
 }
 
@@ -141,7 +141,7 @@ public :
                 {
                     var value = isNoteListener ? m.getVelocity() : m.getControllerNumber();
                     object.getDynamicObject()->setProperty (midiValueId, 0);
-                    jsEnv->callFunctionFromIdentifier (midiReceivedId, var::NativeFunctionArgs (object, &value, 1), true);
+                    jsEnv->postFunctionCall (midiReceivedId, Array<var> {value}, nullptr, object);
                 }
 
             }
@@ -16,6 +16,7 @@
 #include "OSCController.h"
 
 #include "../../Utils/DebugHelpers.h"
+#include "../../Controllable/Parameter/ParameterProxy.h"
 
 #include "../../Node/Manager/NodeManager.h"
 
@@ -58,7 +59,8 @@ OSCController::OSCController (const String& _name) :
     Controller (_name),
     lastMessageReceived (OSCAddressPattern ("/fake")),
     isProcessingOSC (false),
-    oscMessageQueue (this),
+    oscMessageQueue (_name, OSC_QUEUE_LENGTH),
+    stateDump (_name, oscMessageQueue),
     hostNameResolved (false)
 
 {
@@ -73,18 +75,19 @@ OSCController::OSCController (const String& _name) :
     
     logIncomingOSC = addNewParameter<BoolParameter> ("logIncomingOSC", "log the incoming OSC Messages", false);
     logOutGoingOSC = addNewParameter<BoolParameter> ("logOutGoingOSC", "log the outGoing OSC Messages", false);
-    speedLimit = addNewParameter<FloatParameter> ("speedLimit", "min interval (ms) between 2 series of " + String (NUM_OSC_MSG_IN_A_ROW) + " OSCMessages", 0.f, 0.f, 100.f);
+    speedLimit = addNewParameter<FloatParameter> ("speedLimit", "min interval (ms) between 2 sends of OSC messages, messages sent to the same address in the meantime only send last value", 0.f, 0.f, 100.f);
 
     blockFeedback = addNewParameter<BoolParameter> ("blockFeedback", "block osc feedback (resending updated message to controller)", true);
+    sendBundles = addNewParameter<BoolParameter> ("sendBundles", "group outgoing messages in OSC bundles, receivers must support bundles", false);
     sendAllParameters =  addNewParameter<Trigger> ("sendAll", "send all parameter states to initialize ", true);
+    streamStateDump = addNewParameter<BoolParameter> ("streamStateDump", "sendAll streams sequenced bundles, a peer can ack, resume or request them on /lgml/dump/", true);
+    dumpRate = addNewParameter<FloatParameter> ("dumpRate", "bundles per second sent by a streamed sendAll", 500.f, 1.f, 10000.f);
 
     
     setupReceiver();
     setupSender();
 
     receiver.addListener (this);
-    lastOSCMessageSentTime = 0;
-    numSentInARow = NUM_OSC_MSG_IN_A_ROW;
 
 
 
@@ -112,7 +115,7 @@ void OSCController::setupReceiver()
 void OSCController::setupSender()
 {
     isConnected->setValue (false);
-    sender.disconnect();
+    oscMessageQueue.disconnect();
     hostNameResolved = false;
     resolveHostnameIfNeeded();
 
@@ -142,7 +145,7 @@ void OSCController::resolveHostnameIfNeeded()
                 if(resolved.hasValidPort()){
                 String resolvedPortString = String ((int)resolved.port);
 
-                if (!remotePortParam->isSettingValue && remotePortParam->stringValue() != resolvedPortString)
+                if (!remotePortParam->isSettingValue.get() && remotePortParam->stringValue() != resolvedPortString)
                 {
 
                     //    enssure to not create feedback on ports
@@ -161,7 +164,7 @@ void OSCController::resolveHostnameIfNeeded()
                 hostNameResolved = true;
                 int portNum = remotePortParam->stringValue().getTrailingIntValue();
                 bool connected = portNum>=100 && portNum <= 20000;
-                if(connected)connected = sender.connect (remoteIP,portNum );
+                if(connected)connected = connectSender (remoteIP,portNum );
                 isConnected->setValue (connected);
 
                 LOG ((connected?"":"!! un-") <<"resolved IP : " << hostName << " > " << remoteIP << ":" << remotePortParam->stringValue());
@@ -176,13 +179,19 @@ void OSCController::resolveHostnameIfNeeded()
             remoteIP = hostName;
             int portNum  = remotePortParam->stringValue().getTrailingIntValue();
             isConnected->setValue ((portNum >= 100 && portNum <= 20000)?
-                                           sender.connect (remoteIP, portNum):
+                                           connectSender (remoteIP, portNum):
                                            false);
             hostNameResolved = true;
         }
     }
 
 }
+
+bool OSCController::connectSender (const String& ip, int port)
+{
+    return oscMessageQueue.connect (ip, port);
+}
+
 void OSCController::processMessage (const OSCMessage& msg)
 {
     bool logIncoming = logIncomingOSC->boolValue();
@@ -194,6 +203,19 @@ void OSCController::processMessage (const OSCMessage& msg)
 
     if (!enabledParam->boolValue()) return;
 
+    if (msg.getAddressPattern().toString().startsWith ("/lgml/dump/"))
+    {
+        if (msg.getAddressPattern().toString() == OSCStateDump::requestAddress)
+        {
+            WeakReference<ParameterContainer> ref (this);
+            MessageManager::getInstance()->callAsync ([ref]() {if (auto* c = dynamic_cast<OSCController*> (ref.get())) c->sendAllParameters->trigger();});
+        }
+        else
+            stateDump.processPeerMessage (msg);
+
+        return;
+    }
+
     if (blockFeedback->boolValue())
     {
         lastMessageReceived = msg;
@@ -207,7 +229,8 @@ void OSCController::processMessage (const OSCMessage& msg)
 
     if (autoAddParams && !result && !msg.getAddressPattern().containsWildcards())
     {
-        MessageManager::getInstance()->callAsync ([this, msg]() {checkAndAddParameterIfNeeded (msg);});
+        WeakReference<ParameterContainer> ref (this);
+        MessageManager::getInstance()->callAsync ([ref, msg]() {if (auto* c = dynamic_cast<OSCController*> (ref.get())) c->checkAndAddParameterIfNeeded (msg);});
     }
     if(logIncoming && !result){
         LOG("!! "+result.getErrorMessage());
@@ -405,8 +428,9 @@ void OSCController::onContainerParameterChanged (Parameter* p)
     Controller::onContainerParameterChanged (p);
 
     if (p == localPortParam) setupReceiver();
-    else if ((p == remotePortParam && !remoteHostParam->isSettingValue) || p == remoteHostParam ) setupSender();
-    else if (p == speedLimit) {oscMessageQueue.interval = speedLimit->floatValue();}
+    else if ((p == remotePortParam && !remoteHostParam->isSettingValue.get()) || p == remoteHostParam ) setupSender();
+    else if (p == speedLimit) {oscMessageQueue.setInterval ((int) speedLimit->floatValue());}
+    else if (p == sendBundles) {oscMessageQueue.setUseBundles (sendBundles->boolValue());}
 
 
 
@@ -418,8 +442,31 @@ void OSCController::onContainerTriggerTriggered (Trigger* t)
 
     if (t == sendAllParameters)
     {
-        int sentCount = 0;
-        sendAllControllableStates (NodeManager::getInstance(), sentCount);
+        Array<OSCMessage> messages;
+
+        for (auto& c : NodeManager::getInstance()->getAllControllables (true))
+        {
+            if (c.get()) addStateMessage (c, messages);
+        }
+
+        if (messages.size() > 0)
+        {
+            resolveHostnameIfNeeded();
+
+            if (enabledParam->boolValue() && isConnected->boolValue())
+            {
+                if (streamStateDump->boolValue())
+                {
+                    const int dumpId = stateDump.start (messages, dumpRate->floatValue());
+                    NLOG (getNiceName(), "streaming state dump " + String (dumpId) + " : " + String (messages.size()) + " messages in " + String (stateDump.getNumBundles()) + " bundles");
+                }
+                else
+                {
+                    // plain messages, paced by the output queue
+                    for (auto& m : messages) {sendOSC (m, true);}
+                }
+            }
+        }
     }
 }
 
@@ -491,7 +538,7 @@ inline bool compareOSCMessages (const  OSCMessage& a, const OSCMessage& b)
     return true;
 
 }
-bool OSCController::sendOSC (OSCMessage& m)
+bool OSCController::sendOSC (OSCMessage& m, bool coalesce)
 {
     if (enabledParam->boolValue() )
     {
@@ -501,138 +548,88 @@ bool OSCController::sendOSC (OSCMessage& m)
         {
             if (!blockFeedback->boolValue() ||   !compareOSCMessages (lastMessageReceived, m)) //!isProcessingOSC ||
             {
+                if (logOutGoingOSC->boolValue()) { logMessage (m, "Out:");}
+
+                outActivityTrigger->trigger();
 
-                if (speedLimit->floatValue() > 0.0f)
+                if (!isConnected->boolValue())
                 {
-                    oscMessageQueue.add (new OSCMessage (m));
+                    LOG ("OSC : " + nameParam->stringValue() + " not connected");
+                    return false;
                 }
-                else
+
+                switch (oscMessageQueue.add (m, coalesce))
                 {
-                    return sendOSCInternal (m);
-                }
+                    case OSCMessageQueue::messageQueued:
+                        return true;
 
+                    case OSCMessageQueue::messageTooBig:
+                        LOG ("!!! OSC : message too big for a datagram : " + m.getAddressPattern().toString());
+                        return false;
+
+                    case OSCMessageQueue::messageDropped:
+                        return false;
+                }
             }
         }
     }
 
     return false;
 }
-bool OSCController::sendOSCInternal (OSCMessage& m)
-{
-    if (logOutGoingOSC->boolValue()) { logMessage (m, "Out:");}
-    outActivityTrigger->trigger();
-    if(isConnected->boolValue()){
-    return sender.send (m);
-    }
-    else{
-        LOG("OSC : "+nameParam->stringValue()+" not connected");
-
-    }
-    return false;
-}
-
 
 
-void OSCController::sendAllControllableStates (ControllableContainer* c, int& sentControllable)
+bool OSCController::addStateMessage (Controllable* c, Array<OSCMessage>& messages)
 {
-    if (c)
-    {
-        for (auto& controllable : c->getAllControllables())
-        {
-            controllableFeedbackUpdate (c, controllable);
-            sentControllable++;
-
-            if ((sentControllable % 10) == 0)
-            {
-                Thread::sleep (2);
-            }
-        }
-
-        for (auto& container : c->controllableContainers)
-        {
-            sendAllControllableStates (container, sentControllable);
-        }
-    }
+    // triggers have no state
+    if (Parameter::fromControllable (c) == nullptr || c->getFactoryTypeId() == Trigger::_factoryType) return false;
 
-}
-
-
-
-////////////////////////
-// OSCMessageQueue
-///////////////////////
-OSCController::OSCMessageQueue::OSCMessageQueue (OSCController* o):
-    owner (o),
-    aFifo (OSC_QUEUE_LENGTH),
-    interval (1)
-{messages.resize (OSC_QUEUE_LENGTH);}
+    try
+    {
+        OSCMessage m (getAddressFor (c));
 
-void OSCController::OSCMessageQueue::add (OSCMessage* m)
-{
-    int startIndex1, blockSize1, startIndex2, blockSize2;
-    aFifo.prepareToWrite (1, startIndex1, blockSize1, startIndex2, blockSize2);
-    int numWritten = 0;
+        if (!addValueToMessage (c, m)) return false;
 
-    if (blockSize1 > 0)
-    {
-        messages.set (startIndex1, m);
-        numWritten ++;
+        messages.add (m);
+        return true;
     }
-    else if (blockSize2 > 0)
-    {
-        messages.set (startIndex2, m);
-        numWritten ++;
-    }
-    else
+    catch (OSCFormatError&)
     {
-        aFifo.finishedWrite (numWritten);
-        numWritten = 0;
-        timerCallback();
-        NLOG (owner->getNiceName(), "!!! still flooding OSC");
-        delete m;
+        return false;
     }
+}
 
-    aFifo.finishedWrite (numWritten);
-
-    if (!isTimerRunning())startTimer (interval);
+String OSCController::getAddressFor (Controllable* c)
+{
+    return c->controlAddress;
 }
 
-void OSCController::OSCMessageQueue::timerCallback()
+bool OSCController::addValueToMessage (Controllable* c, OSCMessage& m)
 {
-    if (aFifo.getNumReady())
+    if (Parameter* p = Parameter::fromControllable (c))
     {
-        int numRead = 0;
-        int startIndex1, blockSize1, startIndex2, blockSize2;
-        aFifo.prepareToRead (NUM_OSC_MSG_IN_A_ROW, startIndex1, blockSize1, startIndex2, blockSize2);
+        auto  targetType = p->getFactoryTypeId();
 
-        if (blockSize1 > 0)
-        {
-            for ( ; numRead < blockSize1 ; numRead++ )
-            {
-                owner->sendOSCInternal (*messages[startIndex1 + numRead]);
-                delete messages[startIndex1 + numRead];
-            }
-        }
+        if (targetType == ParameterProxy::_factoryType) targetType = ((ParameterProxy*)c)->linkedParam->getFactoryTypeId();
 
-        if (blockSize2 > 0)
+        if (targetType == Trigger::_factoryType) {}
+        else if (targetType == BoolParameter::_factoryType) {m.addInt32 (p->intValue());}
+        else if (targetType == FloatParameter::_factoryType) {m.addFloat32 (p->floatValue());}
+        else if (targetType == IntParameter::_factoryType) {m.addInt32 (p->intValue());}
+        else if (targetType == StringParameter::_factoryType) {m.addString (p->stringValue());}
+        else if (targetType == EnumParameter::_factoryType) {m.addString (p->stringValue());}
+        else
         {
-            for (int i = 0 ; i < blockSize2 ; i++ )
-            {
-                owner->sendOSCInternal (*messages[startIndex2 + i]);
-                delete messages[startIndex2 + i];
-                numRead++;
-            }
+            DBG ("Type not supported " << targetType.toString());
+            return false;
         }
 
-        aFifo.finishedRead (numRead);
-
-    }
-    else
-    {
-        stopTimer();
+        return true;
     }
+
+    return false;
 }
 
+
 StringArray OSCController::OSCAddressToArray (const String& addr)
 {
     StringArray addrArray;
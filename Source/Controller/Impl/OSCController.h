@@ -17,11 +17,12 @@
 #define OSCCONTROLLER_H_INCLUDED
 
 #include "../Controller.h"
+#include "OSCMessageQueue.h"
+#include "OSCStateDump.h"
 
 #include <juce_osc/juce_osc.h>
 
 
-#define NUM_OSC_MSG_IN_A_ROW 10
 #define OSC_QUEUE_LENGTH 5000
 
 
@@ -40,14 +41,13 @@ public:
     BoolParameter* logIncomingOSC;
     BoolParameter* logOutGoingOSC;
     BoolParameter* blockFeedback; // if a parameter is updated from processOSC , stops any osc out with same address
+    BoolParameter* sendBundles;
     Trigger* sendAllParameters;
+    BoolParameter* streamStateDump;
+    FloatParameter* dumpRate;
     
 
 
-    float lastOSCMessageSentTime;
-    int numSentInARow;
-
-
     void processMessage (const OSCMessage& msg);
     virtual Result processMessageInternal (const OSCMessage& msg);
 
@@ -57,7 +57,12 @@ public:
 
     virtual void oscMessageReceived (const OSCMessage& message) override;
     virtual void oscBundleReceived (const OSCBundle& bundle) override;
-    void sendAllControllableStates (ControllableContainer* c, int& sentControllable );
+
+    // state message of c sent by sendAll, returns false if c has no state to send
+    virtual bool addStateMessage (Controllable* c, Array<OSCMessage>& messages);
+    // address under which c is sent
+    virtual String getAddressFor (Controllable* c);
+    static bool addValueToMessage (Controllable*, OSCMessage& m);
 
     static StringArray OSCAddressToArray (const String&);
 
@@ -86,21 +91,11 @@ public:
     }
 #endif
 
-    class OSCMessageQueue: private Timer
-    {
-    public:
-        OSCMessageQueue (OSCController* o);
-        void add (OSCMessage* m);
-        void timerCallback() override;
-        Array<OSCMessage*> messages;
-        AbstractFifo aFifo;
-        OSCController* owner;
-        int interval;
-
-    };
-
+    // outgoing messages are bundled by a dedicated thread, parameter feedback is coalesced
     OSCMessageQueue oscMessageQueue;
-    bool sendOSC (OSCMessage& m);
+    OSCStateDump stateDump;
+    // only parameter feedback should be coalesced : a newer message with the same address replaces a pending one
+    bool sendOSC (OSCMessage& m, bool coalesce = false);
 
     void logMessage (const OSCMessage& m, const String& prefix = "");
 
@@ -111,11 +106,9 @@ private:
     
     void setupReceiver();
     void setupSender();
-    bool sendOSCInternal (OSCMessage& m);
-    friend class OSCMessageQueue;
+    bool connectSender (const String& ip, int port);
     // should use sendOSC for centralizing every call
     OSCReceiver receiver;
-    OSCSender sender;
     //  String lastAddressReceived;
     OSCMessage lastMessageReceived;
     bool isProcessingOSC;
@@ -157,45 +157,26 @@ void OSCDirectController::onContainerParameterChanged (Parameter* p)
 
 void OSCDirectController::sendOSCForAddress (Controllable* c, const String& cAddress)
 {
+    OSCMessage m (cAddress);
 
+    // each trigger fire is sent, only parameter values are coalesced
+    if (addValueToMessage (c, m)) {sendOSC (m, c->getFactoryTypeId() != Trigger::_factoryType);}
+    else {jassertfalse;}
+}
 
-    if (Parameter* p = Parameter::fromControllable (c))
-    {
-        auto  targetType = p->getFactoryTypeId();
-
-        if (targetType == ParameterProxy::_factoryType) targetType = ((ParameterProxy*)c)->linkedParam->getFactoryTypeId();
-
-        if (targetType == Trigger::_factoryType) {sendOSC (cAddress);}
-        else if (targetType == BoolParameter::_factoryType) {sendOSC (cAddress, p->intValue());}
-        else if (targetType == FloatParameter::_factoryType) {sendOSC (cAddress, p->floatValue());}
-        else if (targetType == IntParameter::_factoryType) {sendOSC (cAddress, p->intValue());}
-        else if (targetType == StringParameter::_factoryType) {sendOSC (cAddress, p->stringValue());}
-        else if (targetType == EnumParameter::_factoryType) {sendOSC (cAddress, p->stringValue());}
-        else
-        {
-            DBG ("Type not supported " << targetType.toString());
-            jassertfalse;
-        }
+String OSCDirectController::getAddressFor (Controllable* c)
+{
+    if (c->isChildOf (&userContainer)) return c->getControlAddress (&userContainer);
 
-    }
-    else
-    {
-        jassertfalse;
-    }
+    return c->controlAddress;
 }
+
 void OSCDirectController::controllableFeedbackUpdate (ControllableContainer* /*originContainer*/, Controllable* c)
 {
 
     if (enabledParam->boolValue())
     {
-        if (c->isChildOf (&userContainer))
-        {
-            sendOSCForAddress (c, c->getControlAddress (&userContainer));
-        }
-        else
-        {
-            sendOSCForAddress (c, c->controlAddress);
-        }
+        sendOSCForAddress (c, getAddressFor (c));
     }
 
 
@@ -63,6 +63,7 @@ public:
 
 private:
     void sendOSCForAddress (Controllable*, const String& address);
+    String getAddressFor (Controllable*) override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OSCDirectController)
 
@@ -51,7 +51,7 @@ void OSCJsController::buildLocalEnv()
 
 }
 
-Result OSCJsController::callForMessage (const OSCMessage& msg)
+Result OSCJsController::callForMessage (const OSCMessage& msg, bool isParameterAddress)
 {
 
     String functionName = "onCtl_" + getJsFunctionNameFromAddress (msg.getAddressPattern().toString());
@@ -68,7 +68,12 @@ Result OSCJsController::callForMessage (const OSCMessage& msg)
     }
 
     Result r (Result::ok());
-    var varRes = callFunction (functionName, argArray, false, &r);
+    const Identifier function = getDefinedFunctionIdentifier (functionName);
+
+    // parameter updates to the same function are coalesced, the pooled name identifies it
+    if (function.isValid()) postFunctionCall (function, Array<var> {argArray}, isParameterAddress ? function.getCharPointer().getAddress() : nullptr);
+    else r = Result::fail (noFunctionLogIdentifier.toString());
+
     callonAnyMsg (msg);
     return r;
 }
@@ -99,7 +104,7 @@ void OSCJsController::callonAnyMsg (const OSCMessage& msg)
 
     Array<var> argList = {address, args};
     static const Identifier onCtlAnyMsgIdentifier ("onCtl_AnyMsg");
-    var varRes = callFunctionFromIdentifier (onCtlAnyMsgIdentifier, argList);
+    postFunctionCall (onCtlAnyMsgIdentifier, argList);
 
 }
 
@@ -113,7 +118,7 @@ Result OSCJsController::processMessageInternal (const OSCMessage& m)
     Result r2 (Result::fail ("no valid js file"));
 
     if (hasValidJsFile())
-        r2 = callForMessage (m);
+        r2 = callForMessage (m, r1.wasOk());
 
     if (!r1 && !r2)
     {
@@ -301,6 +306,6 @@ inline void JsOSCListener::processMessage (const OSCMessage& msg)
             for (auto& m : msg) { argsList->append (OSCJsController::OSCArgumentToVar (m)); }
         }
 
-        jsEnv->callFunctionFromIdentifier (oscReceivedCallbackId, var::NativeFunctionArgs (object, jsArgs, 2), true);
+        jsEnv->postFunctionCall (oscReceivedCallbackId, Array<var> {jsArgs[0], jsArgs[1]}, nullptr, object);
     }
 }
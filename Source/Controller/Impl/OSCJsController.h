@@ -31,7 +31,8 @@ public:
 
     ~OSCJsController();
     Result processMessageInternal (const OSCMessage& m) override;
-    Result callForMessage (const OSCMessage& msg);
+    // only messages setting a parameter are coalesced (latest value wins), others are events delivered one by one
+    Result callForMessage (const OSCMessage& msg, bool isParameterAddress = false);
     void callonAnyMsg (const OSCMessage& msg);
 
     static var sendOSCFromJS (const juce::var::NativeFunctionArgs& a);
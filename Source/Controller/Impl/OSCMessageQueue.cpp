@@ -0,0 +1,399 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#include "OSCMessageQueue.h"
+
+#include "../../Utils/DebugHelpers.h"
+
+
+namespace
+{
+    // OSC wire format helpers, every field is padded to 4 bytes and numbers are big endian
+
+    inline bool writeInt32 (char*& d, const char* end, uint32 v)
+    {
+        if (d + 4 > end) return false;
+
+        v = ByteOrder::swapIfLittleEndian (v);
+        memcpy (d, &v, 4);
+        d += 4;
+        return true;
+    }
+
+    inline bool writePadded (char*& d, const char* end, const void* data, size_t size)
+    {
+        const size_t padded = (size + 3) & ~(size_t) 3;
+
+        if (d + padded > end) return false;
+
+        memcpy (d, data, size);
+        memset (d + size, 0, padded - size);
+        d += padded;
+        return true;
+    }
+
+    inline bool writeString (char*& d, const char* end, const String& s)
+    {
+        const char* utf8 = s.toRawUTF8();
+        return writePadded (d, end, utf8, strlen (utf8) + 1);
+    }
+
+    inline uint32 hashBytes (const char* data, int size)
+    {
+        uint32 h = 2166136261u;
+
+        for (int i = 0 ; i < size ; i++) {h = (h ^ (uint8) data[i]) * 16777619u;}
+
+        return h;
+    }
+
+    const int bundleHeaderSize = 16;
+}
+
+
+OSCMessageQueue::OSCMessageQueue (const String& name, int _poolSize, int _slotSize):
+    Thread (name + "_OSCOut"),
+    poolSize (_poolSize),
+    slotSize ((_slotSize + 3) & ~3),
+    numBuckets (nextPowerOfTwo (_poolSize * 2)),
+    numPending (0),
+    numSending (0),
+    numFreeSlots (0),
+    targetPort (0),
+    interval (0),
+    useBundles (0),
+    lastLoggedDrops (0)
+{
+    // any message should fit in a bundle
+    jassert (slotSize + bundleHeaderSize + 4 <= maxPacketSize);
+
+    slotData.allocate ((size_t) (poolSize * slotSize), false);
+    slots.allocate ((size_t) poolSize, true);
+    pending.allocate ((size_t) poolSize, false);
+    sending.allocate ((size_t) poolSize, false);
+    freeSlots.allocate ((size_t) poolSize, false);
+    buckets.allocate ((size_t) numBuckets, true);
+    packet.allocate ((size_t) maxPacketSize, false);
+    scratch.allocate ((size_t) slotSize, false);
+
+    for (int i = poolSize - 1 ; i >= 0 ; i--) {freeSlots[numFreeSlots++] = i;}
+
+    startThread (5);
+}
+
+OSCMessageQueue::~OSCMessageQueue()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (1000);
+
+    for (int i = 0 ; i < poolSize ; i++) {delete slots[i].largeMessage;}
+}
+
+
+bool OSCMessageQueue::connect (const String& _targetHost, int _targetPort)
+{
+    const ScopedLock lk (socketLock);
+    socket = new DatagramSocket (true);
+    targetHost = _targetHost;
+    targetPort = _targetPort;
+
+    if (socket->bindToPort (0))
+        return true;
+
+    socket = nullptr;
+    return false;
+}
+
+void OSCMessageQueue::disconnect()
+{
+    const ScopedLock lk (socketLock);
+    socket = nullptr;
+}
+
+
+void OSCMessageQueue::setInterval (int ms)
+{
+    interval = jmax (0, ms);
+    notify();
+}
+
+void OSCMessageQueue::setUseBundles (bool b)
+{
+    useBundles = b ? 1 : 0;
+}
+
+int OSCMessageQueue::getNumPending()
+{
+    const ScopedLock lk (lock);
+    return numPending;
+}
+
+
+OSCMessageQueue::AddResult OSCMessageQueue::add (const OSCMessage& m, bool coalesce)
+{
+    const ScopedLock lk (lock);
+
+    int addressSize = 0;
+    int size = encodeMessage (m, scratch, slotSize, addressSize);
+    ScopedPointer<MemoryBlock> largeMessage;
+
+    if (size < 0)
+    {
+        // still queued so that it is not sent ahead of pending messages
+        largeMessage = new MemoryBlock ((size_t) maxDatagramSize);
+        size = encodeMessage (m, static_cast<char*> (largeMessage->getData()), maxDatagramSize, addressSize);
+
+        if (size < 0) return messageTooBig;
+
+        largeMessage->setSize ((size_t) size);
+        coalesce = false;
+    }
+
+    uint32 hash = 0;
+    int bucket = -1;
+    int existing = -1;
+
+    if (coalesce)
+    {
+        hash = hashBytes (scratch, addressSize);
+        existing = findPending (scratch, addressSize, hash, bucket);
+    }
+
+    if (existing >= 0)
+    {
+        // latest value wins, in place, keeping first position in the queue
+        memcpy (slotData + (size_t) (existing * slotSize), scratch, (size_t) size);
+        slots[existing].size = size;
+    }
+    else
+    {
+        if (numFreeSlots == 0)
+        {
+            ++numDropped;
+            notify();
+            return messageDropped;
+        }
+
+        const int idx = freeSlots[--numFreeSlots];
+
+        if (largeMessage == nullptr) {memcpy (slotData + (size_t) (idx * slotSize), scratch, (size_t) size);}
+
+        Slot& s = slots[idx];
+        s.size = size;
+        s.addressSize = addressSize;
+        s.addressHash = hash;
+        s.bucket = bucket;
+        s.largeMessage = largeMessage.release();
+        pending[numPending++] = idx;
+
+        if (bucket >= 0) {buckets[bucket] = idx + 1;}
+    }
+
+    if (interval.get() == 0 || numFreeSlots < poolSize / 4) notify();
+
+    return messageQueued;
+}
+
+
+int OSCMessageQueue::findPending (const char* data, int addressSize, uint32 hash, int& bucket)
+{
+    const int mask = numBuckets - 1;
+    bucket = (int) (hash & (uint32) mask);
+
+    while (buckets[bucket] != 0)
+    {
+        const int idx = buckets[bucket] - 1;
+        const Slot& s = slots[idx];
+
+        if (s.addressHash == hash && s.addressSize == addressSize && memcmp (slotData + (size_t) (idx * slotSize), data, (size_t) addressSize) == 0)
+            return idx;
+
+        bucket = (bucket + 1) & mask;
+    }
+
+    return -1;
+}
+
+
+void OSCMessageQueue::run()
+{
+    while (!threadShouldExit())
+    {
+        const int ms = interval.get();
+        wait (ms > 0 ? ms : -1);
+
+        if (threadShouldExit()) break;
+
+        flush();
+    }
+}
+
+
+void OSCMessageQueue::flush()
+{
+    {
+        const ScopedLock lk (lock);
+
+        for (int i = 0 ; i < numPending ; i++)
+        {
+            sending[i] = pending[i];
+
+            if (slots[pending[i]].bucket >= 0) {buckets[slots[pending[i]].bucket] = 0;}
+        }
+
+        numSending = numPending;
+        numPending = 0;
+    }
+
+    if (numSending == 0) return;
+
+    const bool bundle = useBundles.get() != 0;
+    int packetSize = 0;
+    int numInPacket = 0;
+
+    for (int i = 0 ; i < numSending ; i++)
+    {
+        const Slot& s = slots[sending[i]];
+        const char* data = s.largeMessage != nullptr ? static_cast<const char*> (s.largeMessage->getData()) : slotData + (size_t) (sending[i] * slotSize);
+
+        if (numInPacket > 0 && (s.largeMessage != nullptr || packetSize + 4 + s.size > maxPacketSize))
+        {
+            if (numInPacket == 1) sendPacket (packet + bundleHeaderSize + 4, packetSize - bundleHeaderSize - 4);
+            else sendPacket (packet, packetSize);
+
+            numInPacket = 0;
+        }
+
+        // large messages go alone, after what was queued before them
+        if (!bundle || s.largeMessage != nullptr)
+        {
+            sendPacket (data, s.size);
+            continue;
+        }
+
+        if (numInPacket == 0)
+        {
+            // "#bundle" and immediate time tag
+            char* d = packet;
+            writePadded (d, packet + maxPacketSize, "#bundle", 8);
+            writeInt32 (d, packet + maxPacketSize, 0);
+            writeInt32 (d, packet + maxPacketSize, 1);
+            packetSize = bundleHeaderSize;
+        }
+
+        char* d = packet + packetSize;
+        writeInt32 (d, packet + maxPacketSize, (uint32) s.size);
+        memcpy (d, data, (size_t) s.size);
+        packetSize += 4 + s.size;
+        numInPacket++;
+    }
+
+    // a single message is sent as is
+    if (numInPacket == 1) sendPacket (packet + bundleHeaderSize + 4, packetSize - bundleHeaderSize - 4);
+    else if (numInPacket > 1) sendPacket (packet, packetSize);
+
+    releaseSendingSlots();
+
+    const int dropped = numDropped.get();
+
+    if (dropped != lastLoggedDrops)
+    {
+        NLOG (getThreadName(), "!!! OSC output is flooded, " + String (dropped - lastLoggedDrops) + " messages dropped");
+        lastLoggedDrops = dropped;
+    }
+}
+
+
+void OSCMessageQueue::sendPacket (const char* data, int size)
+{
+    const ScopedLock lk (socketLock);
+
+    if (socket != nullptr) socket->write (targetHost, targetPort, data, size);
+}
+
+
+void OSCMessageQueue::releaseSendingSlots()
+{
+    const ScopedLock lk (lock);
+
+    for (int i = 0 ; i < numSending ; i++)
+    {
+        Slot& s = slots[sending[i]];
+        deleteAndZero (s.largeMessage);
+        freeSlots[numFreeSlots++] = sending[i];
+    }
+
+    numSending = 0;
+}
+
+
+int OSCMessageQueue::encodeMessage (const OSCMessage& m, char* dest, int maxSize, int& addressSize)
+{
+    char* d = dest;
+    const char* end = dest + maxSize;
+
+    if (!writeString (d, end, m.getAddressPattern().toString())) return -1;
+
+    addressSize = (int) (d - dest);
+
+    char localTypeTags[32];
+    HeapBlock<char> heapTypeTags;
+    char* typeTags = localTypeTags;
+
+    if (m.size() + 2 > (int) sizeof (localTypeTags))
+    {
+        heapTypeTags.allocate ((size_t) m.size() + 2, false);
+        typeTags = heapTypeTags;
+    }
+
+    typeTags[0] = ',';
+
+    for (int i = 0 ; i < m.size() ; i++) {typeTags[i + 1] = m[i].getType();}
+
+    typeTags[m.size() + 1] = 0;
+
+    if (!writePadded (d, end, typeTags, (size_t) m.size() + 2)) return -1;
+
+    for (auto& a : m)
+    {
+        bool ok = false;
+
+        if (a.isInt32())
+        {
+            ok = writeInt32 (d, end, (uint32) a.getInt32());
+        }
+        else if (a.isFloat32())
+        {
+            const float f = a.getFloat32();
+            uint32 u;
+            memcpy (&u, &f, 4);
+            ok = writeInt32 (d, end, u);
+        }
+        else if (a.isString())
+        {
+            ok = writeString (d, end, a.getString());
+        }
+        else if (a.isBlob())
+        {
+            const MemoryBlock& b = a.getBlob();
+            ok = writeInt32 (d, end, (uint32) b.getSize()) && writePadded (d, end, b.getData(), b.getSize());
+        }
+
+        if (!ok) return -1;
+    }
+
+    return (int) (d - dest);
+}
@@ -0,0 +1,123 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#ifndef OSCMESSAGEQUEUE_H_INCLUDED
+#define OSCMESSAGEQUEUE_H_INCLUDED
+
+#include "../../JuceHeaderCore.h"//keep
+#include <juce_osc/juce_osc.h>
+
+
+/*
+ outgoing OSC pipeline of an OSCController
+
+ messages are encoded on the calling thread into a preallocated pool of fixed size slots,
+ a coalesced message (parameter feedback) with the same address as a pending coalesced one replaces it (latest value wins)
+ other messages are always queued, messages bigger than a slot are queued in their own block, in order
+ a dedicated thread flushes pending messages every interval (or as soon as possible if interval is 0),
+ packing them into OSC bundles fitting in a single UDP datagram
+ */
+
+class OSCMessageQueue : private Thread
+{
+public:
+    OSCMessageQueue (const String& name, int poolSize, int slotSize = 256);
+    ~OSCMessageQueue();
+
+    // payload of an UDP datagram fitting in an ethernet MTU
+    static const int maxPacketSize = 1472;
+    // biggest UDP payload
+    static const int maxDatagramSize = 65507;
+
+    bool connect (const String& targetHost, int targetPort);
+    void disconnect();
+
+    enum AddResult
+    {
+        messageQueued = 0,
+        messageDropped, // pool is full
+        messageTooBig   // does not fit in a datagram
+    };
+
+    AddResult add (const OSCMessage& m, bool coalesce = false);
+
+    // ms between two flushes, 0 flushes as soon as messages are added
+    void setInterval (int ms);
+    void setUseBundles (bool);
+
+    int getNumPending();
+    int getNumDropped() const {return numDropped.get();}
+
+    // encode m in OSC wire format, returns number of bytes written or -1 if it does not fit in maxSize
+    static int encodeMessage (const OSCMessage& m, char* dest, int maxSize, int& addressSize);
+
+    // send an already encoded packet right away, bypassing the queue
+    void sendPacket (const char* data, int size);
+
+private:
+    struct Slot
+    {
+        int size;
+        int addressSize;
+        uint32 addressHash;
+        int bucket; // -1 if not coalesced
+        MemoryBlock* largeMessage; // owned, encoded message when it doesn't fit in the slot
+    };
+
+    void run() override;
+    void flush();
+    void releaseSendingSlots();
+
+    int findPending (const char* data, int addressSize, uint32 hash, int& bucket);
+
+    const int poolSize;
+    const int slotSize;
+    const int numBuckets;
+
+    HeapBlock<char> slotData;
+    HeapBlock<Slot> slots;
+
+    // pending messages, in insertion order, with their hash table (slot index + 1, 0 if empty)
+    HeapBlock<int> pending;
+    int numPending;
+    HeapBlock<int> buckets;
+
+    HeapBlock<int> sending;
+    int numSending;
+
+    HeapBlock<int> freeSlots;
+    int numFreeSlots;
+
+    HeapBlock<char> packet;
+
+    // encoding area for add(), so that a pending address can be overwritten when the pool is full
+    HeapBlock<char> scratch;
+
+    CriticalSection lock;
+    CriticalSection socketLock;
+    ScopedPointer<DatagramSocket> socket;
+    String targetHost;
+    int targetPort;
+
+    Atomic<int> interval;
+    Atomic<int> useBundles;
+    Atomic<int> numDropped;
+    int lastLoggedDrops;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OSCMessageQueue)
+};
+
+
+#endif  // OSCMESSAGEQUEUE_H_INCLUDED
@@ -0,0 +1,261 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#include "OSCStateDump.h"
+
+
+const String OSCStateDump::beginAddress ("/lgml/dump/begin");
+const String OSCStateDump::seqAddress ("/lgml/dump/seq");
+const String OSCStateDump::endAddress ("/lgml/dump/end");
+const String OSCStateDump::ackAddress ("/lgml/dump/ack");
+const String OSCStateDump::resumeAddress ("/lgml/dump/resume");
+const String OSCStateDump::requestAddress ("/lgml/dump/request");
+
+namespace
+{
+    const int bundleHeaderSize = 16;
+    const int controlMessageMaxSize = 64;
+}
+
+
+OSCStateDump::OSCStateDump (const String& name, OSCMessageQueue& _output):
+    Thread (name + "_OSCDump"),
+    output (_output),
+    numMessages (0),
+    totalChecksum (0),
+    dumpId (-1),
+    lastDumpId (Random::getSystemRandom().nextInt (1 << 16)),
+    bundlesPerSecond (500),
+    nextSeq (0),
+    lastAckedSeq (-1)
+{
+}
+
+OSCStateDump::~OSCStateDump()
+{
+    stop();
+}
+
+
+int OSCStateDump::start (const Array<OSCMessage>& messages, double _bundlesPerSecond)
+{
+    stop();
+
+    // peers messages are ignored until the new snapshot is complete
+    dumpId = -1;
+    lastDumpId = (lastDumpId + 1) & 0x7fffffff;
+    bundlesPerSecond = jmax (1.0, _bundlesPerSecond);
+    numMessages = 0;
+    totalChecksum = checksum (nullptr, 0);
+    bundles.reset();
+    bundleOffsets.clearQuick();
+    bundleSizes.clearQuick();
+
+    // seq message has a constant size : 3 int32
+    char seqMessage[controlMessageMaxSize];
+    int addressSize = 0;
+    const int seqMessageSize = OSCMessageQueue::encodeMessage (OSCMessage (seqAddress, 0, 0, 0), seqMessage, controlMessageMaxSize, addressSize);
+    const int maxContentSize = OSCMessageQueue::maxPacketSize - bundleHeaderSize - 4 - seqMessageSize;
+
+    HeapBlock<char> content ((size_t) maxContentSize);
+    HeapBlock<char> encoded ((size_t) maxContentSize);
+    int contentSize = 0;
+    int numInBundle = 0;
+    uint32 bundleChecksum = checksum (nullptr, 0);
+    MemoryOutputStream out (bundles, true);
+
+    auto closeBundle = [&]()
+    {
+        bundleOffsets.add ((int) out.getPosition());
+
+        out.write ("#bundle", 8);
+        out.writeIntBigEndian (0);
+        out.writeIntBigEndian (1);
+
+        OSCMessageQueue::encodeMessage (OSCMessage (seqAddress, lastDumpId, bundleOffsets.size() - 1, (int) bundleChecksum), seqMessage, controlMessageMaxSize, addressSize);
+        out.writeIntBigEndian (seqMessageSize);
+        out.write (seqMessage, (size_t) seqMessageSize);
+        out.write (content, (size_t) contentSize);
+
+        bundleSizes.add ((int) out.getPosition() - bundleOffsets.getLast());
+
+        const uint32 bigEndianChecksum = ByteOrder::swapIfLittleEndian (bundleChecksum);
+        totalChecksum = checksum ((const char*) &bigEndianChecksum, 4, totalChecksum);
+
+        contentSize = 0;
+        numInBundle = 0;
+        bundleChecksum = checksum (nullptr, 0);
+    };
+
+    for (auto& m : messages)
+    {
+        const int size = OSCMessageQueue::encodeMessage (m, encoded, maxContentSize - 4, addressSize);
+
+        if (size < 0)
+        {
+            DBG ("OSC state message too big : " + m.getAddressPattern().toString());
+            continue;
+        }
+
+        if (contentSize + 4 + size > maxContentSize) closeBundle();
+
+        const uint32 bigEndianSize = ByteOrder::swapIfLittleEndian ((uint32) size);
+        memcpy (content + contentSize, &bigEndianSize, 4);
+        memcpy (content + contentSize + 4, encoded, (size_t) size);
+        contentSize += 4 + size;
+        bundleChecksum = checksum (encoded, size, bundleChecksum);
+        numInBundle++;
+        numMessages++;
+    }
+
+    if (numInBundle > 0) closeBundle();
+
+    out.flush();
+
+    nextSeq = 0;
+    lastAckedSeq = -1;
+    dumpId = lastDumpId;
+    startThread (5);
+
+    return lastDumpId;
+}
+
+
+void OSCStateDump::stop()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (1000);
+}
+
+
+void OSCStateDump::acknowledge (int _dumpId, int seq)
+{
+    if (_dumpId < 0 || _dumpId != dumpId.get()) return;
+
+    if (seq > lastAckedSeq.get()) lastAckedSeq = seq;
+
+    notify();
+}
+
+
+void OSCStateDump::resume (int _dumpId, int seq)
+{
+    if (_dumpId < 0 || _dumpId != dumpId.get()) return;
+
+    lastAckedSeq = seq;
+    nextSeq = jlimit (0, getNumBundles(), seq + 1);
+    notify();
+}
+
+
+bool OSCStateDump::processPeerMessage (const OSCMessage& msg)
+{
+    const String address = msg.getAddressPattern().toString();
+
+    if (address == ackAddress || address == resumeAddress)
+    {
+        if (msg.size() >= 2 && msg[0].isInt32() && msg[1].isInt32())
+        {
+            if (address == ackAddress) acknowledge (msg[0].getInt32(), msg[1].getInt32());
+            else resume (msg[0].getInt32(), msg[1].getInt32());
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+
+bool OSCStateDump::hasSentAllBundles() const
+{
+    return nextSeq.get() >= getNumBundles();
+}
+
+
+uint32 OSCStateDump::checksum (const char* data, int size, uint32 previous)
+{
+    uint32 h = previous;
+
+    for (int i = 0 ; i < size ; i++) {h = (h ^ (uint8) data[i]) * 16777619u;}
+
+    return h;
+}
+
+
+void OSCStateDump::run()
+{
+    sendControlMessage (OSCMessage (beginAddress, dumpId.get(), getNumBundles(), numMessages));
+
+    const double interval = 1000.0 / bundlesPerSecond;
+    double nextTime = Time::getMillisecondCounterHiRes();
+    bool endSent = false;
+
+    while (!threadShouldExit())
+    {
+        const int seq = nextSeq.get();
+
+        if (seq >= getNumBundles())
+        {
+            if (!endSent)
+            {
+                sendControlMessage (OSCMessage (endAddress, dumpId.get(), getNumBundles(), (int) totalChecksum));
+                endSent = true;
+            }
+
+            // snapshot is kept for resume requests
+            wait (-1);
+            nextTime = Time::getMillisecondCounterHiRes();
+            continue;
+        }
+
+        endSent = false;
+
+        const int acked = lastAckedSeq.get();
+
+        if (acked >= 0 && seq > acked + ackWindow)
+        {
+            wait (5);
+            continue;
+        }
+
+        const double now = Time::getMillisecondCounterHiRes();
+
+        if (now < nextTime)
+        {
+            wait (jmax (1, (int) (nextTime - now)));
+            continue;
+        }
+
+        output.sendPacket (static_cast<const char*> (bundles.getData()) + bundleOffsets.getUnchecked (seq), bundleSizes.getUnchecked (seq));
+
+        // a resume request may have moved nextSeq in the meantime
+        nextSeq.compareAndSetBool (seq + 1, seq);
+
+        // don't burst if we were late
+        nextTime = jmax (nextTime + interval, now - 10 * interval);
+    }
+}
+
+
+void OSCStateDump::sendControlMessage (const OSCMessage& m)
+{
+    char data[controlMessageMaxSize];
+    int addressSize = 0;
+    const int size = OSCMessageQueue::encodeMessage (m, data, controlMessageMaxSize, addressSize);
+
+    if (size > 0) output.sendPacket (data, size);
+}
@@ -0,0 +1,86 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#ifndef OSCSTATEDUMP_H_INCLUDED
+#define OSCSTATEDUMP_H_INCLUDED
+
+#include "OSCMessageQueue.h"
+
+/*
+ streams a snapshot of state messages as rate-paced OSC bundles
+
+ protocol :
+    /lgml/dump/begin  dumpId numBundles numMessages
+    each bundle starts with /lgml/dump/seq dumpId seq checksum, followed by state messages
+    /lgml/dump/end    dumpId numBundles checksum of all bundles checksums
+ checksum is FNV-1a over the OSC encoding of the state messages of a bundle (without size prefixes)
+
+ the peer can send back :
+    /lgml/dump/ack    dumpId seq : last sequence received without gap, this enables a window of unacked bundles
+    /lgml/dump/resume dumpId seq : restart streaming after seq
+    /lgml/dump/request           : ask for a new dump
+ */
+
+class OSCStateDump : private Thread
+{
+public:
+    OSCStateDump (const String& name, OSCMessageQueue& output);
+    ~OSCStateDump();
+
+    // serialize messages once into bundles and start streaming them, returns the dump id
+    int start (const Array<OSCMessage>& messages, double bundlesPerSecond);
+    void stop();
+
+    void acknowledge (int dumpId, int seq);
+    void resume (int dumpId, int seq);
+
+    // handle /lgml/dump/ messages, returns false for other messages, request messages are not handled here
+    bool processPeerMessage (const OSCMessage& msg);
+
+    int getDumpId() const {return dumpId.get();}
+    int getNumBundles() const {return bundleOffsets.size();}
+    bool hasSentAllBundles() const;
+
+    static uint32 checksum (const char* data, int size, uint32 previous = 2166136261u);
+
+    static const String beginAddress, seqAddress, endAddress, ackAddress, resumeAddress, requestAddress;
+
+    // number of bundles sent ahead of last ack
+    static const int ackWindow = 64;
+
+private:
+    void run() override;
+    void sendControlMessage (const OSCMessage& m);
+
+    OSCMessageQueue& output;
+
+    MemoryBlock bundles;
+    Array<int> bundleOffsets, bundleSizes;
+    int numMessages;
+    uint32 totalChecksum;
+
+    // read from the receiver thread, -1 while a dump is being built
+    Atomic<int> dumpId;
+    int lastDumpId;
+    double bundlesPerSecond;
+
+    Atomic<int> nextSeq;
+    Atomic<int> lastAckedSeq;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OSCStateDump)
+};
+
+
+#endif  // OSCSTATEDUMP_H_INCLUDED
@@ -143,7 +143,7 @@ void SerialPort::removeSerialPortListener (SerialPortListener* listener)
 SerialReadThread::SerialReadThread (String name, SerialPort* _port) :
     Thread (name + "_thread"),
     port (_port),
-    queuedNotifier (100)
+    queuedNotifier (100, true)
 {
 }
 
@@ -183,7 +183,7 @@ void SerialReadThread::run()
                     if (line.size() > 0)
                     {
                         serialThreadListeners.call (&SerialThreadListener::newMessage, var (line));
-                        queuedNotifier.addMessage (new var (line));
+                        queuedNotifier.addMessage (var (line));
                     }
 
                 }
@@ -215,11 +215,11 @@ void SerialReadThread::run()
 
                         if (b == 255)
                         {
-                            var* dataVar = new var();
+                            var dataVar;
 
-                            for (auto& by : byteBuffer) dataVar->append (by);
+                            for (auto& by : byteBuffer) dataVar.append (by);
 
-                            serialThreadListeners.call (&SerialThreadListener::newMessage, *dataVar);
+                            serialThreadListeners.call (&SerialThreadListener::newMessage, dataVar);
                             queuedNotifier.addMessage (dataVar);
                             byteBuffer.clear();
                         }
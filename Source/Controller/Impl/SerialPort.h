@@ -19,7 +19,7 @@
 
 #define SYNCHRONOUS_SERIAL_LISTENERS
 
-#include "../../Utils/QueuedNotifier.h"
+#include "../../Utils/LockFreeQueuedNotifier.h"
 
 #if !defined __arm__
     #define SERIALSUPPORT 1
@@ -48,8 +48,8 @@ public:
     virtual void run() override;
 
     // ASYNC
-    QueuedNotifier<var> queuedNotifier;
-    typedef QueuedNotifier<var>::Listener AsyncListener;
+    LockFreeQueuedNotifier<var> queuedNotifier;
+    typedef LockFreeQueuedNotifier<var>::Listener AsyncListener;
 
     class SerialThreadListener
     {
@@ -34,6 +34,7 @@
 
 
 #include "Scripting/Js/JsGlobalEnvironment.h"
+#include "Preset/PresetMorphEngine.h"
 
 
 const char* const filenameSuffix = ".lgml";
@@ -48,6 +49,7 @@ void setDefault(PropertiesFile *f, const String & n, const var & d)
 void initDefaultUserSettings(){
     auto settings = getAppProperties()->getUserSettings();
     setDefault(settings,"multiThreadedLoading",false);
+    setDefault(settings,"multiThreadedAudio",false);
     setDefault(settings,"check for updates",true);
 
     settings->saveIfNeeded();
@@ -68,6 +70,8 @@ Engine::Engine(): FileBasedDocument (filenameSuffix,
     ParameterFactory::logAllTypes();
     
     loadingStartTime = 0;
+    // before anything can be set from the audio thread
+    ParameterChangeHub::getInstance();
     initAudio();
     Logger::setCurrentLogger (LGMLLogger::getInstance());
 
@@ -84,6 +88,7 @@ Engine::Engine(): FileBasedDocument (filenameSuffix,
 
     DBG ("max recording time : " << std::numeric_limits<sample_clk_t>().max() / (44100.0 * 60.0 * 60.0) << "hours @ 44.1kHz");
     initDefaultUserSettings();
+    ParallelAudioGraph::setMultiThreadingEnabled (getAppProperties()->getUserSettings()->getBoolValue ("multiThreadedAudio", false));
     
 }
 
@@ -96,10 +101,12 @@ Engine::~Engine()
 
 
     closeAudio();
+    AudioGraphWorkers::deleteInstance();
     
     threadPool.removeAllJobs(true, -1);
     
     NodeManager::deleteInstance();
+    PresetMorphEngine::deleteInstance();
     PresetManager::deleteInstance();
     FastMapper::deleteInstance();
 
@@ -125,6 +132,8 @@ Engine::~Engine()
 
     NetworkUtils::deleteInstance();
 
+    ParameterChangeHub::deleteInstance();
+
     AudioDebugPipe::deleteInstanciated();
 #if !FORCE_DISABLE_CRACK
     AudioDebugCrack::deleteInstanciated();
@@ -199,6 +208,8 @@ void Engine::initAudio()
     getAudioDeviceManager().addChangeListener (&audioSettingsHandler);
     // timeManager should be the first audio Callback added to ensure that time is updated each new block
     getAudioDeviceManager().addAudioCallback (TimeManager::getInstance());
+    // morphed parameters are ramped before the graph reads them
+    getAudioDeviceManager().addAudioCallback (PresetMorphEngine::getInstance());
     getAudioDeviceManager().addAudioCallback (&graphPlayer);
 
     DBG ("init audio");
@@ -246,6 +257,7 @@ void Engine::suspendAudio (bool shouldBeSuspended)
 void Engine::closeAudio()
 {
     getAudioDeviceManager().removeAudioCallback (&graphPlayer);
+    getAudioDeviceManager().removeAudioCallback (PresetMorphEngine::getInstance());
     getAudioDeviceManager().removeAudioCallback (TimeManager::getInstance());
     getAudioDeviceManager().closeAudioDevice();
 }
@@ -265,6 +277,7 @@ void Engine::clear()
     //  JsGlobalEnvironment::getInstance()->getEnv()->clear();
     //  graphPlayer.setProcessor(nullptr);
 
+    PresetMorphEngine::getInstance()->cancelAll();
     PresetManager::getInstance()->clear();
 
     NodeManager::getInstance()->clear();
@@ -88,7 +88,7 @@ NodeConnection::~NodeConnection()
 
     masterReference.clear();
 }
-AudioProcessorGraph* NodeConnection::getParentGraph()
+ParallelAudioGraph* NodeConnection::getParentGraph()
 {
     jassert (sourceNode->getParentNodeContainer() == destNode->getParentNodeContainer() );
     return sourceNode->getParentNodeContainer()->getAudioGraph();
@@ -100,9 +100,10 @@ bool NodeConnection::addAudioGraphConnection (uint32 sourceChannel, uint32 destC
 
     bool result = true;
 
-    if (AudioProcessorGraph* g = getParentGraph())
+    if (ParallelAudioGraph* g = getParentGraph())
     {
         result = g->addConnection (getAsNodeBase (sourceNode)->getAudioNode()->nodeId, sourceChannel, getAsNodeBase (destNode)->getAudioNode()->nodeId, destChannel);
+        g->triggerScheduleRebuild();
     }
     else
     {
@@ -125,9 +126,12 @@ void NodeConnection::removeAudioGraphConnection (uint32 sourceChannel, uint32 de
 {
     AudioConnection ac = AudioConnection (sourceChannel, destChannel);
 
-    if (AudioProcessorGraph* g = getParentGraph())
+    if (ParallelAudioGraph* g = getParentGraph())
+    {
         g->removeConnection (getAsNodeBase (sourceNode)->getAudioNode()->nodeId, sourceChannel,
                              getAsNodeBase (destNode)->getAudioNode()->nodeId, destChannel);
+        g->triggerScheduleRebuild();
+    }
 
 
     model.audioConnections.removeAllInstancesOf (ac);
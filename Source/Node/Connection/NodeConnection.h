@@ -20,6 +20,7 @@
 #include "../../Data/DataProcessorGraph.h"
 #include "../ConnectableNode.h"
 #include "../../Utils/FactoryObject.h"
+#include "../NodeContainer/ParallelAudioGraph.h"
 
 
 class NodeConnection :
@@ -109,7 +110,7 @@ public:
     void addConnectionListener (Listener* newListener) { jassert (newListener); listeners.add (newListener); }
     void removeConnectionListener (Listener* listener) { listeners.remove (listener); }
 
-    AudioProcessorGraph* getParentGraph();
+    ParallelAudioGraph* getParentGraph();
 
 protected:
     WeakReference<NodeConnection >::Master masterReference;
@@ -62,7 +62,7 @@ void AudioDeviceInNode::processBlockInternal (AudioBuffer<float>& buffer, MidiBu
 
 
 
-    AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
+    if (!parentGraphHandlesIO()) AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
 
 
     //  totalNumOutputChannels = NodeBase::tot();
@@ -112,7 +112,13 @@ void AudioDeviceOutNode::updateVolMutes()
 
 void AudioDeviceOutNode::processBlockInternal (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
-    if (!enabledParam->boolValue()) return;
+    if (!enabledParam->boolValue())
+    {
+        // parent graph sums our buffer to device output
+        if (parentGraphHandlesIO()) buffer.clear();
+
+        return;
+    }
 
     //  JUCE do not duplicate buffers when comming from the same source
     //  force duplication to isolate behaviour when manipulating buffer channel independently
@@ -148,7 +154,7 @@ void AudioDeviceOutNode::processBlockInternal (AudioBuffer<float>& buffer, MidiB
         lastVolumes.set (i, gain);
     }
 
-    AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
+    if (!parentGraphHandlesIO()) AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
 }
 
 
@@ -20,7 +20,8 @@
 
 REGISTER_NODE_TYPE (AudioMixerNode)
 AudioMixerNode::AudioMixerNode (StringRef name) :
-    NodeBase (name)
+    NodeBase (name),
+    lastOneToOne (false)
 {
     numberOfInput = addNewParameter<IntParameter> ("numInput", "number of input", 2, 1, 32);
     numberOfOutput = addNewParameter<IntParameter> ("numOutput", "number of output", 2, 1, 16);
@@ -142,64 +143,66 @@ void AudioMixerNode::processBlockInternal (AudioBuffer<float>& buffer, MidiBuffe
 
     // doesnt do anything if it's already the right size
     cachedBuffer.setSize (outBuses.size(), numSamples);
-    int totalNumInputChannels = getTotalNumInputChannels();
+    const int numInputs = getTotalNumOutputChannels() > 0 ? jmin (getTotalNumInputChannels(), numBufferChannels, (int) GainMatrix::maxInputs) : 0;
+    const int numOutputs = jmin (outBuses.size(), (int) GainMatrix::maxOutputs);
+    bool force = false;
 
-    if (getTotalNumOutputChannels() > 0 && totalNumInputChannels > 0)
+    if (numInputs != gainMatrix.getNumInputs() || numOutputs != gainMatrix.getNumOutputs())
     {
+        // new crosspoints ramp from 0
+        gainMatrix.setSize (numInputs, numOutputs);
+        force = true;
+    }
 
-        if (oneToOne->boolValue())
-        {
-            for (int i = outBuses.size() - 1 ; i >= 0 ; --i)
-            {
-                auto outI = outBuses.getUnchecked (i);
-
-                if (i < outI->volumes.size())
-                {
-                    cachedBuffer.copyFromWithRamp (i, 0, buffer.getReadPointer (0), numSamples,
-                                                   outI->lastVolumes[i], outI->logVolumes[i]);
-                }
-                else
-                {
-                    cachedBuffer.clear (i, 0, numSamples);
-                }
-            }
-        }
-        else
-        {
-
+    updateGains (force);
 
-            for (int i = outBuses.size() - 1 ; i >= 0 ; --i)
-            {
-                auto outI = outBuses.getUnchecked (i);
-                cachedBuffer.copyFromWithRamp (i, 0, buffer.getReadPointer (0), numSamples,
-                                               outI->lastVolumes[0], outI->logVolumes[0]);
+    // only non null crosspoints are mixed, cachedBuffer avoids in place processing
+    gainMatrix.process (buffer.getArrayOfReadPointers(), cachedBuffer.getArrayOfWritePointers(), numSamples);
 
-                for (int j = totalNumInputChannels - 1 ; j > 0  ; --j)
-                {
-                    cachedBuffer.addFromWithRamp (i, 0, buffer.getReadPointer (j), numSamples,
-                                                  outI->lastVolumes[j], outI->logVolumes[j]);
-                }
-            }
-        }
+    for (int i = numOutputs ; i < cachedBuffer.getNumChannels() ; i++)
+    {
+        cachedBuffer.clear (i, 0, numSamples);
+    }
 
+    for (int i = 0 ; i < cachedBuffer.getNumChannels() ; i++)
+    {
+        buffer.copyFrom (i, 0, cachedBuffer.getReadPointer (i), buffer.getNumSamples());
+    }
 
-        for (int i = outBuses.size() - 1 ; i >= 0 ; --i)
-        {
-            auto outI = outBuses.getUnchecked (i);
+}
 
-            for (int j = totalNumInputChannels - 1 ; j >= 0 ; --j)
-            {
-                outI->lastVolumes.set (j, outI->logVolumes[j]);
-            }
+void AudioMixerNode::updateGains (bool force)
+{
+    const bool diagonal = oneToOne->boolValue();
 
-        }
+    if (diagonal != lastOneToOne)
+    {
+        lastOneToOne = diagonal;
+        force = true;
     }
 
-    for (int i = 0 ; i < cachedBuffer.getNumChannels() ; i++)
+    for (int o = 0 ; o < gainMatrix.getNumOutputs() ; o++)
     {
-        buffer.copyFrom (i, 0, cachedBuffer.getReadPointer (i), buffer.getNumSamples());
-    }
+        auto bus = outBuses.getUnchecked (o);
+
+        if (force) bus->volumesChanged = 1;
+
+        if (bus->volumesChanged.get() == 0) continue;
+
+        // volumes are being resized, retried next block
+        const CriticalSection::ScopedTryLockType lk (bus->volumes.getLock());
 
+        if (!lk.isLocked()) continue;
+
+        bus->volumesChanged = 0;
+
+        for (int i = 0 ; i < gainMatrix.getNumInputs() ; i++)
+        {
+            // one to one only keeps the diagonal
+            const bool used = i < bus->logVolumes.size() && (!diagonal || i == o);
+            gainMatrix.setTarget (i, o, used ? bus->logVolumes.getUnchecked (i) : 0.0f);
+        }
+    }
 }
 
 
@@ -208,7 +211,8 @@ void AudioMixerNode::processBlockInternal (AudioBuffer<float>& buffer, MidiBuffe
 
 AudioMixerNode::OutputBus::OutputBus (int _outputIndex, int numInput):
     outputIndex (_outputIndex),
-    ParameterContainer ("out " + String (_outputIndex+1))
+    ParameterContainer ("out " + String (_outputIndex+1)),
+    volumesChanged (1)
 {
     setNumInput (numInput);
 
@@ -245,8 +249,7 @@ void AudioMixerNode::OutputBus::setNumInput (int numInput)
         }
     }
 
-
-    lastVolumes.resize (numInput);
+    volumesChanged = 1;
 }
 
 void AudioMixerNode::OutputBus::onContainerParameterChanged (Parameter* p)
@@ -263,6 +266,8 @@ void AudioMixerNode::OutputBus::onContainerParameterChanged (Parameter* p)
             v = float01ToGain (volumes.getUnchecked (i)->floatValue());
             i++;
         }
+
+        volumesChanged = 1;
     }
 }
 
@@ -18,6 +18,7 @@
 
 
 #include "../NodeBase.h"
+#include "../../Audio/GainMatrix.h"
 
 
 class AudioMixerNode : public NodeBase
@@ -34,8 +35,9 @@ public:
         void onContainerParameterChanged (Parameter* p)override;
         Array<FloatParameter*, CriticalSection> volumes;
         Array<float> logVolumes;
-        Array<float> lastVolumes;
         int outputIndex;
+        // set when logVolumes change, cleared by the audio thread once read
+        Atomic<int> volumesChanged;
     };
 
 
@@ -45,6 +47,8 @@ public:
     OwnedArray<OutputBus> outBuses;
     //  OwnedArray<Vumeter>
     AudioBuffer<float> cachedBuffer;
+    // audio thread only
+    GainMatrix gainMatrix;
 
 
     IntParameter* numberOfInput;
@@ -57,6 +61,8 @@ public:
 
 
     void processBlockInternal (AudioBuffer<float>& buffer, MidiBuffer&)override;
+    // output only depends on current input
+    double getSilenceSkipSeconds() const override { return 0; }
     void onContainerParameterChanged (Parameter* p) override;
 
 
@@ -64,6 +70,9 @@ public:
 
 
 private:
+    // audio thread : pushes changed bus volumes to the gain matrix
+    void updateGains (bool force);
+    bool lastOneToOne;
 
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioMixerNode)
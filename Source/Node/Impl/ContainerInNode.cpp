@@ -43,7 +43,7 @@ void ContainerInNode::processBlockInternal (AudioBuffer<float>& buffer, MidiBuff
 {
 
 
-    AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
+    if (!parentGraphHandlesIO()) AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
 
     // graphs can be fed with bigger amount of channel (if numoutputChannel>numInputChannel)
     // we need to clear them
@@ -55,7 +55,7 @@ void ContainerOutNode::setParentNodeContainer (NodeContainer* nc)
 
 void ContainerOutNode::processBlockInternal (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
-    AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
+    if (!parentGraphHandlesIO()) AudioProcessorGraph::AudioGraphIOProcessor::processBlock (buffer, midiMessages);
 };
 
 
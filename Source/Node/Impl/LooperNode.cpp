@@ -26,6 +26,8 @@ LooperNode::LooperNode (StringRef name) :
     NodeBase (name),
     //selectedTrack(nullptr),
     wasMonitoring (false),
+    meterForOnset (false),
+    blockStore (name),
     trackGroup (this),
     streamAudioBuffer (2, 16384) // 16000 ~ 300ms and 256*64
 {
@@ -57,12 +59,19 @@ LooperNode::LooperNode (StringRef name) :
     autoClearPreviousIfEmpty = addNewParameter<BoolParameter> ("Auto Clear Previous", "/!\\ Will only work if 'Auto Next' is enabled !\nIf enabled, it will automatically clear the previous track if 'clear' is triggered and the actual selected track is empty.", false);
 
     selectNextTrig =  addNewParameter<Trigger> ("Select Next", "Select Next Track");
+    memoryBudget = addNewParameter<IntParameter> ("memoryBudget", "MB of recorded audio kept in RAM, older blocks are moved to a scratch file, 0 keeps everything in RAM", 0, 0, 65536);
+    blockStore.setMemoryBudget ((int64) memoryBudget->intValue() * 1024 * 1024);
+    stretchCacheBudget = addNewParameter<IntParameter> ("stretchCacheBudget", "MB of stretched renders kept by this looper, split between its tracks, switching back to a previous tempo reuses them", 64, 0, 4096);
+    stretchCacheHitRate = addNewParameter<FloatParameter> ("stretchCacheHitRate", "ratio of tempo changes served from stretched renders cache", 0.f, 0.f, 1.f);
+    stretchCacheHitRate->isEditable = false;
+    stretchCacheHitRate->isSavable = false;
 
 
     addChildControllableContainer (&trackGroup);
     setRateAndBufferSizeDetails (44100, 256);
 
     trackGroup.setNumTracks (numberOfTracks->intValue());
+    updateStretchCacheBudgets();
 
     selectTrack->setValue (0, false, true);
     setPlayConfigDetails (2, 2, 44100, 256);
@@ -78,6 +87,12 @@ LooperNode::LooperNode (StringRef name) :
 
 LooperNode::~LooperNode()
 {
+    if (BufferExportJob* job = exportJob.get())
+    {
+        job->signalJobShouldExit();
+        getEngineThreadPool()->waitForJobToFinish (job, -1);
+    }
+
     if (TimeManager* tm = TimeManager::getInstanceWithoutCreating())
     {
         tm->playState->removeParameterListener (this);
@@ -261,6 +276,14 @@ void LooperNode::TrackGroup::setNumTracks (int numTracks)
 
 }
 
+// may evict renders : never call it with the callback lock held
+void LooperNode::updateStretchCacheBudgets()
+{
+    const int64 trackBudget = (int64) stretchCacheBudget->intValue() * 1024 * 1024 / jmax (1, trackGroup.tracks.size());
+
+    for (auto& t : trackGroup.tracks) {t->playableBuffer.stretchCache.setMemoryBudget (trackBudget);}
+}
+
 
 
 
@@ -278,7 +301,7 @@ bool LooperNode::askForBeingAbleToPlayNow (LooperTrack* _t)
 
     if ( _t->getQuantization() == 0)return true;
 
-    if (TimeManager::getInstance()->playTrigger->isSettingValue) return true;
+    if (TimeManager::getInstance()->playTrigger->isSettingValue.get()) return true;
 
     if (!_t->isMasterTempoTrack()) return false;
 
@@ -441,108 +464,120 @@ void LooperNode::onContainerTriggerTriggered (Trigger* t)
 
     if (t == exportAudio)
     {
-        ScopedLock lk(getCallbackLock());
-        File exportFolder = getEngine()->getCurrentProjectFolder();
-        if(!getEngine()->getCurrentProjectFolder().exists()){
-            exportFolder = File::getSpecialLocation(File::SpecialLocationType::tempDirectory);
-            
-            if(exportFolder.exists()){
-                LOG("!! session not loaded, exporting to temp folder : "+ exportFolder.getFullPathName());
-            }
-            else{
-                LOG("!!! can't create temporary folder for export path");
-                return;
-            }
-            
+        exportTracks();
+    }
+
+
+}
+
+void LooperNode::exportTracks()
+{
+    ThreadPool* tp = getEngineThreadPool();
+
+    if (tp->contains (exportJob))
+    {
+        LOG ("!! export already running for " + shortName);
+        return;
+    }
+
+    File exportFolder = getEngine()->getCurrentProjectFolder();
+    if(!getEngine()->getCurrentProjectFolder().exists()){
+        exportFolder = File::getSpecialLocation(File::SpecialLocationType::tempDirectory);
+
+        if(exportFolder.exists()){
+            LOG("!! session not loaded, exporting to temp folder : "+ exportFolder.getFullPathName());
+        }
+        else{
+            LOG("!!! can't create temporary folder for export path");
+            return;
         }
-        File folder = exportFolder.getChildFile ("LGML_audio").getChildFile (shortName);
-        folder.createDirectory();
-        jassert (folder.exists());
 
-        WavAudioFormat format;
+    }
+    File folder = exportFolder.getChildFile ("LGML_audio").getChildFile (shortName);
+    folder.createDirectory();
+    jassert (folder.exists());
+
+    exportProgress.clearTasks();
+    ScopedPointer<BufferExportJob> job = new BufferExportJob (getSampleRate(), exportProgress.addTask ("export " + shortName));
+    HashMap<String, int> trackForFile;
 
-        for (auto& tr : trackGroup.tracks)
+    for (auto& tr : trackGroup.tracks)
+    {
+        if (tr->playableBuffer.getRecordedLength())
         {
-            if (tr->playableBuffer.getRecordedLength())
+
+            File destFile;
+            String loadedLGMLPath =tr->sampleChoice->getFirstSelectedValue().toString();
+            // overwrite if selected and generated by LGML
+            // fileName should start with LGML to allow such special behavior
+            if (tr->sampleChoice->selectionIsNotEmpty() )
             {
 
-                File destFile;
-                bool isOutsideFile = false;
-                String loadedLGMLPath =tr->sampleChoice->getFirstSelectedValue().toString();
-                // overwrite if selected and generated by LGML
-                // fileName should start with LGML to allow such special behavior
-                if (tr->sampleChoice->selectionIsNotEmpty() )
+                File loadedFile = getEngine()->getFileAtNormalizedPath (loadedLGMLPath);
+
+                if (loadedFile.getFileNameWithoutExtension().startsWith ("LGML"))
                 {
-                    
-                    File loadedFile = getEngine()->getFileAtNormalizedPath (loadedLGMLPath);
-
-                    if (loadedFile.getFileNameWithoutExtension().startsWith ("LGML"))
-                    {
-                        destFile = loadedFile;
-                    }
-                    else if(loadedLGMLPath.startsWith(File::getSeparatorString())){
-                        isOutsideFile = true;
-                        destFile = folder.getChildFile(loadedFile.getFileName());
-                        LOG("!! copying sample : "+loadedLGMLPath);
-                        loadedFile.copyFileTo(destFile);
-                        
-
-                    }
-                    else{
-                        LOG ("!! existing sample already in LGML Folder");
-                        continue;
-                        
-                    }
+                    destFile = loadedFile;
                 }
-                // find first valid name
-                else
-                {
-                    int i = 0;
-
-                    do
-                    {
-                        destFile = (folder.getChildFile ( "LGML_Loop_" + String (tr->trackIdx) + "_" + String (i) + ".wav"));
-                        i++;
-                    }
-                    while (destFile.exists());
+                else if(loadedLGMLPath.startsWith(File::getSeparatorString())){
+                    destFile = folder.getChildFile(loadedFile.getFileName());
+                    LOG("!! copying sample : "+loadedLGMLPath);
+                    job->addFileCopy (loadedFile, destFile);
+                    trackForFile.set (destFile.getFullPathName(), tr->trackIdx);
+                    continue;
+
                 }
+                else{
+                    LOG ("!! existing sample already in LGML Folder");
+                    continue;
 
-                ScopedPointer<FileOutputStream> fp;
+                }
+            }
+            // find first valid name
+            else
+            {
+                int i = 0;
 
-                if (!isOutsideFile && (fp = destFile.createOutputStream()))
+                do
                 {
-                    ScopedPointer<AudioFormatWriter> afw = format.createWriterFor (fp,
-                                                                                   getSampleRate(),
-                                                                                   tr->playableBuffer.getNumChannels(),
-                                                                                   24,
-                                                                                   StringPairArray(), 0);
-
-                    if (afw)
-                    {
-                        fp.release();
-                        afw->writeFromAudioSampleBuffer (tr->playableBuffer.bufferBlockList.getContiguousBuffer (0, -1), 0, (int)tr->playableBuffer.getRecordedLength());
-                        afw->flush();
-
-                    }
-                    else
-                    {
-                        LOG ("!!! export audio : can't create output format writer");
-                        jassertfalse;
-                        continue;
-                    }
+                    destFile = (folder.getChildFile ( "LGML_Loop_" + String (tr->trackIdx) + "_" + String (i) + ".wav"));
+                    i++;
                 }
+                while (destFile.exists());
 
-
-                tr->sampleChoice->addOrSetOption (destFile.getFileNameWithoutExtension(), getEngine()->getNormalizedFilePath (destFile));
-                tr->sampleChoice->selectId (destFile.getFileNameWithoutExtension(), true, false);
+                // reserve the name until the job writes it
+                destFile.create();
             }
+
+            job->addList (&tr->playableBuffer.bufferBlockList, tr->playableBuffer.getNumChannels(), (int)tr->playableBuffer.getRecordedLength(), destFile);
+            trackForFile.set (destFile.getFullPathName(), tr->trackIdx);
         }
+    }
 
+    if (job->getNumItems() == 0) return;
 
+    WeakReference<NodeBase> weakThis (this);
 
-    }
+    job->onItemExported = [weakThis, trackForFile] (const File & destFile, bool succeeded)
+    {
+        auto* looper = dynamic_cast<LooperNode*> (weakThis.get());
+
+        if (looper == nullptr || !succeeded) return;
+
+        LooperTrack* tr = looper->trackGroup.tracks[trackForFile[destFile.getFullPathName()]];
+
+        if (tr == nullptr) return;
 
+        tr->sampleChoice->addOrSetOption (destFile.getFileNameWithoutExtension(), getEngine()->getNormalizedFilePath (destFile));
+        tr->sampleChoice->selectId (destFile.getFileNameWithoutExtension(), true, false);
+    };
 
+    // real progress is reported by the job
+    exportProgress.subTasks.getLast()->start();
+    exportProgress.fakeProgress = nullptr;
+
+    exportJob = job.get();
+    tp->addJob (job.release(), true);
 }
 
 void LooperNode::selectMe (LooperTrack* t)
@@ -609,6 +644,28 @@ void LooperNode::onContainerParameterChanged (Parameter* p)
             else
                 trackGroup.selectedTrack = nullptr;
         }
+
+        lkp = nullptr;
+        updateStretchCacheBudgets();
+    }
+    else if (p == waitForOnset)
+    {
+        // onset detection reads the input meter
+        if (waitForOnset->boolValue() != meterForOnset)
+        {
+            meterForOnset = waitForOnset->boolValue();
+
+            if (meterForOnset) inputMeter.addConsumer();
+            else inputMeter.removeConsumer();
+        }
+    }
+    else if (p == memoryBudget)
+    {
+        blockStore.setMemoryBudget ((int64) memoryBudget->intValue() * 1024 * 1024);
+    }
+    else if (p == stretchCacheBudget)
+    {
+        updateStretchCacheBudgets();
     }
     else if (p == volumeSelected)
     {
@@ -730,7 +787,9 @@ void LooperNode::clearInternal()
 // worst onset detection function ever ...
 bool LooperNode::hasOnset()
 {
-    bool hasOnset = globalRMSValueIn > onsetThreshold->floatValue();
+    // onsetThreshold was tuned on 0.9 * mean absolute value, that is about 0.72 * rms for noise like input
+    const float legacyLevelPerRMS = 0.72f;
+    bool hasOnset = inputMeter.getGlobalLevel() * legacyLevelPerRMS > onsetThreshold->floatValue();
     return hasOnset;
 }
 
@@ -773,6 +832,16 @@ void LooperNode::setAllTimeRatios(){
 
             }
         }
+
+        int numHits = 0, numLookUps = 0;
+
+        for (auto& t : trackGroup.tracks)
+        {
+            numHits += t->playableBuffer.stretchCache.getNumHits();
+            numLookUps += t->playableBuffer.stretchCache.getNumHits() + t->playableBuffer.stretchCache.getNumMisses();
+        }
+
+        if (numLookUps > 0) stretchCacheHitRate->setValue (numHits * 1.0f / numLookUps);
     }
 
 #endif
@@ -19,6 +19,8 @@
 
 #include "../NodeBase.h"
 #include "LooperTrack.h"
+#include "../../Audio/BufferBlockStore.h"
+#include "../../Audio/BufferExportJob.h"
 
 #define MAX_NUM_TRACKS 32
 #include "../../Time/TimeMasterCandidate.h"
@@ -58,6 +60,8 @@ public:
 
     };
 
+    // shared by all tracks, keeps recorded audio within memoryBudget
+    BufferBlockStore blockStore;
     TrackGroup trackGroup;
 
 
@@ -91,6 +95,11 @@ public:
     BoolParameter* outputAllTracksSeparately;
     BoolParameter* autoNextTrackAfterRecord;
     BoolParameter* autoClearPreviousIfEmpty;
+    IntParameter* memoryBudget;
+    IntParameter* stretchCacheBudget;
+    FloatParameter* stretchCacheHitRate;
+    // splits stretchCacheBudget between tracks
+    void updateStretchCacheBudgets();
 
     Trigger* exportAudio;
 
@@ -111,6 +120,9 @@ public:
 
 
     void onContainerTriggerTriggered (Trigger* t) override;
+    // writes recorded tracks to the project audio folder on the engine thread pool
+    void exportTracks();
+    ProgressNotifier exportProgress;
     void onContainerParameterChanged (Parameter* p) override;
     //  void parameterValueChanged(Parameter *p)override;
     // internal
@@ -118,6 +130,8 @@ public:
 
 
     bool wasMonitoring;
+    // inputMeter consumer registered for waitForOnset
+    bool meterForOnset;
 
     //Listener
     class  LooperListener
@@ -153,6 +167,7 @@ private:
     // compute all track stretched versions
     void setAllTimeRatios();
     PhantomBuffer streamAudioBuffer;
+    WeakReference<BufferExportJob> exportJob;
     friend class LooperTrack;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LooperNode)
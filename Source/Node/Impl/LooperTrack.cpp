@@ -69,6 +69,8 @@ logVolume (float01ToGain (DB0_FOR_01), 0.5)
     sampleChoice->addEnumParameterListener (this);
     
     mute->invertVisuals = true;
+
+    playableBuffer.bufferBlockList.setBlockStore (&looperNode->blockStore);
     
     stateParameterString = addNewParameter<StringParameter> ("state", "track state", "cleared");
     stateParameterStringSynchronizer = new AsyncTrackStateStringSynchronizer (stateParameterString);
@@ -1016,6 +1018,7 @@ void LooperTrack::loadAudioSample (const String& path)
                     // lock audio thread on loading sample
                     const ScopedLock lk (parentLooper->getCallbackLock());
                     playableBuffer.originAudioBuffer.makeCopyOf (tempBuf);
+                    playableBuffer.originChanged();
                     playableBuffer.setRecordedLength (destSize);
                     originBPM->setValue (ti.bpm);
                     beatLength->setValue (playableBuffer.getRecordedLength() * 1.0 / ti.beatInSample, false, false);
@@ -18,8 +18,11 @@
 REGISTER_NODE_TYPE (Spat2DNode)
 Spat2DNode::Spat2DNode (StringRef name) :
     NodeBase (name),
-    numSpatInputs (nullptr), numSpatOutputs (nullptr), spatMode (nullptr), shapeMode (nullptr)
+    numSpatInputs (nullptr), numSpatOutputs (nullptr), spatMode (nullptr), shapeMode (nullptr),
+    gainsChanged (1)
 {
+    FloatVectorOperations::clear (gainTable, maxSources * maxTargets);
+
     spatMode = addNewParameter<EnumParameter> ("Mode", "Spatialization Mode (2D/3D, Beam/Proxy)");
     spatMode->addOption ("Beam", BEAM);
     spatMode->addOption ("Proxy", PROXY);
@@ -37,8 +40,8 @@ Spat2DNode::Spat2DNode (StringRef name) :
 
     targetRadius = addNewParameter<FloatParameter> ("Target Radius", "Radius for all targets", .5f, 0.f, 1.f);
 
-    numSpatInputs = addNewParameter<IntParameter> ("Num Inputs", "Number of inputs to spacialize", 1, 0, 16);
-    numSpatOutputs = addNewParameter<IntParameter> ("Num Outputs", "Number of spatialized outputs", 3, 0, 16);
+    numSpatInputs = addNewParameter<IntParameter> ("Num Inputs", "Number of inputs to spacialize", 1, 0, maxSources);
+    numSpatOutputs = addNewParameter<IntParameter> ("Num Outputs", "Number of spatialized outputs", 3, 0, maxTargets);
 
     useGlobalTarget = addNewParameter<BoolParameter> ("Use Global Target", "Use a global target that will act as a max influence and affect all targets.", false);
     globalTargetPosition = addNewParameter<Point2DParameter<float>> ("Global Target Position", "Position of the Global Target");
@@ -156,7 +159,6 @@ void Spat2DNode::updateTargetsFromShape()
 
 void Spat2DNode::computeAllInfluences()
 {
-    //Only one source for now
     switch ((int)spatMode->getFirstSelectedValue())
     {
         case BEAM:
@@ -175,41 +177,45 @@ void Spat2DNode::computeAllInfluences()
 
 void Spat2DNode::computeInfluencesForTarget (int targetIndex)
 {
+    if (targetIndex >= outputDatas.size()) return;
+
+    // influence data is the max of all sources
+    float influence = 0;
+
     for (int i = 0; i < numSpatInputs->intValue(); i++)
     {
-        computeInfluence (i, targetIndex);
+        influence = jmax (influence, computeInfluence (i, targetIndex));
     }
+
+    outputDatas[targetIndex]->update (influence);
 }
 
-void Spat2DNode::computeInfluence (int sourceIndex, int targetIndex)
+float Spat2DNode::computeInfluence (int sourceIndex, int targetIndex)
 {
-    if (sourceIndex >= inputDatas.size()) return;
+    if (sourceIndex >= inputDatas.size() || sourceIndex >= maxSources) return 0;
 
-    if (targetIndex >= outputDatas.size()) return;
+    if (targetIndex >= outputDatas.size() || targetIndex >= maxTargets) return 0;
 
     Data* inputData = inputDatas[sourceIndex];
-    Data* outputData = outputDatas[targetIndex];
+    Point<float> sPos = Point<float> (inputData->elements[0]->value, inputData->elements[1]->value);
 
     float minValue = 0;
 
     if (useGlobalTarget->boolValue())
     {
-        Point<float> sPos = Point<float> (inputDatas[sourceIndex]->elements[0]->value, inputDatas[sourceIndex]->elements[1]->value);
         minValue = getValueForSourceAndTargetPos (sPos, globalTargetPosition->getPoint(), globalTargetRadius->floatValue());
     }
 
-    if (numSpatInputs->intValue() > 0)
-    {
-        Point<float> sPos = Point<float> (inputData->elements[0]->value, inputData->elements[1]->value);
-        Point<float> tPos = targetPositions[targetIndex]->getPoint();
+    Point<float> tPos = targetPositions[targetIndex]->getPoint();
+    const float val = jmax<float> (minValue, getValueForSourceAndTargetPos (sPos, tPos, targetRadius->floatValue()));
 
-        float val = jmax<float> (minValue, getValueForSourceAndTargetPos (sPos, tPos, targetRadius->floatValue()));
-        outputData->update (val);
-    }
-    else
     {
-        outputData->update (0);
+        const SpinLock::ScopedLockType lk (gainLock);
+        gainTable[sourceIndex * maxTargets + targetIndex] = val;
     }
+
+    gainsChanged = 1;
+    return val;
 }
 
 float Spat2DNode::getValueForSourceAndTargetPos (const Point<float>& sourcePosition, const Point<float>& targetPosition, float radius)
@@ -223,6 +229,7 @@ float Spat2DNode::getValueForSourceAndTargetPos (const Point<float>& sourcePosit
 void Spat2DNode::numChannelsChanged (bool /*isInput*/)
 {
     updateInputOutputDataSlots();
+    computeAllInfluences();
 }
 
 bool Spat2DNode::modeIsBeam()
@@ -288,13 +295,44 @@ void Spat2DNode::processBlockInternal (AudioBuffer<float>& buffer, MidiBuffer&)
 
     if (getTotalNumInputChannels() == 0) return;
 
-    for (int i = 2; i < getTotalNumOutputChannels(); i++)
+    const int numSources = jmin (getTotalNumInputChannels(), numSpatInputs->intValue(), (int) maxSources);
+    const int numTargets = jmin (getTotalNumOutputChannels() - 2, numSpatOutputs->intValue(), (int) maxTargets);
+
+    if (numTargets <= 0) return;
+
+    if (numSources != gainMatrix.getNumInputs() || numTargets != gainMatrix.getNumOutputs())
     {
-        float influence = outputDatas[i - 2]->elements[0]->value;
-        buffer.copyFrom (i, 0, buffer.getReadPointer (0), numSamples, influence);
-        buffer.addFrom (i, 0, buffer.getReadPointer (1), numSamples, influence);
+        gainMatrix.setSize (numSources, numTargets);
+        gainsChanged = 1;
     }
 
+    // gains only change with positions, they are ramped over the next block
+    if (gainsChanged.get() != 0)
+    {
+        const SpinLock::ScopedTryLockType lk (gainLock);
 
-}
+        if (lk.isLocked())
+        {
+            gainsChanged = 0;
+
+            for (int t = 0; t < numTargets; t++)
+            {
+                for (int s = 0; s < numSources; s++)
+                {
+                    gainMatrix.setTarget (s, t, gainTable[s * maxTargets + t]);
+                }
+            }
+        }
+    }
 
+    // spat outputs share channels with inputs
+    spatBuffer.setSize (numTargets, numSamples, false, false, true);
+    gainMatrix.process (buffer.getArrayOfReadPointers(), spatBuffer.getArrayOfWritePointers(), numSamples);
+
+    for (int t = 0; t < numTargets; t++)
+    {
+        buffer.copyFrom (t + 2, 0, spatBuffer, t, 0, numSamples);
+    }
+
+
+}
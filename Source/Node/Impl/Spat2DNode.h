@@ -20,6 +20,7 @@
 
 
 #include "../NodeBase.h"
+#include "../../Audio/GainMatrix.h"
 
 class Spat2DNode : public NodeBase
 {
@@ -53,7 +54,8 @@ public:
     void updateTargetsFromShape();
     void computeAllInfluences();
     void computeInfluencesForTarget (int targetIndex);
-    void computeInfluence (int sourceIndex, int targetIndex);
+    // returns the gain of source for target, also published to the audio thread
+    float computeInfluence (int sourceIndex, int targetIndex);
     float getValueForSourceAndTargetPos (const Point<float>& sourcePosition, const Point<float>& targetPosition, float radius);
 
     bool modeIsBeam();
@@ -68,6 +70,21 @@ public:
     void updateChannelNames();
     void numChannelsChanged (bool isInput)override;
     virtual void processBlockInternal (AudioBuffer<float>& /*buffer*/, MidiBuffer& /*midiMessage*/) override;
+    // output only depends on current input
+    double getSilenceSkipSeconds() const override { return 0; }
+
+    static const int maxSources = 16;
+    static const int maxTargets = 16;
+
+private:
+    // source x target gains, written when positions change and read by the audio thread
+    float gainTable[maxSources * maxTargets];
+    SpinLock gainLock;
+    Atomic<int> gainsChanged;
+
+    // audio thread : sources are mixed to each spat output with per sample gain ramps, null gains are skipped
+    GainMatrix gainMatrix;
+    AudioBuffer<float> spatBuffer;
 
 
 
@@ -179,6 +179,11 @@ void VSTNode::initParametersFromProcessor (AudioProcessor* p)
     
     // will check if not already here
     p->addListener (this);
+    {
+        // plugin only posts from its processBlock, called under this lock
+        const ScopedLock lk (getCallbackLock());
+        parameterRelay = new ParameterChangeRelay (*this, p->getNumParameters());
+    }
     {
         ScopedLock lk (controllables.getLock());
         
@@ -248,6 +253,7 @@ void VSTNode::generatePluginFromDescription (PluginDescription* desc)
         
         instance->setPlayHead (getPlayHead());
         innerPlugin = instance;
+        updateInnerPluginTail();
         messageCollector.reset (result.sampleRate);
         
         
@@ -258,14 +264,24 @@ void VSTNode::generatePluginFromDescription (PluginDescription* desc)
         innerPluginTotalNumInputChannels = 0;
         innerPluginTotalNumOutputChannels = 0;
         innerPlugin = nullptr;
+        updateInnerPluginTail();
         LOG ("!!!" << errorMessage);
         jassertfalse;
     }
 }
 
+void VSTNode::updateInnerPluginTail()
+{
+    const double tail = innerPlugin ? jmax (0.0, innerPlugin->getTailLengthSeconds()) : 0.0;
+    innerPluginTailSeconds = tail;
+    innerPluginSkipSeconds = (innerPlugin && !innerPlugin->acceptsMidi()) ? tail : std::numeric_limits<double>::infinity();
+}
+
 void VSTNode::audioProcessorChanged (juce::AudioProcessor* p )
 {
     if (!innerPlugin || p != innerPlugin) return;
+
+    updateInnerPluginTail();
     
     if (innerPlugin->getNumParameters() != VSTParameters.size())
     {
@@ -301,26 +317,21 @@ void VSTNode::audioProcessorParameterChanged (AudioProcessor* p,
                                               int parameterIndex,
                                               float newValue)
 {
-    if (p == innerPlugin)
-    {
-        jassert (parameterIndex < VSTParameters.size());
-        blockFeedback = true;
-        
-        if (parameterIndex < VSTParameters.size() &&
-            VSTParameters.getUnchecked (parameterIndex)->niceName == innerPlugin->getParameterName (parameterIndex))
-        {
-            VSTParameters.getUnchecked (parameterIndex)->setValue (newValue);
-            blockFeedback = false;
-        }
-        else
-        {
-            NLOG ("VSTNode", "!! oldParam update");
-        }
-    }
-    else
-    {
-        NLOG ("VSTNode", "!! oldplugin update");
-    }
+    // often called from the audio thread : no allocation, no listener call here, the relay wakes the message thread
+    // changes of an old plugin or before parameters are built are dropped
+    if (p != innerPlugin || parameterRelay == nullptr) return;
+    
+    parameterRelay->post (parameterIndex, newValue);
+}
+
+void VSTNode::relayedParameterChanged (int index, float value)
+{
+    // relay is rebuilt with parameters, so index is still the one the plugin meant
+    if (index >= VSTParameters.size()) return;
+    
+    blockFeedback = true;
+    VSTParameters.getUnchecked (index)->setValue (value);
+    blockFeedback = false;
 }
 
 
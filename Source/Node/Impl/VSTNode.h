@@ -21,12 +21,14 @@
 
 #include "../../MIDI/MIDIListener.h"
 #include "../../MIDI/MIDIHelpers.h"
+#include "../../Utils/ParameterChangeRelay.h"
 //#define VSTLOADING_THREADED
 class VSTNode :
     public NodeBase,
     public AudioProcessorListener,
     public MIDIListener,
-    public AsyncUpdater // end of vst loading
+    public AsyncUpdater, // end of vst loading
+    public ParameterChangeRelay::Listener
 
 {
 
@@ -71,6 +73,8 @@ public:
                                          int parameterIndex,
                                          float newValue) override;
 
+    void relayedParameterChanged (int index, float value) override;
+
     void audioProcessorChanged (AudioProcessor*) override;
     void loadPresetInternal (PresetManager::Preset* preset)override;
     void savePresetInternal (PresetManager::Preset* preset)override;
@@ -119,7 +123,12 @@ public:
             innerPlugin->setProcessingPrecision (singlePrecision);
             innerPlugin->prepareToPlay (_sampleRate, _blockSize);
         }
+
+        updateInnerPluginTail();
     }
+    double getTailLengthSeconds() const override { return innerPluginTailSeconds.get(); }
+    // plugins receiving midi from messageCollector are never skipped as NodeBase can't see those notes
+    double getSilenceSkipSeconds() const override { return innerPluginSkipSeconds.get(); }
     void releaseResources() override { if (innerPlugin) { innerPlugin->releaseResources(); } };
     bool hasEditor() const override { if (innerPlugin) { return innerPlugin->hasEditor(); } return false; };
     void getStateInformation (MemoryBlock& destData)override ;
@@ -128,6 +137,9 @@ public:
     CriticalSection pluginStateMutex;
     void processBlockInternal (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)override;
     void processBlockBypassed (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)override;
+    // plugin parameter changes can come from the audio thread, they reach VSTParameters through this relay
+    // declared before innerPlugin so that it outlives it
+    ScopedPointer<ParameterChangeRelay> parameterRelay;
     ScopedPointer<AudioPluginInstance> innerPlugin;
 
 
@@ -149,6 +161,11 @@ public:
     int innerPluginTotalNumOutputChannels = 0;
     int innerPluginMaxCommonChannels = 0;
 
+    // cached on the message thread so that the audio thread never queries innerPlugin for them
+    Atomic<double> innerPluginTailSeconds {0.0};
+    Atomic<double> innerPluginSkipSeconds {std::numeric_limits<double>::infinity()};
+    void updateInnerPluginTail();
+
     void handleAsyncUpdate() override;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VSTNode)
 };
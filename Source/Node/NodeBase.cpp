@@ -28,9 +28,8 @@ NodeBase::NodeBase (const String& name, bool _hasMainAudioControl) :
     dryWetFader (5000, 5000, false, 1),
     muteFader (1000, 1000, false, 1),
     lastDryVolume (0),
-    globalRMSValueIn (0),
-    globalRMSValueOut (0),
     wasEnabled (false),
+    numSilentSamples (0),
     logVolume (float01ToGain (DB0_FOR_01), 0.5),
     rmsTimer (this)
 
@@ -43,10 +42,6 @@ NodeBase::NodeBase (const String& name, bool _hasMainAudioControl) :
     muteFader.startFadeIn();
 
 
-    for (int i = 0; i < 2; i++) rmsValuesIn.add (0);
-
-    for (int i = 0; i < 2; i++) rmsValuesIn.add (0);
-
     // when audioNode gets deleted, it will try to remove this instance already deleting by itself
     //  incReferenceCount();
 
@@ -210,16 +205,26 @@ void NodeBase::removeFromAudioGraph()
 {
     if (parentNodeContainer)
     {
-        if (auto pG = parentNodeContainer->getAudioGraph())
-        {
-            const ScopedLock lk (pG->getCallbackLock());
-            pG->removeNode (audioNode);
-        }
-
-        parentNodeContainer->updateAudioGraph (false);
+        // rendering goes on without the node, schedules still using it keep a reference
+        if (auto pG = parentNodeContainer->getAudioGraph()) pG->removeNodeFromSchedules (audioNode);
     }
 }
 
+bool NodeBase::isAudioTransparent() const
+{
+    // faders only move in processBlock, a node being faded is rendered until it reaches its steady state
+    if (isSuspended() || dryWetFader.fadeInCount != 0 || muteFader.fadeInCount != 0) return false;
+
+    if (hasMainAudioControl) return lastVolume == 1 && logVolume.get() == 1 && logVolume.target == 1;
+
+    return lastVolume != 0;
+}
+
+bool NodeBase::parentGraphHandlesIO()
+{
+    return parentNodeContainer && parentNodeContainer->getAudioGraph()->isRenderingSchedule();
+}
+
 AudioProcessor* NodeBase::getAudioProcessor()
 {
     if (audioNode)
@@ -251,16 +256,7 @@ void NodeBase::processBlock (AudioBuffer<float>& buffer,
 
 
 
-    if (rmsListeners.size() || rmsChannelListeners.size())
-    {
-        curSamplesForRMSInUpdate += numSample;
-
-        if (curSamplesForRMSInUpdate >= samplesBeforeRMSUpdate)
-        {
-            updateRMS (buffer, globalRMSValueIn, rmsValuesIn, totalNumInputChannels, rmsChannelListeners.size() == 0);
-            curSamplesForRMSInUpdate = 0;
-        }
-    }
+    inputMeter.process (buffer, totalNumInputChannels);
 
 
 
@@ -271,6 +267,22 @@ void NodeBase::processBlock (AudioBuffer<float>& buffer,
     const double muteFadeValue = muteFader.getCurrentFade();
     const double curLogVol = logVolume.get();
 
+    // skip processing once inputs have been silent for longer than getSilenceSkipSeconds
+    // skipped nodes output a cleared buffer so silence is cheap to detect downstream
+    // inputs are not scanned at all for nodes that can't be skipped
+    bool skipBlock = false;
+    const double skipAfter = getSilenceSkipSeconds();
+
+    if (!std::isinf (skipAfter) && totalNumInputChannels > 0 && midiMessages.isEmpty() && isBufferSilent (buffer, totalNumInputChannels, numSample))
+    {
+        numSilentSamples += numSample;
+        skipBlock = numSilentSamples > (int64) (skipAfter * getSampleRate()) + numSample;
+    }
+    else
+    {
+        numSilentSamples = 0;
+    }
+
     // on disable
     if (wasEnabled && crossfadeValue == 0 )
     {
@@ -296,7 +308,7 @@ void NodeBase::processBlock (AudioBuffer<float>& buffer,
         {
             // copy only what we are expecting
             int maxCommonChannels = jmin (totalNumOutputChannels, totalNumInputChannels);
-            crossFadeBuffer.setSize (maxCommonChannels, numSample);
+            crossFadeBuffer.setSize (maxCommonChannels, numSample, false, false, true);
 
             for (int i = 0 ; i < maxCommonChannels ; i++)
             {
@@ -308,6 +320,11 @@ void NodeBase::processBlock (AudioBuffer<float>& buffer,
         {
             processBlockBypassed (buffer, midiMessages);
         }
+        else if (skipBlock)
+        {
+            buffer.clear();
+            ++numSkippedBlocks;
+        }
         else
         {
             processBlockInternal (buffer, midiMessages);
@@ -354,16 +371,7 @@ void NodeBase::processBlock (AudioBuffer<float>& buffer,
     //    buffer.clear(i,0,numSample);
     //  }
 
-    if (rmsListeners.size() || rmsChannelListeners.size())
-    {
-        curSamplesForRMSOutUpdate += numSample;
-
-        if (curSamplesForRMSOutUpdate >= samplesBeforeRMSUpdate)
-        {
-            updateRMS (buffer, globalRMSValueOut, rmsValuesOut, totalNumOutputChannels, rmsChannelListeners.size() == 0);
-            curSamplesForRMSOutUpdate = 0;
-        }
-    }
+    outputMeter.process (buffer, totalNumOutputChannels);
 
 
 
@@ -412,11 +420,8 @@ bool NodeBase::setPreferedNumAudioInput (int num)
         }
     }
 
-    rmsValuesIn.clear();
     int totalNumInputChannels = getTotalNumInputChannels();
 
-    for (int i = 0; i < totalNumInputChannels; i++) rmsValuesIn.add (0);
-
 
     if (totalNumInputChannels > oldNumChannels)
     {
@@ -469,12 +474,8 @@ bool NodeBase::setPreferedNumAudioOutput (int num)
 
     }
 
-    rmsValuesOut.clear();
-
     int totalNumOutputChannels = getTotalNumOutputChannels();
 
-    for (int i = 0; i < totalNumOutputChannels; i++) rmsValuesOut.add (0);
-
 
     if (totalNumOutputChannels > oldNumChannels)
     {
@@ -735,8 +736,8 @@ void NodeBase::remove()
     if (audioNode.get())
     {
         removeFromAudioGraph();
-        jassert (audioNode.get()->getReferenceCount() == 1);
         // audioNode is owning the pointer so triggers it's deletion instead
+        // or the last retired schedule rendering it does
         audioNode = nullptr;
     }
     else
@@ -29,6 +29,7 @@
 
 #include "ConnectableNode.h"
 #include "../Audio/AudioHelpers.h"
+#include "../Audio/AudioMeter.h"
 
 
 
@@ -120,8 +121,18 @@ public:
 
     int maxCommonIOChannels = 0;
 
-    float globalRMSValueIn ;
-    float globalRMSValueOut ;
+    // processBlockInternal is skipped once all inputs have been silent for longer than that
+    // infinite by default, so nodes keeping state or generating sound are never skipped
+    virtual double getSilenceSkipSeconds() const { return std::numeric_limits<double>::infinity(); }
+    // blocks where processBlockInternal was skipped because of silent inputs
+    int getNumSkippedBlocks() const {return numSkippedBlocks.get();}
+    // audio thread : enabled, unmuted and not fading, processBlock leaves processBlockInternal output untouched
+    bool isAudioTransparent() const;
+
+    // levels published from the audio thread, safe to poll from any thread
+    AudioMeter inputMeter, outputMeter;
+    // someone reads the meters, they are only updated when the node is processed
+    bool hasMeterConsumers() const {return inputMeter.hasConsumers() || outputMeter.hasConsumers();}
 
     //////////////
     //DATA
@@ -173,6 +184,9 @@ protected:
     virtual ~NodeBase();
     void setParentNodeContainer (NodeContainer* _parentNodeContainer)override;
 
+    // graph IO nodes should not use AudioGraphIOProcessor::processBlock when parent graph renders IO by itself (see ParallelAudioGraph)
+    bool parentGraphHandlesIO();
+
 private:
 
     AudioProcessorGraph::Node*   getAudioNode();
@@ -191,15 +205,9 @@ private:
     bool wasEnabled;
     AudioBuffer<float> crossFadeBuffer;
 
-    //RMS
-    const float alphaRMS = 0.05f;
-    const int samplesBeforeRMSUpdate = 512;
-    int curSamplesForRMSInUpdate = 0;
-    int curSamplesForRMSOutUpdate = 0;
-
-
-    Array<float> rmsValuesIn;
-    Array<float> rmsValuesOut;
+    // silence propagation
+    int64 numSilentSamples;
+    Atomic<int> numSkippedBlocks;
 
     SmoothedValue<double> logVolume;
     float lastVolume;
@@ -208,26 +216,49 @@ private:
     class RMSTimer : public Timer
     {
     public:
-        RMSTimer (NodeBase* n): owner (n)
+        RMSTimer (NodeBase* n): owner (n), consumesMeters (false)
         {
             startTimerHz (30);
         }
         void timerCallback()override
         {
-            owner->ConnectableNode::rmsListeners.call (&ConnectableNode::RMSListener::RMSChanged, owner->globalRMSValueIn, owner->globalRMSValueOut);
+            // meters only run while someone listens to them
+            const bool hasListeners = owner->ConnectableNode::rmsListeners.size() > 0 || owner->ConnectableNode::rmsChannelListeners.size() > 0;
+
+            if (hasListeners != consumesMeters)
+            {
+                consumesMeters = hasListeners;
+
+                for (auto* m : {&owner->inputMeter, &owner->outputMeter})
+                {
+                    if (consumesMeters) m->addConsumer();
+                    else m->removeConsumer();
+                }
+            }
+
+            if (!consumesMeters) return;
+
+            owner->inputMeter.getSnapshot (in);
+            owner->outputMeter.getSnapshot (out);
+
+            owner->ConnectableNode::rmsListeners.call (&ConnectableNode::RMSListener::RMSChanged, in.globalLevel, out.globalLevel);
+
+            if (owner->ConnectableNode::rmsChannelListeners.size() == 0) return;
 
             for (int i = 0; i < owner->getTotalNumInputChannels(); i++)
             {
-                owner->ConnectableNode::rmsChannelListeners.call (&ConnectableNode::RMSChannelListener::channelRMSInChanged, owner, owner->rmsValuesIn[i], i);
+                owner->ConnectableNode::rmsChannelListeners.call (&ConnectableNode::RMSChannelListener::channelRMSInChanged, owner, i < in.numChannels ? in.rms[i] : 0, i);
             }
 
             for (int i = 0; i < owner->getTotalNumOutputChannels(); i++)
             {
-                owner->ConnectableNode::rmsChannelListeners.call (&ConnectableNode::RMSChannelListener::channelRMSOutChanged, owner, owner->rmsValuesOut[i], i);
+                owner->ConnectableNode::rmsChannelListeners.call (&ConnectableNode::RMSChannelListener::channelRMSOutChanged, owner, i < out.numChannels ? out.rms[i] : 0, i);
             }
 
         }
         NodeBase* owner;
+        bool consumesMeters;
+        AudioMeter::Snapshot in, out;
     };
 
     RMSTimer rmsTimer;
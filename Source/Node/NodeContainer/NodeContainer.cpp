@@ -37,14 +37,10 @@ rebuildTimer (this),
 isRoot(_isRoot)
 {
 
-    innerGraph = new AudioProcessorGraph();
+    innerGraph = new ParallelAudioGraph();
     innerGraph->releaseResources();
     setPreferedNumAudioOutput (2);
     setPreferedNumAudioInput (2);
-#ifdef MULTITHREADED_AUDIO
-    graphJob = new GraphJob (innerGraph, name);
-    nodeManager = nullptr;
-#endif
 
     //Force non recursive saving of preset as container has only is level to take care, nested containers are other nodes
     presetSavingIsRecursive = false;
@@ -124,7 +120,7 @@ ConnectableNode* NodeContainer::addNode (ConnectableNode* n, const String& nodeN
     if (nodeData) n->configureFromObject (nodeData);
 
 
-    nodeChangeNotifier.addMessage (new NodeChangeMessage (n, true));
+    nodeChangeNotifier.addMessage (NodeChangeMessage (n, true));
     //  nodeContainerListeners.call(&NodeContainerListener::nodeAdded, n);
     return n;
 }
@@ -141,7 +137,7 @@ bool NodeContainer::removeNode (ConnectableNode* n,bool doDelete)
 
     if (n == nullptr) {jassertfalse; return false;}
 
-    nodeChangeNotifier.addMessage (new NodeChangeMessage (n, false));
+    nodeChangeNotifier.addMessage (NodeChangeMessage (n, false));
     nodeContainerListeners.call(&NodeContainerListener::nodeRemoved, n);
     
     if(!doDelete)removeChildControllableContainer (n);
@@ -179,17 +175,17 @@ void NodeContainer::updateAudioGraph (bool lock)
 
     if (!MessageManager::getInstance()->isThisTheMessageThread())
     {
-
-        {
-            ScopedPointer<ScopedLock> lk;
-            if(lock){lk = new ScopedLock(getAudioGraph()->getCallbackLock());}
-
-            getAudioGraph()->suspendProcessing (true);
-        }
-
-
+        // current schedule keeps rendering until the new one is published
         triggerAsyncUpdate();
+        return;
+    }
+
+    ParallelAudioGraph* g = getAudioGraph();
 
+    if (g->hasSchedule() && g->getSampleRate() == NodeBase::getSampleRate() && g->getBlockSize() == NodeBase::getBlockSize())
+    {
+        // live edit : no need to suspend nor prepare the graph, new schedule is swapped at next block
+        g->rebuildSchedule();
         return;
     }
 
@@ -414,7 +410,7 @@ NodeConnection* NodeContainer::addConnection (ConnectableNode* sourceNode, Conne
     c->addConnectionListener (this);
     //  updateAudioGraph();
     // DBG("Dispatch connection Added from NodeManager");
-    nodeChangeNotifier.addMessage (new NodeChangeMessage (c, true));
+    nodeChangeNotifier.addMessage (NodeChangeMessage (c, true));
     //  nodeContainerListeners.call(&NodeContainerListener::connectiosnAdded, c);
 
     return c;
@@ -428,7 +424,7 @@ bool NodeContainer::removeConnection (NodeConnection* c)
     c->removeConnectionListener (this);
 
     connections.removeObject (c);
-    nodeChangeNotifier.addMessage (new NodeChangeMessage (c, false));
+    nodeChangeNotifier.addMessage (NodeChangeMessage (c, false));
     //  nodeContainerListeners.call(&NodeContainerListener::connectionRemoved, c);
 
     return true;
@@ -515,33 +511,25 @@ void NodeContainer::prepareToPlay (double d, int i)
 
 
 
-void NodeContainer::processBlockInternal (AudioBuffer<float>& buffer, MidiBuffer& midiMessage )
+void NodeContainer::setParentNodeContainer (NodeContainer* _parentNodeContainer)
 {
-#ifdef MULTITHREADED_AUDIO
+    NodeBase::setParentNodeContainer (_parentNodeContainer);
+    innerGraph->setParentGraph (_parentNodeContainer != nullptr ? _parentNodeContainer->getAudioGraph() : nullptr);
+}
 
-    if (!nodeManager)
-    {
-        nodeManager = NodeManager::getInstance();
-    }
+bool NodeContainer::canRenderInlined()
+{
+    // inlined container and In/Out nodes are not processed, their meters would freeze
+    return isAudioTransparent() && !hasMeterConsumers()
+           && (containerInNode == nullptr || (containerInNode->isAudioTransparent() && !containerInNode->hasMeterConsumers()))
+           && (containerOutNode == nullptr || (containerOutNode->isAudioTransparent() && !containerOutNode->hasMeterConsumers()));
+}
 
-    if (parentNodeContainer && (nodeManager->getNumJobs() < 4))
-    {
-        const ScopedLock lk (innerGraph->getCallbackLock());
-        graphJob->setBuffersToReferTo (buffer, midiMessage);
-        nodeManager->addJob (graphJob, false);
 
-        while (nodeManager->contains (graphJob)) {}
-    }
-    else
-    {
-        const ScopedLock lk (innerGraph->getCallbackLock());
-        getAudioGraph()->processBlock (buffer, midiMessage);
-    }
-    
-#else
+void NodeContainer::processBlockInternal (AudioBuffer<float>& buffer, MidiBuffer& midiMessage )
+{
     const ScopedLock lk (innerGraph->getCallbackLock());
     getAudioGraph()->processBlock (buffer, midiMessage);
-#endif
 };
 void NodeContainer::processBlockBypassed (AudioBuffer<float>& /*buffer*/, MidiBuffer& /*midiMessages*/)
 {
@@ -24,11 +24,10 @@
 #include "../Impl/ContainerInNode.h"
 #include "../Impl/ContainerOutNode.h"
 #include "../../Controllable/Parameter/ParameterProxy.h"
+#include "ParallelAudioGraph.h"
+#include "../../Utils/LockFreeQueuedNotifier.h"
 
 
-// WIP, will need to go deep if we want to take avantage of a multi Threaded environnement
-//#define MULTITHREADED_AUDIO
-
 class NodeManager;
 
 
@@ -46,7 +45,7 @@ public:
 
 };
 
-typedef  QueuedNotifier<NodeChangeMessage> NodeChangeQueue;
+typedef  LockFreeQueuedNotifier<NodeChangeMessage> NodeChangeQueue;
 
 
 class  NodeContainerListener : public NodeChangeQueue::Listener
@@ -84,6 +83,7 @@ public:
 
 class NodeContainer :
     public NodeBase,
+    public InlinableGraphProcessor,
     public NodeConnection::Listener,
     public ParameterProxy::ParameterProxyListener,
     public AsyncUpdater
@@ -102,8 +102,8 @@ public:
     //Container nodes, not removable by user, handled separately
     ContainerInNode* containerInNode;
     ContainerOutNode* containerOutNode;
-    ScopedPointer<AudioProcessorGraph> innerGraph;
-    AudioProcessorGraph* getAudioGraph() {return innerGraph;};
+    ScopedPointer<ParallelAudioGraph> innerGraph;
+    ParallelAudioGraph* getAudioGraph() {return innerGraph;};
 
 
     //NODE AND CONNECTION MANAGEMENT
@@ -156,6 +156,11 @@ public:
 
     //AUDIO
     bool isRoot;
+
+    void setParentNodeContainer (NodeContainer* _parentNodeContainer) override;
+    // inner graph is rendered by the parent schedule when possible
+    ParallelAudioGraph* getInlinableGraph() override {return innerGraph;}
+    bool canRenderInlined() override;
     
     void updateAudioGraph (bool lock = true) ;
     void numChannelsChanged (bool isInput) override;
@@ -181,37 +186,6 @@ public:
     void removeNodeContainerListener (NodeContainerListener* listener) { nodeContainerListeners.remove (listener); nodeChangeNotifier.removeListener (listener); }
 
 
-#ifdef MULTITHREADED_AUDIO
-    class GraphJob : public ThreadPoolJob
-    {
-    public:
-        GraphJob (AudioProcessorGraph* _graph, String name):
-            ThreadPoolJob ("GraphJob : " + name), graph (_graph)
-        {
-
-        }
-
-        void setBuffersToReferTo (AudioBuffer<float>& buffer, MidiBuffer& midiMessage)
-        {
-            buf = &buffer;
-            midiMess = &midiMessage;
-        }
-
-        JobStatus runJob()override
-        {
-            graph->processBlock (*buf, *midiMess);
-            return JobStatus::jobHasFinished;
-        };
-
-
-        AudioBuffer<float>* buf;
-        MidiBuffer* midiMess;
-        AudioProcessorGraph* graph;
-    };
-    ScopedPointer<GraphJob> graphJob;
-    NodeManager* nodeManager;
-#endif
-
     void handleAsyncUpdate()override;
 
     class RebuildTimer : public Timer
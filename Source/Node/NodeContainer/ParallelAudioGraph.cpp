@@ -0,0 +1,971 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#include "ParallelAudioGraph.h"
+#include "../NodeBase.h"
+#include "../../Utils/AudioThread.h"
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LGML_SPIN_PAUSE() _mm_pause()
+#elif defined (__aarch64__) || defined (__ARM_NEON) || defined (__ARM_NEON__)
+    #define LGML_SPIN_PAUSE() __asm__ __volatile__ ("yield")
+#else
+    #define LGML_SPIN_PAUSE()
+#endif
+
+
+class Engine;
+extern Engine* getEngine();
+extern ThreadPool* getEngineThreadPool();
+
+
+Atomic<int> ParallelAudioGraph::multiThreadingEnabled (0);
+Atomic<int> ParallelAudioGraph::flatteningEnabled (1);
+
+typedef AudioProcessorGraph::AudioGraphIOProcessor GraphIOProcessor;
+
+
+//////////////
+// CountdownWait
+
+CountdownWait::CountdownWait(): numWaiters (0), hasWaited (0), zeroReached (true)
+{
+}
+
+void CountdownWait::reset()
+{
+    if (hasWaited.get() == 0) return;
+
+    zeroReached.reset();
+    hasWaited = 0;
+}
+
+void CountdownWait::decrement (Atomic<int>& counter)
+{
+    if (--counter == 0 && numWaiters.get() > 0) zeroReached.signal();
+}
+
+void CountdownWait::waitForZero (Atomic<int>& counter)
+{
+    for (int i = 0 ; i < maxSpins ; i++)
+    {
+        if (counter.get() <= 0) return;
+
+        LGML_SPIN_PAUSE();
+    }
+
+    ++numWaiters;
+    hasWaited = 1;
+
+    // checked after registering so that a decrement reaching zero meanwhile is not missed
+    while (counter.get() > 0) zeroReached.wait (1);
+
+    --numWaiters;
+}
+
+
+//////////////
+// Schedule
+
+class ParallelAudioGraph::Schedule : public AudioGraphWorkers::Job
+{
+public:
+    enum IOType
+    {
+        notIO, audioIn, audioOut, otherIO
+    };
+
+    // ramp applied on the first block rendered by this schedule
+    enum Fade
+    {
+        noFade, fadeIn, fadeOut
+    };
+
+    struct Link
+    {
+        int sourceOp;
+        int sourceChannel;
+        int destChannel;
+        Fade fade;
+    };
+
+    // links are identified by processors as inlined nodes come from several graphs
+    struct LinkKey
+    {
+        const AudioProcessor* source;
+        const AudioProcessor* dest;
+        int sourceChannel, destChannel;
+
+        bool operator== (const LinkKey& o) const noexcept {return source == o.source && dest == o.dest && sourceChannel == o.sourceChannel && destChannel == o.destChannel;}
+        bool operator< (const LinkKey& o) const noexcept
+        {
+            if (source != o.source) return source < o.source;
+            if (dest != o.dest) return dest < o.dest;
+            if (sourceChannel != o.sourceChannel) return sourceChannel < o.sourceChannel;
+            return destChannel < o.destChannel;
+        }
+    };
+
+    // role of a node once child graphs are inlined, only rendered nodes are scheduled
+    enum Inlining
+    {
+        rendered, inlinedGraph, inlinedIn, inlinedOut
+    };
+
+    struct Op
+    {
+        AudioProcessorGraph::Node::Ptr node; // keeps processor alive as long as it is scheduled
+        AudioProcessor* processor;
+        NodeBase* nodeBase;
+        // lock of the inlined graph owning the node, null for nodes of the rendering graph
+        const CriticalSection* graphLock;
+        IOType ioType;
+        Inlining inlining;
+        // ops whose inputs are this op outputs : container of an inlined In node, Out nodes of an inlined graph
+        Array<int> aliases;
+        int numChannels;
+        int level;
+        Array<Link> inputs;
+        AudioBuffer<float> buffer;
+        MidiBuffer midi;
+    };
+
+    struct Level
+    {
+        int start, end;
+        Atomic<int> nextOp;
+        Atomic<int> remaining;
+        CountdownWait barrier;
+    };
+
+    // previous is the schedule currently published, links that differ from it are ramped
+    // when flatten is set child graphs are inlined and a non flattened schedule is built along
+    Schedule (AudioProcessorGraph& graph, int blockSize, const Schedule* previous, bool flatten):
+        numSamples (0), isValid (false), isFirstBlock (true), retiredAtBlock (-1)
+    {
+        SortedSet<LinkKey> previousLinks, currentLinks;
+
+        if (previous != nullptr)
+        {
+            for (auto& op : previous->ops)
+            {
+                for (auto& l : op->inputs)
+                {
+                    if (l.fade == fadeOut) continue;
+
+                    LinkKey k = {previous->ops.getUnchecked (l.sourceOp)->processor, op->processor, l.sourceChannel, l.destChannel};
+                    previousLinks.add (k);
+                }
+            }
+        }
+
+        OwnedArray<Op> allOps;
+        collect (graph, nullptr, -1, flatten, allOps);
+
+        // schedules don't route midi, such graphs are rendered by JUCE (isValid stays false)
+        for (auto& op : allOps)
+        {
+            if (op->processor->acceptsMidi() || op->processor->producesMidi()) return;
+        }
+
+        // inlined nodes are not rendered, links are connected through them
+        OwnedArray<Op> unsortedOps;
+        Array<int> renderedIndexes;
+        Array<Link> sources;
+
+        for (auto& op : allOps)
+        {
+            renderedIndexes.add (op->inlining == rendered ? unsortedOps.size() : -1);
+
+            if (op->inlining == rendered) unsortedOps.add (nullptr);
+        }
+
+        for (int i = 0 ; i < allOps.size() ; i++)
+        {
+            Op* op = allOps.getUnchecked (i);
+
+            if (op->inlining != rendered) continue;
+
+            Array<Link> resolved;
+
+            for (auto& l : op->inputs)
+            {
+                sources.clearQuick();
+                resolveSource (allOps, l.sourceOp, l.sourceChannel, sources, 0);
+
+                for (auto& s : sources)
+                {
+                    LinkKey k = {allOps.getUnchecked (s.sourceOp)->processor, op->processor, s.sourceChannel, l.destChannel};
+                    currentLinks.add (k);
+
+                    Link r;
+                    r.sourceOp = renderedIndexes[s.sourceOp];
+                    r.sourceChannel = s.sourceChannel;
+                    r.destChannel = l.destChannel;
+                    r.fade = (previous == nullptr || previousLinks.contains (k)) ? noFade : fadeIn;
+                    resolved.add (r);
+                }
+            }
+
+            op->inputs.swapWith (resolved);
+        }
+
+        for (int i = allOps.size() - 1 ; i >= 0 ; i--)
+        {
+            Op* op = allOps.removeAndReturn (i);
+
+            if (op->inlining == rendered) unsortedOps.set (renderedIndexes[i], op);
+            else inlinedOps.add (op);
+
+            if (op->inlining == inlinedGraph) inlinedGraphs.add (dynamic_cast<InlinableGraphProcessor*> (op->processor));
+        }
+
+        const int numNodes = unsortedOps.size();
+        Array<const AudioProcessor*> processors;
+
+        for (auto& op : unsortedOps) processors.add (op->processor);
+
+        // removed links between remaining nodes fade out
+        bool hasFadeOuts = false;
+
+        for (auto& k : previousLinks)
+        {
+            if (currentLinks.contains (k)) continue;
+
+            const int src = processors.indexOf (k.source);
+            const int dst = processors.indexOf (k.dest);
+
+            if (src < 0 || dst < 0) continue;
+
+            if (k.sourceChannel >= unsortedOps[src]->processor->getTotalNumOutputChannels() ||
+                k.destChannel >= unsortedOps[dst]->processor->getTotalNumInputChannels())
+                continue;
+
+            Link l;
+            l.sourceOp = src;
+            l.sourceChannel = k.sourceChannel;
+            l.destChannel = k.destChannel;
+            l.fade = fadeOut;
+            unsortedOps[dst]->inputs.add (l);
+            hasFadeOuts = true;
+        }
+
+        if (!computeLevels (unsortedOps))
+        {
+            // a removed link goes against the new order (reversed connection), it is cut instead
+            if (hasFadeOuts)
+            {
+                for (auto& op : unsortedOps)
+                {
+                    op->level = 0;
+
+                    for (int i = op->inputs.size() - 1 ; i >= 0 ; i--)
+                    {
+                        if (op->inputs.getReference (i).fade == fadeOut) op->inputs.remove (i);
+                    }
+                }
+            }
+
+            // graph has a cycle, should never happen as JUCE rejects them
+            if (!hasFadeOuts || !computeLevels (unsortedOps))
+            {
+                jassertfalse;
+                return;
+            }
+        }
+
+        // sort ops by level and remap links
+        Array<int> newIndexes;
+        newIndexes.insertMultiple (0, -1, numNodes);
+        int maxLevel = -1;
+
+        for (auto& op : unsortedOps) maxLevel = jmax (maxLevel, op->level);
+
+        for (int level = 0 ; level <= maxLevel ; level++)
+        {
+            Level* lv = new Level();
+            lv->start = ops.size();
+
+            for (int i = 0 ; i < numNodes ; i++)
+            {
+                if (unsortedOps.getUnchecked (i)->level == level)
+                {
+                    newIndexes.set (i, ops.size());
+                    ops.add (unsortedOps.getUnchecked (i));
+                }
+            }
+
+            lv->end = ops.size();
+            levels.add (lv);
+        }
+
+        unsortedOps.clear (false);
+
+        for (auto& op : ops)
+        {
+            for (auto& l : op->inputs) l.sourceOp = newIndexes[l.sourceOp];
+
+            op->buffer.setSize (op->numChannels, blockSize);
+            op->midi.ensureSize (2048);
+
+            if (op->ioType == audioOut) outputOps.add (op);
+        }
+
+        graphInput.setSize (graph.getTotalNumInputChannels(), blockSize);
+        isValid = true;
+
+        if (inlinedGraphs.size() > 0)
+        {
+            nested = new Schedule (graph, blockSize, (previous != nullptr && previous->nested != nullptr) ? previous->nested.get() : previous, false);
+            isValid = nested->isValid;
+        }
+    }
+
+    // adds nodes and links of graph, child graphs are added after their parent when flattening
+    static void collect (AudioProcessorGraph& graph, const CriticalSection* graphLock, int parentOp, bool flatten, OwnedArray<Op>& allOps)
+    {
+        const int firstOp = allOps.size();
+        Array<uint32> nodeIds;
+
+        for (int i = 0 ; i < graph.getNumNodes() ; i++)
+        {
+            AudioProcessorGraph::Node* n = graph.getNode (i);
+            AudioProcessor* p = n->getProcessor();
+            Op* op = new Op();
+            op->node = n;
+            op->processor = p;
+            op->nodeBase = dynamic_cast<NodeBase*> (p);
+            op->graphLock = graphLock;
+            op->ioType = notIO;
+            op->inlining = rendered;
+
+            if (auto io = dynamic_cast<GraphIOProcessor*> (p))
+            {
+                if (io->getType() == GraphIOProcessor::audioInputNode) op->ioType = audioIn;
+                else if (io->getType() == GraphIOProcessor::audioOutputNode) op->ioType = audioOut;
+                else op->ioType = otherIO;
+            }
+
+            // IO of an inlined graph are the inputs and outputs of its processor in the parent graph
+            if (parentOp >= 0 && op->ioType == audioIn)
+            {
+                op->inlining = inlinedIn;
+                op->aliases.add (parentOp);
+            }
+            else if (parentOp >= 0 && op->ioType == audioOut)
+            {
+                op->inlining = inlinedOut;
+                allOps.getUnchecked (parentOp)->aliases.add (allOps.size());
+            }
+
+            op->numChannels = jmax (p->getTotalNumInputChannels(), p->getTotalNumOutputChannels());
+            op->level = 0;
+            nodeIds.add (n->nodeId);
+            allOps.add (op);
+        }
+
+        // gather audio links
+        for (int i = 0 ; i < graph.getNumConnections() ; i++)
+        {
+            const AudioProcessorGraph::Connection* c = graph.getConnection (i);
+
+            if (c->sourceChannelIndex == AudioProcessorGraph::midiChannelIndex || c->destChannelIndex == AudioProcessorGraph::midiChannelIndex)
+                continue;
+
+            const int src = nodeIds.indexOf (c->sourceNodeId);
+            const int dst = nodeIds.indexOf (c->destNodeId);
+
+            if (src < 0 || dst < 0) {jassertfalse; continue;}
+
+            Op* srcOp = allOps.getUnchecked (firstOp + src);
+            Op* dstOp = allOps.getUnchecked (firstOp + dst);
+
+            if (c->sourceChannelIndex >= srcOp->processor->getTotalNumOutputChannels() ||
+                c->destChannelIndex >= dstOp->processor->getTotalNumInputChannels())
+                continue;
+
+            Link l;
+            l.sourceOp = firstOp + src;
+            l.sourceChannel = c->sourceChannelIndex;
+            l.destChannel = c->destChannelIndex;
+            l.fade = noFade;
+            dstOp->inputs.add (l);
+        }
+
+        if (!flatten) return;
+
+        for (int i = firstOp, end = allOps.size() ; i < end ; i++)
+        {
+            Op* op = allOps.getUnchecked (i);
+            auto child = dynamic_cast<InlinableGraphProcessor*> (op->processor);
+
+            // child nodes are only rendered once prepared by their graph
+            if (child == nullptr || op->ioType != notIO || child->getInlinableGraph() == nullptr || !child->getInlinableGraph()->hasSchedule()) continue;
+
+            op->inlining = inlinedGraph;
+            ParallelAudioGraph* childGraph = child->getInlinableGraph();
+            collect (*childGraph, &childGraph->getCallbackLock(), i, true, allOps);
+        }
+    }
+
+    // appends the rendered outputs feeding channel of op, going through inlined nodes
+    static void resolveSource (const OwnedArray<Op>& allOps, int opIdx, int channel, Array<Link>& sources, int depth)
+    {
+        const Op& op = *allOps.getUnchecked (opIdx);
+
+        if (op.inlining == rendered)
+        {
+            Link s;
+            s.sourceOp = opIdx;
+            s.sourceChannel = channel;
+            s.destChannel = channel;
+            s.fade = noFade;
+            sources.add (s);
+            return;
+        }
+
+        if (depth > allOps.size()) {jassertfalse; return;}
+
+        // an In node outputs what enters its graph processor, which outputs what enters its Out nodes
+        for (int alias : op.aliases)
+        {
+            for (auto& l : allOps.getUnchecked (alias)->inputs)
+            {
+                if (l.destChannel == channel) resolveSource (allOps, l.sourceOp, l.sourceChannel, sources, depth + 1);
+            }
+        }
+    }
+
+    // audio thread : renders the flat schedule if all inlined graphs allow it
+    void renderBlock (AudioBuffer<float>& buffer, int numGraphInputs, int numGraphOutputs)
+    {
+        bool useNested = nested != nullptr && !isFlatteningEnabled();
+
+        for (int i = 0 ; i < inlinedGraphs.size() && !useNested ; i++) {useNested = !inlinedGraphs.getUnchecked (i)->canRenderInlined();}
+
+        if (useNested) nested->render (buffer, numGraphInputs, numGraphOutputs);
+        else render (buffer, numGraphInputs, numGraphOutputs);
+
+        // both describe the same links, ramps are applied once
+        isFirstBlock = false;
+
+        if (nested != nullptr) nested->isFirstBlock = false;
+    }
+
+    // drops node references, called before freeing the schedule out of the message thread
+    void releaseNodes()
+    {
+        for (auto& op : ops) op->node = nullptr;
+
+        inlinedOps.clear();
+        inlinedGraphs.clear();
+
+        if (nested != nullptr) nested->releaseNodes();
+    }
+
+    // topological levels : a node is one level after its deepest source, false if there is a cycle
+    static bool computeLevels (OwnedArray<Op>& unsortedOps)
+    {
+        bool changed = true;
+        int numPasses = 0;
+
+        while (changed)
+        {
+            changed = false;
+
+            if (numPasses++ > unsortedOps.size()) return false;
+
+            for (auto& op : unsortedOps)
+            {
+                for (auto& l : op->inputs)
+                {
+                    const int minLevel = unsortedOps.getUnchecked (l.sourceOp)->level + 1;
+
+                    if (op->level < minLevel)
+                    {
+                        op->level = minLevel;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void render (AudioBuffer<float>& buffer, int numGraphInputs, int numGraphOutputs)
+    {
+        numSamples = buffer.getNumSamples();
+
+        const int numInputsToCopy = jmin (numGraphInputs, buffer.getNumChannels());
+        graphInput.setSize (numInputsToCopy, numSamples, false, false, true);
+
+        for (int i = 0 ; i < numInputsToCopy ; i++) graphInput.copyFrom (i, 0, buffer, i, 0, numSamples);
+
+        for (auto& lv : levels)
+        {
+            lv->barrier.reset();
+            lv->nextOp = lv->start;
+            lv->remaining = lv->end - lv->start;
+        }
+
+        AudioGraphWorkers* workers = isMultiThreadingEnabled() ? AudioGraphWorkers::getInstanceWithoutCreating() : nullptr;
+
+        if (workers == nullptr || ops.size() < 2 || !workers->run (*this))
+            runWorkerPass();
+
+        isFirstBlock = false;
+
+        buffer.clear();
+
+        for (auto& op : outputOps)
+        {
+            const int numChannelsToAdd = jmin (op->numChannels, numGraphOutputs, buffer.getNumChannels());
+
+            for (int i = 0 ; i < numChannelsToAdd ; i++) buffer.addFrom (i, 0, op->buffer, i, 0, numSamples);
+        }
+    }
+
+    void runWorkerPass() override
+    {
+        for (auto& lv : levels)
+        {
+            for (;;)
+            {
+                const int opIdx = (++lv->nextOp) - 1;
+
+                if (opIdx >= lv->end) break;
+
+                renderOp (*ops.getUnchecked (opIdx));
+                lv->barrier.decrement (lv->remaining);
+            }
+
+            // next level needs all sources to be rendered
+            lv->barrier.waitForZero (lv->remaining);
+        }
+    }
+
+    void renderOp (Op& op)
+    {
+        op.buffer.setSize (op.numChannels, numSamples, false, false, true);
+        op.buffer.clear();
+        op.midi.clear();
+
+        if (op.ioType == audioIn)
+        {
+            const int numChannelsToCopy = jmin (op.numChannels, graphInput.getNumChannels());
+
+            for (int i = 0 ; i < numChannelsToCopy ; i++) op.buffer.copyFrom (i, 0, graphInput, i, 0, numSamples);
+        }
+
+        for (auto& l : op.inputs)
+        {
+            const float* source = ops.getUnchecked (l.sourceOp)->buffer.getReadPointer (l.sourceChannel);
+
+            if (l.fade == noFade || (!isFirstBlock && l.fade == fadeIn))
+                op.buffer.addFrom (l.destChannel, 0, source, numSamples);
+            else if (isFirstBlock)
+                op.buffer.addFromWithRamp (l.destChannel, 0, source, numSamples, l.fade == fadeIn ? 0.0f : 1.0f, l.fade == fadeIn ? 1.0f : 0.0f);
+        }
+
+        // plain JUCE IO processors rely on graph internals, IO is handled here
+        if (op.ioType != notIO && op.nodeBase == nullptr) return;
+
+        // channel config changed since this schedule was built, next one will handle it
+        if (op.processor->isSuspended() ||
+            op.processor->getTotalNumInputChannels() > op.numChannels ||
+            op.processor->getTotalNumOutputChannels() > op.numChannels)
+        {
+            op.buffer.clear();
+            return;
+        }
+
+        // inlined nodes are rendered under the lock of their graph, as their graph would do
+        if (op.graphLock != nullptr) op.graphLock->enter();
+
+        {
+            const ScopedLock lk (op.processor->getCallbackLock());
+            op.processor->processBlock (op.buffer, op.midi);
+        }
+
+        if (op.graphLock != nullptr) op.graphLock->exit();
+    }
+
+    OwnedArray<Op> ops;
+    OwnedArray<Level> levels;
+    Array<Op*> outputOps;
+    AudioBuffer<float> graphInput;
+    int numSamples;
+    bool isValid;
+    // only accessed by the audio thread
+    bool isFirstBlock;
+
+    // IO nodes and processors of inlined graphs, kept alive as their nodes are
+    OwnedArray<Op> inlinedOps;
+    Array<InlinableGraphProcessor*> inlinedGraphs;
+    ScopedPointer<Schedule> nested;
+    // audio block that may still use this schedule, -1 while published
+    int64 retiredAtBlock;
+};
+
+
+class ParallelAudioGraph::ScheduleRebuilder : public AsyncUpdater, public Timer
+{
+public:
+    ScheduleRebuilder (ParallelAudioGraph& g): owner (g) {}
+    void handleAsyncUpdate() override {owner.rebuildSchedule();}
+
+    // polls retired schedules until all are released
+    void timerCallback() override
+    {
+        const ScopedLock lk (owner.scheduleLock);
+
+        if (owner.releaseRetiredSchedules() == 0) stopTimer();
+    }
+
+    ParallelAudioGraph& owner;
+};
+
+
+// retired schedules can hold big buffers, they are freed out of the message and audio threads
+class ScheduleReleaseJob : public ThreadPoolJob
+{
+public:
+    ScheduleReleaseJob (ParallelAudioGraph::Schedule* s): ThreadPoolJob ("scheduleRelease"), schedule (s) {}
+
+    JobStatus runJob() override
+    {
+        schedule = nullptr;
+        return jobHasFinished;
+    }
+
+    ScopedPointer<ParallelAudioGraph::Schedule> schedule;
+};
+
+
+//////////////
+// ParallelAudioGraph
+
+ParallelAudioGraph::ParallelAudioGraph():
+    schedule (nullptr),
+    numBlocksStarted (0),
+    numBlocksDone (0),
+    renderingSchedule (false),
+    parentGraph (nullptr)
+{
+    scheduleRebuilder = new ScheduleRebuilder (*this);
+}
+
+ParallelAudioGraph::~ParallelAudioGraph()
+{
+    // child graphs are destroyed with their nodes, after this one
+    for (int i = 0 ; i < getNumNodes() ; i++)
+    {
+        if (auto child = dynamic_cast<InlinableGraphProcessor*> (getNode (i)->getProcessor()))
+        {
+            if (ParallelAudioGraph* g = child->getInlinableGraph()) g->setParentGraph (nullptr);
+        }
+    }
+
+    scheduleRebuilder->cancelPendingUpdate();
+    scheduleRebuilder->stopTimer();
+    schedule = nullptr;
+    // no more audio callbacks, nodes are released on this thread
+    schedules.clear();
+}
+
+void ParallelAudioGraph::setMultiThreadingEnabled (bool b)
+{
+    // workers are created from here so that no thread is ever spawned from audio thread
+    if (b) AudioGraphWorkers::getInstance();
+
+    multiThreadingEnabled = b ? 1 : 0;
+}
+
+bool ParallelAudioGraph::isMultiThreadingEnabled()
+{
+    return multiThreadingEnabled.get() != 0;
+}
+
+void ParallelAudioGraph::setFlatteningEnabled (bool b)
+{
+    flatteningEnabled = b ? 1 : 0;
+}
+
+bool ParallelAudioGraph::isFlatteningEnabled()
+{
+    return flatteningEnabled.get() != 0;
+}
+
+void ParallelAudioGraph::prepareToPlay (double sampleRate, int blockSize)
+{
+    // JUCE sequence is prepared by the rebuild
+    setRateAndBufferSizeDetails (sampleRate, blockSize);
+    rebuildSchedule();
+}
+
+void ParallelAudioGraph::releaseResources()
+{
+    invalidateSchedule();
+    AudioProcessorGraph::releaseResources();
+}
+
+void ParallelAudioGraph::rebuildSchedule()
+{
+    syncJuceRendering();
+    publishNewSchedule();
+}
+
+void ParallelAudioGraph::publishNewSchedule()
+{
+    {
+        const ScopedLock lk (scheduleLock);
+        ScopedPointer<Schedule> newSchedule;
+
+        // built while the audio thread keeps rendering the current one
+        if (getSampleRate() > 0 && getBlockSize() > 0)
+        {
+            newSchedule = new Schedule (*this, getBlockSize(), schedule.get(), true);
+
+            if (!newSchedule->isValid) newSchedule = nullptr;
+        }
+
+        publishSchedule (newSchedule.release());
+    }
+
+    // parent schedules inline this graph
+    if (parentGraph != nullptr) parentGraph->publishNewSchedule();
+}
+
+void ParallelAudioGraph::invalidateSchedule()
+{
+    {
+        const ScopedLock lk (scheduleLock);
+        publishSchedule (nullptr);
+    }
+
+    // parent renders this graph as a node again
+    // schedules still rendering are released by the retire timer, nodes being kept alive by them
+    if (parentGraph != nullptr) parentGraph->publishNewSchedule();
+}
+
+void ParallelAudioGraph::syncJuceRendering()
+{
+    if (getSampleRate() <= 0 || getBlockSize() <= 0) return;
+
+    // JUCE prepares added nodes and releases removed ones when rebuilding its sequence
+    // audio thread can use it at any block (no schedule, suspended, bigger block), so it is always locked
+    const ScopedLock lk (getCallbackLock());
+    AudioProcessorGraph::prepareToPlay (getSampleRate(), getBlockSize());
+}
+
+void ParallelAudioGraph::removeNodeFromSchedules (Node* node)
+{
+    auto child = dynamic_cast<InlinableGraphProcessor*> (node->getProcessor());
+
+    removeNode (node);
+    // retired schedules still referencing the node are freed at most one block later by the retire timer,
+    // the last reference deletes the processor then, never while the audio thread can render it
+    rebuildSchedule();
+
+    // the new parent schedules don't inline it anymore
+    if (child != nullptr && child->getInlinableGraph() != nullptr) child->getInlinableGraph()->setParentGraph (nullptr);
+}
+
+void ParallelAudioGraph::publishSchedule (Schedule* newSchedule)
+{
+    Schedule* oldSchedule = schedule.get();
+
+    if (newSchedule != nullptr) schedules.add (newSchedule);
+
+    schedule = newSchedule;
+
+    // blocks starting from now pick the new one, the one running may still use the old one
+    if (oldSchedule != nullptr) oldSchedule->retiredAtBlock = numBlocksStarted.get();
+
+    if (releaseRetiredSchedules() > 0) scheduleRebuilder->startTimer (20);
+}
+
+int ParallelAudioGraph::releaseRetiredSchedules()
+{
+    const int64 blocksDone = numBlocksDone.get();
+    int numRemaining = 0;
+
+    for (int i = schedules.size() - 1 ; i >= 0 ; i--)
+    {
+        Schedule* s = schedules.getUnchecked (i);
+
+        if (s->retiredAtBlock < 0) continue;
+
+        if (blocksDone < s->retiredAtBlock)
+        {
+            numRemaining++;
+            continue;
+        }
+
+        schedules.remove (i, false);
+
+        // processors of removed nodes are not deleted on a background thread
+        s->releaseNodes();
+
+        if (getEngine() != nullptr) getEngineThreadPool()->addJob (new ScheduleReleaseJob (s), true);
+        else delete s;
+    }
+
+    return numRemaining;
+}
+
+void ParallelAudioGraph::triggerScheduleRebuild()
+{
+    scheduleRebuilder->triggerAsyncUpdate();
+}
+
+void ParallelAudioGraph::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    // block boundary : the schedule read here is kept until the end of the block
+    ++numBlocksStarted;
+    Schedule* s = schedule.get();
+
+    if (s == nullptr || isSuspended() || buffer.getNumSamples() > getBlockSize())
+    {
+        AudioProcessorGraph::processBlock (buffer, midiMessages);
+    }
+    else
+    {
+        renderingSchedule = true;
+        s->renderBlock (buffer, getTotalNumInputChannels(), getTotalNumOutputChannels());
+        renderingSchedule = false;
+
+        // schedules are only built for graphs without midi nodes, JUCE would output no midi either
+        midiMessages.clear();
+    }
+
+    ++numBlocksDone;
+}
+
+
+
+//////////////
+// AudioGraphWorkers
+
+juce_ImplementSingleton (AudioGraphWorkers);
+
+class AudioGraphWorkers::Worker : public Thread
+{
+public:
+    Worker (AudioGraphWorkers& o, int idx): Thread ("AudioGraphWorker " + String (idx)), owner (o), isSleeping (0)
+    {
+    }
+
+    void run() override
+    {
+        // nodes rendered here write parameters like the device thread does
+        AudioThread::markCurrentThread();
+        int lastGeneration = owner.generation.get();
+        int numSpins = 0;
+        // spin a bit before sleeping so that consecutive blocks do not pay for a wake up
+        const int maxSpins = CountdownWait::maxSpins;
+
+        while (!threadShouldExit())
+        {
+            const int gen = owner.generation.get();
+
+            if (gen != lastGeneration)
+            {
+                lastGeneration = gen;
+                ++owner.numActiveWorkers;
+
+                if (Job* job = owner.currentJob.get()) job->runWorkerPass();
+
+                owner.workersDone.decrement (owner.numActiveWorkers);
+                numSpins = 0;
+                continue;
+            }
+
+            if (++numSpins < maxSpins)
+            {
+                LGML_SPIN_PAUSE();
+                continue;
+            }
+
+            isSleeping = 1;
+
+            if (owner.generation.get() == lastGeneration) wakeUp.wait (10);
+
+            isSleeping = 0;
+            numSpins = 0;
+        }
+    }
+
+    AudioGraphWorkers& owner;
+    Atomic<int> isSleeping;
+    WaitableEvent wakeUp;
+};
+
+
+AudioGraphWorkers::AudioGraphWorkers():
+    currentJob (nullptr),
+    generation (0),
+    numActiveWorkers (0),
+    isBusy (0)
+{
+    const int numWorkers = jlimit (0, 7, SystemStats::getNumCpus() - 1);
+
+    for (int i = 0 ; i < numWorkers ; i++)
+    {
+        Worker* w = new Worker (*this, i);
+        workers.add (w);
+        // highest priority is real-time on supported platforms
+        w->startThread (10);
+    }
+}
+
+AudioGraphWorkers::~AudioGraphWorkers()
+{
+    for (auto& w : workers) w->signalThreadShouldExit();
+
+    for (auto& w : workers)
+    {
+        w->wakeUp.signal();
+        w->stopThread (1000);
+    }
+
+    clearSingletonInstance();
+}
+
+bool AudioGraphWorkers::run (Job& job)
+{
+    if (workers.size() == 0 || !isBusy.compareAndSetBool (1, 0)) return false;
+
+    workersDone.reset();
+    currentJob = &job;
+    ++generation;
+
+    for (auto& w : workers)
+    {
+        if (w->isSleeping.get()) w->wakeUp.signal();
+    }
+
+    job.runWorkerPass();
+
+    // no worker can enter this job anymore, wait for the ones still inside
+    currentJob = nullptr;
+
+    workersDone.waitForZero (numActiveWorkers);
+
+    isBusy = 0;
+    return true;
+}
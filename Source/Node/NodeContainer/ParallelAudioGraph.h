@@ -0,0 +1,186 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#ifndef PARALLELAUDIOGRAPH_H_INCLUDED
+#define PARALLELAUDIOGRAPH_H_INCLUDED
+#pragma once
+
+/*
+ ParallelAudioGraph is the AudioProcessorGraph owned by each NodeContainer
+
+ on top of the JUCE rendering sequence, it keeps its own schedule where nodes are sorted in topological levels :
+ all nodes of a level only depend on previous levels so they can be processed concurrently
+ when multiThreadedAudio is enabled, levels are rendered by the calling audio thread and a fixed pool of worker threads,
+ each level being closed by a barrier that spins a bounded time before sleeping
+
+ edits are hot-swapped : a new schedule is built on the message thread while the current one keeps rendering,
+ then published with an atomic pointer swap picked at the next block boundary
+ links added or removed by an edit are ramped over the first block of the new schedule, so patching never drops a block
+ retired schedules are freed on the engine thread pool once the audio thread can't see them anymore
+
+ child graphs (NodeContainers) are inlined : their nodes are scheduled with the parent ones and links are connected
+ through their IO nodes, so nesting is purely logical and costs no copy nor graph traversal
+ a non flattened schedule is kept for blocks where a child can't be inlined (i.e. fading, muted)
+
+ JUCE rendering is still used when there is no schedule (graph not prepared or suspended, or a node uses midi
+ as schedules don't route it)
+ */
+
+#include "../../JuceHeaderAudio.h"
+
+
+class AudioGraphWorkers;
+class ParallelAudioGraph;
+
+// processor rendering a ParallelAudioGraph between its audio input and output nodes (NodeContainer)
+class InlinableGraphProcessor
+{
+public:
+    virtual ~InlinableGraphProcessor() {}
+
+    virtual ParallelAudioGraph* getInlinableGraph() = 0;
+    // audio thread : false when processBlock would alter the graph output (fades, mute...) or when its meters are read,
+    // it is then rendered as a node
+    virtual bool canRenderInlined() = 0;
+};
+
+class ParallelAudioGraph : public AudioProcessorGraph
+{
+public:
+    ParallelAudioGraph();
+    ~ParallelAudioGraph();
+
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+    void prepareToPlay (double sampleRate, int blockSize) override;
+    void releaseResources() override;
+
+    // build a schedule from current nodes and connections and publish it, has to be called from message thread
+    void rebuildSchedule();
+    // drop current schedule (JUCE rendering is used until next rebuild), safe to call from any thread
+    void invalidateSchedule();
+    // asynchronously rebuild schedule (used when connections change)
+    void triggerScheduleRebuild();
+    bool hasSchedule() const noexcept {return schedule.get() != nullptr;}
+
+    // removes node from the graph and its schedules, processor is deleted on the message thread
+    // when the last retired schedule referencing it is released (at most one block later)
+    void removeNodeFromSchedules (Node* node);
+
+    // true while audio is rendered by the schedule, graph IO nodes should not access JUCE graph buffers then
+    bool isRenderingSchedule() const noexcept {return renderingSchedule;}
+
+    static void setMultiThreadingEnabled (bool);
+    static bool isMultiThreadingEnabled();
+
+    // inline child graphs in parent schedules, enabled by default
+    static void setFlatteningEnabled (bool);
+    static bool isFlatteningEnabled();
+
+    // graph inlining this one, its schedule is rebuilt along with this one
+    void setParentGraph (ParallelAudioGraph* g) {parentGraph = g;}
+
+
+    class Schedule;
+    class ScheduleRebuilder;
+
+private:
+    friend class ScheduleRebuilder;
+
+    // rebuilds JUCE rendering sequence now instead of asynchronously
+    void syncJuceRendering();
+    // builds and publishes a schedule then does the same for parents
+    void publishNewSchedule();
+    // message thread side of the swap, called with scheduleLock
+    void publishSchedule (Schedule* newSchedule);
+    // returns the number of retired schedules still possibly used by the audio thread
+    int releaseRetiredSchedules();
+
+    // read by the audio thread at the beginning of each block
+    Atomic<Schedule*> schedule;
+    // published schedule is the last one, previous ones are retired
+    OwnedArray<Schedule> schedules;
+    CriticalSection scheduleLock;
+    // block boundaries seen by the audio thread
+    Atomic<int64> numBlocksStarted, numBlocksDone;
+
+    ScopedPointer<ScheduleRebuilder> scheduleRebuilder;
+    bool renderingSchedule;
+    ParallelAudioGraph* parentGraph;
+
+    static Atomic<int> multiThreadingEnabled;
+    static Atomic<int> flatteningEnabled;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParallelAudioGraph)
+};
+
+
+
+// waits for a counter to reach zero : spins a bounded time then sleeps on an event set by the last decrement
+class CountdownWait
+{
+public:
+    CountdownWait();
+
+    // before the counter is set, when no thread can be waiting
+    void reset();
+    void decrement (Atomic<int>& counter);
+    void waitForZero (Atomic<int>& counter);
+
+    // ~50us on current cpus, long enough for a level of small nodes
+    static const int maxSpins = 1000;
+
+private:
+    Atomic<int> numWaiters, hasWaited;
+    WaitableEvent zeroReached;
+
+    JUCE_DECLARE_NON_COPYABLE (CountdownWait)
+};
+
+
+// fixed pool of real-time threads shared by all graphs
+class AudioGraphWorkers
+{
+public:
+    juce_DeclareSingleton (AudioGraphWorkers, true);
+    AudioGraphWorkers();
+    ~AudioGraphWorkers();
+
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+        // called concurrently by the audio thread and every awaken worker
+        virtual void runWorkerPass() = 0;
+    };
+
+    // returns false if workers are already busy (i.e nested graph), then caller should render job by itself
+    bool run (Job& job);
+    int getNumWorkers() const {return workers.size();}
+
+private:
+    class Worker;
+    OwnedArray<Worker> workers;
+
+    Atomic<Job*> currentJob;
+    Atomic<int> generation;
+    Atomic<int> numActiveWorkers;
+    Atomic<int> isBusy;
+    CountdownWait workersDone;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioGraphWorkers)
+};
+
+
+#endif  // PARALLELAUDIOGRAPH_H_INCLUDED
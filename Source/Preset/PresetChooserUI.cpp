@@ -158,7 +158,7 @@ void PresetChooserUI::comboBoxChanged (ComboBox* cb)
             int originId = cb->getSelectedId() - PresetChoice::deleteStartId - 1;
             String originText = cb->getItemText (cb->getNumItems() - container->getNumPresets() * 2 + originId);
             PresetManager::Preset* pre = pm->getPreset (container->getPresetFilter(), originText);
-            pm->presets.removeObject (pre);
+            pm->removePreset (pre);
 
             container->currentPreset = nullptr;
             updatePresetComboBox (true);
@@ -18,6 +18,7 @@
 
 #include "PresetManager.h"
 #include "../Controllable/Parameter/ParameterContainer.h"
+#include "../Controllable/ControllableAddressIndex.h"
 
 juce_ImplementSingleton (PresetManager)
 
@@ -69,72 +70,97 @@ PresetManager::Preset* PresetManager::addPresetFromControllableContainer (const
     }
 
 
-    if (!presetExists) presets.add (pre);
+    if (!presetExists) addPreset (pre);
 
     return pre;
 }
 
 PresetManager::Preset* PresetManager::getPreset (String filter, const String& name) const
 {
-    for (auto& pre : presets)
+    return presetIndex[getIndexKey (filter, name)];
+}
+
+
+PresetManager::Preset* PresetManager::addPreset (Preset* pre)
+{
+    const String key = getIndexKey (pre->filter, pre->name);
+
+    // keep the first preset with that name, it may be in use
+    if (Preset* existing = presetIndex[key])
     {
-        if (pre->filter == filter && pre->name == name) return pre;
+        LOG ("!! duplicate preset " << pre->name << " for " << pre->filter << ", keeping the first one");
+        delete pre;
+        return existing;
     }
 
-    return nullptr;
+    presets.add (pre);
+    presetIndex.set (key, pre);
+    numPresetsForFilter.set (pre->filter, numPresetsForFilter[pre->filter] + 1);
+    return pre;
 }
 
+void PresetManager::removePreset (Preset* pre)
+{
+    if (!presets.contains (pre)) return;
+
+    presetIndex.remove (getIndexKey (pre->filter, pre->name));
+    const int num = numPresetsForFilter[pre->filter] - 1;
+
+    if (num > 0) numPresetsForFilter.set (pre->filter, num);
+    else numPresetsForFilter.remove (pre->filter);
 
+    presets.removeObject (pre);
+}
 
 void PresetManager::removePresetForIdx (int idx)
 {
     if (idx > 0 && idx < presets.size())
     {
-        presets.remove (idx);
+        removePreset (presets[idx]);
     }
 
 }
 
 int PresetManager::getNumPresetForFilter (const String& filter) const
 {
-    int num = 0;
+    return numPresetsForFilter[filter];
+}
+
+int PresetManager::removePresetsWithFilters (const HashMap<String, bool>& filters)
+{
+    const int numBefore = presets.size();
 
-    for (auto& pre : presets)
+    for (int i = presets.size() - 1 ; i >= 0 ; i--)
     {
+        Preset* pre = presets.getUnchecked (i);
 
-        if (pre->filter == filter)
-        {
-            num++;
-        }
+        if (!filters.contains (pre->filter)) continue;
+
+        presetIndex.remove (getIndexKey (pre->filter, pre->name));
+        numPresetsForFilter.remove (pre->filter);
+        presets.remove (i);
     }
 
-    return num;
+    return numBefore - presets.size();
 }
 
 void PresetManager::deleteAllUnusedPresets (ParameterContainer* rootContainer)
 {
-    Array<Preset*> presetsToRemove;
-    auto allContainers = rootContainer->getContainersOfType<ParameterContainer> (true);
+    HashMap<String, bool> usedFilters;
 
-    for (auto& p : presets)
+    for (auto& cc : rootContainer->getContainersOfType<ParameterContainer> (true))
     {
-        bool isUsed = false;
+        usedFilters.set (cc->getPresetFilter(), true);
+    }
 
-        for (auto& cc : allContainers)
-        {
-            if (cc->getPresetFilter() == p->filter)
-            {
-                isUsed = true;
-                break;
-            }
-        }
+    HashMap<String, bool> unusedFilters;
 
-        if (!isUsed) presetsToRemove.add (p);
+    for (HashMap<String, int>::Iterator i (numPresetsForFilter) ; i.next();)
+    {
+        if (!usedFilters.contains (i.getKey())) unusedFilters.set (i.getKey(), true);
     }
 
-    int numPresetsToRemove = presetsToRemove.size();
-
-    for (auto& p : presetsToRemove) presets.removeObject (p);
+    int numPresetsToRemove = removePresetsWithFilters (unusedFilters);
 
     LOG ("Cleaned up " << numPresetsToRemove << " unused presets, now " << presets.size() << "presets");
 }
@@ -143,36 +169,31 @@ int PresetManager::deletePresetsForContainer (ParameterContainer* container, boo
 {
     if (container == nullptr) return 0;
 
-    const String filter = container->getPresetFilter();
+    HashMap<String, bool> filters;
+    Array<ParameterContainer*> toVisit;
+    toVisit.add (container);
 
-    Array<Preset*> presetsToRemove;
-
-    for (auto& p : presets)
+    // same traversal as before : only through ParameterContainer children
+    for (int i = 0 ; i < toVisit.size() ; i++)
     {
-        if (p->filter == filter) presetsToRemove.add (p);
-    }
+        filters.set (toVisit[i]->getPresetFilter(), true);
 
-    int numPresetsDeleted = presetsToRemove.size();
+        if (!recursive) break;
 
-    for (auto& p : presetsToRemove) presets.removeObject (p);
-
-    if (recursive)
-    {
-        for (auto& cc : container->getContainersOfType<ParameterContainer> (false))
+        for (auto& cc : toVisit[i]->getContainersOfType<ParameterContainer> (false))
         {
-            if (cc)
-            {
-                numPresetsDeleted += deletePresetsForContainer (cc, true);
-            }
+            if (cc) toVisit.add (cc);
         }
     }
 
-    return numPresetsDeleted;
+    return removePresetsWithFilters (filters);
 }
 
 void PresetManager::clear()
 {
     presets.clear();
+    presetIndex.clear();
+    numPresetsForFilter.clear();
 }
 
 DynamicObject* PresetManager::getObject()
@@ -207,7 +228,7 @@ void PresetManager::configureFromObject (DynamicObject* data)
         Preset* pre = new Preset (presetData.getDynamicObject()->getProperty ("name"), presetData.getDynamicObject()->getProperty ("filter"));
         pre->configureFromObject (presetData.getDynamicObject());
 
-        presets.add (pre);
+        addPreset (pre);
     }
 
 }
@@ -220,31 +241,51 @@ void PresetManager::configureFromObject (DynamicObject* data)
 
 void PresetManager::Preset::addPresetValue (const String& controlAddress, var value)
 {
-    presetValues.add (new PresetValue (controlAddress, value));
+    PresetValue* pv = presetValues.add (new PresetValue (controlAddress, value));
+
+    // first value wins, as the linear search did
+    if (!valueIndex.contains (controlAddress)) valueIndex.set (controlAddress, pv);
 }
 
 void PresetManager::Preset::addPresetValues (Array<PresetValue*> _presetValues)
 {
     presetValues.addArray (_presetValues);
+
+    for (auto& pv : _presetValues)
+    {
+        if (!valueIndex.contains (pv->paramControlAddress)) valueIndex.set (pv->paramControlAddress, pv);
+    }
 }
 
 var PresetManager::Preset::getPresetValue (const String& targetControlAddress)
 {
-    for (auto& pv : presetValues)
-    {
-
-        if (pv->paramControlAddress == targetControlAddress) return pv->presetValue;
-    }
+    if (PresetValue* pv = valueIndex[targetControlAddress]) return pv->presetValue;
 
     return var();
 }
 
 void PresetManager::Preset::clear()
 {
+    valueIndex.clear();
     presetValues.clear();
 }
 
 
+Controllable* PresetManager::PresetValue::resolve (ParameterContainer* container)
+{
+    const int revision = container->getAddressIndex()->getRevision();
+
+    if (resolvedContainer != container || resolvedRevision != revision)
+    {
+        resolvedControllable = container->getControllableForAddress (paramControlAddress);
+        resolvedContainer = container;
+        resolvedRevision = revision;
+    }
+
+    return resolvedControllable.get();
+}
+
+
 DynamicObject* PresetManager::Preset::getObject()
 {
     auto data = new DynamicObject();
@@ -20,6 +20,7 @@
 #define PRESETMANAGER_H_INCLUDED
 
 #include "../JuceHeaderCore.h"//keep
+#include "../Controllable/Controllable.h"
 class ParameterContainer;
 
 
@@ -30,9 +31,18 @@ public:
     class PresetValue
     {
     public:
-        PresetValue (const String& _controlAddress, var _value) : paramControlAddress (_controlAddress), presetValue (_value) {}
+        PresetValue (const String& _controlAddress, var _value) : paramControlAddress (_controlAddress), presetValue (_value), resolvedContainer (nullptr), resolvedRevision (0) {}
         String paramControlAddress;
         var presetValue;
+
+        // controllable at paramControlAddress in container, looked up again only if the address index of container changed
+        Controllable* resolve (ParameterContainer* container);
+
+    private:
+        WeakReference<Controllable> resolvedControllable;
+        const void* resolvedContainer;
+        int resolvedRevision;
+    public:
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetValue)
     };
 
@@ -56,11 +66,16 @@ public:
 
         void configureFromObject (DynamicObject* data);
 
+    private:
+        // presetValues by control address
+        HashMap<String, PresetValue*> valueIndex;
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Preset)
     };
 
     juce_DeclareSingleton (PresetManager, true)
 
+    // use addPreset / removePreset to modify so that the index stays in sync
     OwnedArray<Preset> presets;
 
     PresetManager();
@@ -69,6 +84,9 @@ public:
     Preset* addPresetFromControllableContainer (const String& name, const String& filter, ParameterContainer* container, bool recursive = false, bool includeNotExposed = false);
     Preset* getPreset (String filter, const String& name) const;
 
+    // takes ownership, returns the preset kept in the manager : an existing one with the same name wins
+    Preset* addPreset (Preset* pre);
+    void removePreset (Preset* pre);
     void removePresetForIdx (int idx);
     int getNumPresetForFilter (const String&) const;
 
@@ -81,6 +99,14 @@ public:
     DynamicObject* getObject();
     void configureFromObject (DynamicObject* data);
 
+private:
+    static String getIndexKey (const String& filter, const String& name) {return filter + "\n" + name;}
+    // remove all presets whose filter is in filters, in one pass
+    int removePresetsWithFilters (const HashMap<String, bool>& filters);
+
+    HashMap<String, Preset*> presetIndex;
+    HashMap<String, int> numPresetsForFilter;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetManager)
 };
 
@@ -0,0 +1,435 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#include "PresetMorphEngine.h"
+#include "../Controllable/Parameter/ParameterContainer.h"
+#include "../Time/TimeManager.h"
+#include "../Utils/DebugHelpers.h"
+#include "../Utils/AudioThread.h"
+
+juce_ImplementSingleton (PresetMorphEngine)
+
+
+class PresetMorphEngine::Morph
+{
+public:
+    enum State
+    {
+        running = 0,
+        finished, // reached by the audio thread, target preset still to be loaded
+        cancelled
+    };
+
+    struct Track
+    {
+        // morphs are cancelled before their parameters are deleted
+        Parameter* parameter;
+        int numComponents;
+        bool isInt;
+        double from[3];
+        double to[3];
+
+        double get (int i, double alpha) const {return from[i] + (to[i] - from[i]) * alpha;}
+    };
+
+    Morph (ParameterContainer* c, PresetManager::Preset* t, int64 duration):
+        container (c), targetFilter (t->filter), targetName (t->name), durationSamples (duration), elapsedSamples (0), state (running), retiredAtBlock (-1)
+    {
+    }
+
+    double getProgress() const
+    {
+        return durationSamples > 0 ? jmin (1.0, elapsedSamples.get() / (double) durationSamples) : 1.0;
+    }
+
+    bool uses (const Parameter* p) const
+    {
+        for (auto& t : audioTracks) {if (t.parameter == p) return true;}
+
+        for (auto& t : controlTracks) {if (t.parameter == p) return true;}
+
+        return false;
+    }
+
+    bool usesParametersOf (const ControllableContainer* c) const
+    {
+        for (auto& t : audioTracks) {if (t.parameter->parentContainer == c) return true;}
+
+        for (auto& t : controlTracks) {if (t.parameter->parentContainer == c) return true;}
+
+        return false;
+    }
+
+    // number of numeric components of a value (number, or array of up to 3 numbers), 0 if not morphable
+    static int getComponents (const var& v, double* dest)
+    {
+        if (v.isDouble() || v.isInt() || v.isInt64())
+        {
+            dest[0] = (double) v;
+            return 1;
+        }
+
+        if (const Array<var>* arr = v.getArray())
+        {
+            if (arr->size() < 2 || arr->size() > 3) return 0;
+
+            for (int i = 0 ; i < arr->size() ; i++)
+            {
+                const var& e = arr->getReference (i);
+
+                if (!(e.isDouble() || e.isInt() || e.isInt64())) return 0;
+
+                dest[i] = (double) e;
+            }
+
+            return arr->size();
+        }
+
+        return 0;
+    }
+
+    WeakReference<ParameterContainer> container;
+    // target is looked up again at the end as it may have been deleted meanwhile
+    String targetFilter, targetName;
+    Array<Track> audioTracks, controlTracks;
+
+    const int64 durationSamples;
+    Atomic<int64> elapsedSamples;
+    Atomic<int> state;
+    int64 retiredAtBlock;
+
+    JUCE_DECLARE_NON_COPYABLE (Morph)
+};
+
+
+PresetMorphEngine::PresetMorphEngine():
+    numAudioBlocks (0),
+    audioRunning (0),
+    isProcessing (0),
+    sampleRate (44100),
+    controlRate (50),
+    lastTimerTime (0)
+{
+}
+
+PresetMorphEngine::~PresetMorphEngine()
+{
+    stopTimer();
+}
+
+
+bool PresetMorphEngine::morph (ParameterContainer* container, PresetManager::Preset* from, PresetManager::Preset* to, double durationMs)
+{
+    return startMorph (container, from, to, (int64) (durationMs * sampleRate / 1000.0));
+}
+
+bool PresetMorphEngine::morphInBeats (ParameterContainer* container, PresetManager::Preset* from, PresetManager::Preset* to, double numBeats)
+{
+    TimeManager* tm = TimeManager::getInstance();
+    // beat length is expressed at the rate of the time manager
+    const double samplesPerBeat = tm->beatTimeInSample * sampleRate / jmax (1, tm->sampleRate);
+    return startMorph (container, from, to, (int64) (numBeats * samplesPerBeat));
+}
+
+
+bool PresetMorphEngine::startMorph (ParameterContainer* container, PresetManager::Preset* from, PresetManager::Preset* to, int64 durationSamples)
+{
+    if (container == nullptr || to == nullptr) return false;
+
+    cancel (container);
+
+    if (durationSamples <= 0) return container->loadPreset (to);
+
+    ScopedPointer<Morph> m = new Morph (container, to, durationSamples);
+
+    for (auto& pv : to->presetValues)
+    {
+        Parameter* p = dynamic_cast<Parameter*> (pv->resolve (container));
+
+        if (p == nullptr || p == container->currentPresetName || !p->isEditable) continue;
+
+        // other types jump when the target preset is loaded
+        if (dynamic_cast<MinMaxParameter*> (p) == nullptr) continue;
+
+        var fromValue = from != nullptr ? from->getPresetValue (pv->paramControlAddress) : var();
+
+        if (fromValue.isVoid()) fromValue = p->value;
+
+        Morph::Track t;
+        t.parameter = p;
+        t.isInt = p->value.isInt();
+        t.numComponents = Morph::getComponents (pv->presetValue, t.to);
+
+        if (t.numComponents == 0 || Morph::getComponents (fromValue, t.from) != t.numComponents) continue;
+
+        if (t.numComponents == 1 && p->isTyped()) m->audioTracks.add (t);
+        else m->controlTracks.add (t);
+    }
+
+    if (m->audioTracks.size() == 0 && m->controlTracks.size() == 0) return container->loadPreset (to);
+
+    int slot = findSlot (nullptr);
+
+    if (slot < 0)
+    {
+        LOG ("!!! too many preset morphs running, loading " + to->name + " directly");
+        return container->loadPreset (to);
+    }
+
+    slots[slot] = morphs.add (m.release());
+
+    if (!isTimerRunning())
+    {
+        lastTimerTime = Time::getMillisecondCounterHiRes();
+        startTimerHz (controlRate);
+    }
+
+    return true;
+}
+
+
+int PresetMorphEngine::findSlot (ParameterContainer* container)
+{
+    for (int i = 0 ; i < maxNumMorphs ; i++)
+    {
+        Morph* m = slots[i].get();
+
+        if (container == nullptr ? m == nullptr : (m != nullptr && m->container.get() == container)) return i;
+    }
+
+    return -1;
+}
+
+
+void PresetMorphEngine::cancel (ParameterContainer* container)
+{
+    const int slot = findSlot (container);
+
+    if (slot < 0) return;
+
+    Morph* m = slots[slot].get();
+
+    // the audio thread stops at the state change, the slot is freed right away
+    m->state = Morph::cancelled;
+    retire (slot);
+}
+
+void PresetMorphEngine::cancelAll()
+{
+    for (int i = 0 ; i < maxNumMorphs ; i++)
+    {
+        if (Morph* m = slots[i].get())
+        {
+            m->state = Morph::cancelled;
+            retire (i);
+        }
+    }
+}
+
+void PresetMorphEngine::cancelMorphsUsing (ParameterContainer* container)
+{
+    bool found = false;
+
+    for (int i = 0 ; i < maxNumMorphs ; i++)
+    {
+        Morph* m = slots[i].get();
+
+        if (m != nullptr && (m->container.get() == container || m->usesParametersOf (container)))
+        {
+            m->state = Morph::cancelled;
+            retire (i);
+            found = true;
+        }
+    }
+
+    if (found) waitForProcessBlock();
+}
+
+void PresetMorphEngine::cancelMorphsUsing (Parameter* parameter)
+{
+    bool found = false;
+
+    for (int i = 0 ; i < maxNumMorphs ; i++)
+    {
+        Morph* m = slots[i].get();
+
+        if (m != nullptr && m->uses (parameter))
+        {
+            m->state = Morph::cancelled;
+            retire (i);
+            found = true;
+        }
+    }
+
+    if (found) waitForProcessBlock();
+}
+
+void PresetMorphEngine::waitForProcessBlock()
+{
+    // a block started before the slots were cleared may still use the parameters, blocks are short
+    while (isProcessing.get() != 0) {Thread::yield();}
+}
+
+bool PresetMorphEngine::isMorphing (ParameterContainer* container)
+{
+    return findSlot (container) >= 0;
+}
+
+double PresetMorphEngine::getProgress (ParameterContainer* container)
+{
+    const int slot = findSlot (container);
+    return slot >= 0 ? slots[slot].get()->getProgress() : -1;
+}
+
+
+void PresetMorphEngine::setControlRate (int hz)
+{
+    controlRate = jlimit (1, 1000, hz);
+
+    if (isTimerRunning()) startTimerHz (controlRate);
+}
+
+
+void PresetMorphEngine::retire (int slot)
+{
+    Morph* m = slots[slot].get();
+    slots[slot] = nullptr;
+    // the audio thread may still hold it until the end of the current block
+    m->retiredAtBlock = numAudioBlocks.get();
+}
+
+
+void PresetMorphEngine::processBlock (int numSamples)
+{
+    if (!isProcessing.compareAndSetBool (1, 0)) return;
+
+    for (int i = 0 ; i < maxNumMorphs ; i++)
+    {
+        Morph* m = slots[i].get();
+
+        if (m == nullptr) continue;
+
+        if (m->state.get() != Morph::running) continue;
+
+        // not atomic increment, processBlock never runs twice at once
+        const int64 elapsed = jmin (m->durationSamples, m->elapsedSamples.get() + numSamples);
+        m->elapsedSamples = elapsed;
+
+        // value at the end of the block, the last block lands on the target
+        const double alpha = m->getProgress();
+
+        for (auto& t : m->audioTracks)
+        {
+            const double v = t.get (0, alpha);
+            t.parameter->setTypedValueFromAudio (t.isInt ? (double) roundToInt (v) : v);
+        }
+
+        if (elapsed >= m->durationSamples) m->state.compareAndSetBool (Morph::finished, Morph::running);
+    }
+
+    ++numAudioBlocks;
+    isProcessing = 0;
+}
+
+
+void PresetMorphEngine::processControlRate()
+{
+    // async notifications of all ramps are delivered once
+    ParameterChangeHub::ScopedBatch batch;
+
+    for (int i = 0 ; i < maxNumMorphs ; i++)
+    {
+        Morph* m = slots[i].get();
+
+        if (m == nullptr) continue;
+
+        const int state = m->state.get();
+
+        if (state == Morph::running || state == Morph::finished)
+        {
+            const double alpha = m->getProgress();
+
+            for (auto& t : m->controlTracks)
+            {
+                Array<var> v;
+
+                for (int c = 0 ; c < t.numComponents ; c++) {v.add (t.isInt ? var (roundToInt (t.get (c, alpha))) : var (t.get (c, alpha)));}
+
+                t.parameter->setValue (var (v));
+            }
+        }
+
+        if (state == Morph::finished)
+        {
+            retire (i);
+
+            // sets exact values and steps the non morphable ones
+            if (ParameterContainer* c = m->container.get()) c->loadPreset (PresetManager::getInstance()->getPreset (m->targetFilter, m->targetName));
+        }
+    }
+
+    const int64 blocks = numAudioBlocks.get();
+
+    for (int i = morphs.size() - 1 ; i >= 0 ; i--)
+    {
+        const int64 retiredAt = morphs.getUnchecked (i)->retiredAtBlock;
+
+        if (retiredAt >= 0 && (blocks > retiredAt + 1 || audioRunning.get() == 0)) morphs.remove (i);
+    }
+}
+
+
+void PresetMorphEngine::timerCallback()
+{
+    const double now = Time::getMillisecondCounterHiRes();
+
+    // no audio clock, advance with wall time
+    if (audioRunning.get() == 0)
+    {
+        const int numSamples = (int) ((now - lastTimerTime) * sampleRate / 1000.0);
+
+        if (numSamples > 0) processBlock (numSamples);
+    }
+
+    lastTimerTime = now;
+    processControlRate();
+
+    if (morphs.size() == 0) stopTimer();
+}
+
+
+void PresetMorphEngine::audioDeviceIOCallback (const float** /*inputChannelData*/, int /*numInputChannels*/,
+                                               float** outputChannelData, int numOutputChannels, int numSamples)
+{
+    AudioThread::markCurrentThread();
+    processBlock (numSamples);
+
+    for (int i = 0 ; i < numOutputChannels ; i++)
+        zeromem (outputChannelData[i], sizeof (float) * (size_t) numSamples);
+}
+
+void PresetMorphEngine::audioDeviceAboutToStart (AudioIODevice* device)
+{
+    sampleRate = device->getCurrentSampleRate();
+    audioRunning = 1;
+}
+
+void PresetMorphEngine::audioDeviceStopped()
+{
+    audioRunning = 0;
+}
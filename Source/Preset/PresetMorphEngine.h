@@ -0,0 +1,104 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#ifndef PRESETMORPHENGINE_H_INCLUDED
+#define PRESETMORPHENGINE_H_INCLUDED
+
+#include "PresetManager.h"
+
+/*
+ interpolates the parameters of a container between two presets
+
+ the morph clock is the audio clock : progress advances by block on the audio thread, so a morph ends on the exact sample
+ typed numeric parameters (the ones read by audio code) are ramped per block on the audio thread, through their atomic copy
+ Point2D / Point3D / Range parameters are ramped on the message thread at a configurable control rate
+ other parameters (bool, enum, string...) jump when the morph ends, where the target preset is loaded
+
+ if no audio device is running, the control rate timer drives the clock
+
+ morphs hold raw pointers to their parameters : containers cancel the morphs using them before their parameters are deleted
+ */
+
+class PresetMorphEngine : public AudioIODeviceCallback, private Timer
+{
+public:
+    juce_DeclareSingleton (PresetMorphEngine, true)
+
+    PresetMorphEngine();
+    ~PresetMorphEngine();
+
+    // from can be null to start from current values, a running morph of the same container is cancelled
+    // returns false if the morph can't be started, the target preset is loaded directly for null durations
+    bool morph (ParameterContainer* container, PresetManager::Preset* from, PresetManager::Preset* to, double durationMs);
+    // duration in beats at current tempo
+    bool morphInBeats (ParameterContainer* container, PresetManager::Preset* from, PresetManager::Preset* to, double numBeats);
+
+    void cancel (ParameterContainer* container);
+    void cancelAll();
+    // message thread, cancels the morphs of container or ramping one of its parameters
+    // returns once the audio thread can't use them anymore
+    void cancelMorphsUsing (ParameterContainer* container);
+    void cancelMorphsUsing (Parameter* parameter);
+    bool isMorphing (ParameterContainer* container);
+    // 0 to 1, -1 if not morphing
+    double getProgress (ParameterContainer* container);
+
+    void setControlRate (int hz);
+    int getControlRate() const {return controlRate;}
+    double getSampleRate() const {return sampleRate;}
+
+    // audio thread : advances the clock of all morphs and ramps typed parameters
+    void processBlock (int numSamples);
+    // message thread : ramps control parameters, ends finished morphs and frees released ones
+    void processControlRate();
+
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels, float** outputChannelData, int numOutputChannels, int numSamples) override;
+    void audioDeviceAboutToStart (AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+
+    static const int maxNumMorphs = 64;
+
+private:
+    class Morph;
+
+    bool startMorph (ParameterContainer* container, PresetManager::Preset* from, PresetManager::Preset* to, int64 durationSamples);
+    int findSlot (ParameterContainer* container);
+    void retire (int slot);
+    // waits for the end of a processBlock running on another thread
+    void waitForProcessBlock();
+    void timerCallback() override;
+
+    // written on message thread only, read by audio thread
+    Atomic<Morph*> slots[maxNumMorphs];
+
+    // owned here until the audio thread can't see them anymore
+    OwnedArray<Morph> morphs;
+
+    Atomic<int64> numAudioBlocks;
+    Atomic<int> audioRunning;
+    // the audio callback and the timer never advance the clock together
+    Atomic<int> isProcessing;
+    double sampleRate;
+    int controlRate;
+    double lastTimerTime;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetMorphEngine)
+};
+
+
+#endif  // PRESETMORPHENGINE_H_INCLUDED
@@ -16,6 +16,8 @@
 #include "JsContainerSync.h"
 #include "JsHelpers.h"
 #include "JsEnvironment.h"
+#include "../../Preset/PresetMorphEngine.h"
+#include "../../Utils/DebugHelpers.h"
 
 
 JsContainerSync::~JsContainerSync()
@@ -124,6 +126,48 @@ var getControllableForAddress (const var::NativeFunctionArgs& a)
 
 };
 
+// morphPreset (name, durationMs) / morphPresetInBeats (name, numBeats) : morphs from current values to a preset of this container
+// the engine lives on the message thread, calls from the script thread are forwarded there
+static void startPresetMorph (ParameterContainer* pc, const String& presetName, double duration, bool inBeats)
+{
+    PresetManager::Preset* preset = PresetManager::getInstance()->getPreset (pc->getPresetFilter(), presetName);
+
+    if (preset == nullptr) {LOG ("!!! no preset " << presetName << " to morph " << pc->getControlAddress()); return;}
+
+    PresetMorphEngine* engine = PresetMorphEngine::getInstance();
+
+    if (inBeats) engine->morphInBeats (pc, nullptr, preset, duration);
+    else         engine->morph (pc, nullptr, preset, duration);
+}
+
+static var morphPresetFromJS (const var::NativeFunctionArgs& a, bool inBeats)
+{
+    ParameterContainer* pc = dynamic_cast<ParameterContainer*> (getObjectPtrFromJS<ControllableContainer> (a));
+
+    if (pc == nullptr || a.numArguments < 2) return false;
+
+    const String presetName = a.arguments[0].toString();
+    const double duration = a.arguments[1];
+
+    if (MessageManager::getInstance()->isThisTheMessageThread())
+    {
+        startPresetMorph (pc, presetName, duration, inBeats);
+    }
+    else
+    {
+        WeakReference<ParameterContainer> weakContainer (pc);
+        MessageManager::callAsync ([weakContainer, presetName, duration, inBeats]()
+        {
+            if (auto* c = weakContainer.get()) startPresetMorph (c, presetName, duration, inBeats);
+        });
+    }
+
+    return true;
+}
+
+static var morphPreset (const var::NativeFunctionArgs& a) {return morphPresetFromJS (a, false);}
+static var morphPresetInBeats (const var::NativeFunctionArgs& a) {return morphPresetFromJS (a, true);}
+
 DynamicObject*
 JsContainerSync::createDynamicObjectFromContainer (ControllableContainer* container)
 {
@@ -144,6 +188,17 @@ JsContainerSync::createDynamicObjectFromContainer (ControllableContainer* contai
     myObj->setMethod (getControllableForAddressId, getControllableForAddress);
     myObj->setProperty (jsPtrIdentifier, (int64)container);
 
+    if (auto pc = dynamic_cast<ParameterContainer*> (container))
+    {
+        if (pc->canHavePresets)
+        {
+            static Identifier morphPresetId ("morphPreset");
+            static Identifier morphPresetInBeatsId ("morphPresetInBeats");
+            myObj->setMethod (morphPresetId, morphPreset);
+            myObj->setMethod (morphPresetInBeatsId, morphPresetInBeats);
+        }
+    }
+
     for (auto& c : container->controllables)
     {
         myObj->setProperty (c->shortName, c->createDynamicObject());
@@ -42,13 +42,16 @@ JsEnvironment::JsEnvironment (const String& ns, ParameterContainer* _linkedConta
     autoWatch (false),
     _isInSyncWithLGML (false),
     isLoadingFile (false),
-    isEnabled (true)
+    isEnabled (true),
+    executionTimeout (RelativeTime::milliseconds (defaultExecutionTimeoutMs))
 
 {
+    executor = new JsExecutor (*this, ns);
     jsParameters = new JSEnvContainer (this);
     linkedContainer->addChildControllableContainer (jsParameters);
     linkedContainer->nameParam->addParameterListener(this);
     localEnv = new DynamicObject();
+    dispatchScope = new DynamicObject();
     clearNamespace();
     getEngine()->addControllableContainerListener (this);
     //  addToNamespace(localNamespace, localEnv, getGlobalEnv());
@@ -60,6 +63,8 @@ JsEnvironment::JsEnvironment (const String& ns, ParameterContainer* _linkedConta
 
 JsEnvironment::~JsEnvironment()
 {
+    executor = nullptr;
+
     if (getEngine())
     {
         getEngine()->removeControllableContainerListener (this);
@@ -133,7 +138,10 @@ void JsEnvironment::clearNamespace()
 
     localEnv->clear();
 
+    // pending events target the previous engine
+    executor->clear();
     jsEngine = new JavascriptEngine();
+    jsEngine->maximumExecutionTime = executionTimeout;
 
 
     static Identifier createParamListenerId ("createParameterListener");
@@ -301,6 +309,17 @@ Result JsEnvironment::loadScriptContent (const String& content)
 }
 
 void JsEnvironment::clearListeners()
+{
+    clearDispatchTable();
+
+    {
+        const ScopedLock lk (engineLock);
+        parameterListenerObjects.clear();
+    }
+
+}
+
+void JsEnvironment::clearDispatchTable()
 {
     for (auto& c : listenedParameters)
     {
@@ -316,11 +335,10 @@ void JsEnvironment::clearListeners()
 
     listenedContainers.clear();
 
-    {
-        const ScopedLock lk (engineLock);
-        parameterListenerObjects.clear();
-    }
-
+    const SpinLock::ScopedLockType lk (dispatchLock);
+    parameterFunctions.clear();
+    containerFunctions.clear();
+    containerDispatchs.clear();
 }
 
 bool JsEnvironment::functionIsDefined (const juce::String& s)
@@ -336,6 +354,19 @@ bool JsEnvironment::functionIsDefined (const juce::String& s)
     return false;
 }
 
+Identifier JsEnvironment::getDefinedFunctionIdentifier (const String& s)
+{
+    StringArray arr;
+    arr.addTokens (s, "_", "");
+
+    for (auto& f : userDefinedFunctions)
+    {
+        if (f.compare (arr)) {return f.identifier;}
+    }
+
+    return Identifier();
+}
+
 bool JsEnvironment::functionIdentifierIsDefined (const Identifier& i)
 {
     for (auto& f : userDefinedFunctions)
@@ -397,9 +428,19 @@ var JsEnvironment::callFunctionFromIdentifier (const Identifier& function, const
     return callFunctionFromIdentifier (function, Nargs, logResult, result);
 }
 
+var JsEnvironment::callFunctionFromIdentifier (const Identifier& function, const var::NativeFunctionArgs& Nargs, bool logResult, Result* result)
+{
+    return callInEngine (function, var::undefined(), Nargs, logResult, result);
+}
+
+var JsEnvironment::callFunctionObject (const var& functionObject, const var::NativeFunctionArgs& Nargs, bool logResult, Result* result)
+{
+    return callInEngine (Identifier(), functionObject, Nargs, logResult, result);
+}
+
 #pragma warning(push)
 #pragma warning(disable:4305 4800)
-var JsEnvironment::callFunctionFromIdentifier (const Identifier& function, const var::NativeFunctionArgs& Nargs, bool logResult, Result* result)
+var JsEnvironment::callInEngine (const Identifier& function, const var& functionObject, const var::NativeFunctionArgs& Nargs, bool logResult, Result* result)
 {
     if (!hasValidJsFile()) return &var::undefined;
 
@@ -414,25 +455,20 @@ var JsEnvironment::callFunctionFromIdentifier (const Identifier& function, const
     var res;
     {
 
-        // TODO : assure thread safety (this one liner is non-atomic, but we may need check if engine is not locked)
-        bool engineIsAlreadyLocked =  !ScopedTryLock (engineLock).isLocked();
+        // events go through the executor thread so waiting here is bounded by the execution timeout
+        const ScopedLock lk (engineLock);
 
-        if (!engineIsAlreadyLocked)
+        if (!JsGlobalEnvironment::getInstance()->isDirty())
         {
-
-            if (!JsGlobalEnvironment::getInstance()->isDirty())
-            {
-                res = jsEngine->callFunction (function, Nargs, result);
-            }
+            // empty scope object so that lookups fall back to global scope as callFunction does
+            if (functionObject.isObject())
+                res = jsEngine->callFunctionObject (dispatchScope.get(), functionObject, Nargs, result);
             else
-            {
-                //      DBG("JS avoiding to call function while global environment is dirty");
-            }
+                res = jsEngine->callFunction (function, Nargs, result);
         }
         else
         {
-            //      jassertfalse;
-            NLOG (localNamespace, "!!! jsEngine is Locked");
+            //      DBG("JS avoiding to call function while global environment is dirty");
         }
     }
 
@@ -453,6 +489,26 @@ var JsEnvironment::callFunctionFromIdentifier (const Identifier& function, const
 
 
 
+void JsEnvironment::postFunctionCall (const Identifier& function, const Array<var>& args, const void* target, const var& thisObject, bool logResult)
+{
+    JsExecutor::Event e;
+    e.target = target;
+    e.function = function;
+    e.thisObject = thisObject;
+    e.args = args;
+    e.logResult = logResult;
+    executor->post (e);
+}
+
+void JsEnvironment::setExecutionTimeout (RelativeTime t)
+{
+    const ScopedLock lk (engineLock);
+    executionTimeout = t;
+    jsEngine->maximumExecutionTime = t;
+}
+
+
+
 const NamedValueSet& JsEnvironment::getRootObjectProperties()
 {
     const ScopedLock lk (engineLock);
@@ -529,7 +585,8 @@ void JsEnvironment::timerCallback (int timerID)
     {
         if (_hasValidJsFile && functionIdentifierIsDefined (onUpdateIdentifier))
         {
-            callFunctionFromIdentifier (onUpdateIdentifier, var(), true);
+            // runs on the message thread like other timer and UI events
+            postFunctionCall (onUpdateIdentifier, Array<var> {var()}, &onUpdateTimer);
         }
         else
         {
@@ -561,6 +618,8 @@ Result JsEnvironment::checkUserControllableEventFunction()
 {
     Result res = Result::ok();
 
+    clearDispatchTable();
+
     NamedValueSet root = getRootObjectProperties();
     Array<FunctionIdentifier*> functionNamespaces;
 
@@ -602,12 +661,18 @@ Result JsEnvironment::checkUserControllableEventFunction()
                     if (Parameter* p = dynamic_cast<Parameter*> (c))
                     {
                         listenedParameters.addIfNotAlreadyThere (p);
+                        const SpinLock::ScopedLockType lk (dispatchLock);
+                        parameterFunctions.set (p, root[f->identifier]);
                         found = true;
                         break;
                     }
                     else if (ControllableContainer* cont = candidate->getControllableContainerForAddress (localName))
                     {
                         listenedContainers.addIfNotAlreadyThere (cont);
+                        ContainerDispatch* d = containerDispatchs.add (new ContainerDispatch());
+                        d->function = root[f->identifier];
+                        const SpinLock::ScopedLockType lk (dispatchLock);
+                        containerFunctions.set (cont, d);
                         found = true;
                         break;
                     }
@@ -685,7 +750,25 @@ void JsEnvironment::parameterValueChanged (Parameter* p)
 
     }
 
-    else if (p)callFunction ("on_" + getJsFunctionNameFromAddress (p->getControlAddress()), p->value, false);
+    else if (p)
+    {
+        var function;
+        {
+            const SpinLock::ScopedLockType lk (dispatchLock);
+            function = parameterFunctions[p];
+        }
+
+        if (function.isObject())
+        {
+            JsExecutor::Event e;
+            e.target = p;
+            e.functionObject = function;
+            // the var may be written by another thread, use the copy made for notifications
+            e.args.add (p->getValueForNotification());
+            e.logResult = false;
+            executor->post (e);
+        }
+    }
     else { jassertfalse; }
 
 };
@@ -696,22 +779,55 @@ void JsEnvironment::controllableFeedbackUpdate (ControllableContainer* originCon
     // avoid root callback (only used to reload if
     if (originContainer == getEngine())return;
 
-    var v = var::undefined();
+    var function, address;
+    bool hasAddress = false;
+    ContainerDispatch* d = nullptr;
+    {
+        const SpinLock::ScopedLockType lk (dispatchLock);
+        d = containerFunctions[originContainer];
 
-    if (Parameter* p = dynamic_cast<Parameter*> (c))
-        v = p->value;
+        if (d != nullptr)
+        {
+            function = d->function;
+            hasAddress = d->addresses.contains (c);
 
-    String address = c->getControlAddress (originContainer);
-    StringArray sArr;
-    sArr.addTokens (address, "/", "");
-    jassert (sArr.size() > 0);
-    sArr.remove (0);
-    Array<var> add;
+            if (hasAddress) address = d->addresses[c];
+        }
+    }
+
+    if (!function.isObject()) return;
+
+    if (!hasAddress)
+    {
+        StringArray sArr;
+        sArr.addTokens (c->getControlAddress (originContainer), "/", "");
+        jassert (sArr.size() > 0);
+        sArr.remove (0);
+        Array<var> add;
+
+        for (auto& s : sArr) { add.add (s); }
+
+        address = add;
+
+        const SpinLock::ScopedLockType lk (dispatchLock);
+
+        if (ContainerDispatch* d = containerFunctions[originContainer])
+            d->addresses.set (c, address);
+    }
+
+    var v = var::undefined();
 
-    for (auto& s : sArr) { add.add (s); }
+    if (Parameter* p = dynamic_cast<Parameter*> (c))
+        v = p->getValueForNotification();
 
-    Array<var> argList = { var (add), v };
-    callFunction ("on_" + getJsFunctionNameFromAddress (originContainer->getControlAddress()), argList, false);
+    JsExecutor::Event e;
+    e.target = d;
+    e.subTarget = c;
+    e.functionObject = function;
+    e.args.add (address);
+    e.args.add (v);
+    e.logResult = false;
+    executor->post (e);
 }
 
 
@@ -730,7 +846,12 @@ void JsEnvironment::childStructureChanged (ControllableContainer* notifierC, Con
             _isInSyncWithLGML = false;
             startTimer (autoWatchTimer.id, autoWatchTimer.interval);
         }
-    };
+    }
+    // dispatch table holds raw pointers, resolve it again
+    else if (_hasValidJsFile && _isInSyncWithLGML && !isLoadingFile && notifierC == getEngine())
+    {
+        _isInSyncWithLGML = (bool)checkUserControllableEventFunction();
+    }
 
 };
 
@@ -788,6 +909,9 @@ JSEnvContainer::JSEnvContainer (JsEnvironment* pEnv):
     autoWatch = addNewParameter<BoolParameter> ("autoWatch", "auto reload if file has been changed", false);
     autoWatch->isSavable = false;
     logT =  addNewParameter<Trigger> ("LogEnvironment", "print hierarchy of JS objects");
+    logStatsT =  addNewParameter<Trigger> ("LogStatistics", "print execution statistics of the script");
+    logStatsT->isControllableExposed = false;
+    executionTimeout = addNewParameter<IntParameter> ("executionTimeout", "time in ms after which a running script is interrupted", JsEnvironment::defaultExecutionTimeoutMs, 10, 60000);
 
 }
 
@@ -810,6 +934,10 @@ void JSEnvContainer::onContainerParameterChanged (Parameter* p)
     {
         jsEnv->setAutoWatch (autoWatch->boolValue());
     }
+    else if (p == executionTimeout)
+    {
+        jsEnv->setExecutionTimeout (RelativeTime::milliseconds (executionTimeout->intValue()));
+    }
 }
 void JSEnvContainer::onContainerTriggerTriggered (Trigger* p)
 {
@@ -825,6 +953,10 @@ void JSEnvContainer::onContainerTriggerTriggered (Trigger* p)
     {
         LOG (jsEnv->printAllNamespace());
     }
+    else if (p == logStatsT)
+    {
+        LOG (jsEnv->getExecutionStatistics().toString());
+    }
     else if (p == loadT)
     {
         File  startFolder (jsEnv->getCurrentFile());
@@ -16,6 +16,7 @@
 #ifndef JAVASCRIPTENVIRONNEMENT_H_INCLUDED
 #define JAVASCRIPTENVIRONNEMENT_H_INCLUDED
 #include "../../Controllable/Parameter/ParameterContainer.h"
+#include "JsExecutor.h"
 
 
 
@@ -93,6 +94,18 @@ public:
     var callFunctionFromIdentifier (const Identifier& function, const var& arg, bool logResult = true, Result* result = nullptr);
     var callFunctionFromIdentifier (const Identifier& function, const var::NativeFunctionArgs& Nargs, bool logResult = true, Result* result = nullptr);
 
+    // calls an already resolved js function object, avoids any name lookup
+    var callFunctionObject (const var& functionObject, const var::NativeFunctionArgs& Nargs, bool logResult = true, Result* result = nullptr);
+
+    // queue a call on the script thread, calls with the same non null target are coalesced
+    void postFunctionCall (const Identifier& function, const Array<var>& args, const void* target = nullptr, const var& thisObject = var::undefined(), bool logResult = true);
+
+    // scripts running longer are interrupted
+    void setExecutionTimeout (RelativeTime t);
+    RelativeTime getExecutionTimeout() const {return executionTimeout;}
+    JsExecutor::Statistics getExecutionStatistics() {return executor->getStatistics();}
+    static const int defaultExecutionTimeoutMs = 2000;
+
 protected :
 
 
@@ -117,6 +130,8 @@ protected :
 
 
     bool functionIsDefined (const String&);
+    // identifier of a user defined function, null if not defined
+    Identifier getDefinedFunctionIdentifier (const String&);
     bool functionIdentifierIsDefined (const Identifier& i);
     File currentFile;
 
@@ -237,6 +252,30 @@ private:
 
     void clearListeners();
     Result checkUserControllableEventFunction();
+
+    ScopedPointer<JsExecutor> executor;
+    friend class JsExecutor;
+    RelativeTime executionTimeout;
+
+    var callInEngine (const Identifier& function, const var& functionObject, const var::NativeFunctionArgs& Nargs, bool logResult, Result* result);
+
+
+    // dispatch table resolved when the script is loaded and rebuilt on structure changes
+    // so that callbacks are found with a pointer lookup instead of building on_xxx names
+    struct ContainerDispatch
+    {
+        var function;
+        // relative address arrays passed to js, built on first feedback of each controllable
+        HashMap<Controllable*, var> addresses;
+    };
+
+    void clearDispatchTable();
+    HashMap<Parameter*, var> parameterFunctions;
+    HashMap<ControllableContainer*, ContainerDispatch*> containerFunctions;
+    OwnedArray<ContainerDispatch> containerDispatchs;
+    SpinLock dispatchLock;
+    DynamicObject::Ptr dispatchScope;
+
     void parameterValueChanged (Parameter* c) override;
 
 
@@ -304,7 +343,8 @@ public :
 
     void newMessage (const Parameter::ParamWithValue& pv)override
     {
-        jsEnv->callFunctionFromIdentifier (parameterChangedFId, var::NativeFunctionArgs (object, &pv.value, 1), true);
+        // not coalesced, every value reaches the script
+        jsEnv->postFunctionCall (parameterChangedFId, Array<var> {pv.value}, nullptr, object);
 
     };
 
@@ -331,7 +371,9 @@ public:
     Trigger* reloadT;
     Trigger* showT;
     Trigger* logT;
+    Trigger* logStatsT;
     BoolParameter* autoWatch;
+    IntParameter* executionTimeout;
     JsEnvironment* jsEnv;
 
 private:
@@ -0,0 +1,234 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#include "JsExecutor.h"
+#include "JsEnvironment.h"
+#include "JsGlobalEnvironment.h"
+#include "../../Utils/DebugHelpers.h"
+#include "../../Utils/AudioThread.h"
+
+namespace
+{
+    // set on executor threads, which never wait for room in an executor queue
+    bool& isExecutorThread()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+}
+
+
+JsExecutor::JsExecutor (JsEnvironment& _owner, const String& name, int _capacity):
+    Thread (name + "_js"),
+    owner (_owner),
+    capacity (jmax (1, _capacity)),
+    roomAvailable (true)
+{
+    pending.ensureStorageAllocated (capacity);
+    processing.ensureStorageAllocated (capacity);
+    startThread (5);
+}
+
+JsExecutor::~JsExecutor()
+{
+    signalThreadShouldExit();
+    notify();
+    roomAvailable.signal();
+    // a running script is interrupted by the engine timeout
+    stopThread ((int) owner.getExecutionTimeout().inMilliseconds() + 1000);
+}
+
+
+int64 JsExecutor::getKey (const void* target, const void* subTarget)
+{
+    return (int64) (pointer_sized_int) target * 31 + (int64) (pointer_sized_int) subTarget;
+}
+
+
+void JsExecutor::post (const Event& e)
+{
+    // message thread events keep running there, waiting for the engine at most the execution timeout
+    if (MessageManager::getInstance()->isThisTheMessageThread())
+    {
+        execute (e);
+        return;
+    }
+
+    // waiting on an executor thread could deadlock two environments filling each other's queue
+    const bool canWait = !isExecutorThread() && !AudioThread::isCurrentThread();
+    const int64 key = getKey (e.target, e.subTarget);
+
+    while (!threadShouldExit())
+    {
+        {
+            const ScopedLock lk (lock);
+
+            if (e.target != nullptr && pendingIndex.contains (key))
+            {
+                Event& existing = pending.getReference (pendingIndex[key]);
+
+                if (existing.target == e.target && existing.subTarget == e.subTarget)
+                {
+                    existing.args = e.args;
+                    existing.thisObject = e.thisObject;
+
+                    const SpinLock::ScopedLockType slk (statsLock);
+                    stats.numCoalesced++;
+                    return;
+                }
+            }
+
+            if (pending.size() < capacity || !canWait)
+            {
+                if (e.target != nullptr) pendingIndex.set (key, pending.size());
+
+                pending.add (e);
+
+                const SpinLock::ScopedLockType slk (statsLock);
+
+                if (pending.size() > capacity) stats.numOverflows++;
+
+                stats.maxPending = jmax (stats.maxPending, pending.size());
+                break;
+            }
+
+            roomAvailable.reset();
+        }
+
+        // room is made at the beginning of each batch
+        notify();
+        roomAvailable.wait (100);
+    }
+
+    notify();
+}
+
+
+void JsExecutor::clear()
+{
+    int numDiscarded = 0;
+    {
+        const ScopedLock lk (lock);
+        numDiscarded = pending.size();
+        pending.clearQuick();
+        pendingIndex.clear();
+    }
+    roomAvailable.signal();
+
+    if (numDiscarded > 0)
+    {
+        const SpinLock::ScopedLockType slk (statsLock);
+        stats.numDiscarded += numDiscarded;
+    }
+}
+
+
+int JsExecutor::getNumPending()
+{
+    const ScopedLock lk (lock);
+    return pending.size();
+}
+
+
+JsExecutor::Statistics JsExecutor::getStatistics()
+{
+    const SpinLock::ScopedLockType slk (statsLock);
+    return stats;
+}
+
+void JsExecutor::resetStatistics()
+{
+    const SpinLock::ScopedLockType slk (statsLock);
+    stats = Statistics();
+}
+
+
+String JsExecutor::Statistics::toString() const
+{
+    return String (numCalls) + " calls, mean " + String (getMeanTimeMs(), 3) + " ms, max " + String (maxTimeMs, 3) + " ms, "
+           + String (numCoalesced) + " coalesced, " + String (numOverflows) + " overflows, max pending " + String (maxPending) + ", "
+           + String (numTimeouts) + " timeouts, " + String (numErrors) + " errors, " + String (numDiscarded) + " discarded on reload";
+}
+
+
+void JsExecutor::run()
+{
+    isExecutorThread() = true;
+
+    while (!threadShouldExit())
+    {
+        // namespace is being rebuilt, calls would be skipped
+        if (JsGlobalEnvironment::getInstance()->isDirty())
+        {
+            wait (10);
+            continue;
+        }
+
+        {
+            const ScopedLock lk (lock);
+            processing.swapWith (pending);
+            pendingIndex.clear();
+        }
+
+        roomAvailable.signal();
+
+        if (processing.size() == 0)
+        {
+            wait (-1);
+            continue;
+        }
+
+        for (auto& e : processing)
+        {
+            if (threadShouldExit()) break;
+
+            execute (e);
+        }
+
+        processing.clearQuick();
+    }
+}
+
+
+void JsExecutor::execute (const Event& e)
+{
+    var noArg;
+    var::NativeFunctionArgs nargs (e.thisObject, e.args.size() > 0 ? e.args.begin() : &noArg, e.args.size());
+    Result r (Result::ok());
+
+    const double startTime = Time::getMillisecondCounterHiRes();
+    owner.callInEngine (e.function, e.functionObject, nargs, false, &r);
+    const double elapsed = Time::getMillisecondCounterHiRes() - startTime;
+
+    const bool timedOut = r.failed() && r.getErrorMessage().contains ("timed-out");
+    {
+        const SpinLock::ScopedLockType slk (statsLock);
+        stats.numCalls++;
+        stats.totalTimeMs += elapsed;
+        stats.maxTimeMs = jmax (stats.maxTimeMs, elapsed);
+
+        if (timedOut) stats.numTimeouts++;
+        else if (r.failed()) stats.numErrors++;
+    }
+
+    if (timedOut)
+    {
+        NLOG (owner.localNamespace, "!!! script interrupted after " + String (elapsed, 0) + " ms : " + r.getErrorMessage());
+    }
+    else if (r.failed() && e.logResult)
+    {
+        NLOG (owner.localNamespace, "!!!" << r.getErrorMessage());
+    }
+}
@@ -0,0 +1,98 @@
+/* Copyright © Organic Orchestra, 2017
+*
+* This file is part of LGML.  LGML is a software to manipulate sound in realtime
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation (version 3 of the License).
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+*/
+
+
+#ifndef JSEXECUTOR_H_INCLUDED
+#define JSEXECUTOR_H_INCLUDED
+
+#include "JuceHeader.h"
+
+class JsEnvironment;
+
+// runs js callbacks of a JsEnvironment on its own thread
+// events posted from the message thread (timers, UI, async parameter listeners) run there right away,
+// so that script natives changing containers or firing UI listeners stay on the message thread
+// events posted with the same target are coalesced (latest arguments win) and pending events are delivered in batches
+// the queue is bounded : other threads wait for room, the message thread, audio threads and executor threads
+// (reentrant calls, or scripts of two environments setting each other's parameters) go over the bound (counted as overflows)
+// runaway scripts are interrupted by the JavascriptEngine execution timeout, reported here
+class JsExecutor : private Thread
+{
+public:
+    JsExecutor (JsEnvironment& owner, const String& name, int capacity = 1024);
+    ~JsExecutor();
+
+    struct Event
+    {
+        Event(): target (nullptr), subTarget (nullptr), logResult (true) {}
+
+        // coalescing key, null target never coalesces
+        const void* target;
+        const void* subTarget;
+
+        // function object if resolved, looked up by name otherwise
+        var functionObject;
+        Identifier function;
+        var thisObject;
+        Array<var> args;
+        bool logResult;
+    };
+
+    void post (const Event& e);
+
+    // discard pending events, used when the script is reloaded
+    void clear();
+
+    struct Statistics
+    {
+        Statistics(): numCalls (0), numCoalesced (0), numOverflows (0), numTimeouts (0), numErrors (0), numDiscarded (0),
+            totalTimeMs (0), maxTimeMs (0), maxPending (0) {}
+
+        int64 numCalls, numCoalesced, numOverflows, numTimeouts, numErrors, numDiscarded;
+        double totalTimeMs, maxTimeMs;
+        int maxPending;
+
+        double getMeanTimeMs() const {return numCalls > 0 ? totalTimeMs / numCalls : 0;}
+        String toString() const;
+    };
+
+    Statistics getStatistics();
+    void resetStatistics();
+
+    int getNumPending();
+    int getCapacity() const {return capacity;}
+
+private:
+    void run() override;
+    void execute (const Event& e);
+
+    static int64 getKey (const void* target, const void* subTarget);
+
+    JsEnvironment& owner;
+    const int capacity;
+
+    CriticalSection lock;
+    Array<Event> pending, processing;
+    // coalescing key to index in pending
+    HashMap<int64, int> pendingIndex;
+    WaitableEvent roomAvailable;
+
+    SpinLock statsLock;
+    Statistics stats;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (JsExecutor)
+};
+
+
+#endif  // JSEXECUTOR_H_INCLUDED
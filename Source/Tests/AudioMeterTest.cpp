@@ -0,0 +1,148 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Audio/AudioMeter.h"
+
+
+// publishes constant rising levels on every channel
+class MeterWriterThread : public Thread
+{
+public:
+    MeterWriterThread (AudioMeter& m): Thread ("meterWriter"), meter (m), buffer (AudioMeter::maxChannels, 512) {}
+
+    void run() override
+    {
+        for (int i = 1 ; i < 20000 && !threadShouldExit() ; i++)
+        {
+            for (int c = 0 ; c < buffer.getNumChannels() ; c++) {FloatVectorOperations::fill (buffer.getWritePointer (c), (i % 1000) / 1000.0f, buffer.getNumSamples());}
+
+            meter.process (buffer, buffer.getNumChannels());
+        }
+    }
+
+    AudioMeter& meter;
+    AudioBuffer<float> buffer;
+};
+
+
+class AudioMeterTest: public UnitTest
+{
+public:
+    AudioMeterTest(): UnitTest ("AudioMeter")
+    {
+
+    }
+
+    void runTest()override
+    {
+        const int blockSize = 512;
+        const int numChannels = 2;
+
+        beginTest ("levels");
+        {
+            AudioMeter meter (blockSize);
+            meter.addConsumer();
+            meter.setTruePeakEnabled (true);
+            AudioBuffer<float> buffer (numChannels, blockSize);
+            int64 n = 0;
+
+            for (int block = 0 ; block < 8 ; block++)
+            {
+                for (int i = 0 ; i < blockSize ; i++, n++)
+                {
+                    // fs/4 sine sampled at 45 degrees : samples never reach the real peak
+                    buffer.setSample (0, i, (float) std::sin (double_Pi / 2.0 * n + double_Pi / 4.0));
+                    buffer.setSample (1, i, (float) (0.5 * std::sin (2.0 * double_Pi * 1000.0 * n / 44100.0)));
+                }
+
+                meter.process (buffer, numChannels);
+            }
+
+            AudioMeter::Snapshot s;
+            expect (meter.getSnapshot (s));
+            expectEquals (s.numChannels, numChannels);
+            expectWithinAbsoluteError (s.rms[0], 0.7071f, 0.001f);
+            expectWithinAbsoluteError (s.peak[0], 0.7071f, 0.001f);
+            expectWithinAbsoluteError (s.truePeak[0], 1.0f, 0.03f);
+            expectWithinAbsoluteError (s.rms[1], 0.3536f, 0.005f);
+            expectWithinAbsoluteError (s.peak[1], 0.5f, 0.001f);
+            expectWithinAbsoluteError (s.truePeak[1], 0.5f, 0.005f);
+            expectWithinAbsoluteError (s.globalLevel, 0.7071f, 0.001f);
+
+            // levels decay on silence
+            buffer.clear();
+
+            for (int block = 0 ; block < 200 ; block++) {meter.process (buffer, numChannels);}
+
+            expectEquals (meter.getRMS (0), 0.0f);
+            expectEquals (meter.getTruePeak (0), 0.0f);
+
+            // nothing is computed without consumers
+            meter.removeConsumer();
+            buffer.setSample (0, 0, 1.0f);
+
+            for (int block = 0 ; block < 4 ; block++) {meter.process (buffer, numChannels);}
+
+            expectEquals (meter.getPeak (0), 0.0f);
+
+            // true-peak follows sample peak unless enabled
+            meter.addConsumer();
+            meter.setTruePeakEnabled (false);
+
+            for (int block = 0 ; block < 4 ; block++) {meter.process (buffer, numChannels);}
+
+            expectEquals (meter.getTruePeak (0), meter.getPeak (0));
+        }
+
+        beginTest ("concurrent snapshots");
+        {
+            AudioMeter meter (512);
+            meter.addConsumer();
+            MeterWriterThread writer (meter);
+            writer.startThread();
+
+            AudioMeter::Snapshot s;
+            int numConsistent = 0, numTorn = 0;
+
+            while (writer.isThreadRunning())
+            {
+                if (!meter.getSnapshot (s)) continue;
+
+                numConsistent++;
+
+                for (int c = 1 ; c < s.numChannels ; c++)
+                {
+                    if (s.rms[c] != s.rms[0]) {numTorn++; break;}
+                }
+            }
+
+            writer.stopThread (1000);
+            expectEquals (numTorn, 0);
+            logMessage (String (numConsistent) + " consistent snapshots read");
+        }
+    }
+
+};
+
+
+static AudioMeterTest audioMeterTest;
+
+#endif // unitTest
@@ -18,6 +18,9 @@
 
 #if LGML_UNIT_TESTS
 #include "../Audio/BufferBlockList.h"
+#include "../Audio/BufferBlockStore.h"
+#include "../Audio/MultiNeedle.h"
+#include "../Audio/BufferExportJob.h"
 
 
 inline String BufToString (AudioBuffer<float>& b, int start = 0, int numSamples = -1)
@@ -78,6 +81,232 @@ public:
             }
         }
 
+        {
+            beginTest (" spill blocks to scratch file ");
+            BufferBlockStore store ("test");
+            store.setMinIdleTime (0);
+            BufferBlockList bl (2, 0, 4096);
+            bl.setBlockStore (&store);
+            testBuffer.setSize (2, 4096 * 4);
+            bl.allocateSamples (2, testBuffer.getNumSamples());
+            fillBufferWithRamp (testBuffer);
+            bl.copyFrom (testBuffer, 0);
+            bl.setNumSample (testBuffer.getNumSamples());
+
+            // only the block under the access position stays in RAM
+            store.setMemoryBudget (1);
+
+            for (int i = 0 ; i < 200 && store.getNumSpilledBlocks() < bl.size() - 1 ; i++) {Thread::sleep (10);}
+
+            expectEquals (store.getNumSpilledBlocks(), bl.size() - 1);
+            expect (store.getResidentBytes() == (int64) 2 * 4096 * sizeof (float));
+
+            bool sameContent = true;
+
+            for (int i = 0 ; i < testBuffer.getNumSamples() ; i++)
+            {
+                for (int j = 0 ; j  < testBuffer.getNumChannels() ; j ++)
+                {
+                    sameContent &= testBuffer.getSample (j, i) == bl.getSample (j, i);
+                }
+            }
+
+            expect (sameContent, "spilled content differs");
+
+            // spilled blocks stay writable
+            testBuffer.applyGain (-1.0f);
+            bl.copyFrom (testBuffer, 0);
+            expect (bl.getSample (1, 4096 * 3 + 10) == testBuffer.getSample (1, 4096 * 3 + 10));
+
+            // copies of other threads go through the same blocks
+            AudioSampleBuffer readBack (2, 4096 * 2);
+            bl.readTo (readBack, 4000, 0, readBack.getNumSamples());
+            expect (readBack.getSample (1, 5000) == testBuffer.getSample (1, 9000));
+
+            AudioSampleBuffer& contiguous = bl.getContiguousBuffer (4000, 200);
+            expect (contiguous.getSample (0, 150) == testBuffer.getSample (0, 4150));
+
+            // blocks ahead of a write position come back to RAM
+            store.setPrefetchLength (testBuffer.getNumSamples());
+            bl.setAccessPosition (0, true);
+
+            for (int i = 0 ; i < 200 && store.getNumSpilledBlocks() > 0 ; i++) {Thread::sleep (10);}
+
+            expectEquals (store.getNumSpilledBlocks(), 0);
+            expect (bl.getSample (1, 4096 * 3 + 10) == testBuffer.getSample (1, 4096 * 3 + 10));
+
+            bl.setBlockStore (nullptr);
+        }
+
+        {
+            beginTest (" export to wav ");
+            // spans several export chunks and list blocks
+            BufferBlockList bl (2, 0, 4096);
+            testBuffer.setSize (2, BufferExportJob::chunkSize * 2 + 1000);
+            bl.allocateSamples (2, testBuffer.getNumSamples());
+
+            for (int i = 0 ; i < testBuffer.getNumSamples() ; i++)
+            {
+                for (int j = 0 ; j  < testBuffer.getNumChannels() ; j ++)
+                {
+                    testBuffer.setSample (j, i, (float) ((i % 200) - 100) / (100.0f * (j + 1)));
+                }
+            }
+
+            bl.copyFrom (testBuffer, 0);
+            bl.setNumSample (testBuffer.getNumSamples());
+
+            TemporaryFile tmp (".wav");
+            const int numSamples = testBuffer.getNumSamples() - 10;
+            {
+                BufferExportJob job (44100, nullptr);
+                job.addList (&bl, 2, numSamples, tmp.getFile());
+                job.runJob();
+            }
+
+            WavAudioFormat format;
+            ScopedPointer<AudioFormatReader> reader (format.createReaderFor (tmp.getFile().createInputStream(), true));
+            expect (reader != nullptr, "can't read exported file");
+
+            if (reader != nullptr)
+            {
+                expectEquals ((int) reader->lengthInSamples, numSamples);
+                expectEquals ((int) reader->numChannels, 2);
+                AudioBuffer<float> readBack (2, numSamples);
+                reader->read (&readBack, 0, numSamples, 0, true, true);
+                float maxError = 0;
+
+                for (int j = 0 ; j < 2 ; j++)
+                {
+                    for (int i = 0 ; i < numSamples ; i++) {maxError = jmax (maxError, std::abs (readBack.getSample (j, i) - testBuffer.getSample (j, i)));}
+                }
+
+                // 24 bits
+                expect (maxError < 1e-6f, "exported content differs : " + String (maxError));
+            }
+
+            // a list recorded during export is not written
+            TemporaryFile tmp2 (".wav");
+            {
+                BufferExportJob job (44100, nullptr);
+                job.addList (&bl, 2, numSamples, tmp2.getFile());
+                bl.copyFrom (testBuffer, 0, 0, 10);
+                job.runJob();
+            }
+            expect (!tmp2.getFile().exists());
+
+            // a list deleted during export is exported from the blocks the job references
+            TemporaryFile tmp3 (".wav");
+            {
+                BufferExportJob job (44100, nullptr);
+                {
+                    ScopedPointer<BufferBlockList> deleted (new BufferBlockList (2, 0, 4096));
+                    deleted->allocateSamples (2, testBuffer.getNumSamples());
+                    deleted->copyFrom (testBuffer, 0);
+                    job.addList (deleted, 2, numSamples, tmp3.getFile());
+                }
+                job.runJob();
+            }
+            expect (tmp3.getFile().existsAsFile());
+        }
+
+        {
+            beginTest (" needle rendering benchmark ");
+            // looper like fixture : 4 beats of 0.6s, blocks of 256 samples, 8 tracks jumping on beats
+            const int sampleRate = 44100;
+            const int blockSize = 256;
+            const int beatLength = (int) (0.6 * sampleRate);
+            const int loopLength = 4 * beatLength;
+            const int numTracks = 8;
+            const int numBlocks = 10 * sampleRate / blockSize;
+
+            BufferBlockList bl (2, 0, 65536);
+            testBuffer.setSize (2, loopLength + 1024);
+            fillBufferWithRamp (testBuffer);
+            bl.allocateSamples (2, testBuffer.getNumSamples());
+            bl.copyFrom (testBuffer, 0);
+            bl.setNumSample (loopLength);
+
+            AudioSampleBuffer reference (2, blockSize);
+            AudioSampleBuffer out (2, blockSize);
+            bool sameResult = true;
+
+            // across blocks and loop end
+            for (int start : {0, 65536 - 100, loopLength - 100})
+            {
+                reference.clear();
+                out.clear();
+                AudioSampleBuffer& contiguous = bl.getContiguousBuffer (start, blockSize);
+
+                for (int c = 0 ; c < 2 ; c++) {reference.addFromWithRamp (c, 0, contiguous.getReadPointer (c), blockSize, 0.2f, 0.9f);}
+
+                bl.addTo (out, 2, start, blockSize, 0.2f, 0.9f);
+
+                for (int c = 0 ; c < 2 ; c++)
+                {
+                    for (int i = 0 ; i < blockSize ; i++)
+                    {
+                        sameResult &= std::abs (reference.getSample (c, i) - out.getSample (c, i)) <= 1e-5f * std::abs (reference.getSample (c, i)) + 1e-6f;
+                    }
+                }
+            }
+
+            expect (sameResult, "ramp mixing differs from contiguous copy");
+
+            const int numCalls = numTracks * numBlocks * 2;
+            Random rnd (42);
+            double startTime = Time::getMillisecondCounterHiRes();
+
+            for (int n = 0 ; n < numCalls ; n++)
+            {
+                const int start = rnd.nextInt (loopLength);
+                AudioSampleBuffer& contiguous = bl.getContiguousBuffer (start, blockSize);
+
+                for (int c = 0 ; c < 2 ; c++) {out.addFromWithRamp (c, 0, contiguous.getReadPointer (c), blockSize, 0.2f, 0.9f);}
+            }
+
+            const double legacyTime = Time::getMillisecondCounterHiRes() - startTime;
+            rnd.setSeed (42);
+            startTime = Time::getMillisecondCounterHiRes();
+
+            for (int n = 0 ; n < numCalls ; n++)
+            {
+                bl.addTo (out, 2, rnd.nextInt (loopLength), blockSize, 0.2f, 0.9f);
+            }
+
+            const double kernelTime = Time::getMillisecondCounterHiRes() - startTime;
+            logMessage (String (numCalls) + " needle blocks : copy + ramp " + String (legacyTime, 2) + " ms, direct ramp " + String (kernelTime, 2) + " ms");
+
+            OwnedArray<MultiNeedle> tracks;
+
+            for (int i = 0 ; i < numTracks ; i++)
+            {
+                auto mn = tracks.add (new MultiNeedle (512, 512));
+                mn->setLoopSize (loopLength);
+                mn->jumpTo (0);
+            }
+
+            int numNeedles = 0;
+            startTime = Time::getMillisecondCounterHiRes();
+
+            for (int b = 0 ; b < numBlocks ; b++)
+            {
+                out.clear();
+
+                for (auto mn : tracks)
+                {
+                    // quantized jumps make needles crossfade
+                    if (b % 16 == 0) mn->jumpTo (((b / 16) % 4) * beatLength);
+
+                    mn->addToBuffer (bl, out, blockSize, true);
+                    numNeedles += mn->numActiveNeedle;
+                }
+            }
+
+            const double renderTime = Time::getMillisecondCounterHiRes() - startTime;
+            logMessage (String (numTracks) + " tracks, " + String (numBlocks) + " blocks, " + String (numNeedles * 1.0 / (numBlocks * numTracks), 2) + " needles per block : " + String (renderTime, 2) + " ms");
+        }
+
     }
 
 };
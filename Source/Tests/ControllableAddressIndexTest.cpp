@@ -0,0 +1,123 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Controllable/Parameter/ParameterContainer.h"
+#include "../Controllable/Parameter/NumericParameter.h"
+
+
+class ControllableAddressIndexTest: public UnitTest
+{
+public:
+    ControllableAddressIndexTest(): UnitTest ("ControllableAddressIndex")
+    {
+
+    }
+
+    const int numNodes = 50;
+    const int numLookups = 100000;
+
+    void buildTree (ParameterContainer& root)
+    {
+        for (int i = 0 ; i < numNodes ; i++)
+        {
+            auto node = new ParameterContainer ("node " + String (i));
+            root.addChildControllableContainer (node);
+            node->addNewParameter<FloatParameter> ("gain", "gain");
+
+            auto sub = new ParameterContainer ("sub");
+            node->addChildControllableContainer (sub);
+            sub->addNewParameter<FloatParameter> ("value", "value");
+            sub->addNewParameter<FloatParameter> ("other Value", "value");
+        }
+    }
+
+    void runTest()override
+    {
+        ParameterContainer root ("root");
+        buildTree (root);
+
+        beginTest ("exact addresses");
+        {
+            auto node = dynamic_cast<ParameterContainer*> (root.getControllableContainerByName ("node 3"));
+            auto sub = dynamic_cast<ParameterContainer*> (node->getControllableContainerByName ("sub"));
+            expect (root.getControllableForAddress ("/node3/sub/value") == sub->getControllableByName ("value"));
+            expect (root.getControllableForAddress ("/Node3/Sub/OtherValue") == sub->getControllableByName ("other Value"));
+            expect (root.getControllableForAddress ("node3/gain") == node->getControllableByName ("gain"));
+            expect (node->getControllableForAddress ("/sub/value") == sub->getControllableByName ("value"));
+            expect (root.getControllableForAddress ("/node3/sub/unknown") == nullptr);
+            expect (root.getControllableForAddress (StringArray::fromTokens ("node3 sub value", false)) == sub->getControllableByName ("value"));
+        }
+
+        beginTest ("index follows structure changes");
+        {
+            auto node = dynamic_cast<ParameterContainer*> (root.getControllableContainerByName ("node 4"));
+            node->setNiceName ("renamed");
+            expect (root.getControllableForAddress ("/node4/gain") == nullptr);
+            expect (root.getControllableForAddress ("/renamed/sub/value") != nullptr);
+
+            auto added = node->addNewParameter<FloatParameter> ("added", "added");
+            expect (root.getControllableForAddress ("/renamed/added") == added);
+
+            added->isControllableExposed = false;
+            expect (root.getControllableForAddress ("/renamed/added") == nullptr);
+            expect (root.getControllableForAddress ("/renamed/added", true, true) == added);
+
+            node->removeControllable (added);
+            expect (root.getControllableForAddress ("/renamed/added", true, true) == nullptr);
+
+            root.removeChildControllableContainer (node);
+            expect (root.getControllableForAddress ("/renamed/sub/value") == nullptr);
+            expect (node->getControllableForAddress ("/sub/value") != nullptr);
+            delete node;
+        }
+
+        beginTest ("pattern addresses");
+        {
+            expectEquals (root.getControllablesForExtendedAddress (StringArray::fromTokens ("* sub value", false)).size(), numNodes - 1);
+            expectEquals (root.getControllablesForExtendedAddress (StringArray::fromTokens ("node1? sub *value", false)).size(), 20);
+            expectEquals (root.getControllablesForExtendedAddress (StringArray::fromTokens ("node{1,2} gain", false)).size(), 2);
+        }
+
+        beginTest ("benchmark");
+        {
+            StringArray addresses;
+
+            for (int i = 0 ; i < numNodes ; i++) {addresses.add ("/node" + String (i) + "/sub/value");}
+
+            const double startTime = Time::getMillisecondCounterHiRes();
+            int numFound = 0;
+
+            for (int i = 0 ; i < numLookups ; i++)
+            {
+                if (root.getControllableForAddress (addresses[i % numNodes])) {numFound++;}
+            }
+
+            const double elapsed = Time::getMillisecondCounterHiRes() - startTime;
+            expectEquals (numFound, numLookups - numLookups / numNodes);
+            logMessage (String (numLookups) + " lookups in " + String (elapsed, 2) + " ms");
+        }
+    }
+
+};
+
+
+static ControllableAddressIndexTest controllableAddressIndexTest;
+
+#endif // unitTest
@@ -0,0 +1,155 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Audio/GainMatrix.h"
+
+
+class GainMatrixTest: public UnitTest
+{
+public:
+    GainMatrixTest(): UnitTest ("GainMatrix")
+    {
+
+    }
+
+    static const int numInputs = 32;
+    static const int numOutputs = 16;
+    static const int blockSize = 512;
+
+    // former mixer implementation : one ramped pass per crosspoint
+    void referenceMix (const AudioBuffer<float>& in, AudioBuffer<float>& out, const float* lastGains, const float* gains)
+    {
+        for (int o = 0 ; o < numOutputs ; o++)
+        {
+            out.copyFromWithRamp (o, 0, in.getReadPointer (0), blockSize, lastGains[o * numInputs], gains[o * numInputs]);
+
+            for (int i = 1 ; i < numInputs ; i++)
+                out.addFromWithRamp (o, 0, in.getReadPointer (i), blockSize, lastGains[o * numInputs + i], gains[o * numInputs + i]);
+        }
+    }
+
+    void expectSameBuffers (const AudioBuffer<float>& a, const AudioBuffer<float>& b, const String& what)
+    {
+        float maxError = 0;
+
+        for (int c = 0 ; c < numOutputs ; c++)
+            for (int s = 0 ; s < blockSize ; s++)
+                maxError = jmax (maxError, std::abs (a.getSample (c, s) - b.getSample (c, s)));
+
+        expect (maxError < 1e-4f, what + " differs from reference by " + String (maxError));
+    }
+
+    void runTest()override
+    {
+        Random rnd (42);
+        AudioBuffer<float> in (numInputs, blockSize), out (numOutputs, blockSize), ref (numOutputs, blockSize);
+
+        for (int c = 0 ; c < numInputs ; c++)
+            for (int s = 0 ; s < blockSize ; s++)
+                in.setSample (c, s, rnd.nextFloat() * 2.0f - 1.0f);
+
+        // diagonal plus a few sends, as most live mixers
+        float gains[numInputs * numOutputs] = {0};
+        float lastGains[numInputs * numOutputs] = {0};
+
+        for (int o = 0 ; o < numOutputs ; o++)
+        {
+            gains[o * numInputs + o] = 1.0f;
+            gains[o * numInputs + numOutputs + o] = 0.5f;
+        }
+
+        GainMatrix matrix;
+        matrix.setSize (numInputs, numOutputs);
+
+        beginTest ("ramps");
+        {
+            for (int o = 0 ; o < numOutputs ; o++)
+                for (int i = 0 ; i < numInputs ; i++)
+                    matrix.setTarget (i, o, gains[o * numInputs + i]);
+
+            expectEquals (matrix.getNumActiveCrosspoints(), numOutputs * 2);
+            expect (matrix.isRamping());
+
+            matrix.process (in.getArrayOfReadPointers(), out.getArrayOfWritePointers(), blockSize);
+            referenceMix (in, ref, lastGains, gains);
+            expectSameBuffers (out, ref, "ramped mix");
+            expect (!matrix.isRamping(), "ramps should end with the block");
+        }
+
+        beginTest ("flat gains");
+        {
+            matrix.process (in.getArrayOfReadPointers(), out.getArrayOfWritePointers(), blockSize);
+            referenceMix (in, ref, gains, gains);
+            expectSameBuffers (out, ref, "flat mix");
+        }
+
+        beginTest ("crosspoints going to zero");
+        {
+            FloatVectorOperations::copy (lastGains, gains, numInputs * numOutputs);
+            gains[3 * numInputs + 3] = 0;
+            gains[5 * numInputs + 20] = 0.25f;
+            matrix.setTarget (3, 3, 0);
+            matrix.setTarget (20, 5, 0.25f);
+
+            matrix.process (in.getArrayOfReadPointers(), out.getArrayOfWritePointers(), blockSize);
+            referenceMix (in, ref, lastGains, gains);
+            expectSameBuffers (out, ref, "fading mix");
+            // 3->3 dropped once faded out, 20->5 added
+            expectEquals (matrix.getNumActiveCrosspoints(), numOutputs * 2);
+
+            matrix.setTarget (3 + numOutputs, 3, 0);
+            matrix.process (in.getArrayOfReadPointers(), out.getArrayOfWritePointers(), blockSize);
+            expect (out.getMagnitude (3, 0, blockSize) > 0, "fade out should still be heard");
+            matrix.process (in.getArrayOfReadPointers(), out.getArrayOfWritePointers(), blockSize);
+            expectEquals (out.getMagnitude (3, 0, blockSize), 0.0f);
+        }
+
+        beginTest ("performance");
+        {
+            const int numBlocks = 2000;
+            FloatVectorOperations::copy (lastGains, gains, numInputs * numOutputs);
+
+            double startTime = Time::getMillisecondCounterHiRes();
+
+            for (int b = 0 ; b < numBlocks ; b++) {referenceMix (in, ref, lastGains, gains);}
+
+            const double refTime = (Time::getMillisecondCounterHiRes() - startTime) / numBlocks;
+
+            startTime = Time::getMillisecondCounterHiRes();
+
+            for (int b = 0 ; b < numBlocks ; b++)
+            {
+                // one crosspoint moving every block
+                matrix.setTarget (b % numInputs, 0, (b % 7) / 7.0f);
+                matrix.process (in.getArrayOfReadPointers(), out.getArrayOfWritePointers(), blockSize);
+            }
+
+            const double matrixTime = (Time::getMillisecondCounterHiRes() - startTime) / numBlocks;
+
+            logMessage (String (numInputs) + "x" + String (numOutputs) + " mix : " + String (refTime * 1000.0, 1) + " us/block with one pass per crosspoint, "
+                        + String (matrixTime * 1000.0, 1) + " us/block sparse");
+        }
+    }
+};
+
+static GainMatrixTest gainMatrixTest;
+
+#endif // unitTest
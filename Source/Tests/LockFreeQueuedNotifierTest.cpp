@@ -0,0 +1,166 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Utils/LockFreeQueuedNotifier.h"
+
+
+struct StressMessage
+{
+    StressMessage (int p, int v): producer (p), value (v) {}
+    int producer;
+    int value;
+};
+
+typedef LockFreeQueuedNotifier<StressMessage> StressNotifier;
+
+
+class StressListener : public StressNotifier::Listener
+{
+public:
+    StressListener (int numProducers)
+    {
+        for (int i = 0 ; i < numProducers ; i++) {lastValues.add (-1); numReceived.add (0);}
+    }
+
+    void newMessage (const StressMessage& m) override
+    {
+        if (m.value <= lastValues[m.producer]) {isOrdered = false;}
+
+        lastValues.set (m.producer, m.value);
+        numReceived.set (m.producer, numReceived[m.producer] + 1);
+        totalReceived++;
+    }
+
+    Array<int> lastValues;
+    Array<int> numReceived;
+    int totalReceived = 0;
+    bool isOrdered = true;
+};
+
+
+class StressProducer : public Thread
+{
+public:
+    StressProducer (StressNotifier& n, int _id, int _numMessages, int _firstValue = 0):
+        Thread ("stressProducer" + String (_id)),
+        notifier (n), id (_id), numMessages (_numMessages), firstValue (_firstValue)
+    {}
+
+    void run() override
+    {
+        for (int i = firstValue ; i < firstValue + numMessages ; i++)
+        {
+            const int64 start = Time::getHighResolutionTicks();
+
+            notifier.addMessage (StressMessage (id, i));
+
+            maxTicks = jmax (maxTicks, Time::getHighResolutionTicks() - start);
+        }
+    }
+
+    StressNotifier& notifier;
+    int id, numMessages, firstValue;
+    int64 maxTicks = 0;
+};
+
+
+class LockFreeQueuedNotifierTest: public UnitTest
+{
+public:
+    LockFreeQueuedNotifierTest(): UnitTest ("LockFreeQueuedNotifier")
+    {
+
+    }
+
+    const int numProducers = 4;
+    const int numMessages = 50000;
+    const int capacity = 256;
+
+    // runs all producers while message thread is stuck in this test, so nothing is consumed
+    // a blocking producer (like QueuedNotifier waiting for MessageManagerLock) would never end
+    double runProducers (StressNotifier& notifier)
+    {
+        OwnedArray<StressProducer> producers;
+
+        for (int i = 0 ; i < numProducers ; i++) {producers.add (new StressProducer (notifier, i, numMessages));}
+
+        for (auto p : producers) {p->startThread (9);}
+
+        int64 maxTicks = 0;
+
+        for (auto p : producers)
+        {
+            expect (p->waitForThreadToExit (10000), "producer blocked");
+            maxTicks = jmax (maxTicks, p->maxTicks);
+        }
+
+        return Time::highResolutionTicksToSeconds (maxTicks) * 1000.0;
+    }
+
+    void runTest()override
+    {
+        beginTest ("producers never block on full ring");
+        {
+            StressNotifier notifier (capacity);
+            StressListener listener (numProducers);
+            notifier.addListener (&listener);
+
+            const double maxMs = runProducers (notifier);
+            logMessage ("max addMessage time : " + String (maxMs, 4) + " ms");
+
+            notifier.handleUpdateNowIfNeeded();
+
+            expectEquals (listener.totalReceived, notifier.getCapacity());
+            expectEquals (listener.totalReceived + notifier.getNumDroppedMessages(), numProducers * numMessages);
+            expect (listener.isOrdered, "messages of a producer are out of order");
+
+            notifier.removeListener (&listener);
+        }
+
+        beginTest ("ring is reusable after being drained");
+        {
+            StressNotifier notifier (capacity, true);
+            StressListener listener (1);
+            notifier.addListener (&listener);
+
+            for (int round = 0 ; round < 10 ; round++)
+            {
+                // message thread would be notified synchronously, so feed from another thread
+                StressProducer producer (notifier, 0, capacity, round * capacity);
+                producer.startThread();
+                expect (producer.waitForThreadToExit (10000), "producer blocked");
+
+                notifier.handleUpdateNowIfNeeded();
+            }
+
+            expectEquals (listener.totalReceived, 10 * capacity);
+            expectEquals (notifier.getNumDroppedMessages(), 0);
+            expect (listener.isOrdered, "messages are out of order");
+
+            notifier.removeListener (&listener);
+        }
+    }
+
+};
+
+
+static LockFreeQueuedNotifierTest lockFreeQueuedNotifierTest;
+
+#endif // unitTest
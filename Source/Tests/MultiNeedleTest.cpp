@@ -0,0 +1,155 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include "../Audio/MultiNeedle.h"
+
+
+// renders a MultiNeedle as an audio thread would
+class NeedleRenderThread : public Thread
+{
+public:
+    NeedleRenderThread (MultiNeedle& mn, BufferBlockList& bl, int _blockSize):
+        Thread ("needleRender"),
+        multiNeedle (mn),
+        bufferList (bl),
+        out (bl.getAllocatedNumChannels(), _blockSize),
+        numBlocks (0),
+        maxAbsSample (0),
+        allFinite (true)
+    {}
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            out.clear();
+            multiNeedle.addToBuffer (bufferList, out, out.getNumSamples(), true);
+            numBlocks++;
+
+            if (numBlocks == 1) firstBlockRendered.signal();
+
+            for (int c = 0 ; c < out.getNumChannels() ; c++)
+            {
+                for (int i = 0 ; i < out.getNumSamples() ; i++)
+                {
+                    const float s = out.getSample (c, i);
+                    allFinite &= std::isfinite (s);
+                    maxAbsSample = jmax (maxAbsSample, std::abs (s));
+                }
+            }
+        }
+    }
+
+    MultiNeedle& multiNeedle;
+    BufferBlockList& bufferList;
+    AudioSampleBuffer out;
+    int numBlocks;
+    float maxAbsSample;
+    bool allFinite;
+    WaitableEvent firstBlockRendered;
+};
+
+
+class MultiNeedleTest: public UnitTest
+{
+public:
+    MultiNeedleTest(): UnitTest ("MultiNeedle")
+    {
+
+    }
+
+    const int blockSize = 256;
+    const int loopLength = 44100 * 2;
+    const int numCommands = 3000;
+
+    void runTest()override
+    {
+        BufferBlockList bl (2, 0, 65536);
+        AudioSampleBuffer content (2, loopLength + 2048);
+
+        for (int c = 0 ; c < 2 ; c++)
+        {
+            for (int i = 0 ; i < content.getNumSamples() ; i++) {content.setSample (c, i, 1.0f);}
+        }
+
+        bl.allocateSamples (2, content.getNumSamples());
+        bl.copyFrom (content, 0);
+        bl.setNumSample (loopLength);
+
+        MultiNeedle mn (512, 512);
+        mn.setLoopSize (loopLength);
+        mn.jumpTo (0);
+
+        beginTest ("controls queued before first block");
+        expectEquals (mn.loopSize, 0);
+
+        beginTest ("control while rendering");
+        {
+            NeedleRenderThread renderer (mn, bl, blockSize);
+            renderer.startThread (9);
+            expect (renderer.firstBlockRendered.wait (1000));
+
+            Random rnd (1);
+
+            for (int i = 0 ; i < numCommands ; i++)
+            {
+                const int size = loopLength / 2 + rnd.nextInt (loopLength / 2);
+
+                switch (rnd.nextInt (4))
+                {
+                    case 0: mn.setLoopSize (size); break;
+                    case 1: mn.jumpTo (rnd.nextInt (size - 2048)); break;
+                    case 2: mn.fadeAllOut(); break;
+                    default: mn.setLoopSize (size); mn.jumpTo (rnd.nextInt (size - 2048)); break;
+                }
+
+                if (i % 3 == 0) Thread::sleep (1);
+            }
+
+            renderer.stopThread (1000);
+
+            expect (renderer.allFinite, "non finite output");
+            // unit content, so at most all needles fully open
+            expect (renderer.maxAbsSample <= mn.maxNeedles, "output out of bounds : " + String (renderer.maxAbsSample));
+            logMessage (String (numCommands) + " commands over " + String (renderer.numBlocks) + " blocks, " + String (mn.getNumDroppedCommands()) + " dropped");
+        }
+
+        beginTest ("queued commands applied at block start");
+        {
+            // render thread is now stopped so those are queued
+            mn.setLoopSize (loopLength);
+            mn.jumpTo (0);
+            AudioSampleBuffer out (2, blockSize);
+            out.clear();
+            mn.addToBuffer (bl, out, blockSize, true);
+            expectEquals (mn.loopSize, loopLength);
+            expectEquals (mn.currentPos, blockSize);
+
+            // now the rendering thread, applied right away
+            mn.jumpTo (1000);
+            expectEquals (mn.currentPos, 1000);
+        }
+    }
+
+};
+
+
+static MultiNeedleTest multiNeedleTest;
+
+#endif // unitTest
@@ -0,0 +1,254 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Controller/Impl/OSCStateDump.h"
+
+
+// loopback peer checking sequence and checksums of a dump
+class DumpPeer : public OSCReceiver::Listener<OSCReceiver::RealtimeCallback>
+{
+public:
+    DumpPeer(): dumpId (-1), numBundles (0), numMessages (0), endChecksum (0), dropSeq (-1), checksumsOk (true) {}
+
+    void oscMessageReceived (const OSCMessage& m) override
+    {
+        const String address = m.getAddressPattern().toString();
+        const ScopedLock lk (lock);
+
+        if (address == OSCStateDump::beginAddress)
+        {
+            dumpId = m[0].getInt32();
+            numBundles = m[1].getInt32();
+            numMessages = m[2].getInt32();
+        }
+        else if (address == OSCStateDump::endAddress)
+        {
+            endChecksum = (uint32) m[2].getInt32();
+            endReceived.signal();
+        }
+    }
+
+    void oscBundleReceived (const OSCBundle& b) override
+    {
+        if (b.size() == 0 || !b[0].isMessage() || b[0].getMessage().getAddressPattern().toString() != OSCStateDump::seqAddress) return;
+
+        const OSCMessage& seqMessage = b[0].getMessage();
+        const int seq = seqMessage[1].getInt32();
+        const ScopedLock lk (lock);
+
+        // simulate a lost datagram once
+        if (seq == dropSeq)
+        {
+            dropSeq = -1;
+            return;
+        }
+
+        char data[OSCMessageQueue::maxPacketSize];
+        int addressSize = 0;
+        uint32 cs = OSCStateDump::checksum (nullptr, 0);
+
+        for (int i = 1 ; i < b.size() ; i++)
+        {
+            const int size = OSCMessageQueue::encodeMessage (b[i].getMessage(), data, OSCMessageQueue::maxPacketSize, addressSize);
+            cs = OSCStateDump::checksum (data, size, cs);
+        }
+
+        if (cs != (uint32) seqMessage[2].getInt32()) checksumsOk = false;
+
+        bundleChecksums.set (seq, cs);
+        messagesPerBundle.set (seq, b.size() - 1);
+    }
+
+    // last sequence received without gap
+    int getLastContiguous()
+    {
+        const ScopedLock lk (lock);
+        int i = 0;
+
+        while (bundleChecksums.contains (i)) {i++;}
+
+        return i - 1;
+    }
+
+    uint32 getTotalChecksum()
+    {
+        const ScopedLock lk (lock);
+        uint32 total = OSCStateDump::checksum (nullptr, 0);
+
+        for (int i = 0 ; i < numBundles ; i++)
+        {
+            const uint32 bigEndianChecksum = ByteOrder::swapIfLittleEndian (bundleChecksums[i]);
+            total = OSCStateDump::checksum ((const char*) &bigEndianChecksum, 4, total);
+        }
+
+        return total;
+    }
+
+    int getNumReceivedMessages()
+    {
+        const ScopedLock lk (lock);
+        int n = 0;
+
+        for (HashMap<int, int>::Iterator i (messagesPerBundle) ; i.next();) {n += i.getValue();}
+
+        return n;
+    }
+
+    CriticalSection lock;
+    int dumpId, numBundles, numMessages;
+    uint32 endChecksum;
+    int dropSeq;
+    bool checksumsOk;
+    HashMap<int, uint32> bundleChecksums;
+    HashMap<int, int> messagesPerBundle;
+    WaitableEvent endReceived;
+};
+
+
+class OSCStateDumpTest: public UnitTest
+{
+public:
+    OSCStateDumpTest(): UnitTest ("OSCStateDump")
+    {
+
+    }
+
+    const int numMessages = 5000;
+    const double bundlesPerSecond = 2000;
+
+    void runTest()override
+    {
+        beginTest ("only coalesced messages replace pending ones");
+        {
+            // not connected and never flushed : everything stays pending
+            OSCMessageQueue queue ("test", 16);
+            queue.setInterval (100000);
+            // let the output thread consume the wakeup of setInterval
+            Thread::sleep (50);
+
+            queue.add (OSCMessage ("/feedback", 1.f), true);
+            queue.add (OSCMessage ("/feedback", 2.f), true);
+            expectEquals (queue.getNumPending(), 1);
+
+            queue.add (OSCMessage ("/custom", 1.f));
+            queue.add (OSCMessage ("/custom", 2.f));
+            expectEquals (queue.getNumPending(), 3);
+
+            // bigger than a slot, still queued behind the others
+            expect (queue.add (OSCMessage ("/big", String::repeatedString ("x", 1000))) == OSCMessageQueue::messageQueued);
+            expectEquals (queue.getNumPending(), 4);
+        }
+
+        OSCReceiver receiver;
+        int port = 0;
+
+        for (int i = 0 ; i < 10 && port == 0 ; i++)
+        {
+            const int p = 20000 + Random::getSystemRandom().nextInt (10000);
+
+            if (receiver.connect (p)) port = p;
+        }
+
+        if (port == 0)
+        {
+            logMessage ("can't bind loopback port, skipping");
+            return;
+        }
+
+        Array<OSCMessage> messages;
+
+        for (int i = 0 ; i < numMessages ; i++)
+        {
+            if (i % 3 == 0) messages.add (OSCMessage ("/node" + String (i / 10) + "/param" + String (i % 10), (float) i));
+            else if (i % 3 == 1) messages.add (OSCMessage ("/node" + String (i / 10) + "/param" + String (i % 10), i));
+            else messages.add (OSCMessage ("/node" + String (i / 10) + "/param" + String (i % 10), String ("value " + String (i))));
+        }
+
+        OSCMessageQueue output ("test", 16);
+        expect (output.connect ("127.0.0.1", port));
+
+        beginTest ("full sync");
+        {
+            DumpPeer peer;
+            receiver.addListener (&peer);
+            OSCStateDump dump ("test", output);
+
+            const double startTime = Time::getMillisecondCounterHiRes();
+            const int dumpId = dump.start (messages, bundlesPerSecond);
+            expect (peer.endReceived.wait (10000), "end of dump not received");
+            const double elapsed = Time::getMillisecondCounterHiRes() - startTime;
+
+            // loopback may still lose datagrams, ask for them
+            for (int i = 0 ; i < 5 && peer.getLastContiguous() < dump.getNumBundles() - 1 ; i++)
+            {
+                peer.endReceived.reset();
+                dump.resume (dumpId, peer.getLastContiguous());
+                peer.endReceived.wait (5000);
+            }
+
+            receiver.removeListener (&peer);
+
+            expectEquals (peer.dumpId, dumpId);
+            expectEquals (peer.numBundles, dump.getNumBundles());
+            expectEquals (peer.numMessages, numMessages);
+            expectEquals (peer.getLastContiguous(), dump.getNumBundles() - 1);
+            expectEquals (peer.getNumReceivedMessages(), numMessages);
+            expect (peer.checksumsOk, "bundle checksum mismatch");
+            expect (peer.getTotalChecksum() == peer.endChecksum, "dump checksum mismatch");
+
+            logMessage (String (numMessages) + " messages in " + String (dump.getNumBundles()) + " bundles synced in " + String (elapsed, 2) + " ms");
+        }
+
+        beginTest ("resume after loss");
+        {
+            DumpPeer peer;
+            peer.dropSeq = 3;
+            receiver.addListener (&peer);
+            OSCStateDump dump ("test", output);
+
+            const int dumpId = dump.start (messages, bundlesPerSecond);
+            expect (peer.endReceived.wait (10000), "end of dump not received");
+            expectEquals (peer.getLastContiguous(), 2);
+
+            for (int i = 0 ; i < 5 && peer.getLastContiguous() < dump.getNumBundles() - 1 ; i++)
+            {
+                peer.endReceived.reset();
+                dump.resume (dumpId, peer.getLastContiguous());
+                peer.endReceived.wait (5000);
+            }
+
+            receiver.removeListener (&peer);
+
+            expectEquals (peer.getLastContiguous(), dump.getNumBundles() - 1);
+            expect (peer.checksumsOk, "bundle checksum mismatch");
+            expect (peer.getTotalChecksum() == peer.endChecksum, "dump checksum mismatch");
+
+            // resume for another dump is ignored
+            dump.resume (dumpId + 1, 0);
+            expect (dump.hasSentAllBundles());
+        }
+    }
+
+};
+
+
+static OSCStateDumpTest oscStateDumpTest;
+
+#endif // unitTest
@@ -0,0 +1,450 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Node/NodeContainer/ParallelAudioGraph.h"
+
+
+// processor burning some cpu with a deterministic output
+class BusyProcessor : public AudioProcessor
+{
+public:
+    BusyProcessor (int _workAmount): workAmount (_workAmount) {}
+
+    const String getName() const override {return "BusyProcessor";}
+    void prepareToPlay (double, int) override {}
+    void releaseResources() override {}
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
+    {
+        for (int c = 0 ; c < buffer.getNumChannels() ; c++)
+        {
+            float* d = buffer.getWritePointer (c);
+
+            for (int i = 0 ; i < buffer.getNumSamples() ; i++)
+            {
+                float v = d[i];
+
+                for (int w = 0 ; w < workAmount ; w++) {v = v * 0.999f + 0.0001f;}
+
+                d[i] = v;
+            }
+        }
+    }
+    double getTailLengthSeconds() const override {return 0;}
+    bool acceptsMidi() const override {return false;}
+    bool producesMidi() const override {return false;}
+    AudioProcessorEditor* createEditor() override {return nullptr;}
+    bool hasEditor() const override {return false;}
+    int getNumPrograms() override {return 0;}
+    int getCurrentProgram() override {return 0;}
+    void setCurrentProgram (int) override {}
+    const String getProgramName (int) override {return "";}
+    void changeProgramName (int, const String&) override {}
+    void getStateInformation (juce::MemoryBlock&) override {}
+    void setStateInformation (const void*, int) override {}
+
+    int workAmount;
+};
+
+
+// node reading midi from the graph
+class MidiProcessor : public BusyProcessor
+{
+public:
+    MidiProcessor(): BusyProcessor (0) {}
+    bool acceptsMidi() const override {return true;}
+};
+
+
+// renders a graph as a whole, like NodeContainer
+class NestedGraphProcessor : public BusyProcessor, public InlinableGraphProcessor
+{
+public:
+    NestedGraphProcessor(): BusyProcessor (0), transparent (true) {graph = new ParallelAudioGraph();}
+    ~NestedGraphProcessor() {graph = nullptr;}
+
+    const String getName() const override {return "NestedGraphProcessor";}
+    void prepareToPlay (double sampleRate, int blockSize) override
+    {
+        graph->setPlayConfigDetails (getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate, blockSize);
+        graph->prepareToPlay (sampleRate, blockSize);
+    }
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override
+    {
+        const ScopedLock lk (graph->getCallbackLock());
+        graph->processBlock (buffer, midi);
+
+        // a non transparent container alters its output
+        if (!transparent) buffer.applyGain (0.5f);
+    }
+
+    ParallelAudioGraph* getInlinableGraph() override {return graph;}
+    bool canRenderInlined() override {return transparent;}
+
+    ScopedPointer<ParallelAudioGraph> graph;
+    bool transparent;
+};
+
+
+class ParallelAudioGraphTest: public UnitTest
+{
+public:
+    ParallelAudioGraphTest(): UnitTest ("ParallelAudioGraph")
+    {
+
+    }
+
+    const int blockSize = 512;
+    const double sampleRate = 44100;
+    const int numChannels = 2;
+    const int numBranches = 16;
+    const int branchDepth = 3;
+    const int numBlocks = 200;
+
+    void buildGraph (ParallelAudioGraph& graph)
+    {
+        typedef AudioProcessorGraph::AudioGraphIOProcessor IO;
+        graph.setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        auto in = graph.addNode (new IO (IO::audioInputNode));
+        auto out = graph.addNode (new IO (IO::audioOutputNode));
+
+        for (int b = 0 ; b < numBranches ; b++)
+        {
+            auto last = in;
+
+            for (int d = 0 ; d < branchDepth ; d++)
+            {
+                BusyProcessor* p = new BusyProcessor (20);
+                p->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+                auto n = graph.addNode (p);
+
+                for (int c = 0 ; c < numChannels ; c++) graph.addConnection (last->nodeId, c, n->nodeId, c);
+
+                last = n;
+            }
+
+            for (int c = 0 ; c < numChannels ; c++) graph.addConnection (last->nodeId, c, out->nodeId, c);
+        }
+
+        graph.prepareToPlay (sampleRate, blockSize);
+    }
+
+    double renderBlocks (ParallelAudioGraph& graph, AudioBuffer<float>& lastBlock)
+    {
+        MidiBuffer midi;
+        AudioBuffer<float> buffer (numChannels, blockSize);
+        const double startTime = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0 ; i < numBlocks ; i++)
+        {
+            for (int c = 0 ; c < numChannels ; c++)
+                for (int s = 0 ; s < blockSize ; s++)
+                    buffer.setSample (c, s, (float) ((s + i) % 100) / 100.0f);
+
+            const ScopedLock lk (graph.getCallbackLock());
+            graph.processBlock (buffer, midi);
+        }
+
+        lastBlock.makeCopyOf (buffer);
+        return (Time::getMillisecondCounterHiRes() - startTime) / numBlocks;
+    }
+
+    void expectSameBlocks (const AudioBuffer<float>& a, const AudioBuffer<float>& b, const String& what)
+    {
+        for (int c = 0 ; c < numChannels ; c++)
+        {
+            for (int s = 0 ; s < blockSize ; s++)
+            {
+                expect (std::abs (a.getSample (c, s) - b.getSample (c, s)) < 1e-4f, what + " differs at sample " + String (s));
+            }
+        }
+    }
+
+    // renders one block of constant input
+    void renderConstant (ParallelAudioGraph& graph, AudioBuffer<float>& buffer, float value)
+    {
+        MidiBuffer midi;
+        buffer.setSize (numChannels, blockSize);
+
+        for (int c = 0 ; c < numChannels ; c++) {FloatVectorOperations::fill (buffer.getWritePointer (c), value, blockSize);}
+
+        const ScopedLock lk (graph.getCallbackLock());
+        graph.processBlock (buffer, midi);
+    }
+
+    void testHotSwap()
+    {
+        typedef AudioProcessorGraph::AudioGraphIOProcessor IO;
+        ParallelAudioGraph graph;
+        graph.setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        auto in = graph.addNode (new IO (IO::audioInputNode));
+        auto out = graph.addNode (new IO (IO::audioOutputNode));
+        BusyProcessor* p = new BusyProcessor (0);
+        p->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        AudioProcessorGraph::Node::Ptr n = graph.addNode (p);
+
+        for (int c = 0 ; c < numChannels ; c++)
+        {
+            graph.addConnection (in->nodeId, c, n->nodeId, c);
+            graph.addConnection (n->nodeId, c, out->nodeId, c);
+        }
+
+        graph.prepareToPlay (sampleRate, blockSize);
+        AudioBuffer<float> buffer;
+        renderConstant (graph, buffer, 1);
+        expectEquals (buffer.getSample (0, blockSize - 1), 1.0f);
+
+        // added link ramps in over the first block
+        for (int c = 0 ; c < numChannels ; c++) {graph.addConnection (in->nodeId, c, out->nodeId, c);}
+
+        graph.rebuildSchedule();
+        renderConstant (graph, buffer, 1);
+        expectWithinAbsoluteError (buffer.getSample (0, 0), 1.0f, 0.01f);
+        expectWithinAbsoluteError (buffer.getSample (1, blockSize - 1), 2.0f, 0.01f);
+        expect (buffer.getSample (0, blockSize / 2) > 1.4f && buffer.getSample (0, blockSize / 2) < 1.6f, "no ramp on added link");
+        renderConstant (graph, buffer, 1);
+        expectEquals (buffer.getSample (0, 0), 2.0f);
+
+        // removed link ramps out
+        for (int c = 0 ; c < numChannels ; c++) {graph.removeConnection (n->nodeId, c, out->nodeId, c);}
+
+        graph.rebuildSchedule();
+        renderConstant (graph, buffer, 1);
+        expectWithinAbsoluteError (buffer.getSample (0, 0), 2.0f, 0.01f);
+        expectWithinAbsoluteError (buffer.getSample (0, blockSize - 1), 1.0f, 0.01f);
+        renderConstant (graph, buffer, 1);
+        expectEquals (buffer.getSample (0, 0), 1.0f);
+
+        // no block is being rendered, so no rendering reference is left once removed
+        graph.removeNodeFromSchedules (n);
+        expectEquals (n->getReferenceCount(), 1);
+        renderConstant (graph, buffer, 1);
+        expectEquals (buffer.getSample (0, blockSize - 1), 1.0f);
+        n = nullptr;
+    }
+
+    void testConcurrentEdits()
+    {
+        typedef AudioProcessorGraph::AudioGraphIOProcessor IO;
+        ParallelAudioGraph graph;
+        graph.setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        auto in = graph.addNode (new IO (IO::audioInputNode));
+        auto out = graph.addNode (new IO (IO::audioOutputNode));
+        Array<AudioProcessorGraph::Node*> branches;
+
+        for (int b = 0 ; b < numBranches ; b++)
+        {
+            BusyProcessor* p = new BusyProcessor (1);
+            p->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+            auto n = graph.addNode (p);
+            branches.add (n);
+
+            for (int c = 0 ; c < numChannels ; c++) {graph.addConnection (n->nodeId, c, out->nodeId, c);}
+        }
+
+        // input goes through untouched, edits must never cut it
+        for (int c = 0 ; c < numChannels ; c++) {graph.addConnection (in->nodeId, c, out->nodeId, c);}
+
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        // audio thread renders while the graph is patched, no block should be silent
+        struct Renderer : public Thread
+        {
+            Renderer (ParallelAudioGraphTest& t, ParallelAudioGraph& g): Thread ("hotSwapRenderer"), test (t), graph (g), numBlocks (0), numSilentBlocks (0) {}
+
+            void run() override
+            {
+                AudioBuffer<float> buffer;
+
+                while (!threadShouldExit())
+                {
+                    test.renderConstant (graph, buffer, 1);
+                    numBlocks++;
+
+                    if (buffer.getMagnitude (0, 0, buffer.getNumSamples()) < 0.5f) numSilentBlocks++;
+                }
+            }
+
+            ParallelAudioGraphTest& test;
+            ParallelAudioGraph& graph;
+            int numBlocks, numSilentBlocks;
+        };
+
+        Renderer renderer (*this, graph);
+        renderer.startThread();
+        const int numEdits = 200;
+        double rebuildTime = 0;
+
+        for (int i = 0 ; i < numEdits ; i++)
+        {
+            auto n = branches[i % numBranches];
+
+            for (int c = 0 ; c < numChannels ; c++)
+            {
+                if (i % 2 == 0) graph.addConnection (in->nodeId, c, n->nodeId, c);
+                else graph.removeConnection (in->nodeId, c, n->nodeId, c);
+            }
+
+            const double startTime = Time::getMillisecondCounterHiRes();
+            graph.rebuildSchedule();
+            rebuildTime += Time::getMillisecondCounterHiRes() - startTime;
+            Thread::sleep (1);
+        }
+
+        renderer.stopThread (1000);
+        expect (renderer.numBlocks > 0);
+        expectEquals (renderer.numSilentBlocks, 0);
+        logMessage ("hot-swap : " + String (numEdits) + " edits over " + String (renderer.numBlocks) + " blocks, "
+                    + String (rebuildTime / numEdits, 3) + " ms per rebuild off the audio thread");
+    }
+
+    // chain of depth nested graphs, each level processing its input with one node then passing it to the next level
+    void addNestedChain (ParallelAudioGraph& graph, int depth, Array<NestedGraphProcessor*>& containers)
+    {
+        typedef AudioProcessorGraph::AudioGraphIOProcessor IO;
+        auto in = graph.addNode (new IO (IO::audioInputNode));
+        auto out = graph.addNode (new IO (IO::audioOutputNode));
+        BusyProcessor* p = new BusyProcessor (2);
+        p->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        auto n = graph.addNode (p);
+        auto last = n;
+
+        for (int c = 0 ; c < numChannels ; c++) {graph.addConnection (in->nodeId, c, n->nodeId, c);}
+
+        if (depth > 0)
+        {
+            NestedGraphProcessor* child = new NestedGraphProcessor();
+            child->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+            child->graph->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+            child->graph->setParentGraph (&graph);
+            containers.add (child);
+            addNestedChain (*child->graph, depth - 1, containers);
+            auto cn = graph.addNode (child);
+
+            for (int c = 0 ; c < numChannels ; c++) {graph.addConnection (n->nodeId, c, cn->nodeId, c);}
+
+            last = cn;
+        }
+
+        // direct path checks that links through IO nodes are summed as the graph would do
+        for (int c = 0 ; c < numChannels ; c++)
+        {
+            graph.addConnection (last->nodeId, c, out->nodeId, c);
+            graph.addConnection (in->nodeId, c, out->nodeId, c);
+        }
+    }
+
+    void testFlattening()
+    {
+        const int maxDepth = 16;
+        const bool wasFlattening = ParallelAudioGraph::isFlatteningEnabled();
+
+        for (int depth = 1 ; depth <= maxDepth ; depth *= 2)
+        {
+            ParallelAudioGraph graph;
+            Array<NestedGraphProcessor*> containers;
+            graph.setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+            addNestedChain (graph, depth, containers);
+
+            // children are prepared first so that they can be inlined
+            for (int i = containers.size() - 1 ; i >= 0 ; i--) {containers[i]->prepareToPlay (sampleRate, blockSize);}
+
+            graph.prepareToPlay (sampleRate, blockSize);
+
+            AudioBuffer<float> nestedRes, flatRes;
+            ParallelAudioGraph::setFlatteningEnabled (false);
+            const double nestedTime = renderBlocks (graph, nestedRes);
+            ParallelAudioGraph::setFlatteningEnabled (true);
+            const double flatTime = renderBlocks (graph, flatRes);
+
+            expectSameBlocks (nestedRes, flatRes, "flattened render of depth " + String (depth));
+            logMessage ("nesting depth " + String (depth) + " : nested " + String (nestedTime * 1000.0, 1) + " us/block, flattened " + String (flatTime * 1000.0, 1) + " us/block");
+
+            if (depth == maxDepth)
+            {
+                // a container that can't be inlined is rendered as a node
+                containers[depth / 2]->transparent = false;
+                AudioBuffer<float> alteredRes;
+                renderBlocks (graph, alteredRes);
+                expect (std::abs (alteredRes.getSample (0, blockSize - 1) - flatRes.getSample (0, blockSize - 1)) > 1e-3f, "non transparent container was inlined");
+                containers[depth / 2]->transparent = true;
+            }
+        }
+
+        ParallelAudioGraph::setFlatteningEnabled (wasFlattening);
+    }
+
+    void runTest()override
+    {
+        const bool wasEnabled = ParallelAudioGraph::isMultiThreadingEnabled();
+
+        beginTest ("parallel render matches JUCE render");
+        ParallelAudioGraph graph;
+        buildGraph (graph);
+        AudioBuffer<float> juceRes, singleRes, parallelRes;
+
+        // JUCE renders when there is no schedule
+        graph.invalidateSchedule();
+        renderBlocks (graph, juceRes);
+        graph.rebuildSchedule();
+
+        ParallelAudioGraph::setMultiThreadingEnabled (false);
+        const double singleTime = renderBlocks (graph, singleRes);
+
+        ParallelAudioGraph::setMultiThreadingEnabled (true);
+        const double parallelTime = renderBlocks (graph, parallelRes);
+
+        expectSameBlocks (juceRes, singleRes, "single threaded render");
+        expectSameBlocks (juceRes, parallelRes, "parallel render");
+
+        beginTest ("hot-swap");
+        testHotSwap();
+
+        beginTest ("edits while rendering");
+        testConcurrentEdits();
+
+        beginTest ("flattened nested graphs");
+        testFlattening();
+
+        beginTest ("midi graphs are rendered by JUCE");
+        {
+            ParallelAudioGraph midiGraph;
+            buildGraph (midiGraph);
+            expect (midiGraph.hasSchedule());
+            MidiProcessor* m = new MidiProcessor();
+            m->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+            midiGraph.addNode (m);
+            midiGraph.rebuildSchedule();
+            expect (!midiGraph.hasSchedule());
+        }
+
+        beginTest ("benchmark");
+        logMessage ("graph of " + String (numBranches) + "x" + String (branchDepth) + " nodes, " + String (AudioGraphWorkers::getInstance()->getNumWorkers()) + " workers");
+        logMessage ("single threaded : " + String (singleTime, 3) + " ms/block");
+        logMessage ("multi threaded : " + String (parallelTime, 3) + " ms/block");
+
+        ParallelAudioGraph::setMultiThreadingEnabled (wasEnabled);
+    }
+
+};
+
+
+static ParallelAudioGraphTest parallelAudioGraphTest;
+
+#endif // unitTest
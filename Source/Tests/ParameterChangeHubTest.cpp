@@ -0,0 +1,202 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Controllable/Parameter/NumericParameter.h"
+#include "../Controllable/Parameter/Trigger.h"
+#include "../Utils/LockFreeQueuedNotifier.h"
+
+
+class CountingAsyncListener : public Parameter::AsyncListener
+{
+public:
+    CountingAsyncListener(): numMessages (0), numRangeMessages (0) {}
+
+    void newMessage (const Parameter::ParamWithValue& pv) override
+    {
+        if (pv.isRange()) numRangeMessages++;
+        else {numMessages++; lastValue = pv.value;}
+    }
+
+    int numMessages, numRangeMessages;
+    var lastValue;
+};
+
+
+// sets every parameter numRounds times from a non message thread
+template<typename SetFunction>
+class ChangeProducerThread : public Thread
+{
+public:
+    ChangeProducerThread (int _numParams, int _numRounds, SetFunction f): Thread ("changeProducer"), numParams (_numParams), numRounds (_numRounds), setFunction (f) {}
+
+    void run() override
+    {
+        for (int r = 0 ; r < numRounds ; r++)
+        {
+            for (int i = 0 ; i < numParams ; i++) {setFunction (i, r);}
+        }
+    }
+
+    int numParams, numRounds;
+    SetFunction setFunction;
+};
+
+template<typename SetFunction>
+double runProducer (int numParams, int numRounds, SetFunction f)
+{
+    ChangeProducerThread<SetFunction> producer (numParams, numRounds, f);
+    const double start = Time::getMillisecondCounterHiRes();
+    producer.startThread();
+
+    while (producer.isThreadRunning()) {Thread::sleep (1);}
+
+    return Time::getMillisecondCounterHiRes() - start;
+}
+
+
+class ParameterChangeHubTest: public UnitTest
+{
+public:
+    ParameterChangeHubTest(): UnitTest ("ParameterChangeHub")
+    {
+
+    }
+
+    const int numParams = 20000;
+    const int numBaselineParams = 2000;
+    const int numRounds = 20;
+
+    void runTest()override
+    {
+        ParameterChangeHub* hub = ParameterChangeHub::getInstance();
+
+        beginTest ("coalescing");
+        {
+            FloatParameter p ("p", "", 0, 0, 1000);
+            CountingAsyncListener listener;
+            p.addAsyncParameterListener (&listener);
+
+            runProducer (1, 1000, [&p] (int, int r) {p.setValue (r + 1);});
+            hub->flush();
+
+            expectEquals (listener.numMessages, 1);
+            expectEquals ((double) listener.lastValue, 1000.0);
+
+            // range changes have their own bit
+            runProducer (1, 1, [&p] (int, int) {p.setMinMax (0, 10);});
+            hub->flush();
+            expectEquals (listener.numRangeMessages, 1);
+
+            // message thread changes are delivered right away
+            p.setValue (5);
+            expectEquals (listener.numMessages, 2);
+
+            p.removeAsyncParameterListener (&listener);
+        }
+
+        beginTest ("trigger fires are not coalesced");
+        {
+            Trigger t ("t", "");
+            CountingAsyncListener listener;
+            t.addAsyncParameterListener (&listener);
+
+            runProducer (1, 100, [&t] (int, int) {t.trigger();});
+            hub->flush();
+
+            expectEquals (listener.numMessages, 100);
+            t.removeAsyncParameterListener (&listener);
+        }
+
+        beginTest ("deleting a dirty parameter");
+        {
+            ScopedPointer<FloatParameter> a = new FloatParameter ("a", "", 0, 0, 1);
+            FloatParameter b ("b", "", 0, 0, 1);
+            CountingAsyncListener listener;
+            a->addAsyncParameterListener (&listener);
+            b.addAsyncParameterListener (&listener);
+
+            runProducer (1, 1, [&a, &b] (int, int) {a->setValue (0.5); b.setValue (0.5);});
+            a = nullptr;
+            hub->flush();
+
+            expectEquals (listener.numMessages, 1);
+            b.removeAsyncParameterListener (&listener);
+        }
+
+        beginTest ("benchmark");
+        {
+            // former path : one LockFreeQueuedNotifier per parameter, with a listener as every ParameterContainer adds one
+            {
+                typedef LockFreeQueuedNotifier<Parameter::ParamWithValue> Notifier;
+                OwnedArray<Notifier> notifiers;
+                CountingAsyncListener listener;
+
+                for (int i = 0 ; i < numBaselineParams ; i++)
+                {
+                    notifiers.add (new Notifier (100))->addListener (&listener);
+                }
+
+                const double ms = runProducer (numBaselineParams, numRounds, [&notifiers] (int i, int r) {notifiers.getUnchecked (i)->addMessage (Parameter::ParamWithValue (nullptr, r, false));});
+
+                for (auto n : notifiers) {n->handleUpdateNowIfNeeded();}
+
+                const size_t bytesPerParam = sizeof (Notifier) + (size_t) notifiers[0]->getCapacity() * (sizeof (Parameter::ParamWithValue) + sizeof (uint32));
+                logMessage ("queued notifier : ~" + String ((int) bytesPerParam) + " bytes per parameter, "
+                            + String (numBaselineParams * numRounds / ms * 1000.0, 0) + " changes/s, "
+                            + String (listener.numMessages) + " messages delivered");
+            }
+
+            {
+                OwnedArray<FloatParameter> params;
+                CountingAsyncListener listener;
+
+                for (int i = 0 ; i < numParams ; i++)
+                {
+                    params.add (new FloatParameter ("p" + String (i), "", 0, 0, numRounds))->addAsyncParameterListener (&listener);
+                }
+
+                const int64 marked = hub->getNumMarkedChanges();
+                const int64 delivered = hub->getNumDeliveredUpdates();
+                const double ms = runProducer (numParams, numRounds, [&params] (int i, int r) {params.getUnchecked (i)->setValue (r + 1);});
+                hub->flush();
+
+                const int64 numChanges = hub->getNumMarkedChanges() - marked;
+                expectEquals ((int) numChanges, numParams * numRounds);
+                expect (listener.numMessages <= (int) (hub->getNumDeliveredUpdates() - delivered));
+                expect (listener.numMessages >= numParams, "every parameter should be notified");
+                expectEquals ((double) listener.lastValue, (double) numRounds);
+
+                const size_t bytesPerParam = sizeof (Atomic<int>) + sizeof (Parameter*);
+                logMessage ("change hub : " + String ((int) bytesPerParam) + " bytes per parameter, "
+                            + String (numChanges / ms * 1000.0, 0) + " changes/s, "
+                            + String (listener.numMessages) + " messages delivered");
+
+                for (auto p : params) {p->removeAsyncParameterListener (&listener);}
+            }
+        }
+    }
+
+};
+
+
+static ParameterChangeHubTest parameterChangeHubTest;
+
+#endif // unitTest
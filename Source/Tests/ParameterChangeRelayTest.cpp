@@ -0,0 +1,130 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Utils/ParameterChangeRelay.h"
+
+
+class RelayListener : public ParameterChangeRelay::Listener
+{
+public:
+    RelayListener (int numParameters)
+    {
+        for (int i = 0 ; i < numParameters ; i++) {lastValues.add (-1); numReceived.add (0);}
+    }
+
+    void relayedParameterChanged (int index, float value) override
+    {
+        lastValues.set (index, value);
+        numReceived.set (index, numReceived[index] + 1);
+    }
+
+    Array<float> lastValues;
+    Array<int> numReceived;
+};
+
+
+// automation of a plugin : every parameter moved at each block
+class AutomationThread : public Thread
+{
+public:
+    AutomationThread (ParameterChangeRelay& r, int _numBlocks): Thread ("automation"), relay (r), numBlocks (_numBlocks) {}
+
+    void run() override
+    {
+        for (int b = 0 ; b < numBlocks ; b++)
+        {
+            const int64 start = Time::getHighResolutionTicks();
+
+            for (int i = 0 ; i < relay.getNumParameters() ; i++) {relay.post (i, (float) b / numBlocks);}
+
+            maxTicks = jmax (maxTicks, Time::getHighResolutionTicks() - start);
+        }
+    }
+
+    ParameterChangeRelay& relay;
+    const int numBlocks;
+    int64 maxTicks = 0;
+};
+
+
+class ParameterChangeRelayTest: public UnitTest
+{
+public:
+    ParameterChangeRelayTest(): UnitTest ("ParameterChangeRelay")
+    {
+
+    }
+
+    const int numParameters = 512;
+    const int numBlocks = 2000;
+
+    void runTest()override
+    {
+        beginTest ("changes are coalesced per index");
+        {
+            RelayListener listener (numParameters);
+            ParameterChangeRelay relay (listener, numParameters);
+
+            // message thread is stuck in this test, nothing is delivered until flush
+            AutomationThread automation (relay, numBlocks);
+            automation.startThread (9);
+            expect (automation.waitForThreadToExit (10000), "automation thread blocked");
+            logMessage ("max time to post " + String (numParameters) + " changes : " + String (Time::highResolutionTicksToSeconds (automation.maxTicks) * 1000.0, 4) + " ms");
+
+            relay.flush();
+
+            for (int i = 0 ; i < numParameters ; i++)
+            {
+                expectEquals (listener.numReceived[i], 1);
+                expectEquals (listener.lastValues[i], (float) (numBlocks - 1) / numBlocks);
+            }
+
+            // drained indexes can be queued again
+            AutomationThread oneBlock (relay, 1);
+            oneBlock.startThread();
+            expect (oneBlock.waitForThreadToExit (10000), "automation thread blocked");
+            relay.flush();
+
+            expectEquals (listener.numReceived[0], 2);
+            expectEquals (listener.lastValues[0], 0.0f);
+        }
+
+        beginTest ("message thread changes are delivered synchronously");
+        {
+            RelayListener listener (numParameters);
+            ParameterChangeRelay relay (listener, numParameters);
+
+            if (MessageManager::getInstance()->isThisTheMessageThread())
+            {
+                expect (relay.post (3, 0.5f));
+                expectEquals (listener.numReceived[3], 1);
+                expectEquals (listener.lastValues[3], 0.5f);
+            }
+
+            expect (!relay.post (numParameters, 0.5f), "out of range index should be rejected");
+            expect (!relay.post (-1, 0.5f), "out of range index should be rejected");
+        }
+    }
+};
+
+
+static ParameterChangeRelayTest parameterChangeRelayTest;
+
+#endif // unitTest
@@ -0,0 +1,194 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Controllable/Parameter/NumericParameter.h"
+#include "../Controllable/Parameter/BoolParameter.h"
+#include "../Controllable/Parameter/EnumParameter.h"
+#include "../Utils/AudioThread.h"
+
+
+// writes steps of 1/1000 from another thread
+class ParameterWriterThread : public Thread
+{
+public:
+    ParameterWriterThread (FloatParameter& p): Thread ("paramWriter"), param (p), maxWriteMs (0) {}
+
+    void run() override
+    {
+        for (int i = 0 ; i < 100000 && !threadShouldExit() ; i++)
+        {
+            const double start = Time::getMillisecondCounterHiRes();
+            param.setValue ((i % 1001) / 1000.0);
+            maxWriteMs = jmax (maxWriteMs, Time::getMillisecondCounterHiRes() - start);
+        }
+    }
+
+    FloatParameter& param;
+    double maxWriteMs;
+};
+
+
+// writes once from a thread marked as audio thread
+class AudioParameterWriterThread : public Thread
+{
+public:
+    AudioParameterWriterThread (FloatParameter& p, double v): Thread ("audioParamWriter"), param (p), valueToWrite (v) {}
+
+    void run() override
+    {
+        AudioThread::markCurrentThread();
+        param.setValue (valueToWrite);
+    }
+
+    FloatParameter& param;
+    double valueToWrite;
+};
+
+
+// counts synchronous notifications
+class NotificationCounter : public Parameter::Listener
+{
+public:
+    NotificationCounter(): count (0) {}
+    void parameterValueChanged (Parameter*) override {++count;}
+    Atomic<int> count;
+};
+
+
+// sets the parameter again from its own notification
+class ReentrantSetter : public Parameter::Listener
+{
+public:
+    void parameterValueChanged (Parameter* p) override
+    {
+        if (p->floatValue() == 0.5f) p->setValue (0.25);
+    }
+};
+
+
+class ParameterTypedValueTest: public UnitTest
+{
+public:
+    ParameterTypedValueTest(): UnitTest ("ParameterTypedValue")
+    {
+
+    }
+
+    void runTest()override
+    {
+        beginTest ("typed values");
+        {
+            FloatParameter f ("f", "", 0.5, 0, 1);
+            expectEquals (f.floatValue(), 0.5f);
+            f.setValue (2.0);
+            expectEquals (f.floatValue(), 1.0f);
+            expectEquals ((double) f.value, 1.0);
+
+            IntParameter i ("i", "", 3, 0, 10);
+            i.setValue (-4);
+            expectEquals (i.intValue(), 0);
+            i.setValue (7);
+            expectEquals (i.intValue(), 7);
+
+            BoolParameter b ("b", "", true);
+            expect (b.boolValue());
+            b.setValue (false);
+            expect (!b.boolValue());
+
+            EnumParameter e ("e");
+            expectEquals (e.getSelectedIndex(), -1);
+            e.addOption ("a");
+            e.addOption ("b");
+            e.addOption ("c");
+            e.selectId ("b", true);
+            expectEquals (e.getSelectedIndex(), 1);
+            e.unselectAll();
+            expectEquals (e.getSelectedIndex(), -1);
+        }
+
+        beginTest ("reentrant set is deferred");
+        {
+            FloatParameter f ("f", "", 0, 0, 1);
+            ReentrantSetter setter;
+            f.addParameterListener (&setter);
+            f.setValue (0.5);
+            // inner set can't run while the outer one notifies
+            expectEquals (f.floatValue(), 0.5f);
+            expectEquals (f.isSettingValue.get(), 0);
+            f.removeParameterListener (&setter);
+        }
+
+        beginTest ("audio thread writes the typed value only");
+        {
+            FloatParameter f ("f", "", 0.25, 0, 1);
+            AudioParameterWriterThread writer (f, 0.75);
+            writer.startThread();
+            writer.waitForThreadToExit (1000);
+            expectEquals (f.floatValue(), 0.75f);
+            // the var follows on the message thread
+            expectEquals ((double) f.value, 0.25);
+            expectEquals (f.isSettingValue.get(), 0);
+            expect (!AudioThread::isCurrentThread());
+        }
+
+        beginTest ("audio thread writes are limited and notified synchronously");
+        {
+            FloatParameter f ("f", "", 0.25, 0, 1);
+            NotificationCounter counter;
+            f.addParameterListener (&counter);
+            AudioParameterWriterThread writer (f, 2.0);
+            writer.startThread();
+            writer.waitForThreadToExit (1000);
+            expectEquals (f.floatValue(), 1.0f);
+            expectEquals (counter.count.get(), 1);
+            f.removeParameterListener (&counter);
+        }
+
+        beginTest ("concurrent reads");
+        {
+            FloatParameter f ("f", "", 0, 0, 1);
+            ParameterWriterThread writer (f);
+            writer.startThread();
+
+            int numReads = 0, numInvalid = 0;
+
+            while (writer.isThreadRunning())
+            {
+                const double v = f.doubleValue();
+                const double steps = v * 1000.0;
+
+                if (v < 0 || v > 1 || std::abs (steps - std::round (steps)) > 1e-6) numInvalid++;
+
+                numReads++;
+            }
+
+            writer.stopThread (1000);
+            expectEquals (numInvalid, 0);
+            logMessage (String (numReads) + " reads, longest write " + String (writer.maxWriteMs, 3) + " ms");
+        }
+    }
+
+};
+
+
+static ParameterTypedValueTest parameterTypedValueTest;
+
+#endif // unitTest
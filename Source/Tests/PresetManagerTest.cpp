@@ -0,0 +1,155 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Controllable/Parameter/ParameterContainer.h"
+#include "../Controllable/Parameter/NumericParameter.h"
+#include "../Preset/PresetManager.h"
+
+
+class CountingParameterListener : public Parameter::Listener
+{
+public:
+    CountingParameterListener(): numCalls (0) {}
+    void parameterValueChanged (Parameter*) override {numCalls++;}
+    int numCalls;
+};
+
+
+class PresetManagerTest: public UnitTest
+{
+public:
+    PresetManagerTest(): UnitTest ("PresetManager")
+    {
+
+    }
+
+    const int numNodes = 500;
+    const String filter = "presetManagerTest";
+
+    void runTest()override
+    {
+        PresetManager* pm = PresetManager::getInstance();
+        ParameterContainer root ("root");
+        Array<FloatParameter*> gains;
+
+        for (int i = 0 ; i < numNodes ; i++)
+        {
+            auto node = new ParameterContainer ("node " + String (i));
+            root.addChildControllableContainer (node);
+            gains.add (node->addNewParameter<FloatParameter> ("gain", "gain", 0, 0, 1));
+        }
+
+        for (int i = 0 ; i < numNodes ; i++) {gains[i]->setValue (i / (float) numNodes);}
+
+        PresetManager::Preset* pre = pm->addPresetFromControllableContainer ("scene", filter, &root, true);
+
+        for (int i = 0 ; i < numNodes ; i++) {gains[i]->setValue (1 - i / (float) numNodes);}
+
+        PresetManager::Preset* other = pm->addPresetFromControllableContainer ("other", filter, &root, true);
+
+        for (int i = 0 ; i < numNodes ; i++) {gains[i]->setValue (i / (float) numNodes);}
+
+        beginTest ("index");
+        {
+            expect (pm->getPreset (filter, "scene") == pre);
+            expect (pm->getPreset (filter, "unknown") == nullptr);
+            expectEquals (pm->getNumPresetForFilter (filter), 2);
+
+            // saving with the same name replaces values
+            expect (pm->addPresetFromControllableContainer ("scene", filter, &root, true) == pre);
+            expectEquals (pm->getNumPresetForFilter (filter), 2);
+
+            expect (pre->getPresetValue (gains[10]->getControlAddress (&root)) == var (gains[10]->value));
+            expect (pre->getPresetValue ("/node10/unknown").isVoid());
+        }
+
+        beginTest ("batched recall");
+        {
+            CountingParameterListener listener;
+
+            for (auto& g : gains) {g->setValue (1); g->addParameterListener (&listener);}
+
+            root.loadPreset (pre);
+
+            bool allRecalled = true;
+
+            for (int i = 0 ; i < numNodes ; i++) {allRecalled &= gains[i]->floatValue() == i / (float) numNodes;}
+
+            expect (allRecalled, "values not recalled");
+            // notified once per changed parameter, when all values are set
+            expectEquals (listener.numCalls, numNodes);
+
+            listener.numCalls = 0;
+            root.loadPreset (pre);
+            expectEquals (listener.numCalls, 0);
+
+            for (auto& g : gains) {g->removeParameterListener (&listener);}
+        }
+
+        beginTest ("resolution follows structure");
+        {
+            auto node = dynamic_cast<ParameterContainer*> (root.getControllableContainerByName ("node 3"));
+            node->setNiceName ("renamed");
+            gains[3]->setValue (1);
+            gains[4]->setValue (1);
+            root.loadPreset (pre);
+            expectEquals (gains[3]->floatValue(), 1.0f);
+            expectEquals (gains[4]->floatValue(), 4 / (float) numNodes);
+
+            node->setNiceName ("node 3");
+            root.loadPreset (pre);
+            expectEquals (gains[3]->floatValue(), 3 / (float) numNodes);
+        }
+
+        beginTest ("benchmark");
+        {
+            const int numRecalls = 20;
+            double elapsed = 0;
+
+            for (int r = 0 ; r < numRecalls ; r++)
+            {
+                root.loadPreset (other);
+                const double startTime = Time::getMillisecondCounterHiRes();
+                root.loadPreset (pre);
+                elapsed += Time::getMillisecondCounterHiRes() - startTime;
+            }
+
+            logMessage ("recall of " + String (numNodes) + " parameters : " + String (elapsed / numRecalls, 3) + " ms");
+        }
+
+        beginTest ("delete");
+        {
+            expectEquals (pm->deletePresetsForContainer (&root, false), 0);
+            root.currentPreset = nullptr;
+
+            pm->removePreset (other);
+            expectEquals (pm->getNumPresetForFilter (filter), 1);
+            pm->removePreset (pre);
+            expectEquals (pm->getNumPresetForFilter (filter), 0);
+            expect (pm->getPreset (filter, "scene") == nullptr);
+        }
+    }
+
+};
+
+
+static PresetManagerTest presetManagerTest;
+
+#endif // unitTest
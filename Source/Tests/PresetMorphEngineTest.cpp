@@ -0,0 +1,196 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Controllable/Parameter/ParameterContainer.h"
+#include "../Controllable/Parameter/NumericParameter.h"
+#include "../Controllable/Parameter/BoolParameter.h"
+#include "../Controllable/Parameter/Point2DParameter.h"
+#include "../Controllable/Parameter/RangeParameter.h"
+#include "../Controllable/Parameter/ParameterChangeHub.h"
+#include "../Preset/PresetMorphEngine.h"
+
+
+class PresetMorphEngineTest: public UnitTest
+{
+public:
+    PresetMorphEngineTest(): UnitTest ("PresetMorphEngine")
+    {
+
+    }
+
+    const String filter = "presetMorphEngineTest";
+    const int numBenchParameters = 2000;
+
+    void runTest()override
+    {
+        PresetManager* pm = PresetManager::getInstance();
+        PresetMorphEngine* engine = PresetMorphEngine::getInstance();
+        const double sr = engine->getSampleRate();
+
+        ParameterContainer root ("root");
+        auto gain = root.addNewParameter<FloatParameter> ("gain", "gain", 0, 0, 1);
+        auto steps = root.addNewParameter<IntParameter> ("steps", "steps", 0, 0, 100);
+        auto pos = root.addNewParameter<Point2DParameter<float>> ("pos", "pos", 0.f, 0.f);
+        auto range = root.addNewParameter<RangeParameter> ("range", "range", 0.f, 1.f, 0.f, 0.2f);
+        auto mute = root.addNewParameter<BoolParameter> ("mute", "mute", false);
+
+        PresetManager::Preset* a = pm->addPresetFromControllableContainer ("A", filter, &root, true);
+
+        gain->setValue (1);
+        steps->setValue (100);
+        pos->setPoint (1.f, -1.f);
+        range->setValue (Array<var> {0.4, 1.0});
+        mute->setValue (true);
+
+        PresetManager::Preset* b = pm->addPresetFromControllableContainer ("B", filter, &root, true);
+
+        root.loadPreset (a);
+
+        beginTest ("audio rate ramp");
+        {
+            expect (engine->morph (&root, a, b, 1000));
+            expect (engine->isMorphing (&root));
+
+            engine->processBlock ((int) (sr / 2));
+            expectWithinAbsoluteError (engine->getProgress (&root), 0.5, 1e-6);
+            // visible to audio code before any message thread work
+            expectWithinAbsoluteError (gain->floatValue(), 0.5f, 1e-4f);
+            expectEquals (steps->intValue(), 50);
+            expect (mute->boolValue() == false);
+        }
+
+        beginTest ("control rate ramp");
+        {
+            engine->processControlRate();
+            expectWithinAbsoluteError (pos->getX(), 0.5f, 1e-4f);
+            expectWithinAbsoluteError (pos->getY(), -0.5f, 1e-4f);
+            expectWithinAbsoluteError (range->getRangeMin(), 0.2f, 1e-4f);
+            expectWithinAbsoluteError (range->getRangeMax(), 0.6f, 1e-4f);
+
+            ParameterChangeHub::getInstance()->flush();
+            // var and listeners follow the audio value
+            expectWithinAbsoluteError ((float) gain->value, 0.5f, 1e-4f);
+        }
+
+        beginTest ("sample accurate end");
+        {
+            engine->processBlock ((int) (sr / 2) - 1);
+            expect (engine->getProgress (&root) < 1.0);
+            engine->processBlock (1);
+            expectEquals (gain->floatValue(), 1.0f);
+
+            engine->processControlRate();
+            ParameterChangeHub::getInstance()->flush();
+
+            expect (!engine->isMorphing (&root));
+            expect (root.currentPreset == b);
+            expectEquals (steps->intValue(), 100);
+            expectEquals (pos->getY(), -1.0f);
+            // non morphable parameters jump at the end
+            expect (mute->boolValue());
+        }
+
+        beginTest ("cancel");
+        {
+            root.loadPreset (a);
+            expect (engine->morph (&root, nullptr, b, 1000));
+            engine->processBlock ((int) (sr / 4));
+            engine->cancel (&root);
+            engine->processBlock ((int) (sr / 4));
+            engine->processControlRate();
+            ParameterChangeHub::getInstance()->flush();
+
+            expect (!engine->isMorphing (&root));
+            expectWithinAbsoluteError (gain->floatValue(), 0.25f, 1e-4f);
+            expect (root.currentPreset == a);
+            expect (mute->boolValue() == false);
+        }
+
+        beginTest ("removed parameters cancel their morphs");
+        {
+            ScopedPointer<ParameterContainer> temp (new ParameterContainer ("temp"));
+            auto g = temp->addNewParameter<FloatParameter> ("g", "g", 0, 0, 1);
+            PresetManager::Preset* from = pm->addPresetFromControllableContainer ("from", filter, temp, true);
+            g->setValue (1);
+            PresetManager::Preset* to = pm->addPresetFromControllableContainer ("to", filter, temp, true);
+
+            expect (engine->morph (temp, from, to, 1000));
+            temp->removeControllable (g);
+            expect (!engine->isMorphing (temp));
+
+            auto g2 = temp->addNewParameter<FloatParameter> ("g", "g", 0, 0, 1);
+            g2->setValue (0);
+            expect (engine->morph (temp, from, to, 1000));
+            temp = nullptr;
+            // would write to deleted parameters
+            engine->processBlock ((int) (sr / 4));
+            engine->processControlRate();
+
+            pm->removePreset (from);
+            pm->removePreset (to);
+        }
+
+        beginTest ("benchmark");
+        {
+            ParameterContainer big ("big");
+            Array<FloatParameter*> gains;
+
+            for (int i = 0 ; i < numBenchParameters ; i++) {gains.add (big.addNewParameter<FloatParameter> ("gain" + String (i), "gain", 0, 0, 1));}
+
+            PresetManager::Preset* low = pm->addPresetFromControllableContainer ("low", filter, &big, true);
+
+            for (auto& g : gains) {g->setValue (1);}
+
+            PresetManager::Preset* high = pm->addPresetFromControllableContainer ("high", filter, &big, true);
+
+            const int blockSize = 512;
+            const int numBlocks = (int) (sr / blockSize);
+            expect (engine->morph (&big, low, high, numBlocks * blockSize * 1000.0 / sr));
+
+            const double startTime = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0 ; i < numBlocks ; i++) {engine->processBlock (blockSize);}
+
+            const double elapsed = Time::getMillisecondCounterHiRes() - startTime;
+
+            engine->processControlRate();
+            ParameterChangeHub::getInstance()->flush();
+            expect (!engine->isMorphing (&big));
+            expectEquals (gains.getLast()->floatValue(), 1.0f);
+
+            logMessage ("morph of " + String (numBenchParameters) + " parameters : " + String (elapsed * 1000.0 / numBlocks, 2)
+                        + " us per " + String (blockSize) + " samples block");
+
+            big.currentPreset = nullptr;
+            pm->removePreset (low);
+            pm->removePreset (high);
+        }
+
+        root.currentPreset = nullptr;
+        pm->removePreset (a);
+        pm->removePreset (b);
+    }
+
+};
+
+
+static PresetMorphEngineTest presetMorphEngineTest;
+
+#endif // unitTest
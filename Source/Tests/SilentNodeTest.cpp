@@ -0,0 +1,94 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Node/Impl/AudioMixerNode.h"
+
+
+class SilentNodeTest: public UnitTest
+{
+public:
+    SilentNodeTest(): UnitTest ("SilentNodeTest")
+    {
+
+    }
+
+    ScopedPointer<AudioMixerNode> mixer;
+    AudioBuffer<float> testBuffer;
+    MidiBuffer midi;
+
+    const int blockSize = 256;
+    const int sampleRate = 44100;
+
+    void processSilentBlock()
+    {
+        testBuffer.clear();
+        mixer->processBlock (testBuffer, midi);
+    }
+
+    void processNoiseBlock()
+    {
+        for (int c = 0 ; c < testBuffer.getNumChannels() ; c++)
+        {
+            for (int i = 0 ; i < blockSize ; i++) {testBuffer.setSample (c, i, 0.5f * (float) ((i % 7) - 3) / 3.0f);}
+        }
+
+        mixer->processBlock (testBuffer, midi);
+    }
+
+    void runTest()override
+    {
+        mixer = new AudioMixerNode();
+        mixer->setPlayConfigDetails (2, 2, sampleRate, blockSize);
+        testBuffer.setSize (2, blockSize);
+
+        beginTest ("silent inputs are skipped after tail");
+        {
+            processNoiseBlock();
+            expectEquals (mixer->getNumSkippedBlocks(), 0);
+
+            // first silent block is still processed to flush the node
+            processSilentBlock();
+            expectEquals (mixer->getNumSkippedBlocks(), 0);
+
+            for (int i = 0 ; i < 10 ; i++) {processSilentBlock();}
+
+            expectEquals (mixer->getNumSkippedBlocks(), 10);
+            expect (testBuffer.hasBeenCleared(), "skipped block should output a cleared buffer");
+        }
+
+        beginTest ("non silent input wakes up the node");
+        {
+            processNoiseBlock();
+            expectEquals (mixer->getNumSkippedBlocks(), 10);
+            expect (testBuffer.getMagnitude (0, blockSize) > 0, "mixer should output signal");
+
+            processSilentBlock();
+            expectEquals (mixer->getNumSkippedBlocks(), 10);
+        }
+
+        mixer = nullptr;
+    }
+};
+
+
+static SilentNodeTest silentNodeTest;
+
+#endif // unitTest
@@ -0,0 +1,154 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+
+#if LGML_UNIT_TESTS
+#include  "JuceHeader.h"
+#include "../Node/Impl/Spat2DNode.h"
+
+
+class Spat2DNodeTest: public UnitTest
+{
+public:
+    Spat2DNodeTest(): UnitTest ("Spat2DNode")
+    {
+
+    }
+
+    static const int numSources = 8;
+    static const int numTargets = 16;
+    static const int blockSize = 512;
+
+    ScopedPointer<Spat2DNode> spat;
+    AudioBuffer<float> buffer;
+    MidiBuffer midi;
+
+    // sources turning around the center at different speeds
+    Point<float> getSourcePosition (int source, int block)
+    {
+        const float angle = (source * 1.0f / numSources + block * (source + 1) * 0.002f) * float_Pi * 2;
+        return Point<float> (.5f + cosf (angle) * .3f, .5f + sinf (angle) * .3f);
+    }
+
+    void moveSources (int block)
+    {
+        for (int s = 0 ; s < numSources ; s++) {spat->setSourcePosition (s, getSourcePosition (s, block));}
+    }
+
+    // each source is a constant so that outputs are the sum of gains
+    float getSourceLevel (int source) {return 1.0f / (source + 1);}
+
+    void render()
+    {
+        buffer.clear();
+
+        for (int s = 0 ; s < numSources ; s++) {FloatVectorOperations::fill (buffer.getWritePointer (s), getSourceLevel (s), blockSize);}
+
+        spat->processBlockInternal (buffer, midi);
+    }
+
+    float getExpectedGain (int source, int target, int block)
+    {
+        return spat->getValueForSourceAndTargetPos (getSourcePosition (source, block), spat->targetPositions[target]->getPoint(), spat->targetRadius->floatValue());
+    }
+
+    float getExpectedOutput (int target, int block)
+    {
+        float v = 0;
+
+        for (int s = 0 ; s < numSources ; s++) {v += getSourceLevel (s) * getExpectedGain (s, target, block);}
+
+        return v;
+    }
+
+    void runTest()override
+    {
+        spat = new Spat2DNode();
+        spat->numSpatInputs->setValue (numSources);
+        spat->numSpatOutputs->setValue (numTargets);
+        spat->shapeMode->setValue ("Circle");
+        spat->setPlayConfigDetails (numSources, numTargets + 2, 44100, blockSize);
+        buffer.setSize (numTargets + 2, blockSize);
+
+        expectEquals (spat->getTotalNumInputData(), numSources);
+        expectEquals (spat->getTotalNumOutputData(), numTargets);
+
+        beginTest ("gains of all sources");
+        {
+            moveSources (0);
+            // first block ramps from silence
+            render();
+            render();
+
+            for (int t = 0 ; t < numTargets ; t++)
+            {
+                const float expected = getExpectedOutput (t, 0);
+                expectWithinAbsoluteError (buffer.getSample (t + 2, 0), expected, 1e-4f);
+                expectWithinAbsoluteError (buffer.getSample (t + 2, blockSize - 1), expected, 1e-4f);
+
+                float maxGain = 0;
+
+                for (int s = 0 ; s < numSources ; s++) {maxGain = jmax (maxGain, getExpectedGain (s, t, 0));}
+
+                expectWithinAbsoluteError ((float) spat->getOutputData (t)->elements[0]->value, maxGain, 1e-4f);
+            }
+        }
+
+        beginTest ("moving sources are ramped");
+        {
+            moveSources (10);
+            render();
+
+            for (int t = 0 ; t < numTargets ; t++)
+            {
+                const float from = getExpectedOutput (t, 0);
+                const float to = getExpectedOutput (t, 10);
+                const float* d = buffer.getReadPointer (t + 2);
+                float maxStep = 0;
+
+                for (int i = 1 ; i < blockSize ; i++) {maxStep = jmax (maxStep, std::abs (d[i] - d[i - 1]));}
+
+                expectWithinAbsoluteError (d[0], from, 1e-4f);
+                expectWithinAbsoluteError (d[blockSize - 1], to, std::abs (to - from) / blockSize + 1e-4f);
+                expect (maxStep <= std::abs (to - from) / blockSize + 1e-4f, "gain change should be spread over the block");
+            }
+        }
+
+        beginTest ("performance");
+        {
+            const int numBlocks = 1000;
+            const double startTime = Time::getMillisecondCounterHiRes();
+
+            for (int b = 0 ; b < numBlocks ; b++)
+            {
+                moveSources (b);
+                render();
+            }
+
+            const double time = (Time::getMillisecondCounterHiRes() - startTime) / numBlocks;
+            logMessage (String (numSources) + " moving sources x " + String (numTargets) + " targets : " + String (time * 1000.0, 1) + " us/block");
+        }
+
+        spat = nullptr;
+    }
+};
+
+
+static Spat2DNodeTest spat2DNodeTest;
+
+#endif // unitTest
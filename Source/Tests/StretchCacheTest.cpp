@@ -0,0 +1,124 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include "../Audio/StretchCache.h"
+
+
+class StretchCacheTest: public UnitTest
+{
+public:
+    StretchCacheTest(): UnitTest ("StretchCache")
+    {
+
+    }
+
+    AudioSampleBuffer makeRender (int numSamples, float value)
+    {
+        AudioSampleBuffer b (2, numSamples);
+
+        for (int c = 0 ; c < b.getNumChannels() ; c++) {FloatVectorOperations::fill (b.getWritePointer (c), value, numSamples);}
+
+        return b;
+    }
+
+    void runTest()override
+    {
+        const int numSamples = 1000;
+        const int64 renderBytes = 2 * numSamples * sizeof (float);
+        Array<int> onsets;
+        onsets.add (10);
+        onsets.add (500);
+
+        beginTest ("hits and revisions");
+        {
+            StretchCache cache (renderBytes * 4);
+            cache.setSourceRevision (1);
+            AudioSampleBuffer render;
+            Array<int> foundOnsets;
+
+            expect (!cache.lookUp (0.5, 1, render, foundOnsets));
+            cache.add (0.5, 1, makeRender (numSamples, 0.5f), onsets);
+            expect (cache.lookUp (0.5, 1, render, foundOnsets));
+            expectEquals (render.getNumSamples(), numSamples);
+            expectEquals (render.getSample (1, 20), 0.5f);
+            expect (foundOnsets == onsets);
+
+            // same ratio computed with another bpm pair
+            expect (cache.lookUp (120.0 / 240.0 * (1 + 1e-12), 1, render, foundOnsets));
+
+            // outdated job result is ignored
+            cache.add (2.0, 0, makeRender (numSamples, 2.0f), onsets);
+            expect (!cache.lookUp (2.0, 1, render, foundOnsets));
+
+            cache.setSourceRevision (2);
+            expectEquals (cache.getNumEntries(), 0);
+            expect (!cache.lookUp (0.5, 2, render, foundOnsets));
+
+            expectEquals (cache.getNumHits(), 2);
+            expectEquals (cache.getNumMisses(), 3);
+            expectWithinAbsoluteError (cache.getHitRate(), 0.4f, 1e-6f);
+        }
+
+        beginTest ("least recently used eviction");
+        {
+            StretchCache cache (renderBytes * 3);
+            AudioSampleBuffer render;
+            Array<int> foundOnsets;
+
+            cache.add (0.5, 0, makeRender (numSamples, 0.5f), onsets);
+            cache.add (0.75, 0, makeRender (numSamples, 0.75f), onsets);
+            cache.add (1.5, 0, makeRender (numSamples, 1.5f), onsets);
+            expectEquals (cache.getUsedBytes(), renderBytes * 3);
+
+            // 0.75 becomes the oldest
+            expect (cache.lookUp (0.5, 0, render, foundOnsets));
+            cache.add (2.0, 0, makeRender (numSamples, 2.0f), onsets);
+
+            expectEquals (cache.getNumEntries(), 3);
+            expect (!cache.lookUp (0.75, 0, render, foundOnsets));
+            expect (cache.lookUp (0.5, 0, render, foundOnsets));
+            expect (cache.lookUp (2.0, 0, render, foundOnsets));
+            expectEquals (render.getSample (0, 0), 2.0f);
+
+            // re-adding a ratio replaces it
+            cache.add (2.0, 0, makeRender (numSamples, 3.0f), onsets);
+            expectEquals (cache.getNumEntries(), 3);
+            expect (cache.lookUp (2.0, 0, render, foundOnsets));
+            expectEquals (render.getSample (0, 0), 3.0f);
+
+            cache.setMemoryBudget (renderBytes);
+            expectEquals (cache.getNumEntries(), 1);
+            expect (cache.lookUp (2.0, 0, render, foundOnsets));
+
+            // bigger than budget
+            cache.add (4.0, 0, makeRender (numSamples * 2, 4.0f), onsets);
+            expect (!cache.lookUp (4.0, 0, render, foundOnsets));
+            expectEquals (cache.getNumEntries(), 1);
+
+            cache.setMemoryBudget (0);
+            expectEquals (cache.getUsedBytes(), (int64) 0);
+        }
+    }
+
+};
+
+
+static StretchCacheTest stretchCacheTest;
+
+#endif // unitTest
@@ -0,0 +1,120 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#if LGML_UNIT_TESTS
+#include "../Audio/PlayableBuffer.h"
+
+#if BUFFER_CAN_STRETCH
+#include "../Audio/StretcherJob.h"
+
+
+class StretcherJobTest: public UnitTest
+{
+public:
+    StretcherJobTest(): UnitTest ("StretcherJob")
+    {
+
+    }
+
+    const int sampleRate = 44100;
+    const double ratio = 1.25;
+
+    // tone with a click every half second
+    void fillOrigin (AudioSampleBuffer& b, int numSamples)
+    {
+        b.setSize (2, numSamples);
+
+        for (int i = 0 ; i < numSamples ; i++)
+        {
+            float v = 0.3f * (float) std::sin (2.0 * double_Pi * 220.0 * i / sampleRate);
+
+            if (i % (sampleRate / 2) < 200) v += 0.6f * (1.0f - (i % (sampleRate / 2)) / 200.0f);
+
+            b.setSample (0, i, v);
+            b.setSample (1, i, -v);
+        }
+    }
+
+    float getRMS (const AudioSampleBuffer& b)
+    {
+        return b.getRMSLevel (0, 0, b.getNumSamples());
+    }
+
+    void runTest()override
+    {
+        ThreadPool pool (4);
+
+        for (int seconds : {4, 16, 32})
+        {
+            beginTest ("stretch " + String (seconds) + "s loop");
+            const int numSamples = seconds * sampleRate;
+            PlayableBuffer pb (2, numSamples, (float) sampleRate, 256);
+            fillOrigin (pb.originAudioBuffer, numSamples);
+            pb.originChanged();
+            float serialRMS = 0;
+
+            for (int numWorkers : {1, 4})
+            {
+                StretcherJob job (&pb, ratio, &pool, numWorkers);
+                const double startTime = Time::getMillisecondCounterHiRes();
+                double firstPublished = -1;
+                int lastWatermark = 0;
+                bool watermarkIncreases = true;
+                pool.addJob (&job, false);
+
+                while (pool.contains (&job))
+                {
+                    const int watermark = pb.getStretchWatermark();
+
+                    if (watermark > 0 && firstPublished < 0) firstPublished = Time::getMillisecondCounterHiRes() - startTime;
+
+                    watermarkIncreases &= watermark >= lastWatermark;
+                    lastWatermark = watermark;
+                    Thread::sleep (1);
+                }
+
+                const double elapsed = Time::getMillisecondCounterHiRes() - startTime;
+                const int targetLength = (int) (numSamples * ratio);
+
+                expect (pb.isStretchReady, "stretch not committed");
+                expect (watermarkIncreases, "published samples went back");
+                expectEquals (pb.getStretchWatermark(), targetLength);
+                expectEquals (pb.stretchedBlockList.getNumSamples(), targetLength);
+
+                const float rms = getRMS (pb.stretchedBlockList.getContiguousBuffer (0, targetLength));
+
+                if (numWorkers == 1) serialRMS = rms;
+                // seams crossfades shouldn't change the level
+                else expectWithinAbsoluteError (rms / serialRMS, 1.0f, 0.1f);
+
+                logMessage (String (seconds) + "s loop, " + String (numWorkers) + " workers, "
+                            + String (job.getNumSegments()) + " segments : " + String (elapsed, 1) + " ms, first samples playable after "
+                            + String (firstPublished, 1) + " ms");
+            }
+        }
+
+        pool.removeAllJobs (true, 1000);
+    }
+
+};
+
+
+static StretcherJobTest stretcherJobTest;
+
+#endif
+#endif // unitTest
@@ -37,6 +37,7 @@ juce_ImplementSingleton (TimeManager);
 #include "../Node/NodeBase.h"
 #include "../Utils/DebugHelpers.h"
 #include "../Audio/AudioHelpers.h"
+#include "../Utils/AudioThread.h"
 
 
 
@@ -351,6 +352,8 @@ void TimeManager::audioDeviceIOCallback (const float** /*inputChannelData*/,
                                          int numOutputChannels,
                                          int numSamples)
 {
+    // first callback of the device thread
+    AudioThread::markCurrentThread();
 
     if (click->boolValue() && timeState.isPlaying && timeState.time >= 0)
     {
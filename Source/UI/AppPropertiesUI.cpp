@@ -40,6 +40,18 @@ public:
 
 };
 
+template<class FunctionType>
+class BoolCallbackPropUI : public BoolPropUI{
+public:
+    BoolCallbackPropUI(const String & _name,FunctionType f):BoolPropUI(_name),func(f){}
+    void setState(bool b)  override{
+        BoolPropUI::setState(b);
+        func(b);
+    }
+    FunctionType func;
+
+};
+
 template<class FunctionType>
 class BoolUnsavedPropUI : public BooleanPropertyComponent{
 public:
@@ -86,6 +98,11 @@ namespace{
         return new ActionPropUI<FunctionType>(n,f);
     }
 
+    template<class FunctionType>
+    BooleanPropertyComponent* createCallbackPropUI(const String & n, FunctionType f){
+        return new BoolCallbackPropUI<FunctionType>(n,f);
+    }
+
     template<class FunctionType>
     BooleanPropertyComponent* createUnsavedPropUI(const String & n, FunctionType f,bool defaultV = false){
         return new BoolUnsavedPropUI<FunctionType>(n,f,defaultV);
@@ -108,8 +125,36 @@ namespace{
         auto engine = getEngine();
         engine->stimulateAudio (b);
     }
+    void setMultiThreadedAudio(bool b){
+        ParallelAudioGraph::setMultiThreadingEnabled (b);
+    }
 }
 
+class AudioPrefPage : public Component{
+public:
+    AudioPrefPage(){
+        deviceSelector = new AudioDeviceSelectorComponent (getAudioDeviceManager(),
+                                                           0, 256,
+                                                           0, 256,
+                                                           false, false, false, false);
+        addAndMakeVisible(deviceSelector);
+        properties = new PropertyPanel();
+        properties->addProperties(
+                                  {
+                                      createCallbackPropUI("multiThreadedAudio",setMultiThreadedAudio),
+                                  } );
+        addAndMakeVisible(properties);
+    }
+    void resized() override{
+        auto area = getLocalBounds();
+        properties->setBounds(area.removeFromBottom(properties->getTotalContentHeight()));
+        deviceSelector->setBounds(area);
+    }
+
+    ScopedPointer<AudioDeviceSelectorComponent> deviceSelector;
+    ScopedPointer<PropertyPanel> properties;
+};
+
 class PrefPanel : public PreferencesPanel{
     Component* createComponentForPage (const String& pageName)override{
         if(pageName==AppPropertiesUI::GeneralPageName){
@@ -122,13 +167,7 @@ class PrefPanel : public PreferencesPanel{
             return res;
         }
         else if (pageName==AppPropertiesUI::AudioPageName){
-            auto* audioSettingsComp = new AudioDeviceSelectorComponent (getAudioDeviceManager(),
-                                                                        0, 256,
-                                                                        0, 256,
-                                                                        false, false, false, false);
-            return audioSettingsComp;
-
-
+            return new AudioPrefPage();
         }
 
         else if(pageName==AppPropertiesUI::AdvancedPageName){
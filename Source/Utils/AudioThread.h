@@ -0,0 +1,41 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#ifndef AUDIOTHREAD_H_INCLUDED
+#define AUDIOTHREAD_H_INCLUDED
+#pragma once
+
+// threads rendering audio mark themselves once so that shared code (parameters, notifiers)
+// can avoid allocating or waiting when called from them
+// thread_local : marking and checking never allocate nor lock
+
+namespace AudioThread
+{
+inline bool& getFlag()
+{
+    static thread_local bool flag = false;
+    return flag;
+}
+
+// call from the audio callback or from a render worker, cheap enough to call every block
+inline void markCurrentThread() { getFlag() = true; }
+
+inline bool isCurrentThread() { return getFlag(); }
+}
+
+#endif  // AUDIOTHREAD_H_INCLUDED
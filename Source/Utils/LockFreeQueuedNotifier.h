@@ -0,0 +1,228 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#ifndef LOCKFREEQUEUEDNOTIFIER_H_INCLUDED
+#define LOCKFREEQUEUEDNOTIFIER_H_INCLUDED
+#pragma once
+
+#include "QueuedNotifier.h"
+#include <type_traits>
+
+/*
+ LockFreeQueuedNotifier is a variant of QueuedNotifier that can be fed from real-time threads, without coalesced listeners
+
+ messages are copied in place in a preallocated ring of slots (no new / delete per message)
+ writing to the ring only uses atomics : when the ring is full, the newest message is dropped and counted
+ the ring is multi-producer / single-consumer (message thread), singleProducer mode skips the CAS on write index
+
+ the consumer is woken up by triggerAsyncUpdate : it allocates nothing (AsyncUpdater message is preallocated)
+ but the first call after each delivery posts to the JUCE message queue, which takes the platform queue lock
+ later calls are a single atomic check until the message thread has handled the update
+
+ slots are only allocated when the first listener is added, so unobserved objects stay lightweight
+ Listener type is the same as QueuedNotifier one, so listeners work with both
+ */
+
+template<typename MessageClass>
+class LockFreeQueuedNotifier: public  AsyncUpdater
+{
+public:
+    typedef typename QueuedNotifier<MessageClass>::Listener Listener;
+
+    LockFreeQueuedNotifier (int _capacity, bool _singleProducer = false):
+        capacity (nextPowerOfTwo (jmax (2, _capacity))),
+        singleProducer (_singleProducer),
+        dequeuePos (0)
+    {
+    }
+
+    virtual ~LockFreeQueuedNotifier()
+    {
+        cancelPendingUpdate();
+
+        if (ringReady.get())
+        {
+            while (popNext (false)) {}
+        }
+    }
+
+
+    // returns false if message has been dropped (ring full)
+    bool addMessage (const MessageClass& msg, bool forceSendNow = false)
+    {
+        if (!ringReady.get() || listeners.size() == 0)
+            return true;
+
+        if (!forceSendNow)
+        {
+            MessageManager* mm = MessageManager::getInstanceWithoutCreating();
+            forceSendNow = mm != nullptr && mm->isThisTheMessageThread();
+        }
+
+        if (forceSendNow)
+        {
+            listeners.call (&Listener::newMessage, msg);
+            return true;
+        }
+
+        bool added = true;
+
+        if (!push (msg))
+        {
+            ++numDroppedMessages;
+            added = false;
+        }
+
+        triggerAsyncUpdate();
+        return added;
+    }
+
+
+
+    // listeners get every message that was not dropped, in order
+    void addListener (Listener* newListener)
+    {
+        allocateRingIfNeeded();
+        listeners.add (newListener);
+    }
+
+    void removeListener (Listener* listener) { listeners.remove (listener); }
+
+    int getCapacity() const noexcept {return capacity;}
+    int getNumDroppedMessages() const noexcept {return numDroppedMessages.get();}
+    void resetDroppedMessagesCount() {numDroppedMessages = 0;}
+
+private:
+
+    typedef typename std::aligned_storage<sizeof (MessageClass), alignof (MessageClass)>::type MessageStorage;
+
+    struct Slot
+    {
+        Atomic<uint32> sequence;
+        MessageStorage storage;
+        MessageClass& get() {return *reinterpret_cast<MessageClass*> (&storage);}
+    };
+
+
+    void allocateRingIfNeeded()
+    {
+        const SpinLock::ScopedLockType lk (allocationLock);
+
+        if (ringReady.get())
+            return;
+
+        slots.allocate ((size_t) capacity, false);
+
+        for (int i = 0 ; i < capacity ; i++)
+        {
+            new (slots + i) Slot();
+            slots[i].sequence = (uint32) i;
+        }
+
+        ringReady = 1;
+    }
+
+    // bounded MPSC ring : each slot sequence tells if it is free for position pos (== pos) or readable (== pos + 1)
+    bool push (const MessageClass& msg)
+    {
+        uint32 pos = enqueuePos.get();
+        Slot* slot;
+
+        for (;;)
+        {
+            slot = &slots[(int) (pos & (uint32) (capacity - 1))];
+            const int32 diff = (int32) (slot->sequence.get() - pos);
+
+            if (diff == 0)
+            {
+                if (singleProducer)
+                {
+                    enqueuePos = pos + 1;
+                    break;
+                }
+
+                if (enqueuePos.compareAndSetBool (pos + 1, pos))
+                    break;
+
+                pos = enqueuePos.get();
+            }
+            else if (diff < 0)
+            {
+                // full
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos.get();
+            }
+        }
+
+        new (&slot->storage) MessageClass (msg);
+        slot->sequence = pos + 1;
+        return true;
+    }
+
+    // consumer only
+    bool popNext (bool notify)
+    {
+        Slot& slot = slots[(int) (dequeuePos & (uint32) (capacity - 1))];
+
+        // not written yet, or being written : producer will trigger a new update
+        if ((int32) (slot.sequence.get() - (dequeuePos + 1)) < 0)
+            return false;
+
+        if (notify) {listeners.call (&Listener::newMessage, slot.get());}
+
+        slot.get().~MessageClass();
+        slot.sequence = dequeuePos + (uint32) capacity;
+        ++dequeuePos;
+        return true;
+    }
+
+
+    void handleAsyncUpdate() override
+    {
+        if (ringReady.get())
+        {
+            // only deliver what was there when we started, so fast producers can't stall message thread
+            for (int i = 0 ; i < capacity ; i++)
+            {
+                if (!popNext (true)) break;
+            }
+        }
+    }
+
+
+    const int capacity;
+    const bool singleProducer;
+
+    HeapBlock<Slot> slots;
+    Atomic<int> ringReady;
+    SpinLock allocationLock;
+
+    Atomic<uint32> enqueuePos;
+    uint32 dequeuePos;
+    Atomic<int> numDroppedMessages;
+
+    ListenerList<Listener > listeners;
+
+    JUCE_DECLARE_NON_COPYABLE (LockFreeQueuedNotifier)
+};
+
+
+#endif  // LOCKFREEQUEUEDNOTIFIER_H_INCLUDED
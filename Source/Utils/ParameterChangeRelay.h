@@ -0,0 +1,112 @@
+/*
+ ==============================================================================
+
+ Copyright © Organic Orchestra, 2017
+
+ This file is part of LGML. LGML is a software to manipulate sound in realtime
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation (version 3 of the License).
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ ==============================================================================
+ */
+
+#ifndef PARAMETERCHANGERELAY_H_INCLUDED
+#define PARAMETERCHANGERELAY_H_INCLUDED
+#pragma once
+
+#include "LockFreeQueuedNotifier.h"
+
+/*
+ ParameterChangeRelay brings indexed parameter changes from any thread (i.e plugin automation on the audio thread) to the message thread
+
+ values are coalesced per index in preallocated atomics : only the last value written before the message thread drains is delivered
+ an index is queued in a lock-free ring only when it is not already pending, so the ring (one slot per index) can't overflow
+ posting never allocates, changes posted from the message thread are delivered synchronously
+ a newly pending index wakes the message thread through the queue, which may take the JUCE message queue lock (see LockFreeQueuedNotifier)
+ */
+
+class ParameterChangeRelay : private LockFreeQueuedNotifier<int>::Listener
+{
+public:
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+        // message thread
+        virtual void relayedParameterChanged (int index, float value) = 0;
+    };
+
+    ParameterChangeRelay (Listener& _listener, int _numParameters):
+        listener (_listener),
+        numParameters (jmax (0, _numParameters)),
+        queue (jmax (1, _numParameters))
+    {
+        values.allocate ((size_t) jmax (1, numParameters), false);
+        pending.allocate ((size_t) jmax (1, numParameters), false);
+
+        for (int i = 0 ; i < numParameters ; i++)
+        {
+            new (values + i) Atomic<float> (0.0f);
+            new (pending + i) Atomic<int> (0);
+        }
+
+        // ring is allocated here, never from the posting thread
+        queue.addListener (this);
+    }
+
+    ~ParameterChangeRelay()
+    {
+        queue.removeListener (this);
+    }
+
+    // any thread, returns false if index is out of range
+    bool post (int index, float value)
+    {
+        if (!isPositiveAndBelow (index, numParameters)) return false;
+
+        values[index] = value;
+
+        // already queued, the newest value will be read when dequeued
+        if (!pending[index].compareAndSetBool (1, 0)) return true;
+
+        if (!queue.addMessage (index))
+        {
+            // can't happen as each index is queued once at most
+            jassertfalse;
+            pending[index] = 0;
+            return false;
+        }
+
+        return true;
+    }
+
+    // delivers pending changes now, message thread only
+    void flush() {queue.handleUpdateNowIfNeeded();}
+
+    int getNumParameters() const noexcept {return numParameters;}
+
+private:
+    void newMessage (const int& index) override
+    {
+        // cleared before reading so that a value posted meanwhile queues the index again
+        pending[index] = 0;
+        listener.relayedParameterChanged (index, values[index].get());
+    }
+
+    Listener& listener;
+    const int numParameters;
+    HeapBlock<Atomic<float>> values;
+    HeapBlock<Atomic<int>> pending;
+    LockFreeQueuedNotifier<int> queue;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterChangeRelay)
+};
+
+
+#endif  // PARAMETERCHANGERELAY_H_INCLUDED